@@ -42,8 +42,8 @@
 #include "cavity3d_swap_kernel.inc"
 // Provide macroscopic initial conditions
 void SetInitialMacrosVars() {
-    for (auto idBlock : g_Block()) {
-        Block& block{idBlock.second};
+    for (const auto& idBlock : g_Block()) {
+        const Block& block{idBlock.second};
         std::vector<int> iterRng;
         iterRng.assign(block.WholeRange().begin(), block.WholeRange().end());
         const int blockIdx{block.ID()};
@@ -60,8 +60,8 @@ void SetInitialMacrosVars() {
                                      1, LOCALSTENCIL, "Real", OPS_RW),
                          ops_arg_dat(g_MacroVars().at(compo.wId).at(blockIdx),
                                      1, LOCALSTENCIL, "Real", OPS_RW),
-                         ops_arg_dat(g_CoordinateXYZ()[blockIdx], SpaceDim(),
-                                     LOCALSTENCIL, "Real", OPS_READ),
+                         ops_arg_gbl(block.Grid(), block.GridSize(), "Real",
+                                     OPS_READ),
                          ops_arg_idx());
         }
     }
@@ -81,6 +81,17 @@ void simulate(const Configuration& config) {
     DefineCollision(config.CollisionTypes, config.CollisionCompoIds);
     DefineBodyForce(config.bodyForceTypes, config.bodyForceCompoIds);
     DefineScheme(config.schemeType);
+    DefineTiling(config.tileOrder, config.tileSize);
+    DefineMacroVarsLayout(config.macroVarsLayout);
+    DefinePopulationStorage(config.populationStorage);
+    DefineSnapshotCompression(config.snapshotCompression, config.deflateLevel,
+                              config.snapshotTolerance);
+    DefineSnapshotLayout(config.snapshotLayout, config.stripeSize);
+    DefineXdmfSidecar(config.xdmfSidecar);
+    DefineProbes(config.probes, config.probePeriod, config.probeBufferSize,
+                 config.currentTimeStep);
+    DefineStatistics(config.statisticsPeriod, config.currentTimeStep);
+    DefineSlices(config.slices, config.spaceDim);
     DefineInitialCondition(config.initialTypes, config.initialConditionCompoId);
     for (auto& bcConfig : config.blockBoundaryConfig) {
         DefineBlockBoundary(bcConfig.blockIndex, bcConfig.componentID,
@@ -116,11 +127,22 @@ int main(int argc, const char** argv) {
     // start a new simulaton from a configuration file
     if (configFileFound) {
         ReadConfiguration(configFileName);
-        simulate(Config());
+        // DryRun=<GB per rank> only projects the memory of the configuration
+        bool dryRun{false};
+        Real memoryBudget{0};
+        int rankNum{1};
+        GetDryRunFromCmd(dryRun, memoryBudget, rankNum, argc, argv);
+        if (dryRun) {
+            EstimateMemory(Config(), memoryBudget, rankNum);
+        } else {
+            simulate(Config());
+        }
     }
     ops_timers(&ct1, &et1);
     ops_printf("\nTotal Wall time %lf\n", et1 - et0);
     // Print OPS performance details to output stream
     ops_timing_output(std::cout);
     ops_exit();
+    // The fields moved into the arena are not freed by OPS
+    ReleaseFieldArena();
 }
\ No newline at end of file
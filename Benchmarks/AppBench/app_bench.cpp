@@ -0,0 +1,472 @@
+/**
+ * Copyright 2019 United Kingdom Research and Innovation
+ *
+ * Authors: See AUTHORS
+ *
+ * Contact: [jianping.meng@stfc.ac.uk and/or jpmeng@gmail.com]
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * ANDANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @brief End-to-end benchmark of the lid-driven cavity flow
+ *  @details One case of the benchmark matrix is run per call. The cavity is
+ *  split into slabs along x when more than one block is asked for, and after
+ *  a number of warm-up steps the throughput (MLUPS), the time spent in each
+ *  phase of a time step and the peak resident memory are appended to a CSV
+ *  file, together with the mean kinetic energy at the end of the run so that
+ *  a case with compressed populations can be validated against the double
+ *  one. The case is given on the command line as key=value pairs:
+ *  size=64 lattice=d3q19 scheme=stream|swap storage=double|compressed16
+ *  tiling=none|morton|hilbert tile=16 blocks=1 steps=100 warm=10
+ *  output=app_bench.csv, where a 3D case can be traversed in tiles of tile x
+ *  tile nodes, see DefineTiling(). Use run_matrix.py to sweep the matrix.
+ **/
+#include <sys/resource.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+#include "mplb.h"
+#include "ops_seq_v2.h"
+#include "app_bench_kernel.inc"
+
+struct BenchCase {
+    std::string lattice;
+    std::string scheme{"stream"};
+    std::string storage{"double"};
+    std::string tiling{"none"};
+    int tileSize{16};
+    int size{64};
+    int blockNum{1};
+    SizeType steps{100};
+    SizeType warmSteps{10};
+    std::string output{"app_bench.csv"};
+};
+
+std::string ArgFromCmd(const int argc, const char** argv,
+                       const std::string& key, const std::string& fallback) {
+    const std::string prefix{key + "="};
+    for (int i = 1; i < argc; i++) {
+        if (std::strncmp(argv[i], prefix.c_str(), prefix.size()) == 0) {
+            return std::string(argv[i] + prefix.size());
+        }
+    }
+    return fallback;
+}
+
+BenchCase ReadBenchCase(const int argc, const char** argv) {
+    BenchCase benchCase;
+#ifdef OPS_2D
+    benchCase.lattice = ArgFromCmd(argc, argv, "lattice", "d2q9");
+#endif
+#ifdef OPS_3D
+    benchCase.lattice = ArgFromCmd(argc, argv, "lattice", "d3q19");
+#endif
+    benchCase.scheme = ArgFromCmd(argc, argv, "scheme", benchCase.scheme);
+    benchCase.storage = ArgFromCmd(argc, argv, "storage", benchCase.storage);
+    benchCase.tiling = ArgFromCmd(argc, argv, "tiling", benchCase.tiling);
+    benchCase.tileSize =
+        std::atoi(ArgFromCmd(argc, argv, "tile", "16").c_str());
+    benchCase.size = std::atoi(ArgFromCmd(argc, argv, "size", "64").c_str());
+    benchCase.blockNum =
+        std::atoi(ArgFromCmd(argc, argv, "blocks", "1").c_str());
+    benchCase.steps = std::atol(ArgFromCmd(argc, argv, "steps", "100").c_str());
+    benchCase.warmSteps =
+        std::atol(ArgFromCmd(argc, argv, "warm", "10").c_str());
+    benchCase.output = ArgFromCmd(argc, argv, "output", benchCase.output);
+    if (benchCase.scheme != "stream" && benchCase.scheme != "swap") {
+        ops_printf("Error! Unknown scheme %s, use stream or swap!\n",
+                   benchCase.scheme.c_str());
+        exit(EXIT_FAILURE);
+    }
+#ifdef OPS_2D
+    if (benchCase.scheme == "swap") {
+        ops_printf("Error! The swap scheme is only implemented in 3D!\n");
+        exit(EXIT_FAILURE);
+    }
+#endif
+    if (benchCase.storage != "double" && benchCase.storage != "compressed16") {
+        ops_printf("Error! Unknown storage %s, use double or compressed16!\n",
+                   benchCase.storage.c_str());
+        exit(EXIT_FAILURE);
+    }
+    if (benchCase.storage == "compressed16" &&
+        (SpaceDim() != 3 || benchCase.scheme != "stream")) {
+        ops_printf(
+            "Error! The compressed populations are only implemented for the "
+            "3D stream scheme!\n");
+        exit(EXIT_FAILURE);
+    }
+    if (benchCase.tiling != "none" && benchCase.tiling != "morton" &&
+        benchCase.tiling != "hilbert") {
+        ops_printf("Error! Unknown tiling %s, use none, morton or hilbert!\n",
+                   benchCase.tiling.c_str());
+        exit(EXIT_FAILURE);
+    }
+    if (benchCase.tiling != "none" &&
+        (SpaceDim() != 3 || benchCase.tileSize < 1)) {
+        ops_printf(
+            "Error! The tiling is only implemented in 3D with a positive tile "
+            "size!\n");
+        exit(EXIT_FAILURE);
+    }
+    if (benchCase.blockNum < 1 || benchCase.size < 2 * benchCase.blockNum) {
+        ops_printf("Error! %d blocks cannot be cut from a cavity of size %d!\n",
+                   benchCase.blockNum, benchCase.size);
+        exit(EXIT_FAILURE);
+    }
+    return benchCase;
+}
+
+// Provide macroscopic initial conditions
+void SetInitialMacrosVars() {
+    for (const auto& idBlock : g_Block()) {
+        const Block& block{idBlock.second};
+        std::vector<int> iterRng;
+        iterRng.assign(block.WholeRange().begin(), block.WholeRange().end());
+        const int blockIdx{block.ID()};
+        for (auto& idCompo : g_Components()) {
+            const Component& compo{idCompo.second};
+            const int rhoId{compo.macroVars.at(Variable_Rho).id};
+#ifdef OPS_2D
+            ops_par_loop(KerSetInitialMacroVars, "KerSetInitialMacroVars",
+                         block.Get(), SpaceDim(), iterRng.data(),
+                         ops_arg_dat(g_MacroVars().at(rhoId).at(blockIdx), 1,
+                                     LOCALSTENCIL, "Real", OPS_RW),
+                         ops_arg_dat(g_MacroVars().at(compo.uId).at(blockIdx),
+                                     1, LOCALSTENCIL, "Real", OPS_RW),
+                         ops_arg_dat(g_MacroVars().at(compo.vId).at(blockIdx),
+                                     1, LOCALSTENCIL, "Real", OPS_RW),
+                         ops_arg_idx());
+#endif
+#ifdef OPS_3D
+            ops_par_loop(KerSetInitialMacroVars, "KerSetInitialMacroVars",
+                         block.Get(), SpaceDim(), iterRng.data(),
+                         ops_arg_dat(g_MacroVars().at(rhoId).at(blockIdx), 1,
+                                     LOCALSTENCIL, "Real", OPS_RW),
+                         ops_arg_dat(g_MacroVars().at(compo.uId).at(blockIdx),
+                                     1, LOCALSTENCIL, "Real", OPS_RW),
+                         ops_arg_dat(g_MacroVars().at(compo.vId).at(blockIdx),
+                                     1, LOCALSTENCIL, "Real", OPS_RW),
+                         ops_arg_dat(g_MacroVars().at(compo.wId).at(blockIdx),
+                                     1, LOCALSTENCIL, "Real", OPS_RW),
+                         ops_arg_idx());
+#endif
+        }
+    }
+}
+// Provide macroscopic body-force term
+void UpdateMacroscopicBodyForce(const Real time) {}
+
+void DefineBenchCase(const BenchCase& benchCase) {
+    const bool swap{benchCase.scheme == "swap"};
+    std::string caseName{"Cavity_Benchmark"};
+    DefineCase(caseName, SpaceDim());
+    // Slabs along x which share the node plane at their interfaces
+    const int cellNum{benchCase.size - 1};
+    const Real meshSize{(Real)1. / cellNum};
+    std::vector<int> blockIds;
+    std::vector<std::string> blockNames;
+    std::vector<int> blockSize;
+    std::map<int, std::vector<Real>> startPos;
+    int startCell{0};
+    for (int blockIdx = 0; blockIdx < benchCase.blockNum; blockIdx++) {
+        const int blockCells{cellNum / benchCase.blockNum +
+                             (blockIdx < cellNum % benchCase.blockNum ? 1 : 0)};
+        blockIds.push_back(blockIdx);
+        blockNames.push_back("Cavity" + std::to_string(blockIdx));
+        blockSize.push_back(blockCells + 1);
+        for (int axis = 1; axis < SpaceDim(); axis++) {
+            blockSize.push_back(benchCase.size);
+        }
+        startPos[blockIdx] = std::vector<Real>(SpaceDim(), 0);
+        startPos[blockIdx][0] = startCell * meshSize;
+        startCell += blockCells;
+    }
+    DefineBlocks(blockIds, blockNames, blockSize, meshSize, startPos);
+    for (int blockIdx = 0; blockIdx < benchCase.blockNum - 1; blockIdx++) {
+        std::vector<int> fromBlock{blockIdx};
+        std::vector<int> toBlock{blockIdx + 1};
+        std::vector<BoundarySurface> fromSurface{BoundarySurface::Right};
+        std::vector<BoundarySurface> toSurface{BoundarySurface::Left};
+        std::vector<VertexType> connectionType{VertexType::VirtualBoundary};
+        DefineBlockConnection(fromBlock, fromSurface, toBlock, toSurface,
+                              connectionType);
+    }
+
+    std::vector<std::string> compoNames{"Fluid"};
+    std::vector<int> compoid{0};
+    std::vector<std::string> lattNames{benchCase.lattice};
+    std::vector<Real> tauRef{0.01};
+    DefineComponents(compoNames, compoid, lattNames, tauRef);
+
+#ifdef OPS_2D
+    std::vector<VariableTypes> marcoVarTypes{Variable_Rho, Variable_U,
+                                             Variable_V};
+    std::vector<std::string> macroVarNames{"rho", "u", "v"};
+    std::vector<int> macroVarId{0, 1, 2};
+    std::vector<int> macroCompoId{0, 0, 0};
+#endif
+#ifdef OPS_3D
+    std::vector<VariableTypes> marcoVarTypes{Variable_Rho, Variable_U,
+                                             Variable_V, Variable_W};
+    std::vector<std::string> macroVarNames{"rho", "u", "v", "w"};
+    std::vector<int> macroVarId{0, 1, 2, 3};
+    std::vector<int> macroCompoId{0, 0, 0, 0};
+#endif
+    DefineMacroVars(marcoVarTypes, macroVarNames, macroVarId, macroCompoId);
+
+    std::vector<CollisionType> collisionTypes{
+        swap ? Collision_BGKIsothermal2nd_Swap : Collision_BGKIsothermal2nd};
+    std::vector<int> collisionCompoId{0};
+    DefineCollision(collisionTypes, collisionCompoId);
+
+    std::vector<BodyForceType> bodyForceTypes{swap ? BodyForce_None_Swap
+                                                   : BodyForce_None};
+    std::vector<SizeType> bodyForceCompoId{0};
+    DefineBodyForce(bodyForceTypes, bodyForceCompoId);
+
+    SchemeType scheme{swap ? Scheme_StreamCollision_Swap
+                           : Scheme_StreamCollision};
+    DefineScheme(scheme);
+    DefinePopulationStorage(benchCase.storage == "compressed16"
+                                ? Population_Compressed16
+                                : Population_Double);
+    const TileOrder tileOrder{benchCase.tiling == "morton"    ? Tile_Morton
+                              : benchCase.tiling == "hilbert" ? Tile_Hilbert
+                                                              : Tile_None};
+    DefineTiling(tileOrder, {benchCase.tileSize, benchCase.tileSize});
+
+    // The lid is the top wall, all the others are stationary walls.
+#ifdef OPS_2D
+    std::vector<VariableTypes> macroVarTypesatBoundary{Variable_U, Variable_V};
+    std::vector<BoundarySurface> surfaces{
+        BoundarySurface::Left, BoundarySurface::Right, BoundarySurface::Top,
+        BoundarySurface::Bottom};
+#endif
+#ifdef OPS_3D
+    std::vector<VariableTypes> macroVarTypesatBoundary{Variable_U, Variable_V,
+                                                       Variable_W};
+    std::vector<BoundarySurface> surfaces{
+        BoundarySurface::Left,   BoundarySurface::Right,
+        BoundarySurface::Top,    BoundarySurface::Bottom,
+        BoundarySurface::Front,  BoundarySurface::Back};
+#endif
+    std::vector<Real> noSlipStationaryWall(SpaceDim(), 0);
+    std::vector<Real> noSlipMovingWall(SpaceDim(), 0);
+    noSlipMovingWall[0] = 0.01;
+    const int lastBlock{benchCase.blockNum - 1};
+    for (const int blockIdx : blockIds) {
+        for (const auto surface : surfaces) {
+            if ((surface == BoundarySurface::Left && blockIdx > 0) ||
+                (surface == BoundarySurface::Right && blockIdx < lastBlock)) {
+                continue;
+            }
+            DefineBlockBoundary(blockIdx, 0, surface,
+                                BoundaryScheme::EQMDiffuseRefl,
+                                macroVarTypesatBoundary,
+                                surface == BoundarySurface::Top
+                                    ? noSlipMovingWall
+                                    : noSlipStationaryWall);
+        }
+    }
+
+    std::vector<InitialType> initType{Initial_BGKFeq2nd};
+    std::vector<int> initalCompoId{0};
+    DefineInitialCondition(initType, initalCompoId);
+    Partition();
+    SetInitialMacrosVars();
+#ifdef OPS_2D
+    PreDefinedInitialCondition();
+#endif
+#ifdef OPS_3D
+    PreDefinedInitialCondition3D();
+#endif
+    SetTimeStep(meshSize / SoundSpeed());
+}
+
+// The maximum over all ranks, i.e., the time of the slowest one
+Real MaxOverRanks(const Real value) {
+    Real result{value};
+#ifdef OPS_MPI
+    double local{value}, global{value};
+    MPI_Allreduce(&local, &global, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+    result = global;
+#endif
+    return result;
+}
+
+// The kinetic energy per node, where the sum is over all ranks
+Real MeanKineticEnergy() {
+#ifdef OPS_2D
+    UpdateMacroVars();
+#endif
+#ifdef OPS_3D
+    UpdateMacroVars3D();
+#endif
+    ops_reduction handle{ops_decl_reduction_handle(sizeof(Real), "double",
+                                                   "KineticEnergy")};
+    long nodeNum{0};
+    const Component& compo{g_Components().begin()->second};
+    for (const auto& idBlock : g_Block()) {
+        const Block& block{idBlock.second};
+        std::vector<int> iterRng;
+        iterRng.assign(block.WholeRange().begin(), block.WholeRange().end());
+        const int blockIdx{block.ID()};
+        long blockNodes{1};
+        for (const int size : block.Size()) {
+            blockNodes *= size;
+        }
+        nodeNum += blockNodes;
+#ifdef OPS_2D
+        ops_par_loop(KerCalcKineticEnergy, "KerCalcKineticEnergy", block.Get(),
+                     SpaceDim(), iterRng.data(),
+                     ops_arg_dat(g_MacroVars().at(compo.uId).at(blockIdx), 1,
+                                 LOCALSTENCIL, "double", OPS_READ),
+                     ops_arg_dat(g_MacroVars().at(compo.vId).at(blockIdx), 1,
+                                 LOCALSTENCIL, "double", OPS_READ),
+                     ops_arg_reduce(handle, 1, "double", OPS_INC));
+#endif
+#ifdef OPS_3D
+        ops_par_loop(KerCalcKineticEnergy, "KerCalcKineticEnergy", block.Get(),
+                     SpaceDim(), iterRng.data(),
+                     ops_arg_dat(g_MacroVars().at(compo.uId).at(blockIdx), 1,
+                                 LOCALSTENCIL, "double", OPS_READ),
+                     ops_arg_dat(g_MacroVars().at(compo.vId).at(blockIdx), 1,
+                                 LOCALSTENCIL, "double", OPS_READ),
+                     ops_arg_dat(g_MacroVars().at(compo.wId).at(blockIdx), 1,
+                                 LOCALSTENCIL, "double", OPS_READ),
+                     ops_arg_reduce(handle, 1, "double", OPS_INC));
+#endif
+    }
+    Real energy{0};
+    ops_reduction_result(handle, &energy);
+    return energy / nodeNum;
+}
+
+void WriteBenchResult(const BenchCase& benchCase, const Real seconds,
+                      const Real energy) {
+    int rank{0};
+    int rankNum{1};
+#ifdef OPS_MPI
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &rankNum);
+#endif
+    const char* threads{std::getenv("OMP_NUM_THREADS")};
+    const int threadNum{threads ? std::atoi(threads) : 1};
+    long nodeNum{0};
+    for (const auto& idBlock : g_Block()) {
+        long blockNodes{1};
+        for (const int size : idBlock.second.Size()) {
+            blockNodes *= size;
+        }
+        nodeNum += blockNodes;
+    }
+    const Real mlups{nodeNum * benchCase.steps / seconds / 1e6};
+    std::vector<Real> phaseTimes;
+    for (const Real phaseTime : PhaseTimes()) {
+        phaseTimes.push_back(MaxOverRanks(phaseTime));
+    }
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    // ru_maxrss is given in kilobytes on Linux
+    const Real peakRSS{MaxOverRanks(usage.ru_maxrss / 1024.)};
+    ops_printf(
+        "%s %s %s %s size=%d blocks=%d: %.3f MLUPS over %ld steps, kinetic "
+        "energy %.10e\n",
+        benchCase.lattice.c_str(), benchCase.scheme.c_str(),
+        benchCase.storage.c_str(), benchCase.tiling.c_str(), benchCase.size,
+        benchCase.blockNum, mlups,
+        (long)benchCase.steps, energy);
+    if (rank != 0) {
+        return;
+    }
+    bool newFile{true};
+    {
+        std::ifstream existing(benchCase.output);
+        newFile = !existing.good() ||
+                  existing.peek() == std::ifstream::traits_type::eof();
+    }
+    std::ofstream csv(benchCase.output, std::ios::app);
+    if (!csv.is_open()) {
+        ops_printf("Error! Cannot open %s for the results!\n",
+                   benchCase.output.c_str());
+        return;
+    }
+    if (newFile) {
+        csv << "spacedim,lattice,scheme,storage,tiling,tile,size,blocks,ranks,"
+               "threads,steps,nodes,seconds,mlups";
+        for (int phase = 0; phase < Phase_Num; phase++) {
+            csv << ",t_" << PhaseName((TimingPhase)phase);
+        }
+        csv << ",peak_rss_mb,energy\n";
+    }
+    csv << SpaceDim() << "," << benchCase.lattice << "," << benchCase.scheme
+        << "," << benchCase.storage << "," << benchCase.tiling << ","
+        << benchCase.tileSize << "," << benchCase.size << ","
+        << benchCase.blockNum << ","
+        << rankNum << "," << threadNum << "," << benchCase.steps << ","
+        << nodeNum << "," << seconds << "," << mlups;
+    for (const Real phaseTime : phaseTimes) {
+        csv << "," << phaseTime;
+    }
+    csv << "," << peakRSS << "," << std::setprecision(12) << energy << "\n";
+}
+
+void benchmark(const BenchCase& benchCase) {
+    DefineBenchCase(benchCase);
+    void (*cycle)(const Real){benchCase.scheme == "swap" ? SwapStreamCollision
+                                                         : StreamCollision};
+    SizeType iter{0};
+    for (; iter < benchCase.warmSteps; iter++) {
+        cycle(iter * TimeStep());
+    }
+    ResetPhaseTimes();
+    double ct0, ct1, et0, et1;
+    ops_timers(&ct0, &et0);
+    for (; iter < benchCase.warmSteps + benchCase.steps; iter++) {
+        cycle(iter * TimeStep());
+    }
+    ops_timers(&ct1, &et1);
+    const Real seconds{MaxOverRanks(et1 - et0)};
+    WriteBenchResult(benchCase, seconds, MeanKineticEnergy());
+    DestroyModel();
+}
+
+int main(int argc, const char** argv) {
+    // OPS initialisation where a few arguments can be passed to set
+    // the simulation
+    ops_init(argc, argv, 1);
+    benchmark(ReadBenchCase(argc, argv));
+    ops_exit();
+    // The fields moved into the arena are not freed by OPS
+    ReleaseFieldArena();
+}
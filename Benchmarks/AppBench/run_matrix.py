@@ -0,0 +1,216 @@
+"""Run the end-to-end cavity benchmark over a parameter matrix.
+
+Every combination of block size, lattice, scheme, population storage, tiling,
+block count, rank count and thread count is run once by the AppBench
+executables, whose results are collected in <output>.csv and <output>.json.
+With --compare, the throughput is checked against a stored baseline (CSV or
+JSON written by this script) and the script fails if any case is slower than
+the tolerance allows. A case with compressed populations is validated against
+the same case in double, where the script fails if their kinetic energies
+differ by more than --energy-tolerance. A tiled case is compared with the same
+case untiled, where the speedup is printed and the script fails unless the
+kinetic energies are identical, since the tiles only reorder the nodes of each
+loop.
+"""
+import argparse
+import csv
+import itertools
+import json
+import os
+import shlex
+import subprocess
+import sys
+
+parser = argparse.ArgumentParser(description="""
+Run the MPLB cavity benchmark over a parameter matrix.\n
+The executables AppBench2D<Variant> and AppBench3D<Variant> are looked up in
+the build directory, where the Seq variant is replaced by the Mpi one when
+more than one rank is asked for.\n
+""", formatter_class=argparse.RawTextHelpFormatter)
+parser.add_argument("-B", "--BuildDir", type=str, default=".",
+                    help="Directory of the AppBench executables.")
+parser.add_argument("-V", "--variant", type=str, default="SeqDev",
+                    help="Executable variant, e.g., SeqDev, Seq or Cuda.")
+parser.add_argument("--sizes", type=int, nargs="+",
+                    default=[32, 64, 128, 256, 512],
+                    help="Number of nodes along each edge of the cavity.")
+parser.add_argument("--lattices", type=str, nargs="+",
+                    default=["d2q9", "d3q15", "d3q19"])
+parser.add_argument("--schemes", type=str, nargs="+",
+                    default=["stream", "swap"])
+parser.add_argument("--storages", type=str, nargs="+", default=["double"],
+                    help="Population storage, double or compressed16, where "
+                    "the latter is only run for the 3D stream scheme.")
+parser.add_argument("--tilings", type=str, nargs="+", default=["none"],
+                    help="Tile order, none, morton or hilbert, where the "
+                    "latter two are only run in 3D.")
+parser.add_argument("--tile", type=int, default=16,
+                    help="Number of nodes of a tile along x and y.")
+parser.add_argument("--blocks", type=int, nargs="+", default=[1])
+parser.add_argument("--ranks", type=int, nargs="+", default=[1])
+parser.add_argument("--threads", type=int, nargs="+", default=[1])
+parser.add_argument("--steps", type=int, default=100,
+                    help="Number of timed steps per case.")
+parser.add_argument("--warm", type=int, default=10,
+                    help="Number of warm-up steps per case.")
+parser.add_argument("--mpirun", type=str, default="mpirun -np {ranks}",
+                    help="Launcher for runs with more than one rank.")
+parser.add_argument("-o", "--output", type=str, default="app_bench",
+                    help="Base name of the CSV and JSON results.")
+parser.add_argument("-c", "--compare", type=str, default="",
+                    help="Baseline results to compare with.")
+parser.add_argument("-t", "--tolerance", type=float, default=0.05,
+                    help="Allowed relative loss of MLUPS against the baseline.")
+parser.add_argument("--energy-tolerance", type=float, default=1e-3,
+                    help="Allowed relative difference of the kinetic energy "
+                    "of compressed populations from double.")
+args = parser.parse_args()
+
+# The columns identifying a case of the matrix
+keyColumns = ["lattice", "scheme", "storage", "tiling", "size", "blocks",
+              "ranks", "threads"]
+
+
+def CaseKey(row, storage=None, tiling=None):
+    # Results written before the storage and tiling columns were added are in
+    # double and untiled
+    values = dict(row, storage=storage or row.get("storage", "double"),
+                  tiling=tiling or row.get("tiling", "none"))
+    return tuple(str(values[column]) for column in keyColumns)
+
+
+def LatticeDim(lattice):
+    return 2 if lattice.startswith("d2") else 3
+
+
+def Executable(lattice, ranks):
+    variant = args.variant
+    if ranks > 1:
+        variant = variant.replace("Seq", "Mpi")
+    name = "AppBench{}D{}".format(LatticeDim(lattice), variant)
+    return os.path.join(args.BuildDir, name)
+
+
+def ReadResults(fileName):
+    if fileName.endswith(".json"):
+        with open(fileName) as jsonFile:
+            return json.load(jsonFile)
+    with open(fileName, newline="") as csvFile:
+        return [{column: ToNumber(value) for column, value in row.items()}
+                for row in csv.DictReader(csvFile)]
+
+
+def ToNumber(value):
+    for convert in (int, float):
+        try:
+            return convert(value)
+        except ValueError:
+            pass
+    return value
+
+
+def RunMatrix():
+    csvName = args.output + ".csv"
+    if os.path.exists(csvName):
+        os.remove(csvName)
+    failed = []
+    for (size, lattice, scheme, storage, tiling, blocks, ranks,
+         threads) in itertools.product(args.sizes, args.lattices, args.schemes,
+                                       args.storages, args.tilings,
+                                       args.blocks, args.ranks, args.threads):
+        if scheme == "swap" and LatticeDim(lattice) == 2:
+            continue
+        if storage != "double" and (scheme != "stream" or
+                                    LatticeDim(lattice) == 2):
+            continue
+        if tiling != "none" and LatticeDim(lattice) == 2:
+            continue
+        command = [Executable(lattice, ranks), "size={}".format(size),
+                   "lattice={}".format(lattice), "scheme={}".format(scheme),
+                   "storage={}".format(storage),
+                   "tiling={}".format(tiling), "tile={}".format(args.tile),
+                   "blocks={}".format(blocks), "steps={}".format(args.steps),
+                   "warm={}".format(args.warm),
+                   "output={}".format(os.path.abspath(csvName))]
+        if ranks > 1:
+            command = shlex.split(args.mpirun.format(ranks=ranks)) + command
+        env = dict(os.environ, OMP_NUM_THREADS=str(threads))
+        print(" ".join(command), "with", threads, "threads", flush=True)
+        if subprocess.call(command, env=env) != 0:
+            failed.append(" ".join(command))
+    results = ReadResults(csvName) if os.path.exists(csvName) else []
+    with open(args.output + ".json", "w") as jsonFile:
+        json.dump(results, jsonFile, indent=2)
+    for command in failed:
+        print("Failed:", command)
+    return results, len(failed) == 0
+
+
+def Compare(results, baseline):
+    reference = {CaseKey(row): float(row["mlups"]) for row in baseline}
+    regressed = False
+    print("{:<40} {:>10} {:>10} {:>8}".format("Case", "Baseline", "MLUPS",
+                                               "Ratio"))
+    for row in results:
+        key = CaseKey(row)
+        mlups = float(row["mlups"])
+        if key not in reference:
+            print("{:<40} {:>10} {:>10.3f}".format(" ".join(key), "-", mlups))
+            continue
+        ratio = mlups / reference[key]
+        flag = ""
+        if ratio < 1 - args.tolerance:
+            flag = " slower"
+            regressed = True
+        print("{:<40} {:>10.3f} {:>10.3f} {:>8.3f}{}".format(
+            " ".join(key), reference[key], mlups, ratio, flag))
+    return not regressed
+
+
+def ValidateStorage(results):
+    """Compare the kinetic energy of compressed cases with the double ones"""
+    reference = {CaseKey(row): float(row["energy"]) for row in results
+                 if row["storage"] == "double"}
+    valid = True
+    for row in results:
+        key = CaseKey(row, "double")
+        if row["storage"] == "double" or key not in reference:
+            continue
+        energy = float(row["energy"])
+        difference = abs(energy - reference[key]) / max(reference[key], 1e-300)
+        flag = ""
+        if difference > args.energy_tolerance:
+            flag = " invalid"
+            valid = False
+        print("{:<40} energy {:.6e} double {:.6e} difference {:.2e}{}".format(
+            " ".join(CaseKey(row)), energy, reference[key], difference, flag))
+    return valid
+
+
+def CompareTiling(results):
+    """Compare the tiled cases with the untiled ones"""
+    reference = {CaseKey(row): row for row in results
+                 if row.get("tiling", "none") == "none"}
+    valid = True
+    for row in results:
+        key = CaseKey(row, tiling="none")
+        if row.get("tiling", "none") == "none" or key not in reference:
+            continue
+        untiled = reference[key]
+        speedup = float(row["mlups"]) / float(untiled["mlups"])
+        flag = ""
+        if float(row["energy"]) != float(untiled["energy"]):
+            flag = " invalid"
+            valid = False
+        print("{:<40} {:.3f} MLUPS untiled {:.3f} speedup {:.3f}{}".format(
+            " ".join(CaseKey(row)), float(row["mlups"]),
+            float(untiled["mlups"]), speedup, flag))
+    return valid
+
+
+results, succeeded = RunMatrix()
+succeeded = ValidateStorage(results) and succeeded
+succeeded = CompareTiling(results) and succeeded
+if args.compare:
+    succeeded = Compare(results, ReadResults(args.compare)) and succeeded
+sys.exit(0 if succeeded else 1)
@@ -0,0 +1,98 @@
+"""Compare the kernels with and without the huge-page field arena.
+
+The kernel benchmark is run twice on a single size class (DRAM by default),
+first with the fields where OPS allocates them (arena=0) and then moved into
+the huge-page arena (arena=1). For every kernel, the time per node and the
+data TLB read misses per node sampled by the hardware counters of the two runs
+are printed side by side with their ratio, followed by the memory backed by
+huge pages in each run. The benchmark must be built with PERFCOUNTERS and
+FIELDARENA, otherwise the script fails as there is nothing to compare.
+"""
+import argparse
+import re
+import subprocess
+import sys
+
+parser = argparse.ArgumentParser(description="""
+TLB misses of the MPLB kernels with and without the huge-page arena.\n
+""", formatter_class=argparse.RawTextHelpFormatter)
+parser.add_argument("executable", type=str,
+                    help="The KernelBench executable, e.g., KernelBenchSeqDev.")
+parser.add_argument("--size", type=str, default="DRAM",
+                    choices=["L1", "L2", "L3", "DRAM"],
+                    help="Size class to run.")
+parser.add_argument("--time", type=float, default=0.5,
+                    help="Minimum measuring time (seconds) of each kernel.")
+parser.add_argument("extra", type=str, nargs="*",
+                    help="Further key=value arguments of the benchmark.")
+args = parser.parse_args()
+
+# Kernel Size Nodes ns/node GB/s STREAM dTLB/node
+benchLine = re.compile(r"^(\w[\w ]*?)\s+(L1|L2|L3|DRAM)\s+(\d+)\s+([0-9.]+)"
+                       r"\s+[0-9.]+\s+[0-9.]+%\s+(\S+)$")
+hugeLine = re.compile(r"Memory backed by huge pages: ([0-9.]+) MB, field "
+                      r"arena: ([0-9.]+) MB")
+
+
+def Run(arena):
+    command = [args.executable, "only={}".format(args.size),
+               "time={}".format(args.time), "arena={}".format(arena)]
+    command += args.extra
+    print(" ".join(command), flush=True)
+    result = subprocess.run(command, stdout=subprocess.PIPE,
+                            stderr=subprocess.STDOUT, universal_newlines=True)
+    if result.returncode != 0:
+        print(result.stdout)
+        return None
+    return Parse(result.stdout)
+
+
+def Parse(output):
+    """Return {kernel: [ns/node, TLB misses/node]} and the huge-page and arena
+    MB"""
+    kernels = {}
+    memoryMB = [0, 0]
+    for line in output.splitlines():
+        line = line.strip()
+        huge = hugeLine.search(line)
+        if huge:
+            memoryMB = [float(huge.group(1)), float(huge.group(2))]
+            continue
+        bench = benchLine.match(line)
+        if bench:
+            kernels[bench.group(1)] = [float(bench.group(4)), bench.group(5)]
+    return kernels, memoryMB
+
+
+def Ratio(new, old):
+    try:
+        return "{:.3f}".format(float(new) / float(old))
+    except (ValueError, ZeroDivisionError):
+        return "n/a"
+
+
+baseline = Run(0)
+arena = Run(1)
+if baseline is None or arena is None:
+    sys.exit(1)
+sampled = [kernel for kernel, values in arena[0].items()
+           if values[1] != "n/a"]
+if not sampled:
+    print("No TLB misses are sampled, please build with -DPERFCOUNTERS=ON and "
+          "check perf_event_paranoid!")
+    sys.exit(1)
+if arena[1][1] == 0:
+    print("No field is moved into the arena, please build with "
+          "-DFIELDARENA=ON!")
+    sys.exit(1)
+print("\n{:<28} {:>10} {:>10} {:>7} {:>10} {:>10} {:>7}".format(
+    "Kernel", "ns/node", "arena", "ratio", "dTLB/node", "arena", "ratio"))
+for kernel, (nsPerNode, tlbMiss) in baseline[0].items():
+    if kernel not in arena[0]:
+        continue
+    arenaNs, arenaTlb = arena[0][kernel]
+    print("{:<28} {:>10.3f} {:>10.3f} {:>7} {:>10} {:>10} {:>7}".format(
+        kernel, nsPerNode, arenaNs, Ratio(arenaNs, nsPerNode), tlbMiss,
+        arenaTlb, Ratio(arenaTlb, tlbMiss)))
+print("\nMemory backed by huge pages: {:.2f} MB without and {:.2f} MB with "
+      "the arena ({:.2f} MB)".format(baseline[1][0], arena[1][0], arena[1][1]))
@@ -0,0 +1,512 @@
+/**
+ * Copyright 2019 United Kingdom Research and Innovation
+ *
+ * Authors: See AUTHORS
+ *
+ * Contact: [jianping.meng@stfc.ac.uk and/or jpmeng@gmail.com]
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * ANDANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @brief Micro-benchmarks of the individual lattice kernels
+ *  @details Each kernel is timed on its own over a set of synthetic cubic
+ *  blocks whose working set fits in L1, L2, L3 and main memory respectively.
+ *  For every kernel and block the best repetition is reported as ns/node,
+ *  the effective bandwidth from the compulsory traffic of the kernel, and
+ *  that bandwidth as a fraction of a STREAM triad measured at the same size.
+ *  The cache sizes are taken from the system where available and can be
+ *  overridden by L1=, L2=, L3= and DRAM= (bytes) on the command line, while
+ *  time= sets the minimum measuring time (seconds) of each entry.
+ *  only= keeps a single size class, e.g., only=DRAM, and arena=0 keeps the
+ *  fields where OPS allocates them instead of moving them into the huge-page
+ *  arena. With PERFCOUNTERS, the data TLB misses per node of each kernel are
+ *  reported as well, which compare_arena.py uses to show the misses saved by
+ *  the arena.
+ **/
+#include <unistd.h>
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+#include "mplb.h"
+#include "ops_seq_v2.h"
+#include "kernel_bench_kernel.inc"
+
+// The kernels under test are compiled into the library wrappers. Each launch
+// is timed and its traffic counted here, so only the hardware counters are
+// sampled around it rather than the whole KernelScope of roofline.h.
+void KerCollideBGKIsothermal3D(ACC<Real>& fStage, const ACC<Real>& f,
+                               const ACC<int>& nodeType, const ACC<Real>& Rho,
+                               const ACC<Real>& U, const ACC<Real>& V,
+                               const ACC<Real>& W, const Real* tauRef,
+                               const Real* dt, const int* lattIdx,
+                               const Real* grid, const int* idx);
+void KerStream3D(ACC<Real>& f, const ACC<Real>& fStage,
+                 const ACC<int>& nodeType, const ACC<int>& geometry,
+                 const int* lattIdx);
+void KerLocalSwap3D(ACC<Real>& f, const ACC<int>& nodeType,
+                    const ACC<int>& geometry, const int* lattIdx);
+void KerSwapStream3D(ACC<Real>& f, const ACC<int>& nodeType,
+                     const ACC<int>& geometry, const int* lattIdx);
+void KerCutCellEQMDiffuseRefl3D(ACC<Real>& f, const ACC<int>& nodeType,
+                                const ACC<int>& geometryProperty,
+                                const Real* givenMacroVars,
+                                const int* lattIdx);
+void KerCalcDensity3D(ACC<Real>& Rho, const ACC<Real>& f,
+                      const ACC<int>& nodeType, const int* lattIdx);
+void KerCalcU3D(ACC<Real>& U, const ACC<Real>& f, const ACC<int>& nodeType,
+                const ACC<Real>& Rho, const int* lattIdx);
+
+struct SizeClass {
+    std::string name;
+    long cacheBytes;
+    int nodesPerEdge;
+};
+
+struct BenchResult {
+    std::string kernel;
+    std::string sizeClass;
+    long nodes;
+    Real seconds;
+    Real bytesPerNode;
+    // Data TLB misses per node, negative if the counters are not sampled
+    Real tlbMisses;
+};
+
+Real minTime{0.2};
+std::vector<BenchResult> results;
+std::map<std::string, Real> triadBandwidth;
+// The TLB misses and nodes of a kernel counted up to the last size class
+std::map<std::string, std::pair<Real, Real>> countedTLBMisses;
+
+long CacheSize(const int name, const long fallback) {
+    const long size{sysconf(name)};
+    return size > 0 ? size : fallback;
+}
+
+long SizeFromCmd(const int argc, const char** argv, const std::string& key,
+                 const long fallback) {
+    const std::string prefix{key + "="};
+    for (int i = 1; i < argc; i++) {
+        if (std::strncmp(argv[i], prefix.c_str(), prefix.size()) == 0) {
+            return std::atol(argv[i] + prefix.size());
+        }
+    }
+    return fallback;
+}
+
+// The bytes a node holds in the distributions, macroscopic variables and the
+// two integer properties, i.e. what a time step touches.
+long StateBytesPerNode() {
+    return (2 * NUMXI + 4) * sizeof(Real) + 2 * sizeof(int);
+}
+
+std::vector<SizeClass> DefineSizeClasses(const int argc, const char** argv) {
+    const long l1{SizeFromCmd(argc, argv, "L1",
+                              CacheSize(_SC_LEVEL1_DCACHE_SIZE, 32768))};
+    const long l2{SizeFromCmd(argc, argv, "L2",
+                              CacheSize(_SC_LEVEL2_CACHE_SIZE, 1048576))};
+    const long l3{SizeFromCmd(argc, argv, "L3",
+                              CacheSize(_SC_LEVEL3_CACHE_SIZE, 33554432))};
+    const long dram{SizeFromCmd(argc, argv, "DRAM", 8 * l3)};
+    std::vector<SizeClass> sizeClasses{
+        {"L1", l1, 0}, {"L2", l2, 0}, {"L3", l3, 0}, {"DRAM", dram, 0}};
+    // Half of a cache level is left to the halos, stencils and the code.
+    for (auto& sizeClass : sizeClasses) {
+        const long target{sizeClass.name == "DRAM" ? sizeClass.cacheBytes
+                                                   : sizeClass.cacheBytes / 2};
+        const int edge{(int)std::cbrt((Real)target / StateBytesPerNode())};
+        sizeClass.nodesPerEdge = std::max(edge, 4);
+    }
+    for (int i = 1; i < argc; i++) {
+        if (std::strncmp(argv[i], "only=", 5) == 0) {
+            const std::string only{argv[i] + 5};
+            sizeClasses.erase(
+                std::remove_if(sizeClasses.begin(), sizeClasses.end(),
+                               [&only](const SizeClass& sizeClass) {
+                                   return sizeClass.name != only;
+                               }),
+                sizeClasses.end());
+        }
+    }
+    if (sizeClasses.empty()) {
+        ops_printf("Error! There is no size class to benchmark!\n");
+        assert(!sizeClasses.empty());
+    }
+    return sizeClasses;
+}
+
+// Run a kernel repeatedly for at least minTime and return the best time.
+template <typename Launch>
+Real BestTime(Launch launch) {
+    Real best{std::numeric_limits<Real>::max()};
+    Real total{0};
+    int repetition{0};
+    while (total < minTime || repetition < 3) {
+        double ct0, ct1, et0, et1;
+        ops_timers(&ct0, &et0);
+        launch();
+        ops_timers(&ct1, &et1);
+        best = std::min(best, (Real)(et1 - et0));
+        total += et1 - et0;
+        repetition++;
+    }
+    return best;
+}
+
+void Record(const std::string& kernel, const std::string& sizeClass,
+            const long nodes, const Real seconds, const Real bytesPerNode) {
+    // The counters accumulate over the size classes, so only the increase
+    // since the last class is due to this one.
+    Real countedNodes{0};
+    const Real misses{KernelCount(kernel, Counter_TLBMisses, countedNodes)};
+    std::pair<Real, Real>& counted{countedTLBMisses[kernel]};
+    Real tlbMisses{-1};
+    if (misses >= 0 && countedNodes > counted.second) {
+        tlbMisses = (misses - counted.first) / (countedNodes - counted.second);
+        counted = {misses, countedNodes};
+    }
+    results.push_back(
+        {kernel, sizeClass, nodes, seconds, bytesPerNode, tlbMisses});
+}
+
+// The STREAM triad a = b + s*c over arrays as large as the block state.
+void BenchTriad(const SizeClass& sizeClass, const long nodes) {
+    const long size{std::max(nodes * StateBytesPerNode() /
+                                 (3 * (long)sizeof(Real)),
+                             (long)1)};
+    std::vector<Real> a(size, 0), b(size, 1), c(size, 2);
+    const Real scalar{3};
+    const Real seconds{BestTime([&]() {
+        for (long i = 0; i < size; i++) {
+            a[i] = b[i] + scalar * c[i];
+        }
+    })};
+    if (a[size / 2] != 7) {
+        ops_printf("Error! The STREAM triad produced a wrong result!\n");
+    }
+    triadBandwidth[sizeClass.name] = 3 * sizeof(Real) * size / seconds;
+    Record("STREAM triad", sizeClass.name, size, seconds, 3 * sizeof(Real));
+}
+
+// CalcBGKFeq on its own, from node-major macroscopic arrays to f.
+void BenchFeq(const SizeClass& sizeClass, const long nodes) {
+    std::vector<Real> rho(nodes, 1), u(nodes, 0.01), v(nodes, 0.02),
+        w(nodes, 0.03), f(nodes * NUMXI, 0);
+    const Real seconds{BestTime([&]() {
+        for (long i = 0; i < nodes; i++) {
+            for (int xiIndex = 0; xiIndex < NUMXI; xiIndex++) {
+                f[i * NUMXI + xiIndex] =
+                    CalcBGKFeq(xiIndex, rho[i], u[i], v[i], w[i], 1, 2);
+            }
+        }
+    })};
+    Record("CalcBGKFeq", sizeClass.name, nodes, seconds,
+           (NUMXI + 4) * sizeof(Real));
+}
+
+void BenchBlockKernels(const Block& block, const SizeClass& sizeClass) {
+    const int blockIdx{block.ID()};
+    const Component& compo{g_Components().at(0)};
+    const int rhoId{compo.macroVars.at(Variable_Rho).id};
+    ops_dat f{g_f().at(blockIdx)};
+    ops_dat fStage{g_fStage().at(blockIdx)};
+    ops_dat nodeType{g_NodeType().at(compo.id).at(blockIdx)};
+    ops_dat geometry{g_GeometryProperty().at(blockIdx)};
+    ops_dat rho{g_MacroVars().at(rhoId).at(blockIdx)};
+    ops_dat u{g_MacroVars().at(compo.uId).at(blockIdx)};
+    ops_dat v{g_MacroVars().at(compo.vId).at(blockIdx)};
+    ops_dat w{g_MacroVars().at(compo.wId).at(blockIdx)};
+    std::vector<int> iterRng;
+    iterRng.assign(block.WholeRange().begin(), block.WholeRange().end());
+    const long nodes{(long)block.Size().at(0) * block.Size().at(1) *
+                     block.Size().at(2)};
+    const Real dist{(Real)NUMXI * sizeof(Real)};
+    const Real* tauRef{&compo.tauRef};
+    const Real* pdt{pTimeStep()};
+
+    Real seconds{BestTime([&]() {
+        CounterScope counters{"KerCollideBGKIsothermal3D", (Real)nodes};
+        ops_par_loop(KerCollideBGKIsothermal3D, "KerCollideBGKIsothermal3D",
+                     block.Get(), SpaceDim(), iterRng.data(),
+                     ops_arg_dat(fStage, NUMXI, LOCALSTENCIL, "double",
+                                 OPS_RW),
+                     ops_arg_dat(f, NUMXI, LOCALSTENCIL, "double", OPS_READ),
+                     ops_arg_dat(nodeType, 1, LOCALSTENCIL, "int", OPS_READ),
+                     ops_arg_dat(rho, 1, LOCALSTENCIL, "double", OPS_READ),
+                     ops_arg_dat(u, 1, LOCALSTENCIL, "double", OPS_READ),
+                     ops_arg_dat(v, 1, LOCALSTENCIL, "double", OPS_READ),
+                     ops_arg_dat(w, 1, LOCALSTENCIL, "double", OPS_READ),
+                     ops_arg_gbl(tauRef, 1, "double", OPS_READ),
+                     ops_arg_gbl(pdt, 1, "double", OPS_READ),
+                     ops_arg_gbl(compo.index, 2, "int", OPS_READ),
+                     ops_arg_gbl(block.Grid(), block.GridSize(), "double",
+                                 OPS_READ),
+                     ops_arg_idx());
+    })};
+    // fStage is read for the forcing term as well as written.
+    Record("KerCollideBGKIsothermal3D", sizeClass.name, nodes, seconds,
+           3 * dist + 4 * sizeof(Real) + sizeof(int));
+
+    seconds = BestTime([&]() {
+        CounterScope counters{"KerStream3D", (Real)nodes};
+        ops_par_loop(KerStream3D, "KerStream3D", block.Get(), SpaceDim(),
+                     iterRng.data(),
+                     ops_arg_dat(f, NUMXI, LOCALSTENCIL, "double", OPS_RW),
+                     ops_arg_dat(fStage, NUMXI, ONEPTLATTICESTENCIL, "double",
+                                 OPS_READ),
+                     ops_arg_dat(nodeType, 1, LOCALSTENCIL, "int", OPS_READ),
+                     ops_arg_dat(geometry, 1, LOCALSTENCIL, "int", OPS_READ),
+                     ops_arg_gbl(compo.index, 2, "int", OPS_READ));
+    });
+    Record("KerStream3D", sizeClass.name, nodes, seconds,
+           2 * dist + 2 * sizeof(int));
+
+    seconds = BestTime([&]() {
+        CounterScope counters{"KerLocalSwap3D", (Real)nodes};
+        ops_par_loop(KerLocalSwap3D, "KerLocalSwap3D", block.Get(),
+                     SpaceDim(), iterRng.data(),
+                     ops_arg_dat(f, NUMXI, LOCALSTENCIL, "double", OPS_RW),
+                     ops_arg_dat(nodeType, 1, LOCALSTENCIL, "int", OPS_READ),
+                     ops_arg_dat(geometry, 1, LOCALSTENCIL, "int", OPS_READ),
+                     ops_arg_gbl(compo.index, 2, "int", OPS_READ));
+    });
+    Record("KerLocalSwap3D", sizeClass.name, nodes, seconds,
+           2 * dist + 2 * sizeof(int));
+
+    seconds = BestTime([&]() {
+        CounterScope counters{"KerSwapStream3D", (Real)nodes};
+        ops_par_loop(KerSwapStream3D, "KerSwapStream3D", block.Get(),
+                     SpaceDim(), iterRng.data(),
+                     ops_arg_dat(f, NUMXI, LOCALSTENCIL, "double", OPS_RW),
+                     ops_arg_dat(nodeType, 1, LOCALSTENCIL, "int", OPS_READ),
+                     ops_arg_dat(geometry, 1, LOCALSTENCIL, "int", OPS_READ),
+                     ops_arg_gbl(compo.index, 2, "int", OPS_READ));
+    });
+    Record("KerSwapStream3D", sizeClass.name, nodes, seconds,
+           2 * dist + 2 * sizeof(int));
+
+    // A wall is timed per node of the face rather than of the block.
+    std::vector<int> faceRng{
+        block.BoundarySurfaceRange().at(BoundarySurface::Left)};
+    const long faceNodes{(long)(faceRng[1] - faceRng[0]) *
+                         (faceRng[3] - faceRng[2]) *
+                         (faceRng[5] - faceRng[4])};
+    const Real wallVars[]{0, 0, 0};
+    seconds = BestTime([&]() {
+        CounterScope counters{"KerCutCellEQMDiffuseRefl3D", (Real)faceNodes};
+        ops_par_loop(KerCutCellEQMDiffuseRefl3D, "KerCutCellEQMDiffuseRefl3D",
+                     block.Get(), SpaceDim(), faceRng.data(),
+                     ops_arg_dat(f, NUMXI, LOCALSTENCIL, "double", OPS_RW),
+                     ops_arg_dat(nodeType, 1, LOCALSTENCIL, "int", OPS_READ),
+                     ops_arg_dat(geometry, 1, LOCALSTENCIL, "int", OPS_READ),
+                     ops_arg_gbl(wallVars, 3, "double", OPS_READ),
+                     ops_arg_gbl(compo.index, 2, "int", OPS_READ));
+    });
+    Record("KerCutCellEQMDiffuseRefl3D", sizeClass.name, faceNodes, seconds,
+           2 * dist + 2 * sizeof(int));
+
+    seconds = BestTime([&]() {
+        CounterScope counters{"KerCalcDensity3D", (Real)nodes};
+        ops_par_loop(KerCalcDensity3D, "KerCalcDensity3D", block.Get(),
+                     SpaceDim(), iterRng.data(),
+                     ops_arg_dat(rho, 1, LOCALSTENCIL, "double", OPS_RW),
+                     ops_arg_dat(f, NUMXI, LOCALSTENCIL, "double", OPS_READ),
+                     ops_arg_dat(nodeType, 1, LOCALSTENCIL, "int", OPS_READ),
+                     ops_arg_gbl(compo.index, 2, "int", OPS_READ));
+    });
+    Record("KerCalcDensity3D", sizeClass.name, nodes, seconds,
+           dist + 2 * sizeof(Real) + sizeof(int));
+
+    seconds = BestTime([&]() {
+        CounterScope counters{"KerCalcU3D", (Real)nodes};
+        ops_par_loop(KerCalcU3D, "KerCalcU3D", block.Get(), SpaceDim(),
+                     iterRng.data(),
+                     ops_arg_dat(u, 1, LOCALSTENCIL, "double", OPS_RW),
+                     ops_arg_dat(f, NUMXI, LOCALSTENCIL, "double", OPS_READ),
+                     ops_arg_dat(nodeType, 1, LOCALSTENCIL, "int", OPS_READ),
+                     ops_arg_dat(rho, 1, LOCALSTENCIL, "double", OPS_READ),
+                     ops_arg_gbl(compo.index, 2, "int", OPS_READ));
+    });
+    Record("KerCalcU3D", sizeClass.name, nodes, seconds,
+           dist + 3 * sizeof(Real) + sizeof(int));
+}
+
+void Report() {
+    ops_printf("\n%-28s %-5s %10s %10s %10s %8s %10s\n", "Kernel", "Size",
+               "Nodes", "ns/node", "GB/s", "STREAM", "dTLB/node");
+    for (const auto& result : results) {
+        const Real bandwidth{result.bytesPerNode * result.nodes /
+                             result.seconds};
+        char tlbMisses[16]{"n/a"};
+        if (result.tlbMisses >= 0) {
+            std::snprintf(tlbMisses, sizeof(tlbMisses), "%.4f",
+                          result.tlbMisses);
+        }
+        ops_printf("%-28s %-5s %10ld %10.3f %10.3f %7.1f%% %10s\n",
+                   result.kernel.c_str(), result.sizeClass.c_str(),
+                   result.nodes, 1e9 * result.seconds / result.nodes,
+                   bandwidth / 1e9,
+                   100 * bandwidth / triadBandwidth.at(result.sizeClass),
+                   tlbMisses);
+    }
+}
+
+// Provide macroscopic initial conditions
+void SetInitialMacrosVars() {
+    for (const auto& idBlock : g_Block()) {
+        const Block& block{idBlock.second};
+        std::vector<int> iterRng;
+        iterRng.assign(block.WholeRange().begin(), block.WholeRange().end());
+        const int blockIdx{block.ID()};
+        for (auto& idCompo : g_Components()) {
+            const Component& compo{idCompo.second};
+            const int rhoId{compo.macroVars.at(Variable_Rho).id};
+            ops_par_loop(KerSetBenchMacroVars, "KerSetBenchMacroVars",
+                         block.Get(), SpaceDim(), iterRng.data(),
+                         ops_arg_dat(g_MacroVars().at(rhoId).at(blockIdx), 1,
+                                     LOCALSTENCIL, "Real", OPS_RW),
+                         ops_arg_dat(g_MacroVars().at(compo.uId).at(blockIdx),
+                                     1, LOCALSTENCIL, "Real", OPS_RW),
+                         ops_arg_dat(g_MacroVars().at(compo.vId).at(blockIdx),
+                                     1, LOCALSTENCIL, "Real", OPS_RW),
+                         ops_arg_dat(g_MacroVars().at(compo.wId).at(blockIdx),
+                                     1, LOCALSTENCIL, "Real", OPS_RW),
+                         ops_arg_idx());
+        }
+    }
+}
+// Provide macroscopic body-force term
+void UpdateMacroscopicBodyForce(const Real time) {}
+
+void benchmark(const std::vector<SizeClass>& sizeClasses) {
+    std::string caseName{"Kernel_Benchmark"};
+    SizeType spaceDim{3};
+    DefineCase(caseName, spaceDim);
+    // One unconnected cubic block per size class
+    std::vector<int> blockIds;
+    std::vector<std::string> blockNames;
+    std::vector<int> blockSize;
+    std::map<int, std::vector<Real>> startPos;
+    for (int blockIdx = 0; blockIdx < sizeClasses.size(); blockIdx++) {
+        const int edge{sizeClasses[blockIdx].nodesPerEdge};
+        blockIds.push_back(blockIdx);
+        blockNames.push_back(sizeClasses[blockIdx].name);
+        blockSize.insert(blockSize.end(), {edge, edge, edge});
+        startPos[blockIdx] = {(Real)blockIdx, 0.0, 0.0};
+    }
+    Real meshSize{1. / 32};
+    DefineBlocks(blockIds, blockNames, blockSize, meshSize, startPos);
+
+    std::vector<std::string> compoNames{"Fluid"};
+    std::vector<int> compoid{0};
+    std::vector<std::string> lattNames{"d3q19"};
+    std::vector<Real> tauRef{0.01};
+    DefineComponents(compoNames, compoid, lattNames, tauRef);
+
+    std::vector<VariableTypes> marcoVarTypes{Variable_Rho, Variable_U,
+                                             Variable_V, Variable_W};
+    std::vector<std::string> macroVarNames{"rho", "u", "v", "w"};
+    std::vector<int> macroVarId{0, 1, 2, 3};
+    std::vector<int> macroCompoId{0, 0, 0, 0};
+    DefineMacroVars(marcoVarTypes, macroVarNames, macroVarId, macroCompoId);
+
+    std::vector<CollisionType> collisionTypes{Collision_BGKIsothermal2nd};
+    std::vector<int> collisionCompoId{0};
+    DefineCollision(collisionTypes, collisionCompoId);
+
+    std::vector<BodyForceType> bodyForceTypes{BodyForce_None};
+    std::vector<SizeType> bodyForceCompoId{0};
+    DefineBodyForce(bodyForceTypes, bodyForceCompoId);
+
+    SchemeType scheme{Scheme_StreamCollision};
+    DefineScheme(scheme);
+
+    std::vector<VariableTypes> macroVarTypesatBoundary{Variable_U, Variable_V,
+                                                       Variable_W};
+    std::vector<Real> noSlipStationaryWall{0, 0, 0};
+    const std::vector<BoundarySurface> surfaces{
+        BoundarySurface::Left,   BoundarySurface::Right,
+        BoundarySurface::Top,    BoundarySurface::Bottom,
+        BoundarySurface::Front,  BoundarySurface::Back};
+    for (const int blockIdx : blockIds) {
+        for (const auto surface : surfaces) {
+            DefineBlockBoundary(blockIdx, 0, surface,
+                                BoundaryScheme::EQMDiffuseRefl,
+                                macroVarTypesatBoundary, noSlipStationaryWall);
+        }
+    }
+
+    std::vector<InitialType> initType{Initial_BGKFeq2nd};
+    std::vector<int> initalCompoId{0};
+    DefineInitialCondition(initType, initalCompoId);
+    Partition();
+    SetInitialMacrosVars();
+    PreDefinedInitialCondition3D();
+    SetTimeStep(meshSize / SoundSpeed());
+
+    for (const auto& idBlock : g_Block()) {
+        const Block& block{idBlock.second};
+        const SizeClass& sizeClass{sizeClasses.at(block.ID())};
+        const long nodes{(long)block.Size().at(0) * block.Size().at(1) *
+                         block.Size().at(2)};
+        ops_printf("Benchmarking %s: %d^3 nodes for %ld bytes of cache\n",
+                   sizeClass.name.c_str(), sizeClass.nodesPerEdge,
+                   sizeClass.cacheBytes);
+        BenchTriad(sizeClass, nodes);
+        BenchFeq(sizeClass, nodes);
+        BenchBlockKernels(block, sizeClass);
+    }
+    Report();
+    ReportPerfCounters();
+    ReportHugePages();
+}
+
+int main(int argc, const char** argv) {
+    // OPS initialisation where a few arguments can be passed to set
+    // the simulation
+    ops_init(argc, argv, 1);
+    const std::vector<SizeClass> sizeClasses{DefineSizeClasses(argc, argv)};
+    for (int i = 1; i < argc; i++) {
+        if (std::strncmp(argv[i], "time=", 5) == 0) {
+            minTime = std::atof(argv[i] + 5);
+        }
+        if (std::strncmp(argv[i], "arena=", 6) == 0) {
+            UseFieldArena(std::atoi(argv[i] + 6) != 0);
+        }
+    }
+    benchmark(sizeClasses);
+    ops_exit();
+    // The fields moved into the arena are not freed by OPS
+    ReleaseFieldArena();
+}
@@ -0,0 +1,179 @@
+"""Run the strong and weak scaling study of the 3D applications.
+
+Each application is run under mpirun on a single host for every combination of
+rank and thread count. In the strong mode the problem of the given
+configuration is kept fixed, while in the weak mode the z extent of every block
+grows with the number of workers (ranks x threads) so that the nodes per worker
+stay constant. The phase times printed by the library at the end of a run give
+  efficiency: T(1)/(p*T(p)) for strong and T(1)/T(p) for weak scaling, where T
+              is the wall time of the slowest rank and p the number of workers
+  halo:       the fraction of the wall time spent in halo exchanges
+  imbalance:  max/average over the ranks of the time spent outside halo
+              exchanges, i.e., 1 means a perfectly balanced run
+The results are collected in <output>.csv and <output>.json.
+"""
+import argparse
+import csv
+import itertools
+import json
+import os
+import re
+import shlex
+import subprocess
+import sys
+import tempfile
+
+parser = argparse.ArgumentParser(description="""
+Strong and weak scaling of the MPLB applications.\n
+An application is given as Name=Executable:Config, e.g.,
+Cavity3D=./Cavity3DMpi:Apps/3DCavity/Cavity3D.json\n
+""", formatter_class=argparse.RawTextHelpFormatter)
+parser.add_argument("--apps", type=str, nargs="+", required=True,
+                    help="Applications as Name=Executable:Config.")
+parser.add_argument("--ranks", type=int, nargs="+", default=[1, 2, 4, 8])
+parser.add_argument("--threads", type=int, nargs="+", default=[1])
+parser.add_argument("--mode", type=str, default="both",
+                    choices=["strong", "weak", "both"])
+parser.add_argument("--steps", type=int, default=200,
+                    help="Number of time steps per run.")
+parser.add_argument("--mpirun", type=str, default="mpirun -np {ranks}",
+                    help="Launcher of the runs.")
+parser.add_argument("-o", "--output", type=str, default="scaling",
+                    help="Base name of the CSV and JSON results.")
+args = parser.parse_args()
+
+columns = ["app", "mode", "ranks", "threads", "workers", "nodes", "seconds",
+           "efficiency", "halo", "imbalance"]
+phaseHeader = re.compile(r"Phase times over (\d+) ranks")
+phaseLine = re.compile(r"^(\w+)\s+([0-9.eE+-]+)\s+([0-9.eE+-]+)\s*$")
+
+
+def ParseApp(app):
+    name, rest = app.split("=", 1)
+    executable, config = rest.rsplit(":", 1)
+    return name, os.path.abspath(executable), os.path.abspath(config)
+
+
+def WriteConfig(config, workers, mode, directory):
+    """Write the configuration of a run and return its file name and nodes"""
+    with open(config) as jsonFile:
+        caseConfig = json.load(jsonFile)
+    caseConfig["Transient"] = True
+    caseConfig["TimeStepsToRun"] = args.steps
+    caseConfig["CurrentTimeStep"] = 0
+    # No check point is wanted during a timed run
+    caseConfig["CheckPeriod"] = args.steps + 1
+    sizes = caseConfig["BlockSize"]
+    spaceDim = caseConfig["SpaceDim"]
+    if mode == "weak":
+        for blockIdx in range(len(sizes) // spaceDim):
+            z = blockIdx * spaceDim + spaceDim - 1
+            sizes[z] = (sizes[z] - 1) * workers + 1
+    nodes = 0
+    for blockIdx in range(len(sizes) // spaceDim):
+        blockNodes = 1
+        for size in sizes[blockIdx * spaceDim:(blockIdx + 1) * spaceDim]:
+            blockNodes *= size
+        nodes += blockNodes
+    fileName = os.path.join(directory, "{}_{}.json".format(mode, workers))
+    with open(fileName, "w") as jsonFile:
+        json.dump(caseConfig, jsonFile, indent=2)
+    return fileName, nodes
+
+
+def ParsePhaseTimes(output):
+    """Return {phase: (max, average)} from the report of the library"""
+    times = {}
+    inReport = False
+    for line in output.splitlines():
+        if phaseHeader.search(line):
+            inReport = True
+            times = {}
+            continue
+        if inReport:
+            match = phaseLine.match(line.strip())
+            if match is None:
+                if times:
+                    inReport = False
+                continue
+            times[match.group(1)] = (float(match.group(2)),
+                                     float(match.group(3)))
+    return times
+
+
+def Run(executable, config, ranks, threads, directory):
+    command = shlex.split(args.mpirun.format(ranks=ranks)) + [
+        executable, "Config={}".format(config)]
+    env = dict(os.environ, OMP_NUM_THREADS=str(threads))
+    print(" ".join(command), "with", threads, "threads", flush=True)
+    result = subprocess.run(command, env=env, cwd=directory,
+                            stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+                            universal_newlines=True)
+    if result.returncode != 0:
+        print(result.stdout)
+        return None
+    times = ParsePhaseTimes(result.stdout)
+    if "Total" not in times:
+        print("No phase times found in the output of", " ".join(command))
+        return None
+    return times
+
+
+def RunScaling():
+    results = []
+    failed = False
+    modes = ["strong", "weak"] if args.mode == "both" else [args.mode]
+    for app, mode in itertools.product(args.apps, modes):
+        name, executable, config = ParseApp(app)
+        reference = None
+        for ranks, threads in itertools.product(sorted(args.ranks),
+                                                sorted(args.threads)):
+            workers = ranks * threads
+            with tempfile.TemporaryDirectory() as directory:
+                caseConfig, nodes = WriteConfig(config, workers, mode,
+                                                directory)
+                times = Run(executable, caseConfig, ranks, threads, directory)
+            if times is None:
+                failed = True
+                continue
+            seconds = times["Total"][0]
+            if reference is None:
+                reference = (workers, seconds)
+            speedup = reference[1] / seconds
+            if mode == "strong":
+                efficiency = speedup * reference[0] / workers
+            else:
+                efficiency = speedup
+            halo = times["Halo"][0] / seconds if seconds > 0 else 0
+            busyMax = seconds - times["Halo"][0]
+            busyAverage = times["Total"][1] - times["Halo"][1]
+            imbalance = busyMax / busyAverage if busyAverage > 0 else 1
+            results.append({"app": name, "mode": mode, "ranks": ranks,
+                            "threads": threads, "workers": workers,
+                            "nodes": nodes, "seconds": seconds,
+                            "efficiency": efficiency, "halo": halo,
+                            "imbalance": imbalance})
+    return results, not failed
+
+
+def WriteResults(results):
+    with open(args.output + ".csv", "w", newline="") as csvFile:
+        writer = csv.DictWriter(csvFile, fieldnames=columns)
+        writer.writeheader()
+        writer.writerows(results)
+    with open(args.output + ".json", "w") as jsonFile:
+        json.dump(results, jsonFile, indent=2)
+    print("{:<12} {:<6} {:>5} {:>7} {:>12} {:>10} {:>10} {:>8} {:>9}".format(
+        "App", "Mode", "Ranks", "Threads", "Nodes", "Seconds", "Efficiency",
+        "Halo", "Imbalance"))
+    for row in results:
+        print("{:<12} {:<6} {:>5} {:>7} {:>12} {:>10.4f} {:>10.3f} {:>8.3f} "
+              "{:>9.3f}".format(row["app"], row["mode"], row["ranks"],
+                                row["threads"], row["nodes"], row["seconds"],
+                                row["efficiency"], row["halo"],
+                                row["imbalance"]))
+
+
+results, succeeded = RunScaling()
+WriteResults(results)
+sys.exit(0 if succeeded else 1)
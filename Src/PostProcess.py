@@ -40,6 +40,7 @@
 # python 2 and python 3 compatibility for the print function
 from __future__ import print_function
 import json
+import os
 import sys
 
 try:
@@ -104,15 +105,27 @@ def ChangeShape3D(data, nx, ny, nz, dataLength, haloNum):
     return data.transpose((2, 1, 0, 3))
 
 
-def ReadVariableFromHDF5(fileName, varName, varLen=1, haloNum=1, withHalo=False):
+def ReadVariableFromHDF5(fileName, varName, varLen=1, haloNum=1, withHalo=False, blockName=None):
     if ((not h5Loaded) or (not numpyLoaded)):
         print("The h5py or numpy is not installed!")
         res = "The h5py or numpy is not installed!"
         return res
     dataFile = h5.File(fileName, "r")
-    blockName = list(dataFile.keys())[0]
+    # A shared snapshot holds a group for every block
+    if blockName is None:
+        blockName = list(dataFile.keys())[0]
+    if blockName not in dataFile.keys():
+        dataFile.close()
+        return None
     dataKey = varName+'_'+blockName
+    # e.g., CoordinateXYZ is only written for stretched blocks
+    if dataKey not in dataFile[blockName].keys():
+        dataFile.close()
+        return None
     rawData = np.array(dataFile[blockName][dataKey])
+    # A quantised snapshot keeps the multiples of its quantum
+    if 'Quantum' in dataFile[blockName][dataKey].attrs:
+        rawData = rawData * dataFile[blockName][dataKey].attrs['Quantum']
     spaceDim = len(rawData.shape)
     if spaceDim == 3:
         nx = int(rawData.shape[2]/varLen)-2*haloNum
@@ -151,7 +164,7 @@ def ReadVariableFromHDF5(fileName, varName, varLen=1, haloNum=1, withHalo=False)
     return np.ascontiguousarray(res)
 
 
-def ReadBlockData(fileName, variables):
+def ReadBlockData(fileName, variables, blockName=None):
     """Read a series of variables specified by a list of dictionary "variables" on a block from a file specified by "fileName" """
     errorMsg = "Please provide a list variables in the format [{'name':'rho','len':1,'haloNum':1,'withHalo':False}"
     if not isinstance(variables, list):
@@ -182,8 +195,12 @@ def ReadBlockData(fileName, variables):
             if isinstance(var['withHalo'], bool):
                 withHalo = var['withHalo']
         print("Reading ", var, "...")
-        res[name] = ReadVariableFromHDF5(
-            fileName, varName=name, varLen=len, haloNum=haloNum, withHalo=withHalo)
+        data = ReadVariableFromHDF5(
+            fileName, varName=name, varLen=len, haloNum=haloNum, withHalo=withHalo, blockName=blockName)
+        if data is None:
+            print(name, "is not found in", fileName)
+            continue
+        res[name] = data
     if "CoordinateXYZ" in res.keys():
         if res['CoordinateXYZ'].shape[-1] == 3:
             res['X'] = np.copy(res['CoordinateXYZ'][:, :, :, 0])
@@ -196,6 +213,20 @@ def ReadBlockData(fileName, variables):
     return res
 
 
+def UniformCoordinates(res, meshSize, startPos):
+    """Rebuild X, Y (and Z) of a uniform block from its start position and mesh size"""
+    if 'X' in res.keys() or not res:
+        return res
+    shape = next(iter(res.values())).shape
+    spaceDim = len(startPos)
+    axes = [startPos[i] + meshSize * np.arange(shape[i])
+            for i in range(spaceDim)]
+    grids = np.meshgrid(*axes, indexing='ij')
+    for name, grid in zip(['X', 'Y', 'Z'], grids):
+        res[name] = grid
+    return res
+
+
 def WriteVariablesToPlainHDF5(res, fileName):
     """ Save the data into a plain HDF5 file"""
     if ((not h5Loaded) or (not numpyLoaded)):
@@ -531,27 +562,44 @@ def PrepareVariables(options):
 
 
 def PrepareFileName(options):
+    """The output name, the HDF5 file and the block name of every block and time, where a shared snapshot is used if it exists"""
     fileNames = []
     timeRange = range(options['ConvertStartAt'],options['ConvertEndAt']+1,options['CheckPeriod'])
     for blockName in options['BlockNames']:
         base = options['CaseName'] + '_'+blockName+'_T'
         for time in timeRange:
-            fileNames.append(base+str(time))
+            h5file = options['CaseName'] + '_T' + str(time) + '.h5'
+            if not os.path.isfile(h5file):
+                h5file = base + str(time) + '.h5'
+            fileNames.append((base+str(time), h5file, blockName))
     return fileNames
 
 
+def BlockStartPos(options, fileName):
+    """The start position of the block written to fileName, if it is known"""
+    if not ('StartPos' in options and 'BlockIds' in options):
+        return None
+    for blockId, blockName in zip(options['BlockIds'], options['BlockNames']):
+        if fileName.startswith(options['CaseName'] + '_' + blockName + '_T'):
+            return options['StartPos'].get(str(blockId))
+    return None
+
 
 def main(jsonFile):
     options = ReadJson(jsonFile)
     variables = PrepareVariables(options)
-    for fileName in PrepareFileName(options):
-        h5file = fileName+'.h5'
+    for fileName, h5file, blockName in PrepareFileName(options):
+        res = ReadBlockData(h5file, variables, blockName)
+        # Uniform blocks do not write their coordinates
+        startPos = BlockStartPos(options, fileName)
+        if startPos is not None and 'MeshSize' in options:
+            res = UniformCoordinates(res, options['MeshSize'], startPos)
         if options['ConvertOutputTo']=='VTK':
-            WriteMacroVarsVTK(ReadBlockData(h5file,variables),fileName)
+            WriteMacroVarsVTK(res,fileName)
         if options['ConvertOutputTo']=='Tecplot':
-            WriteMacroVarsTecplotHDF5(ReadBlockData(h5file,variables),fileName+'_Tecplot.h5')
+            WriteMacroVarsTecplotHDF5(res,fileName+'_Tecplot.h5')
         if options['ConvertOutputTo']=='PlainH5':
-            WriteVariablesToPlainHDF5(ReadBlockData(h5file,variables),fileName+'_Plain.h5')
+            WriteVariablesToPlainHDF5(res,fileName+'_Plain.h5')
     return 0
 
 if __name__ == '__main__':
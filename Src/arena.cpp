@@ -0,0 +1,223 @@
+/**
+ * Copyright 2019 United Kingdom Research and Innovation
+ *
+ * Authors: See AUTHORS
+ *
+ * Contact: [jianping.meng@stfc.ac.uk and/or jpmeng@gmail.com]
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * ANDANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*! @brief   Move the fields into a huge-page backed arena
+ * @author  Jianping Meng
+ * @details The reservation of the arena and the moving of the local dats, see
+ * arena.h.
+ */
+#include "arena.h"
+#include "ops_lib_core.h"
+#ifdef OPS_MPI
+#include "ops_mpi_core.h"
+#endif
+#include "memory.h"
+#include "numa.h"
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#if defined(FIELDARENA) && defined(__linux__)
+#include <sys/mman.h>
+#include <unistd.h>
+#include <cstdint>
+
+struct ArenaRegion {
+    char* base{nullptr};
+    size_t capacity{0};
+    size_t used{0};
+    int moved{0};
+};
+
+ArenaRegion fieldArena;
+bool arenaEnabled{true};
+
+size_t HugePageSize() { return 2 * 1024 * 1024; }
+
+size_t CacheLineSize() { return 64; }
+
+size_t RoundUp(const size_t bytes, const size_t alignment) {
+    return (bytes + alignment - 1) / alignment * alignment;
+}
+
+/*
+ * Reserve a region aligned to a huge page, where only the touched pages are
+ * backed by memory. The unaligned head and tail of the mapping are returned.
+ */
+char* MapHugeRegion(const size_t bytes) {
+    const size_t mapped{bytes + HugePageSize()};
+    void* region{mmap(nullptr, mapped, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0)};
+    if (region == MAP_FAILED) {
+        return nullptr;
+    }
+    const uintptr_t start{(uintptr_t)region};
+    const uintptr_t base{RoundUp(start, HugePageSize())};
+    if (base > start) {
+        munmap(region, base - start);
+    }
+    const uintptr_t end{start + mapped};
+    if (end > base + bytes) {
+        munmap((void*)(base + bytes), end - base - bytes);
+    }
+#ifdef MADV_HUGEPAGE
+    madvise((void*)base, bytes, MADV_HUGEPAGE);
+#endif
+    return (char*)base;
+}
+
+void UseFieldArena(const bool enabled) { arenaEnabled = enabled; }
+
+void MoveFieldsToArena() {
+    if (!arenaEnabled || fieldArena.base != nullptr) {
+        return;
+    }
+    // A page plus the stagger of a dat at most on top of its local bytes
+    const size_t pageSize{(size_t)sysconf(_SC_PAGESIZE)};
+    size_t capacity{0};
+    for (const FieldMemory& field : FieldMemories()) {
+        capacity += RoundUp((size_t)LocalFieldBytes(field), pageSize) +
+                    2 * pageSize;
+    }
+    if (capacity == 0) {
+        return;
+    }
+    fieldArena.capacity = RoundUp(capacity, HugePageSize());
+    fieldArena.base = MapHugeRegion(fieldArena.capacity);
+    if (fieldArena.base == nullptr) {
+        ops_printf(
+            "Warning! The field arena cannot be reserved, the fields stay "
+            "where OPS allocates them!\n");
+        fieldArena = ArenaRegion{};
+        return;
+    }
+    // Page aligned plus a stagger of a different cache line for each dat, 17
+    // being coprime with the 64 lines of a 4 KB page.
+    const size_t linesPerPage{pageSize / CacheLineSize()};
+    for (const FieldMemory& field : FieldMemories()) {
+        const ops_dat dat{field.dat};
+        if (dat->data == nullptr || dat->user_managed) {
+            continue;
+        }
+        const size_t stagger{(fieldArena.moved * 17 % linesPerPage) *
+                             CacheLineSize()};
+        const size_t offset{RoundUp(fieldArena.used, pageSize) + stagger};
+        const size_t bytes{(size_t)LocalFieldBytes(field)};
+        char* data{fieldArena.base + offset};
+        const int outer{(int)field.blockSize.size() - 1};
+        FirstTouchDat(data, dat->data,
+                      std::vector<int>(dat->size, dat->size + outer + 1),
+                      -dat->d_m[outer], dat->d_p[outer], dat->elem_size);
+        ops_free(dat->data);
+        dat->data = data;
+        dat->user_managed = 1;
+        fieldArena.used = offset + bytes;
+        fieldArena.moved++;
+    }
+}
+
+void ReleaseFieldArena() {
+    if (fieldArena.base != nullptr) {
+        munmap(fieldArena.base, fieldArena.capacity);
+    }
+    fieldArena = ArenaRegion{};
+}
+
+void AdviseHugePages() {
+    long advised{0};
+#ifdef MADV_HUGEPAGE
+    for (const FieldMemory& field : FieldMemories()) {
+        const ops_dat dat{field.dat};
+        if (dat->data == nullptr || dat->user_managed) {
+            continue;
+        }
+        const uintptr_t start{RoundUp((uintptr_t)dat->data, HugePageSize())};
+        const uintptr_t end{((uintptr_t)dat->data +
+                             (uintptr_t)LocalFieldBytes(field)) /
+                            HugePageSize() * HugePageSize()};
+        if (end > start &&
+            madvise((void*)start, end - start, MADV_HUGEPAGE) == 0) {
+            advised++;
+        }
+    }
+#endif
+    std::ifstream thpMode("/sys/kernel/mm/transparent_hugepage/enabled");
+    std::string mode;
+    std::getline(thpMode, mode);
+    if (mode.find("[never]") != std::string::npos) {
+        ops_printf(
+            "Warning! Transparent huge pages are disabled on this system, the "
+            "fields are backed by small pages!\n");
+    }
+    ops_printf(
+        "%d dats are moved into the field arena (%.2f of %.2f MB reserved), "
+        "%ld other dats are advised to use huge pages\n",
+        fieldArena.moved, fieldArena.used / (1024. * 1024.),
+        fieldArena.capacity / (1024. * 1024.), advised);
+}
+
+// The anonymous memory of this process backed by huge pages (bytes)
+double HugePageBytes() {
+    std::ifstream smaps("/proc/self/smaps_rollup");
+    if (!smaps.good()) {
+        smaps.open("/proc/self/smaps");
+    }
+    double bytes{0};
+    std::string line;
+    while (std::getline(smaps, line)) {
+        if (line.compare(0, 14, "AnonHugePages:") == 0) {
+            std::istringstream value(line.substr(14));
+            double kiloBytes{0};
+            value >> kiloBytes;
+            bytes += kiloBytes * 1024;
+        }
+    }
+    return bytes;
+}
+
+void ReportHugePages() {
+    double bytes[2]{HugePageBytes(), (double)fieldArena.used};
+#ifdef OPS_MPI
+    MPI_Allreduce(MPI_IN_PLACE, bytes, 2, MPI_DOUBLE, MPI_SUM, OPS_MPI_GLOBAL);
+#endif
+    const double mega{1024. * 1024.};
+    ops_printf(
+        "Memory backed by huge pages: %.2f MB, field arena: %.2f MB\n",
+        bytes[0] / mega, bytes[1] / mega);
+}
+#else
+void UseFieldArena(const bool enabled) {}
+void MoveFieldsToArena() {}
+void ReleaseFieldArena() {}
+void AdviseHugePages() {}
+void ReportHugePages() {}
+#endif  // FIELDARENA && __linux__
@@ -0,0 +1,62 @@
+/**
+ * Copyright 2019 United Kingdom Research and Innovation
+ *
+ * Authors: See AUTHORS
+ *
+ * Contact: [jianping.meng@stfc.ac.uk and/or jpmeng@gmail.com]
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * ANDANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*! @brief   Move the fields into a huge-page backed arena
+ * @author  Jianping Meng
+ * @details With FIELDARENA on Linux, MoveFieldsToArena(), called by
+ * Partition() right after ops_partition, reserves one 2 MB aligned region per
+ * process (rank) sized from the local bytes of the fields accounted in
+ * memory.h, advises it to be backed by transparent huge pages and moves every
+ * local dat into it, so that sweeping the fields needs far fewer TLB entries.
+ * Since the local sizes are known by then, this works in both the sequential
+ * and the MPI builds. The threads copy the dats as the kernels will sweep them,
+ * which is their first touch, see FirstTouchDat(). The start of every dat is
+ * staggered by a different number of cache lines within a page so that dats
+ * of power-of-two-ish sizes, e.g., 33^3 or 257^3 nodes, do not map their nodes
+ * onto the same cache sets. The moved dats are user managed, i.e., OPS does
+ * not free them, so ReleaseFieldArena() shall be called after ops_exit(). The
+ * dats that are not moved, e.g., when the arena is switched off, are advised
+ * by AdviseHugePages() for their aligned interiors.
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+// The arena is not used if it is switched off before calling Partition()
+void UseFieldArena(const bool enabled);
+void MoveFieldsToArena();
+// Unmap the arena, which must be after ops_exit() when no dat is accessed
+void ReleaseFieldArena();
+// Advise the huge-page aligned interior of the dats which are not moved
+void AdviseHugePages();
+// Print the memory backed by huge pages over all the ranks
+void ReportHugePages();
+#endif  // ARENA_H
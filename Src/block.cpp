@@ -1,4 +1,5 @@
 #include "block.h"
+#include <algorithm>
 #include <string>
 #include <vector>
 #include <map>
@@ -107,6 +108,12 @@ Block::Block(const int blockId, const std::string& blockName,
     }
     size = blockSize;
     block = ops_decl_block(spaceDim, blockName.c_str());
+    // Node indices are the coordinates until a grid is given
+    grid.assign(2 * spaceDim + 1, 1);
+    for (int axis = 0; axis < spaceDim; axis++) {
+        grid.at(2 * axis) = 0;
+    }
+    grid.at(2 * spaceDim) = 0;
     wholeRange.resize(2 * spaceDim);
     wholeRange.at(0) = 0;
     wholeRange.at(1) = size.at(0);
@@ -146,4 +153,48 @@ void Block::AddNeighbor(BoundarySurface surface, const Neighbor& neighbor) {
         assert(neighbors.find(surface) == neighbors.end());
     }
     neighbors.emplace(surface, neighbor);
+}
+
+void Block::SetUniformGrid(const std::vector<Real>& startPos,
+                           const Real meshSize) {
+    if ((int)startPos.size() != spaceDim) {
+        ops_printf("Error! Block %s expects %i start coordinates but got %i!\n",
+                   name.c_str(), spaceDim, (int)startPos.size());
+        assert((int)startPos.size() == spaceDim);
+    }
+    grid.resize(2 * spaceDim + 1);
+    for (int axis = 0; axis < spaceDim; axis++) {
+        grid.at(2 * axis) = startPos.at(axis);
+        grid.at(2 * axis + 1) = meshSize;
+    }
+    grid.at(2 * spaceDim) = 0;
+    uniform = true;
+}
+
+void Block::SetStretchedGrid(
+    const std::vector<std::vector<Real>>& coordinates) {
+    for (int axis = 0; axis < spaceDim; axis++) {
+        const std::vector<Real>& axisCoordinates{coordinates.at(axis)};
+        if ((int)axisCoordinates.size() != size.at(axis)) {
+            ops_printf(
+                "Error! Block %s expects %i coordinates along the axis %i but "
+                "got %i!\n",
+                name.c_str(), size.at(axis), axis,
+                (int)axisCoordinates.size());
+            assert((int)axisCoordinates.size() == size.at(axis));
+        }
+        grid.at(2 * axis) = axisCoordinates.front();
+        grid.at(2 * axis + 1) =
+            (axisCoordinates.back() - axisCoordinates.front()) /
+            std::max(size.at(axis) - 1, 1);
+    }
+    // A non-zero flag followed by the offset of the table of each axis
+    grid.resize(2 * spaceDim + 1 + spaceDim);
+    grid.at(2 * spaceDim) = 1;
+    for (int axis = 0; axis < spaceDim; axis++) {
+        grid.at(2 * spaceDim + 1 + axis) = grid.size();
+        grid.insert(grid.end(), coordinates.at(axis).begin(),
+                    coordinates.at(axis).end());
+    }
+    uniform = false;
 }
\ No newline at end of file
@@ -77,6 +77,11 @@ class Block {
     std::vector<int> wholeRange;
     std::vector<int> bulkRange;
     std::map<BoundarySurface, Neighbor> neighbors;
+    // The start position and the mesh size along each axis, i.e., {x0, dx,
+    // y0, dy, z0, dz}, followed by the tables of a stretched block, see
+    // NodeCoordinate()
+    std::vector<Real> grid;
+    bool uniform{true};
 #ifdef OPS_3D
     std::vector<int> kminRange;
     std::vector<int> kmaxRange;
@@ -100,6 +105,23 @@ class Block {
         return neighbors;
     };
     void AddNeighbor(BoundarySurface surface, const Neighbor& neighbor);
+    /*!
+     * A uniform block only carries its start position and mesh size, from
+     * which kernels compute the coordinates of a node by ops_arg_idx().
+     */
+    void SetUniformGrid(const std::vector<Real>& startPos, const Real meshSize);
+    /*!
+     * A stretched block keeps the coordinates of its nodes along each axis in
+     * the CoordinateXYZ field for the output, and Grid() carries them as
+     * tables so that NodeCoordinate() is exact in the kernels as well. The
+     * start position and the average mesh size in front of the tables are
+     * only good for locating a node roughly.
+     */
+    void SetStretchedGrid(const std::vector<std::vector<Real>>& coordinates);
+    bool IsUniform() const { return uniform; };
+    const Real* Grid() const { return grid.data(); };
+    // The number of values of Grid(), i.e., the size of the global argument
+    int GridSize() const { return (int)grid.size(); };
 };
 using BlockGroup = std::map<int, Block>;
 #endif  // BLOCK_H
\ No newline at end of file
@@ -39,7 +39,10 @@
 #include "type.h"
 #include "boundary.h"
 #include <cassert>
+#include <map>
+#include <algorithm>
 #include "model.h"
+#include "scheme.h"
 /*!
  * boundaryHaloPt: the halo point needed by the boundary condition
  * In general, the periodic boundary conditions will need one halo point
@@ -57,6 +60,26 @@ int boundaryHaloPt{1};
 
 const std::vector<BlockBoundary>& BlockBoundaries() { return blockBoundaries; }
 
+bool IsBoundaryTypeSharedByComponents() {
+    // The node type of a component is determined by the sequence of its
+    // boundary definitions (the last definition wins at edges and corners),
+    // so components share one node classification if these sequences are
+    // identical.
+    std::map<int, std::vector<std::vector<int>>> boundaryTypes;
+    for (const auto& boundary : blockBoundaries) {
+        boundaryTypes[boundary.componentID].push_back(
+            {boundary.blockIndex, (int)boundary.boundarySurface,
+             (int)boundary.boundaryType});
+    }
+    const int firstCompoId{g_Components().begin()->first};
+    for (const auto& compo : g_Components()) {
+        if (boundaryTypes[compo.first] != boundaryTypes[firstCompoId]) {
+            return false;
+        }
+    }
+    return true;
+}
+
 
 void DefineBlockBoundary(int blockIndex, int componentID,
                          BoundarySurface boundarySurface,
@@ -83,6 +106,73 @@ void DefineBlockBoundary(int blockIndex, int componentID,
         blockBoundary.blockIndex);
 }
 
+bool periodicHalos{false};
+
+void DefinePeriodicHalos(const bool halos) { periodicHalos = halos; }
+
+// The swap scheme writes into the halos without carrying the writes back to
+// the periodic images, and the 2D stream step has not been validated with
+// self-connected blocks, so that both keep copying the periodic surfaces
+// after the stream step, i.e., KerCutCellPeriodic(3D). The moment scheme has
+// no populations to be copied and is always served by the halos.
+bool IsPeriodicServedByHalos() {
+#ifdef OPS_3D
+    if (Scheme() == Scheme_StreamCollision_Moment) {
+        return true;
+    }
+    return periodicHalos && Scheme() == Scheme_StreamCollision;
+#endif
+#ifdef OPS_2D
+    return false;
+#endif
+}
+
+/*!
+ * Connect a periodic surface and its opposite surface to the block itself,
+ * the halos created at Partition() then carry the periodic images.
+ */
+void DefinePeriodicConnection(const int blockIndex,
+                              const BoundarySurface surface) {
+    const std::map<BoundarySurface, BoundarySurface> opposite{
+        {BoundarySurface::Left, BoundarySurface::Right},
+        {BoundarySurface::Right, BoundarySurface::Left},
+        {BoundarySurface::Top, BoundarySurface::Bottom},
+        {BoundarySurface::Bottom, BoundarySurface::Top},
+#ifdef OPS_3D
+        {BoundarySurface::Front, BoundarySurface::Back},
+        {BoundarySurface::Back, BoundarySurface::Front},
+#endif
+    };
+    if (opposite.count(surface) == 0) {
+        ops_printf(
+            "Error! The periodic boundary can only be defined at a surface of "
+            "the block %i!\n",
+            blockIndex);
+        assert(opposite.count(surface) > 0);
+    }
+    const BoundarySurface oppositeSurface{opposite.at(surface)};
+    // The pair may be connected already by the opposite surface or by
+    // another component
+    const auto& neighbors{g_Block().at(blockIndex).Neighbors()};
+    for (const auto connected : {surface, oppositeSurface}) {
+        if (neighbors.count(connected) > 0 &&
+            (neighbors.at(connected).blockId != blockIndex ||
+             neighbors.at(connected).type != VertexType::MDPeriodic)) {
+            ops_printf(
+                "Error! The periodic surface %i of Block %i has been connected "
+                "to another block!\n",
+                (int)connected, blockIndex);
+            assert(neighbors.at(connected).blockId == blockIndex);
+        }
+    }
+    if (neighbors.count(surface) == 0) {
+        DefineBlockConnection(
+            {blockIndex, blockIndex}, {surface, oppositeSurface},
+            {blockIndex, blockIndex}, {oppositeSurface, surface},
+            {VertexType::MDPeriodic, VertexType::MDPeriodic});
+    }
+}
+
 void DefineBlockBoundary(int blockIndex, int componentID,
                          BoundarySurface boundarySurface,
                          BoundaryScheme boundaryScheme,
@@ -120,6 +210,21 @@ void DefineBlockBoundary(int blockIndex, int componentID,
     blockBoundary.boundarySurface = boundarySurface;
     blockBoundary.boundaryScheme = boundaryScheme;
     blockBoundary.boundaryType = boundaryType;
+    const bool periodic{boundaryScheme == BoundaryScheme::FDPeriodic ||
+                        boundaryScheme == BoundaryScheme::MDPeriodic};
+    if (periodic && periodicHalos && !IsPeriodicServedByHalos()) {
+        ops_printf(
+            "Warning! The periodic surface %i of Block %i is copied after the "
+            "stream step as the halos cannot serve it in this dimension or "
+            "scheme!\n",
+            (int)boundarySurface, blockIndex);
+    }
+    if (periodic && IsPeriodicServedByHalos()) {
+        // Periodic surfaces are served by the halos of the block itself, so
+        // that the stream step reads the opposite surface directly.
+        DefinePeriodicConnection(blockIndex, boundarySurface);
+        blockBoundary.boundaryType = VertexType::MDPeriodic;
+    }
     blockBoundaries.push_back(blockBoundary);
     ops_printf(
         "The scheme %i is adopted for Component %i at Surface %i, boundary "
@@ -376,11 +481,259 @@ void BoundaryNormal3D(const VertexGeometryType vg, int* unitNormal) {
     }
 }
 #ifdef OPS_3D
+LoopPlanGroup boundaryPlan;
+LoopPlanGroup& g_BoundaryPlan() { return boundaryPlan; }
+bool boundaryBatching{true};
+
+void DefineBoundaryBatching(const bool batching) {
+    boundaryBatching = batching;
+}
+
+bool IsBoundaryBatched() { return boundaryBatching; }
+
+// If two records may treat the same populations of a node or of its
+// neighbours, which the kernel reads, so that their order matters.
+bool AreBoundaryRecordsDependent(const int* record, const int* other) {
+    if (record[BoundaryRecord_LattIdx + 1] <
+            other[BoundaryRecord_LattIdx] ||
+        other[BoundaryRecord_LattIdx + 1] < record[BoundaryRecord_LattIdx]) {
+        return false;
+    }
+    const int* range{record + BoundaryRecord_Range};
+    const int* otherRange{other + BoundaryRecord_Range};
+    for (int axis = 0; axis < SpaceDim(); axis++) {
+        if (range[2 * axis + 1] + 1 < otherRange[2 * axis] ||
+            otherRange[2 * axis + 1] + 1 < range[2 * axis]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// The records of one face to be treated by a single loop
+struct FaceRecords {
+    BoundarySurface face;
+    std::vector<int> records;
+    std::vector<Real> givenVars;
+};
+
+void BuildBoundaryPlan3D() {
+    boundaryPlan.clear();
+    const std::vector<BoundarySurface> faces{
+        BoundarySurface::Left,   BoundarySurface::Right, BoundarySurface::Top,
+        BoundarySurface::Bottom, BoundarySurface::Front, BoundarySurface::Back};
+    const bool moment{Scheme() == Scheme_StreamCollision_Moment};
+    for (const auto& idBlock : g_Block()) {
+        const Block& block{idBlock.second};
+        const int blockIndex{block.ID()};
+        // The loops of a block replay the records in the order of definition,
+        // so that the condition defined last wins at shared nodes. A record
+        // joins the last loop of its face unless a record of a later loop
+        // depends on it, otherwise a new loop is started. There are no
+        // per-surface kernels for the moments, so that each surface is given a
+        // loop of its own instead if the loops are not batched.
+        std::vector<FaceRecords> faceLoops;
+        for (const auto& boundary : blockBoundaries) {
+            const BoundaryScheme scheme{boundary.boundaryScheme};
+            if (boundary.blockIndex != blockIndex) {
+                continue;
+            }
+            // The periodic surfaces are served by the halos under the moment
+            // scheme, which has no kernel for any other scheme
+            if (moment && scheme != BoundaryScheme::EQMDiffuseRefl &&
+                scheme != BoundaryScheme::FDPeriodic) {
+                ops_printf(
+                    "Error! The boundary scheme %i is not implemented for the "
+                    "moment scheme!\n",
+                    (int)scheme);
+                assert(scheme == BoundaryScheme::EQMDiffuseRefl);
+            }
+            if (scheme != BoundaryScheme::ExtrapolPressure1ST &&
+                scheme != BoundaryScheme::EQMDiffuseRefl &&
+                (scheme != BoundaryScheme::FDPeriodic ||
+                 IsPeriodicServedByHalos())) {
+                continue;
+            }
+            // The copy sweep reads the images from the halos of a connection,
+            // which only the swap scheme transfers for the populations
+            if (scheme == BoundaryScheme::FDPeriodic &&
+                Scheme() == Scheme_StreamCollision_Swap &&
+                block.Neighbors().count(boundary.boundarySurface) == 0) {
+                ops_printf(
+                    "Error! The periodic surface %i of Block %i must be "
+                    "connected to its image by DefineBlockConnection() under "
+                    "the swap scheme!\n",
+                    (int)boundary.boundarySurface, blockIndex);
+                assert(block.Neighbors().count(boundary.boundarySurface) > 0);
+            }
+            const std::vector<int>& range{
+                block.BoundarySurfaceRange().at(boundary.boundarySurface)};
+            // Edges and corners are treated with the first face holding them
+            bool found{false};
+            BoundarySurface face{BoundarySurface::Left};
+            for (const auto candidate : faces) {
+                const std::vector<int>& faceRange{
+                    block.BoundarySurfaceRange().at(candidate)};
+                bool inside{true};
+                for (int axis = 0; axis < SpaceDim(); axis++) {
+                    inside = inside &&
+                             faceRange[2 * axis] <= range[2 * axis] &&
+                             range[2 * axis + 1] <= faceRange[2 * axis + 1];
+                }
+                if (inside) {
+                    face = candidate;
+                    found = true;
+                    break;
+                }
+            }
+            if (!found) {
+                ops_printf(
+                    "Error! The boundary surface %i of Block %i is not on any "
+                    "face of the block!\n",
+                    (int)boundary.boundarySurface, blockIndex);
+                assert(found);
+            }
+            const int* lattIdx{g_Components().at(boundary.componentID).index};
+            std::vector<int> record{(int)scheme,
+                                    (int)boundary.boundarySurface, lattIdx[0],
+                                    lattIdx[1], 0};
+            record.insert(record.end(), range.begin(), range.end());
+            int loopIdx{moment && !boundaryBatching
+                            ? -1
+                            : (int)faceLoops.size() - 1};
+            for (; loopIdx >= 0; loopIdx--) {
+                if (faceLoops[loopIdx].face == face) {
+                    break;
+                }
+                const std::vector<int>& laterRecords{
+                    faceLoops[loopIdx].records};
+                bool dependent{false};
+                for (SizeType recordIdx = 0; recordIdx < laterRecords.size();
+                     recordIdx += BoundaryRecord_Size) {
+                    dependent = dependent ||
+                                AreBoundaryRecordsDependent(
+                                    record.data(), &laterRecords[recordIdx]);
+                }
+                if (dependent) {
+                    loopIdx = -1;
+                    break;
+                }
+            }
+            if (loopIdx < 0) {
+                faceLoops.push_back(FaceRecords{face, {}, {}});
+                loopIdx = (int)faceLoops.size() - 1;
+            }
+            std::vector<int>& faceRecords{faceLoops[loopIdx].records};
+            std::vector<Real>& faceVars{faceLoops[loopIdx].givenVars};
+            // The moment kernel collides with the relaxation time in front
+            if (moment && faceVars.empty()) {
+                faceVars.push_back(
+                    g_Components().at(boundary.componentID).tauRef);
+            }
+            record[BoundaryRecord_VarOffset] = (int)faceVars.size();
+            faceRecords.insert(faceRecords.end(), record.begin(), record.end());
+            faceVars.insert(faceVars.end(), boundary.givenVars.begin(),
+                            boundary.givenVars.end());
+        }
+        // The moment kernel starts a node from the moments of the last step
+        // rather than from the results of the loops before, so that a loop
+        // replays all the records of the block in their order and the nodes
+        // shared with the other loops are given the same values as the
+        // surfaces treated in sequence. Without batching, a surface replays
+        // the records up to its own, which the later surfaces carry on.
+        std::vector<int> blockRecords;
+        std::vector<Real> blockVars;
+        std::vector<int> recordNums;
+        if (moment && !faceLoops.empty()) {
+            blockVars.push_back(faceLoops.front().givenVars.front());
+            for (const auto& faceLoop : faceLoops) {
+                const int offset{(int)blockVars.size() - 1};
+                for (SizeType recordIdx = 0;
+                     recordIdx < faceLoop.records.size();
+                     recordIdx += BoundaryRecord_Size) {
+                    const SizeType start{blockRecords.size()};
+                    blockRecords.insert(
+                        blockRecords.end(),
+                        faceLoop.records.begin() + recordIdx,
+                        faceLoop.records.begin() + recordIdx +
+                            BoundaryRecord_Size);
+                    blockRecords[start + BoundaryRecord_VarOffset] += offset;
+                }
+                blockVars.insert(blockVars.end(),
+                                 faceLoop.givenVars.begin() + 1,
+                                 faceLoop.givenVars.end());
+                recordNums.push_back((int)blockRecords.size() /
+                                     BoundaryRecord_Size);
+            }
+        }
+        for (SizeType loopIdx = 0; loopIdx < faceLoops.size(); loopIdx++) {
+            const FaceRecords& faceLoop{faceLoops[loopIdx]};
+            const std::vector<int>& faceRecords{faceLoop.records};
+            const int recordNum{(int)faceRecords.size() / BoundaryRecord_Size};
+            // The iteration range covers all the records of this loop
+            std::vector<int> range(faceRecords.begin() + BoundaryRecord_Range,
+                                   faceRecords.begin() + BoundaryRecord_Size);
+            for (int recordIdx = 1; recordIdx < recordNum; recordIdx++) {
+                const int* recordRange{&faceRecords[recordIdx *
+                                                        BoundaryRecord_Size +
+                                                    BoundaryRecord_Range]};
+                for (int axis = 0; axis < SpaceDim(); axis++) {
+                    range[2 * axis] =
+                        std::min(range[2 * axis], recordRange[2 * axis]);
+                    range[2 * axis + 1] = std::max(range[2 * axis + 1],
+                                                   recordRange[2 * axis + 1]);
+                }
+            }
+            LoopPlan loop{CreateLoopPlan(block, range, (int)faceLoop.face)};
+            if (moment) {
+                loop.moment = true;
+                loop.dats = {g_Moments()[blockIndex],
+                             g_MomentsStage()[blockIndex],
+                             g_GeometryProperty()[blockIndex]};
+            } else {
+                loop.dats = {g_f()[blockIndex],
+                             g_GeometryProperty()[blockIndex]};
+            }
+            if (moment) {
+                const int replayNum{boundaryBatching
+                                        ? (int)blockRecords.size() /
+                                              BoundaryRecord_Size
+                                        : recordNums[loopIdx]};
+                loop.intArgs = {replayNum};
+                loop.intArgs.insert(
+                    loop.intArgs.end(), blockRecords.begin(),
+                    blockRecords.begin() + replayNum * BoundaryRecord_Size);
+                loop.realArgs = blockVars;
+            } else {
+                loop.intArgs = {recordNum};
+                loop.intArgs.insert(loop.intArgs.end(), faceRecords.begin(),
+                                    faceRecords.end());
+                loop.realArgs = faceLoop.givenVars;
+            }
+            if (loop.realArgs.empty()) {
+                // keep a valid pointer for the global argument
+                loop.realArgs.push_back(0);
+            }
+            boundaryPlan.push_back(loop);
+        }
+    }
+}
+
 void ImplementBoundary3D() {
-    for (const auto& boundary : BlockBoundaries()) {
-        const Block& block{g_Block().at(boundary.blockIndex)};
-        TreatBlockBoundary3D(block, boundary.componentID,
-                             boundary.givenVars.data(), boundary.boundaryScheme,
+    if (boundaryBatching || Scheme() == Scheme_StreamCollision_Moment) {
+        for (auto& loop : boundaryPlan) {
+            TreatBlockBoundary3D(loop);
+        }
+        return;
+    }
+    for (const auto& boundary : blockBoundaries) {
+        if (boundary.boundaryScheme == BoundaryScheme::FDPeriodic &&
+            IsPeriodicServedByHalos()) {
+            continue;
+        }
+        TreatBlockBoundary3D(g_Block().at(boundary.blockIndex),
+                             boundary.componentID, boundary.givenVars.data(),
+                             boundary.boundaryScheme,
                              boundary.boundarySurface);
     }
 }
@@ -67,21 +67,6 @@ const std::vector<BoundarySurface> AllBoundarySurface{BoundarySurface::Left,
 
 };
 
-enum class BoundaryScheme {
-    KineticDiffuseWall = 11,
-    KineticSpelluarWall = 12,
-    ExtrapolPressure1ST = 16,
-    ExtrapolPressure2ND = 17,
-    MDPeriodic = 18,
-    FDPeriodic = 19,
-    BounceBack = 20,
-    FreeFlux = 21,
-    ZouHeVelocity = 22,
-    EQNNoSlip = 23,
-    EQMDiffuseRefl = 24,
-    None = -1
-};
-
 struct BlockBoundary {
     int blockIndex;
     int componentID;
@@ -97,6 +82,23 @@ int BoundaryHaloNum();
 void SetBoundaryHaloNum(const int boundaryhaloNum);
 void BoundaryNormal3D(const VertexGeometryType vg, int* unitNormal);
 
+void DefinePeriodicConnection(const int blockIndex,
+                              const BoundarySurface surface);
+/*!
+ * Serve the periodic boundaries by the halos of self-connected blocks (false
+ * by default), otherwise FDPeriodic copies the populations of the periodic
+ * images into the boundary nodes after the stream step as before. The two do
+ * not give the same results, see the Manual. Only 3D Scheme_StreamCollision
+ * can choose, where the moment scheme is always served by the halos and the
+ * swap scheme and 2D always copy. Must be called before DefineBlockBoundary().
+ */
+void DefinePeriodicHalos(const bool halos);
+/*!
+ * If periodic boundaries are served by the halos of self-connected blocks,
+ * see DefinePeriodicHalos().
+ */
+bool IsPeriodicServedByHalos();
+
 void DefineBlockBoundary(int blockIndex, int componentID,
                          BoundarySurface boundarySurface,
                          BoundaryScheme boundaryScheme,
@@ -108,12 +110,39 @@ void DefineBlockBoundary(
     int blockIndex, int componentID, BoundarySurface boundarySurface,
     const VertexType boundaryType = VertexType::VirtualBoundary);
 const std::vector<BlockBoundary>& BlockBoundaries();
+// True if all components are given the same boundary types in the same
+// order, i.e., their node types are identical.
+bool IsBoundaryTypeSharedByComponents();
 #ifdef OPS_3D
 void TreatBlockBoundary3D(const Block& block, const int componentID,
                           const Real* givenVars,
                           const BoundaryScheme boundaryScheme,
                           const BoundarySurface boundarySurface);
 void ImplementBoundary3D();
+/*!
+ * Execution plan of the boundary loops, built by BuildBoundaryPlan3D() after
+ * Partition(). A loop, {f, geometry}, treats the boundary conditions of all
+ * components on one block face over the bounding box of their surfaces, and
+ * there is one loop per face unless a condition must follow one of another
+ * face that was defined later at shared nodes, i.e., the definition order is
+ * kept wherever it matters. intArgs holds the
+ * number of records and the records (see BoundaryRecord), realArgs the given
+ * variables. Under the moment scheme, a loop is {moments, momentsStage,
+ * geometry}, replays all the records of its block in order and realArgs starts
+ * with the relaxation time.
+ */
+LoopPlanGroup& g_BoundaryPlan();
+void BuildBoundaryPlan3D();
+void TreatBlockBoundary3D(LoopPlan& loop);
+/*!
+ * Treat the 3D boundary conditions by the loops of g_BoundaryPlan() (true by
+ * default), or surface by surface in the order of their definition by the
+ * per-surface TreatBlockBoundary3D(), which is kept as the reference of the
+ * batched loops. The moment scheme is then given one loop per surface, which
+ * replays the records up to its own. Must be called before Partition().
+ */
+void DefineBoundaryBatching(const bool batching);
+bool IsBoundaryBatched();
 #endif
 
 #ifdef OPS_2D
@@ -28,6 +28,35 @@ enum class BoundarySurface {
 
 };
 
+enum class BoundaryScheme {
+    KineticDiffuseWall = 11,
+    KineticSpelluarWall = 12,
+    ExtrapolPressure1ST = 16,
+    ExtrapolPressure2ND = 17,
+    MDPeriodic = 18,
+    FDPeriodic = 19,
+    BounceBack = 20,
+    FreeFlux = 21,
+    ZouHeVelocity = 22,
+    EQNNoSlip = 23,
+    EQMDiffuseRefl = 24,
+    None = -1
+};
+
+/*!
+ * Layout of a boundary record used by the batched boundary kernel, i.e.,
+ * the scheme, the boundary surface, the first and last lattice index of the
+ * component, the offset of its given variables and its iteration range.
+ */
+enum BoundaryRecord {
+    BoundaryRecord_Scheme = 0,
+    BoundaryRecord_Surface = 1,
+    BoundaryRecord_LattIdx = 2,
+    BoundaryRecord_VarOffset = 4,
+    BoundaryRecord_Range = 5,
+    BoundaryRecord_Size = 11
+};
+
 /*!
  * Discrete velocity type at a solid wall boundary
  */
@@ -704,4 +733,108 @@ static inline OPS_FUN_PREFIX BndryDvType FindBdyDvType3D(const VertexGeometryTyp
 #endif
     return res;
 }
+
+// If a boundary node with the geometry vg receives the population moving along
+// (cx, cy, cz) from its neighbour, i.e., the conditions of KerStream3D
+static inline OPS_FUN_PREFIX bool IsStreamedIn3D(const VertexGeometryType vg,
+                                                 const int cx, const int cy,
+                                                 const int cz) {
+    switch (vg) {
+        case VG_IP:
+            return cx <= 0;
+        case VG_IM:
+            return cx >= 0;
+        case VG_JP:
+            return cy <= 0;
+        case VG_JM:
+            return cy >= 0;
+        case VG_KP:
+            return cz <= 0;
+        case VG_KM:
+            return cz >= 0;
+        case VG_IPJP_I:
+            return cy <= 0 && cx <= 0;
+        case VG_IPJM_I:
+            return cy >= 0 && cx <= 0;
+        case VG_IMJP_I:
+            return cy <= 0 && cx >= 0;
+        case VG_IMJM_I:
+            return cy >= 0 && cx >= 0;
+        case VG_IPKP_I:
+            return cz <= 0 && cx <= 0;
+        case VG_IPKM_I:
+            return cz >= 0 && cx <= 0;
+        case VG_IMKP_I:
+            return cz <= 0 && cx >= 0;
+        case VG_IMKM_I:
+            return cz >= 0 && cx >= 0;
+        case VG_JPKP_I:
+            return cz <= 0 && cy <= 0;
+        case VG_JPKM_I:
+            return cz >= 0 && cy <= 0;
+        case VG_JMKP_I:
+            return cz <= 0 && cy >= 0;
+        case VG_JMKM_I:
+            return cz >= 0 && cy >= 0;
+        case VG_IPJP_O:
+            return cy <= 0 || cx <= 0;
+        case VG_IPJM_O:
+            return cy >= 0 || cx <= 0;
+        case VG_IMJP_O:
+            return cy <= 0 || cx >= 0;
+        case VG_IMJM_O:
+            return cy >= 0 || cx >= 0;
+        case VG_IPKP_O:
+            return cz <= 0 || cx <= 0;
+        case VG_IPKM_O:
+            return cz >= 0 || cx <= 0;
+        case VG_IMKP_O:
+            return cz <= 0 || cx >= 0;
+        case VG_IMKM_O:
+            return cz >= 0 || cx >= 0;
+        case VG_JPKP_O:
+            return cz <= 0 || cy <= 0;
+        case VG_JPKM_O:
+            return cz >= 0 || cy <= 0;
+        case VG_JMKP_O:
+            return cz <= 0 || cy >= 0;
+        case VG_JMKM_O:
+            return cz >= 0 || cy >= 0;
+        case VG_IPJPKP_I:
+            return cx <= 0 && cy <= 0 && cz <= 0;
+        case VG_IPJPKM_I:
+            return cx <= 0 && cy <= 0 && cz >= 0;
+        case VG_IPJMKP_I:
+            return cx <= 0 && cy >= 0 && cz <= 0;
+        case VG_IPJMKM_I:
+            return cx <= 0 && cy >= 0 && cz >= 0;
+        case VG_IMJPKP_I:
+            return cx >= 0 && cy <= 0 && cz <= 0;
+        case VG_IMJPKM_I:
+            return cx >= 0 && cy <= 0 && cz >= 0;
+        case VG_IMJMKP_I:
+            return cx >= 0 && cy >= 0 && cz <= 0;
+        case VG_IMJMKM_I:
+            return cx >= 0 && cy >= 0 && cz >= 0;
+        case VG_IPJPKP_O:
+            return cx <= 0 || cy <= 0 || cz <= 0;
+        case VG_IPJPKM_O:
+            return cx <= 0 || cy <= 0 || cz >= 0;
+        case VG_IPJMKP_O:
+            return cx <= 0 || cy >= 0 || cz <= 0;
+        case VG_IPJMKM_O:
+            return cx <= 0 || cy >= 0 || cz >= 0;
+        case VG_IMJPKP_O:
+            return cx >= 0 || cy <= 0 || cz <= 0;
+        case VG_IMJPKM_O:
+            return cx >= 0 || cy <= 0 || cz >= 0;
+        case VG_IMJMKP_O:
+            return cx >= 0 || cy >= 0 || cz <= 0;
+        case VG_IMJMKM_O:
+            return cx >= 0 || cy >= 0 || cz >= 0;
+        default:
+            return false;
+    }
+}
+
 #endif //  BOUNDARY_HOST_DEVICE_H
\ No newline at end of file
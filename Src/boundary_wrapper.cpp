@@ -7,6 +7,7 @@
 #include "boundary_host_device.h"
 #include "scheme.h"
 #include "ops_seq_v2.h"
+#include "roofline.h"
 #include "boundary_kernel.inc"
 #ifdef OPS_3D
 void TreatBlockBoundary3D(const Block& block, const int componentID,
@@ -20,6 +21,11 @@ void TreatBlockBoundary3D(const Block& block, const int componentID,
                      block.BoundarySurfaceRange().at(boundarySurface).end());
     switch (boundaryScheme) {
         case BoundaryScheme::ExtrapolPressure1ST: {
+            KERNEL_SCOPE(
+                "KerCutCellExtrapolPressure1ST3D", SpaceDim(), range.data(),
+                {{g_f()[blockIndex], OPS_RW},
+                 {g_NodeType().at(componentID).at(blockIndex), OPS_READ},
+                 {g_GeometryProperty()[blockIndex], OPS_READ}});
             ops_par_loop(
                 KerCutCellExtrapolPressure1ST3D,
                 "KerCutCellExtrapolPressure1ST3D", block.Get(), SpaceDim(),
@@ -36,6 +42,11 @@ void TreatBlockBoundary3D(const Block& block, const int componentID,
                             OPS_READ));
         } break;
         case BoundaryScheme::EQMDiffuseRefl: {
+            KERNEL_SCOPE(
+                "KerCutCellEQMDiffuseRefl3D", SpaceDim(), range.data(),
+                {{g_f()[blockIndex], OPS_RW},
+                 {g_NodeType().at(componentID).at(blockIndex), OPS_READ},
+                 {g_GeometryProperty()[blockIndex], OPS_READ}});
             ops_par_loop(
                 KerCutCellEQMDiffuseRefl3D, "KerCutCellEQMDiffuseRefl3D",
                 block.Get(), SpaceDim(), range.data(),
@@ -50,6 +61,11 @@ void TreatBlockBoundary3D(const Block& block, const int componentID,
                             OPS_READ));
         } break;
         case BoundaryScheme::FDPeriodic: {
+            KERNEL_SCOPE(
+                "KerCutCellPeriodic3D", SpaceDim(), range.data(),
+                {{g_f()[blockIndex], OPS_RW},
+                 {g_NodeType().at(componentID).at(blockIndex), OPS_READ},
+                 {g_GeometryProperty()[blockIndex], OPS_READ}});
             ops_par_loop(
                 KerCutCellPeriodic3D, "KerCutCellPeriodic3D", block.Get(),
                 SpaceDim(), range.data(),
@@ -67,6 +83,46 @@ void TreatBlockBoundary3D(const Block& block, const int componentID,
             break;
     }
 }
+
+void TreatBlockBoundary3D(LoopPlan& loop) {
+    const int recordNum{loop.intArgs[0]};
+    if (loop.moment) {
+        const int current{CurrentMomentsIndex()};
+        KERNEL_SCOPE(
+            "KerCutCellBoundaryMoment3D", SpaceDim(), loop.iterRng,
+            {{loop.dats[1 - current], OPS_RW}, {loop.dats[current], OPS_READ},
+             {loop.dats[2], OPS_READ}});
+        ops_par_loop(
+            KerCutCellBoundaryMoment3D, "KerCutCellBoundaryMoment3D",
+            loop.block, SpaceDim(), loop.iterRng,
+            ops_arg_dat(loop.dats[1 - current], Moment_Num, LOCALSTENCIL,
+                        "double", OPS_RW),
+            ops_arg_dat(loop.dats[current], Moment_Num, ONEPTLATTICESTENCIL,
+                        "double", OPS_READ),
+            ops_arg_dat(loop.dats[2], 1, LOCALSTENCIL, "int", OPS_READ),
+            ops_arg_gbl(pTimeStep(), 1, "double", OPS_READ), ops_arg_idx(),
+            ops_arg_gbl(&loop.intArgs[0], 1, "int", OPS_READ),
+            ops_arg_gbl(&loop.intArgs[1], recordNum * BoundaryRecord_Size,
+                        "int", OPS_READ),
+            ops_arg_gbl(loop.realArgs.data(), (int)loop.realArgs.size(),
+                        "double", OPS_READ));
+        return;
+    }
+    KERNEL_SCOPE(
+        "KerCutCellBoundary3D", SpaceDim(), loop.iterRng,
+        {{loop.dats[0], OPS_RW}, {loop.dats[1], OPS_READ}});
+    ops_par_loop(KerCutCellBoundary3D, "KerCutCellBoundary3D", loop.block,
+                 SpaceDim(), loop.iterRng,
+                 ops_arg_dat(loop.dats[0], NUMXI, ONEPTREGULARSTENCIL, "double",
+                             OPS_RW),
+                 ops_arg_dat(loop.dats[1], 1, LOCALSTENCIL, "int", OPS_READ),
+                 ops_arg_idx(),
+                 ops_arg_gbl(&loop.intArgs[0], 1, "int", OPS_READ),
+                 ops_arg_gbl(&loop.intArgs[1], recordNum * BoundaryRecord_Size,
+                             "int", OPS_READ),
+                 ops_arg_gbl(loop.realArgs.data(), (int)loop.realArgs.size(),
+                             "double", OPS_READ));
+}
 #endif //OPS_3D
 
 #ifdef OPS_2D
@@ -81,6 +137,11 @@ void TreatBlockBoundary(const Block& block, const int componentID,
                      block.BoundarySurfaceRange().at(boundarySurface).end());
     switch (boundaryScheme) {
         case BoundaryScheme::ExtrapolPressure1ST: {
+            KERNEL_SCOPE(
+                "KerCutCellExtrapolPressure1ST", SpaceDim(), range.data(),
+                {{g_f()[blockIndex], OPS_RW},
+                 {g_NodeType().at(componentID).at(blockIndex), OPS_READ},
+                 {g_GeometryProperty()[blockIndex], OPS_READ}});
             ops_par_loop(
                 KerCutCellExtrapolPressure1ST,
                 "KerCutCellExtrapolPressure1ST", block.Get(), SpaceDim(),
@@ -97,6 +158,11 @@ void TreatBlockBoundary(const Block& block, const int componentID,
                             OPS_READ));
         } break;
         case BoundaryScheme::EQMDiffuseRefl: {
+            KERNEL_SCOPE(
+                "KerCutCellEQMDiffuseRefl", SpaceDim(), range.data(),
+                {{g_f()[blockIndex], OPS_RW},
+                 {g_NodeType().at(componentID).at(blockIndex), OPS_READ},
+                 {g_GeometryProperty()[blockIndex], OPS_READ}});
             ops_par_loop(
                 KerCutCellEQMDiffuseRefl, "KerCutCellEQMDiffuseRefl",
                 block.Get(), SpaceDim(), range.data(),
@@ -111,6 +177,11 @@ void TreatBlockBoundary(const Block& block, const int componentID,
                             OPS_READ));
         } break;
         case BoundaryScheme::FDPeriodic: {
+            KERNEL_SCOPE(
+                "KerCutCellPeriodic", SpaceDim(), range.data(),
+                {{g_f()[blockIndex], OPS_RW},
+                 {g_NodeType().at(componentID).at(blockIndex), OPS_READ},
+                 {g_GeometryProperty()[blockIndex], OPS_READ}});
             ops_par_loop(
                 KerCutCellPeriodic, "KerCutCellPeriodic", block.Get(),
                 SpaceDim(), range.data(),
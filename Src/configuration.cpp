@@ -34,6 +34,7 @@
  * @author  Jianping Meng
  * @details Define the functions for Json configuration input
  */
+#include <algorithm>
 #include "configuration.h"
 #include "ops_lib_core.h"
 #ifdef OPS_MPI
@@ -133,12 +134,61 @@ NLOHMANN_JSON_SERIALIZE_ENUM(
     SchemeType, {{Scheme_E1st2nd, "Scheme_E1st2nd"},
                  {Scheme_StreamCollision, "Scheme_StreamCollision"},
                  {Scheme_I1st2nd, " Scheme_I1st2nd"},
-                 {Scheme_StreamCollision_Swap, "Scheme_StreamCollision_Swap"}});
+                 {Scheme_StreamCollision_Swap, "Scheme_StreamCollision_Swap"},
+                 {Scheme_StreamCollision_Moment,
+                  "Scheme_StreamCollision_Moment"}});
+
+NLOHMANN_JSON_SERIALIZE_ENUM(TileOrder, {{Tile_None, "Tile_None"},
+                                         {Tile_Morton, "Tile_Morton"},
+                                         {Tile_Hilbert, "Tile_Hilbert"}});
+
+NLOHMANN_JSON_SERIALIZE_ENUM(
+    MacroVarsLayout, {{MacroVars_Separate, "MacroVars_Separate"},
+                      {MacroVars_Interleaved, "MacroVars_Interleaved"}});
+
+NLOHMANN_JSON_SERIALIZE_ENUM(
+    PopulationStorage,
+    {{Population_Double, "Population_Double"},
+     {Population_Compressed16, "Population_Compressed16"}});
+
+NLOHMANN_JSON_SERIALIZE_ENUM(SnapshotCompression,
+                             {{Snapshot_Plain, "Snapshot_Plain"},
+                              {Snapshot_Deflate, "Snapshot_Deflate"},
+                              {Snapshot_Quantised, "Snapshot_Quantised"}});
+
+NLOHMANN_JSON_SERIALIZE_ENUM(SnapshotLayout,
+                             {{Snapshot_FilePerBlock, "Snapshot_FilePerBlock"},
+                              {Snapshot_SharedFile, "Snapshot_SharedFile"}});
+
+NLOHMANN_JSON_SERIALIZE_ENUM(ProbeType, {{Probe_Point, "Probe_Point"},
+                                         {Probe_Line, "Probe_Line"},
+                                         {Probe_Plane, "Probe_Plane"}});
+
+NLOHMANN_JSON_SERIALIZE_ENUM(SliceType, {{Slice_Plane, "Slice_Plane"},
+                                         {Slice_Subsample, "Slice_Subsample"}});
 
 const Configuration& Config() { return config; }
 
 const json& JsonConfig() { return jsonConfig; }
 
+int GetProbeNum() {
+    int num{0};
+    while (jsonConfig.contains("Probe" + std::to_string(num)) &&
+           !jsonConfig["Probe" + std::to_string(num)].is_null()) {
+        num++;
+    }
+    return num;
+}
+
+int GetSliceNum() {
+    int num{0};
+    while (jsonConfig.contains("Slice" + std::to_string(num)) &&
+           !jsonConfig["Slice" + std::to_string(num)].is_null()) {
+        num++;
+    }
+    return num;
+}
+
 int GetBlockBoundaryConditionNum() {
     int num{0};
     std::string key{"BoundaryCondition" + std::to_string(num)};
@@ -211,6 +261,78 @@ void ParseJson() {
                   bcName, "MacroVarTypesatBoundary");
         }
     }
+    if (jsonConfig.contains("TileOrder")) {
+        Query(config.tileOrder, "TileOrder");
+        if (config.tileOrder != Tile_None) {
+            Query(config.tileSize, "TileSize");
+        }
+    }
+    if (jsonConfig.contains("MacroVarsLayout")) {
+        Query(config.macroVarsLayout, "MacroVarsLayout");
+    }
+    if (jsonConfig.contains("PopulationStorage")) {
+        Query(config.populationStorage, "PopulationStorage");
+    }
+    if (jsonConfig.contains("SnapshotCompression")) {
+        Query(config.snapshotCompression, "SnapshotCompression");
+        if (jsonConfig.contains("DeflateLevel")) {
+            Query(config.deflateLevel, "DeflateLevel");
+        }
+        if (jsonConfig.contains("SnapshotTolerance")) {
+            Query(config.snapshotTolerance, "SnapshotTolerance");
+        }
+    }
+    if (jsonConfig.contains("SnapshotLayout")) {
+        Query(config.snapshotLayout, "SnapshotLayout");
+        if (jsonConfig.contains("StripeSize")) {
+            Query(config.stripeSize, "StripeSize");
+        }
+    }
+    if (jsonConfig.contains("XdmfSidecar")) {
+        Query(config.xdmfSidecar, "XdmfSidecar");
+    }
+    const int probeNum{GetProbeNum()};
+    if (probeNum > 0) {
+        Query(config.probePeriod, "ProbePeriod");
+        if (jsonConfig.contains("ProbeBufferSize")) {
+            Query(config.probeBufferSize, "ProbeBufferSize");
+        }
+    }
+    config.probes.resize(probeNum);
+    for (int probeIdx = 0; probeIdx < probeNum; probeIdx++) {
+        const std::string probeName{"Probe" + std::to_string(probeIdx)};
+        ProbeDefinition& probe{config.probes[probeIdx]};
+        Query(probe.name, probeName, "Name");
+        Query(probe.type, probeName, "Type");
+        Query(probe.origin, probeName, "Origin");
+        if (probe.type != Probe_Point) {
+            Query(probe.axis0, probeName, "Axis0");
+            Query(probe.pointNum, probeName, "PointNum");
+        }
+        if (probe.type == Probe_Plane) {
+            Query(probe.axis1, probeName, "Axis1");
+        }
+    }
+    const int sliceNum{GetSliceNum()};
+    config.slices.resize(sliceNum);
+    for (int sliceIdx = 0; sliceIdx < sliceNum; sliceIdx++) {
+        const std::string sliceName{"Slice" + std::to_string(sliceIdx)};
+        SliceDefinition& slice{config.slices[sliceIdx]};
+        Query(slice.name, sliceName, "Name");
+        Query(slice.type, sliceName, "Type");
+        Query(slice.period, sliceName, "Period");
+        if (slice.type == Slice_Plane) {
+            Query(slice.axis, sliceName, "Axis");
+            Query(slice.position, sliceName, "Position");
+        }
+        slice.stride.assign(config.spaceDim, 1);
+        if (jsonConfig[sliceName].contains("Stride")) {
+            Query(slice.stride, sliceName, "Stride");
+        }
+    }
+    if (jsonConfig.contains("StatisticsPeriod")) {
+        Query(config.statisticsPeriod, "StatisticsPeriod");
+    }
     Query(config.currentTimeStep, "CurrentTimeStep");
     Query(config.transient, "Transient");
 
@@ -277,4 +399,310 @@ void GetConfigFileFromCmd(bool& findConfig, std::string& fileName,
             break;
         }
     }
-}
\ No newline at end of file
+}
+void GetDryRunFromCmd(bool& dryRun, Real& memoryBudget, int& rankNum,
+                      const int argc, const char** argv) {
+    dryRun = false;
+    memoryBudget = 0;
+    rankNum = 1;
+#ifdef OPS_MPI
+    MPI_Comm_size(OPS_MPI_GLOBAL, &rankNum);
+#endif
+    for (int i = 1; i < argc; i++) {
+        const std::string arg{argv[i]};
+        if (arg.find("DryRun=") == 0) {
+            dryRun = true;
+            if (arg.size() > 7) {
+                memoryBudget = std::stod(arg.substr(7));
+            }
+        }
+        if (arg.find("Ranks=") == 0) {
+            rankNum = std::stoi(arg.substr(6));
+        }
+    }
+}
+
+// The types of the macroscopic variables of a component
+std::vector<VariableTypes> MacroVarTypesOfComponent(const Configuration& config,
+                                                    const int compoId) {
+    std::vector<VariableTypes> macroVarTypes;
+    for (SizeType varIdx = 0; varIdx < config.macroCompoIds.size(); varIdx++) {
+        if (config.macroCompoIds.at(varIdx) == compoId) {
+            macroVarTypes.push_back(config.macroVarTypes.at(varIdx));
+        }
+    }
+    return macroVarTypes;
+}
+
+// The body force of a component, BodyForce_None if it is not given
+BodyForceType BodyForceOfComponent(const Configuration& config,
+                                   const int compoId) {
+    BodyForceType forceType{BodyForce_None};
+    for (SizeType idx = 0; idx < config.bodyForceCompoIds.size(); idx++) {
+        if ((int)config.bodyForceCompoIds.at(idx) == compoId) {
+            forceType = config.bodyForceTypes.at(idx);
+        }
+    }
+    return forceType;
+}
+
+// The collision of a component, false if it is not given
+bool CollisionOfComponent(const Configuration& config, const int compoId,
+                          CollisionType& collisionType) {
+    const auto collision{std::find(config.CollisionCompoIds.begin(),
+                                   config.CollisionCompoIds.end(), compoId)};
+    if (collision == config.CollisionCompoIds.end()) {
+        return false;
+    }
+    collisionType = config.CollisionTypes.at(collision -
+                                             config.CollisionCompoIds.begin());
+    return true;
+}
+
+// Whether CreateMacroVars() interleaves the variables of a component
+bool IsMacroVarsInterleaved(const Configuration& config, const int compoId) {
+    CollisionType collisionType;
+    if (!CanInterleaveMacroVars(config.macroVarsLayout, config.schemeType,
+                                config.spaceDim) ||
+        !CollisionOfComponent(config, compoId, collisionType)) {
+        return false;
+    }
+    return CanInterleaveMacroVars(collisionType,
+                                  BodyForceOfComponent(config, compoId),
+                                  MacroVarTypesOfComponent(config, compoId));
+}
+
+// Whether CreateStagePopulations() keeps fStage in 16 bits
+bool IsPopulationCompressed(const Configuration& config) {
+    if (!CanCompressPopulations(config.populationStorage, config.schemeType,
+                                config.spaceDim)) {
+        return false;
+    }
+    for (const int compoId : config.compoIds) {
+        CollisionType collisionType;
+        if (!CollisionOfComponent(config, compoId, collisionType) ||
+            !CanCompressPopulations(collisionType,
+                                    BodyForceOfComponent(config, compoId),
+                                    MacroVarTypesOfComponent(config, compoId),
+                                    IsMacroVarsInterleaved(config, compoId))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * The fields created by a configuration and their bytes per node, which
+ * follows DefineBlocks, DefineComponents, DefineMacroVars, DefineBodyForce,
+ * DefineScheme, CreateMacroVars(), CreateStagePopulations() and
+ * CreateStatistics().
+ */
+std::vector<std::pair<std::string, int>> FieldsOfConfiguration(
+    const Configuration& config) {
+    const int realSize{sizeof(Real)};
+    const int intSize{sizeof(int)};
+    const int spaceDim{(int)config.spaceDim};
+    int xiNum{0};
+    for (const std::string& lattName : config.lattNames) {
+        const int latticeSize{LatticeSize(lattName)};
+        if (latticeSize == 0) {
+            ops_printf("Error! The lattice %s is unknown!\n", lattName.c_str());
+            assert(latticeSize > 0);
+        }
+        xiNum += latticeSize;
+    }
+    std::vector<std::pair<std::string, int>> fields;
+    fields.emplace_back("GeometryProperty", intSize);
+    if (config.schemeType == Scheme_StreamCollision_Moment) {
+        fields.emplace_back("Moments", Moment_Num * realSize);
+        fields.emplace_back("MomentsStage", Moment_Num * realSize);
+    } else {
+        fields.emplace_back("f", xiNum * realSize);
+    }
+    if (IsPopulationCompressed(config)) {
+        fields.emplace_back("fStageCompressed", xiNum * (int)sizeof(short));
+    } else if (config.schemeType == Scheme_StreamCollision) {
+        fields.emplace_back("fStage", xiNum * realSize);
+    }
+    for (const std::string& compoName : config.compoNames) {
+        fields.emplace_back("NodeType_" + compoName, intSize);
+    }
+    for (SizeType compoIdx = 0; compoIdx < config.compoIds.size();
+         compoIdx++) {
+        const int compoId{config.compoIds.at(compoIdx)};
+        std::vector<std::string> macroVarNames;
+        for (SizeType varIdx = 0; varIdx < config.macroCompoIds.size();
+             varIdx++) {
+            if (config.macroCompoIds.at(varIdx) == compoId) {
+                macroVarNames.push_back(config.macroVarNames.at(varIdx));
+            }
+        }
+        // The separate fields of an interleaved component only hold the
+        // initial condition of a new run
+        const bool interleaved{IsMacroVarsInterleaved(config, compoId)};
+        if (interleaved) {
+            fields.emplace_back("MacroVars_" + config.compoNames.at(compoIdx),
+                                4 * realSize);
+        }
+        for (const std::string& macroVarName : macroVarNames) {
+            if (!interleaved || config.currentTimeStep == 0) {
+                fields.emplace_back(macroVarName, realSize);
+            }
+            if (!config.transient) {
+                fields.emplace_back(macroVarName + "Copy", realSize);
+            }
+        }
+        // The running statistics, which DefineStatistics() ignores in 2D
+        if (config.statisticsPeriod > 0 && spaceDim == 3 &&
+            CanCollectStatistics(MacroVarTypesOfComponent(config, compoId))) {
+            fields.emplace_back("Statistics_" + config.compoNames.at(compoIdx),
+                                Statistics_Num * realSize);
+        }
+    }
+    for (SizeType forceIdx = 0; forceIdx < config.bodyForceCompoIds.size();
+         forceIdx++) {
+        const int compoId{(int)config.bodyForceCompoIds.at(forceIdx)};
+        if (!NeedBodyForceField(config.bodyForceTypes.at(forceIdx),
+                                MacroVarTypesOfComponent(config, compoId))) {
+            continue;
+        }
+        for (SizeType idx = 0; idx < config.compoIds.size(); idx++) {
+            if (config.compoIds.at(idx) == compoId) {
+                fields.emplace_back("Force_" + config.compoNames.at(idx),
+                                    spaceDim * realSize);
+            }
+        }
+    }
+    return fields;
+}
+
+/*
+ * The nodes of a block held by the busiest rank including the halo. Like
+ * ops_partition, every block is decomposed over all the ranks, so that each
+ * rank holds a part of every block, into a grid of ranks as MPI_Dims_create
+ * gives it, i.e., the prime factors are spread so that the numbers of ranks
+ * along the axes are as close as possible and non-increasing from the first
+ * axis, whatever the extents of the block.
+ */
+Real LocalNodes(const int* blockSize, const int spaceDim, const int rankNum) {
+    // The default halo depth of a Field
+    const int haloDepth{1};
+    std::vector<int> cuts(spaceDim, 1);
+    std::vector<int> factors;
+    int rest{rankNum};
+    for (int factor = 2; factor <= rest; factor++) {
+        while (rest % factor == 0) {
+            factors.push_back(factor);
+            rest /= factor;
+        }
+    }
+    std::sort(factors.rbegin(), factors.rend());
+    for (const int factor : factors) {
+        *std::min_element(cuts.begin(), cuts.end()) *= factor;
+    }
+    std::sort(cuts.rbegin(), cuts.rend());
+    Real nodes{1};
+    for (int axis = 0; axis < spaceDim; axis++) {
+        const int localSize{(blockSize[axis] + cuts[axis] - 1) / cuts[axis]};
+        nodes *= localSize + 2 * haloDepth;
+    }
+    return nodes;
+}
+
+Real EstimatedBytesPerRank(const Configuration& config,
+                           const std::vector<int>& blockSize,
+                           const int bytesPerNode, const int rankNum) {
+    const int spaceDim{(int)config.spaceDim};
+    Real bytes{0};
+    for (SizeType blockIdx = 0; blockIdx < config.blockIds.size();
+         blockIdx++) {
+        bytes += bytesPerNode *
+                 LocalNodes(&blockSize[blockIdx * spaceDim], spaceDim, rankNum);
+    }
+    return bytes;
+}
+
+// Scale the node numbers of all blocks by a common factor
+std::vector<int> ScaledBlockSize(const std::vector<int>& blockSize,
+                                 const Real scale) {
+    std::vector<int> scaledSize(blockSize);
+    for (int& size : scaledSize) {
+        size = std::max((int)std::round((size - 1) * scale) + 1, 2);
+    }
+    return scaledSize;
+}
+
+void EstimateMemory(const Configuration& config, const Real memoryBudget,
+                    const int rankNum) {
+    const std::vector<std::pair<std::string, int>> fields{
+        FieldsOfConfiguration(config)};
+    const int spaceDim{(int)config.spaceDim};
+    const Real mega{1024. * 1024.};
+    const Real giga{mega * 1024.};
+    int bytesPerNode{0};
+    Real domainNodes{0};
+    for (SizeType blockIdx = 0; blockIdx < config.blockIds.size();
+         blockIdx++) {
+        Real blockNodes{1};
+        for (int axis = 0; axis < spaceDim; axis++) {
+            blockNodes *= config.blockSize.at(blockIdx * spaceDim + axis);
+        }
+        domainNodes += blockNodes;
+    }
+    ops_printf("\nDry run of %s over %d ranks with %.0f nodes\n",
+               config.caseName.c_str(), rankNum, domainNodes);
+    ops_printf("%-24s %12s %12s\n", "Field", "Bytes/node", "MB/rank");
+    for (const auto& field : fields) {
+        ops_printf("%-24s %12d %12.2f\n", field.first.c_str(), field.second,
+                   EstimatedBytesPerRank(config, config.blockSize,
+                                         field.second, rankNum) /
+                       mega);
+        bytesPerNode += field.second;
+    }
+    const Real peakBytes{EstimatedBytesPerRank(config, config.blockSize,
+                                               bytesPerNode, rankNum)};
+    ops_printf("%-24s %12d %12.2f\n", "Total", bytesPerNode, peakBytes / mega);
+    ops_printf("The projected peak memory per rank is %.3f GB\n",
+               peakBytes / giga);
+    if (memoryBudget <= 0) {
+        return;
+    }
+    auto fits = [&](const Real scale) {
+        return EstimatedBytesPerRank(config,
+                                     ScaledBlockSize(config.blockSize, scale),
+                                     bytesPerNode, rankNum) <=
+               memoryBudget * giga;
+    };
+    if (!fits(0)) {
+        ops_printf("Error! Even the smallest domain exceeds %.3f GB per rank!\n",
+                   memoryBudget);
+        return;
+    }
+    Real lower{0}, upper{1};
+    while (fits(upper) && upper < 1e6) {
+        lower = upper;
+        upper *= 2;
+    }
+    for (int iter = 0; iter < 60; iter++) {
+        const Real middle{(lower + upper) / 2};
+        if (fits(middle)) {
+            lower = middle;
+        } else {
+            upper = middle;
+        }
+    }
+    const std::vector<int> largestSize{
+        ScaledBlockSize(config.blockSize, lower)};
+    ops_printf(
+        "The largest domain fitting %.3f GB per rank scales the blocks by "
+        "%.3f:\n",
+        memoryBudget, lower);
+    for (SizeType blockIdx = 0; blockIdx < config.blockIds.size();
+         blockIdx++) {
+        ops_printf("Block %s:", config.blockNames.at(blockIdx).c_str());
+        for (int axis = 0; axis < spaceDim; axis++) {
+            ops_printf(" %d", largestSize.at(blockIdx * spaceDim + axis));
+        }
+        ops_printf("\n");
+    }
+}
@@ -57,6 +57,9 @@
 #include "flowfield_host_device.h"
 #include "boundary.h"
 #include "scheme.h"
+#include "snapshot.h"
+#include "probe.h"
+#include "slice.h"
 
 /**
  * Structure for holding various input parameters.
@@ -79,6 +82,21 @@ struct Configuration {
     std::vector<InitialType> initialTypes;
     std::vector<int> initialConditionCompoId;
     SchemeType schemeType{Scheme_StreamCollision};
+    TileOrder tileOrder{Tile_None};
+    std::vector<int> tileSize;
+    MacroVarsLayout macroVarsLayout{MacroVars_Separate};
+    PopulationStorage populationStorage{Population_Double};
+    SnapshotCompression snapshotCompression{Snapshot_Plain};
+    int deflateLevel{4};
+    std::map<std::string, Real> snapshotTolerance;
+    SnapshotLayout snapshotLayout{Snapshot_FilePerBlock};
+    SizeType stripeSize{1 << 20};
+    bool xdmfSidecar{true};
+    std::vector<ProbeDefinition> probes;
+    SizeType probePeriod{0};
+    SizeType probeBufferSize{100};
+    SizeType statisticsPeriod{0};
+    std::vector<SliceDefinition> slices;
     std::vector<std::string> blockNames;
     std::vector<int> blockIds;
     std::vector<int> blockSize;
@@ -189,4 +207,34 @@ void Query(T& value, const std::string& key0, const std::string& key1) {
 void GetConfigFileFromCmd(bool& findConfig, std::string& fileName,
                           const int argc, const char** argv);
 
+/**
+ * @brief Get the dry-run request from the command line, i.e.,
+ * DryRun=<memory budget per rank in GB> and optionally Ranks=<rank number>.
+ * @param dryRun if a dry run is asked for.
+ * @param memoryBudget the memory budget per rank in GB, 0 if not given.
+ * @param rankNum the rank number to project for, the current one by default.
+ * @param argc the command line argument number.
+ * @param argv the command line arguments.
+ */
+void GetDryRunFromCmd(bool& dryRun, Real& memoryBudget, int& rankNum,
+                      const int argc, const char** argv);
+
+/**
+ * @brief Estimate the memory of the fields that a configuration will create
+ * without allocating any of them.
+ * @details The peak memory per rank is projected by assuming that every block
+ * is decomposed over all the ranks into the grid of MPI_Dims_create, which
+ * ops_partition uses unless the decomposition is given. The storage rules are
+ * those of the fields themselves, see CanInterleaveMacroVars(),
+ * CanCompressPopulations() and CanCollectStatistics(). With a budget, the
+ * largest domain, i.e., all the block sizes scaled by a common factor, whose
+ * peak per rank fits the budget is also printed. The halos of OPS itself and
+ * the MPI buffers are not included.
+ * @param config the configuration.
+ * @param memoryBudget the memory budget per rank in GB, 0 if no budget.
+ * @param rankNum the rank number.
+ */
+void EstimateMemory(const Configuration& config, const Real memoryBudget,
+                    const int rankNum);
+
 #endif  // CONFIGURATION_H
\ No newline at end of file
@@ -68,15 +68,79 @@
 // }
 
 
+std::vector<Real> phaseTimes(Phase_Num, 0);
+
+const std::string& PhaseName(const TimingPhase phase) {
+    static const std::vector<std::string> names{
+        "MacroVars", "BodyForce", "Collision", "Halo", "Stream", "Boundary"};
+    return names.at(phase);
+}
+
+const std::vector<Real>& PhaseTimes() { return phaseTimes; }
+
+void ResetPhaseTimes() { phaseTimes.assign(Phase_Num, 0); }
+
+/*!
+ * Add the time elapsed since phaseStart to the phase and return the current
+ * time as the start of the next phase.
+ */
+double AccumulatePhase(const TimingPhase phase, const double phaseStart) {
+    double cpuTime, wallTime;
+    ops_timers(&cpuTime, &wallTime);
+    phaseTimes[phase] += wallTime - phaseStart;
+    return wallTime;
+}
+
+void ReportPhaseTimes() {
+    std::vector<double> localTimes(phaseTimes.begin(), phaseTimes.end());
+    double totalTime{0};
+    for (const double phaseTime : localTimes) {
+        totalTime += phaseTime;
+    }
+    localTimes.push_back(totalTime);
+    std::vector<double> maxTimes(localTimes), sumTimes(localTimes);
+    int rankNum{1};
+#ifdef OPS_MPI
+    MPI_Comm_size(OPS_MPI_GLOBAL, &rankNum);
+    MPI_Allreduce(localTimes.data(), maxTimes.data(), (int)localTimes.size(),
+                  MPI_DOUBLE, MPI_MAX, OPS_MPI_GLOBAL);
+    MPI_Allreduce(localTimes.data(), sumTimes.data(), (int)localTimes.size(),
+                  MPI_DOUBLE, MPI_SUM, OPS_MPI_GLOBAL);
+#endif
+    ops_printf("\nPhase times over %d ranks (seconds):\n", rankNum);
+    ops_printf("%-12s %12s %12s\n", "Phase", "Max", "Average");
+    for (int phase = 0; phase <= Phase_Num; phase++) {
+        const std::string name{phase < Phase_Num
+                                    ? PhaseName((TimingPhase)phase)
+                                    : std::string("Total")};
+        ops_printf("%-12s %12.6f %12.6f\n", name.c_str(), maxTimes[phase],
+                   sumTimes[phase] / rankNum);
+    }
+}
+
+double PhaseClock() {
+    double cpuTime, wallTime;
+    ops_timers(&cpuTime, &wallTime);
+    return wallTime;
+}
+
 void Iterate(const SizeType steps, const SizeType checkPointPeriod,
              const SizeType start) {
     const SchemeType scheme = Scheme();
     ops_printf("Starting the iteration...\n");
     switch (scheme) {
-        case Scheme_StreamCollision: {
+        case Scheme_StreamCollision:
+        case Scheme_StreamCollision_Moment: {
             for (SizeType iter = start; iter < start + steps; iter++) {
                 const Real time{iter * TimeStep()};
-                StreamCollision(time);
+                if (scheme == Scheme_StreamCollision_Moment) {
+                    MomentStreamCollision(time);
+                } else {
+                    StreamCollision(time);
+                }
+                SampleProbes(iter + 1);
+                AccumulateStatistics(iter + 1);
+                WriteSlices(iter + 1);
                 if (((iter + 1) % checkPointPeriod) == 0) {
                     ops_printf("%d iterations!\n", iter + 1);
 #ifdef OPS_3D
@@ -85,16 +149,29 @@ void Iterate(const SizeType steps, const SizeType checkPointPeriod,
 #ifdef OPS_2D
                     UpdateMacroVars();
 #endif
-                    WriteFlowfieldToHdf5((iter + 1));
-                    WriteDistributionsToHdf5((iter + 1));
-                    WriteNodePropertyToHdf5((iter + 1));
+                    {
+                        SnapshotScope snapshot{CaseName(), iter + 1};
+                        WriteFlowfieldToHdf5((iter + 1));
+                        WriteDistributionsToHdf5((iter + 1));
+                        WriteNodePropertyToHdf5((iter + 1));
+                        WriteStatisticsToHdf5(iter + 1);
+                    }
+                    WriteXdmf(CaseName(), iter + 1, (iter + 1) * TimeStep());
                 }
             }
+            WriteFinalStatistics(start + steps, checkPointPeriod);
         } break;
         default:
             break;
     }
     ops_printf("Simulation finished! Exiting...\n");
+    ReportPhaseTimes();
+    ReportRoofline();
+    ReportPerfCounters();
+    ReportHugePages();
+    ReportSnapshots();
+    FlushProbes();
+    WriteTrace(CaseName() + "_trace.json");
     DestroyModel();
 
 }
@@ -104,13 +181,21 @@ void Iterate(const Real convergenceCriteria, const SizeType checkPointPeriod,
     const SchemeType scheme = Scheme();
     ops_printf("Starting the iteration...\n");
     switch (scheme) {
-        case Scheme_StreamCollision: {
+        case Scheme_StreamCollision:
+        case Scheme_StreamCollision_Moment: {
             SizeType iter{start};
             Real residualError{1};
             do {
                 const Real time{iter * TimeStep()};
-                StreamCollision(time);
+                if (scheme == Scheme_StreamCollision_Moment) {
+                    MomentStreamCollision(time);
+                } else {
+                    StreamCollision(time);
+                }
                 iter = iter + 1;
+                SampleProbes(iter);
+                AccumulateStatistics(iter);
+                WriteSlices(iter);
                 if ((iter % checkPointPeriod) == 0) {
 #ifdef OPS_3D
                     UpdateMacroVars3D();
@@ -121,16 +206,29 @@ void Iterate(const Real convergenceCriteria, const SizeType checkPointPeriod,
                     CalcResidualError();
                     residualError = GetMaximumResidual(checkPointPeriod);
                     DispResidualError(iter, checkPointPeriod);
-                    WriteFlowfieldToHdf5(iter);
-                    WriteDistributionsToHdf5(iter);
-                    WriteNodePropertyToHdf5(iter);
+                    {
+                        SnapshotScope snapshot{CaseName(), iter};
+                        WriteFlowfieldToHdf5(iter);
+                        WriteDistributionsToHdf5(iter);
+                        WriteNodePropertyToHdf5(iter);
+                        WriteStatisticsToHdf5(iter);
+                    }
+                    WriteXdmf(CaseName(), iter, iter * TimeStep());
                 }
             } while (residualError >= convergenceCriteria);
+            WriteFinalStatistics(iter, checkPointPeriod);
         } break;
         default:
             break;
     }
     ops_printf("Simulation finished! Exiting...\n");
+    ReportPhaseTimes();
+    ReportRoofline();
+    ReportPerfCounters();
+    ReportHugePages();
+    ReportSnapshots();
+    FlushProbes();
+    WriteTrace(CaseName() + "_trace.json");
     DestroyModel();
 }
 
@@ -138,13 +236,15 @@ void StreamCollision(const Real time) {
 #if DebugLevel >= 1
     ops_printf("Calculating the macroscopic variables...\n");
 #endif
+    double phaseStart{PhaseClock()};
 #ifdef OPS_3D
     UpdateMacroVars3D();
 #endif
 #ifdef OPS_2D
     UpdateMacroVars();
-#endif
     CopyBlockEnvelopDistribution(g_fStage(), g_f());
+#endif
+    phaseStart = AccumulatePhase(Phase_MacroVars, phaseStart);
 #if DebugLevel >= 1
     ops_printf("Calculating the mesoscopic body force term...\n");
 #endif
@@ -155,6 +255,7 @@ void StreamCollision(const Real time) {
 #ifdef OPS_2D
     PreDefinedBodyForce();
 #endif
+    phaseStart = AccumulatePhase(Phase_BodyForce, phaseStart);
 #if DebugLevel >= 1
     ops_printf("Calculating the collision term...\n");
 #endif
@@ -164,11 +265,13 @@ void StreamCollision(const Real time) {
 #ifdef OPS_2D
     PreDefinedCollision();
 #endif
+    phaseStart = AccumulatePhase(Phase_Collision, phaseStart);
 
 #if DebugLevel >= 1
     ops_printf("Updating the halos...\n");
 #endif
     TransferHalos();
+    phaseStart = AccumulatePhase(Phase_Halo, phaseStart);
 
 #if DebugLevel >= 1
     ops_printf("Streaming...\n");
@@ -179,6 +282,7 @@ void StreamCollision(const Real time) {
 #ifdef OPS_2D
     Stream();
 #endif
+    phaseStart = AccumulatePhase(Phase_Stream, phaseStart);
 
 #if DebugLevel >= 1
     ops_printf("Implementing the boundary conditions...\n");
@@ -190,22 +294,26 @@ void StreamCollision(const Real time) {
 #ifdef OPS_2D
     ImplementBoundary();
 #endif
+    AccumulatePhase(Phase_Boundary, phaseStart);
 }
 
 void SwapStreamCollision(const Real time) {
 #if DebugLevel >= 1
     ops_printf("Calculating the macroscopic variables...\n");
 #endif
+    double phaseStart{PhaseClock()};
 #ifdef OPS_3D
     UpdateMacroVars3D();
 #endif
 #ifdef OPS_2D
     UpdateMacroVars();
 #endif
+    phaseStart = AccumulatePhase(Phase_MacroVars, phaseStart);
 #if DebugLevel >= 1
     ops_printf("Calculating the mesoscopic body force term...\n");
 #endif
     UpdateMacroscopicBodyForce(time);
+    phaseStart = AccumulatePhase(Phase_BodyForce, phaseStart);
 
 #if DebugLevel >= 1
     ops_printf("Calculating the collision term...\n");
@@ -216,6 +324,7 @@ void SwapStreamCollision(const Real time) {
 #ifdef OPS_2D
     PreDefinedCollision();
 #endif
+    phaseStart = AccumulatePhase(Phase_Collision, phaseStart);
 
 #ifdef OPS_3D
     PreDefinedBodyForce3D();
@@ -223,11 +332,13 @@ void SwapStreamCollision(const Real time) {
 #ifdef OPS_2D
     PreDefinedBodyForce();
 #endif
+    phaseStart = AccumulatePhase(Phase_BodyForce, phaseStart);
 
 #if DebugLevel >= 1
     ops_printf("Updating the halos...\n");
 #endif
     TransferHalos();
+    phaseStart = AccumulatePhase(Phase_Halo, phaseStart);
 
 #if DebugLevel >= 1
     ops_printf("Streaming...\n");
@@ -238,6 +349,7 @@ void SwapStreamCollision(const Real time) {
 #ifdef OPS_2D
     Stream();
 #endif
+    phaseStart = AccumulatePhase(Phase_Stream, phaseStart);
 
 #if DebugLevel >= 1
     ops_printf("Implementing the boundary conditions...\n");
@@ -249,5 +361,29 @@ void SwapStreamCollision(const Real time) {
 #ifdef OPS_2D
     ImplementBoundary();
 #endif
+    AccumulatePhase(Phase_Boundary, phaseStart);
 }
 
+void MomentStreamCollision(const Real time) {
+#ifdef OPS_3D
+#if DebugLevel >= 1
+    ops_printf("Updating the halos of the moments...\n");
+#endif
+    double phaseStart{PhaseClock()};
+    CurrentMoments().TransferHalos();
+    phaseStart = AccumulatePhase(Phase_Halo, phaseStart);
+
+#if DebugLevel >= 1
+    ops_printf("Streaming and colliding the moments...\n");
+#endif
+    PredefinedStream3D();
+    phaseStart = AccumulatePhase(Phase_Stream, phaseStart);
+
+#if DebugLevel >= 1
+    ops_printf("Implementing the boundary conditions...\n");
+#endif
+    ImplementBoundary3D();
+    SwapMoments();
+    AccumulatePhase(Phase_Boundary, phaseStart);
+#endif  // OPS_3D
+}
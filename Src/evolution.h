@@ -41,6 +41,8 @@
 //#include "boundary.h"
 //#include "flowfield.h"
 //#include "model.h"
+#include "roofline.h"
+#include "arena.h"
 //#include "scheme.h"
 #include "type.h"
 #include "field.h"
@@ -69,6 +71,37 @@
  */
 void StreamCollision(const Real time);
 void SwapStreamCollision(const Real time);
+/*!
+ * Cycle of the moment scheme, see Scheme_StreamCollision_Moment, where the
+ * collision is part of the stream phase and the macroscopic variables are
+ * only computed at the check points.
+ */
+void MomentStreamCollision(const Real time);
+
+/*!
+ * The phases of a time step, whose wall time is accumulated by the
+ * stream-collision wraps so that applications can break a run down.
+ */
+enum TimingPhase {
+    Phase_MacroVars = 0,
+    Phase_BodyForce = 1,
+    Phase_Collision = 2,
+    Phase_Halo = 3,
+    Phase_Stream = 4,
+    Phase_Boundary = 5,
+    Phase_Num = 6
+};
+const std::string& PhaseName(const TimingPhase phase);
+/*!
+ * Accumulated wall time (seconds) of each phase since the last reset
+ */
+const std::vector<Real>& PhaseTimes();
+void ResetPhaseTimes();
+/*!
+ * Print the maximum and average time of each phase over all the ranks, which
+ * gives the halo fraction and the load imbalance of a run.
+ */
+void ReportPhaseTimes();
 
 void Iterate(const SizeType steps, const SizeType checkPointPeriod,
              const SizeType start = 0);
@@ -82,6 +115,9 @@ void Iterate(void (*cycle)(T), const SizeType steps,
     for (SizeType iter = start; iter < start + steps; iter++) {
         const Real time{iter * TimeStep()};
         cycle(time);
+        SampleProbes(iter + 1);
+        AccumulateStatistics(iter + 1);
+        WriteSlices(iter + 1);
         if (((iter + 1) % checkPointPeriod) == 0) {
             ops_printf("%d iterations!\n", iter + 1);
 #ifdef OPS_3D
@@ -90,12 +126,25 @@ void Iterate(void (*cycle)(T), const SizeType steps,
 #ifdef OPS_2D
             UpdateMacroVars();
 #endif
-            WriteFlowfieldToHdf5((iter + 1));
-            WriteDistributionsToHdf5((iter + 1));
-            WriteNodePropertyToHdf5((iter + 1));
+            {
+                SnapshotScope snapshot{CaseName(), iter + 1};
+                WriteFlowfieldToHdf5((iter + 1));
+                WriteDistributionsToHdf5((iter + 1));
+                WriteNodePropertyToHdf5((iter + 1));
+                WriteStatisticsToHdf5(iter + 1);
+            }
+            WriteXdmf(CaseName(), iter + 1, (iter + 1) * TimeStep());
         }
     }
+    WriteFinalStatistics(start + steps, checkPointPeriod);
     ops_printf("Simulation finished! Exiting...\n");
+    ReportPhaseTimes();
+    ReportRoofline();
+    ReportPerfCounters();
+    ReportHugePages();
+    ReportSnapshots();
+    FlushProbes();
+    WriteTrace(CaseName() + "_trace.json");
     DestroyModel();
 }
 
@@ -108,6 +157,9 @@ void Iterate(void (*cycle)(T), const Real convergenceCriteria,
         const Real time{iter * TimeStep()};
         cycle(time);
         iter = iter + 1;
+        SampleProbes(iter);
+        AccumulateStatistics(iter);
+        WriteSlices(iter);
         if ((iter % checkPointPeriod) == 0) {
 #ifdef OPS_3D
             UpdateMacroVars3D();
@@ -118,13 +170,26 @@ void Iterate(void (*cycle)(T), const Real convergenceCriteria,
             CalcResidualError();
             residualError = GetMaximumResidual(checkPointPeriod);
             DispResidualError(iter, checkPointPeriod);
-            WriteFlowfieldToHdf5(iter);
-            WriteDistributionsToHdf5(iter);
-            WriteNodePropertyToHdf5(iter);
+            {
+                SnapshotScope snapshot{CaseName(), iter};
+                WriteFlowfieldToHdf5(iter);
+                WriteDistributionsToHdf5(iter);
+                WriteNodePropertyToHdf5(iter);
+                WriteStatisticsToHdf5(iter);
+            }
+            WriteXdmf(CaseName(), iter, iter * TimeStep());
         }
     } while (residualError >= convergenceCriteria);
+    WriteFinalStatistics(iter, checkPointPeriod);
 
     ops_printf("Simulation finished! Exiting...\n");
+    ReportPhaseTimes();
+    ReportRoofline();
+    ReportPerfCounters();
+    ReportHugePages();
+    ReportSnapshots();
+    FlushProbes();
+    WriteTrace(CaseName() + "_trace.json");
     DestroyModel();
 }
 
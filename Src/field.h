@@ -38,6 +38,7 @@
  */
 #ifndef FIELD_H
 #define FIELD_H
+#include <cassert>
 #include <list>
 #include <map>
 #include <string>
@@ -48,6 +49,10 @@
 #include "ops_mpi_core.h"
 #endif
 #include "type.h"
+#include "trace.h"
+#include "memory.h"
+#include "snapshot.h"
+#include "xdmf.h"
 template <typename T>
 class Field {
    private:
@@ -64,6 +69,8 @@ class Field {
     int spaceDim{2};
 #endif
     std::string type;
+    bool freed{false};
+    void AssertNotFreed() const;
 
    public:
     Field(const std::string& varName, const int dataDim = 1,
@@ -83,9 +90,19 @@ class Field {
     void WriteToHDF5(const std::string& caseName, const SizeType timeStep) const;
     int HaloDepth() const { return haloDepth; };
     int DataDim() const { return dim; };
+    bool IsAllocated() const { return !data.empty(); };
+    // Free the dats of a field without halos, which cannot be used any more,
+    // i.e., at() stops with an error afterwards
+    void Free();
     ~Field(){};
-    ops_dat& at(int blockIdx) { return data.at(blockIdx); };
-    const ops_dat& at(int blockIdx) const { return data.at(blockIdx); };
+    ops_dat& at(int blockIdx) {
+        AssertNotFreed();
+        return data.at(blockIdx);
+    };
+    const ops_dat& at(int blockIdx) const {
+        AssertNotFreed();
+        return data.at(blockIdx);
+    };
     ops_dat& operator[](int blockIdx) { return this->at(blockIdx); };
     const ops_dat& operator[](int blockIdx) const { return this->at(blockIdx); };
     void CreateHalos();
@@ -94,6 +111,7 @@ class Field {
 template <typename T>
 void Field<T>::TransferHalos() {
     if (haloGroup != nullptr) {
+        TraceScope scope{"TransferHalos", Trace_Halo};
         ops_halo_transfer(haloGroup);
     }
 };
@@ -112,6 +130,9 @@ Field<T>::Field(const std::string& varName, const int dataDim, const int halo) {
     if (name == "d") {
         type = "double";
     }
+    if (name == "s") {
+        type = "short";
+    }
 }
 template <typename T>
 Field<T>::Field(const char* varName, const int dataDim,
@@ -129,6 +150,9 @@ Field<T>::Field(const char* varName, const int dataDim,
     if (name == "d") {
         type = "double";
     }
+    if (name == "s") {
+        type = "short";
+    }
 }
 
 template <typename T>
@@ -150,11 +174,34 @@ void Field<T>::CreateFieldFromScratch(const Block& block) {
                      d_m, d_p, temp, type.c_str(), dataName.c_str());
     data.emplace(blockId, localDat);
     dataBlock.emplace(blockId, block);
+    AccountFieldMemory(name, localDat, dim, sizeof(T), haloDepth, size);
     delete[] d_p;
     delete[] d_m;
     delete[] base;
 }
 
+template <typename T>
+void Field<T>::Free() {
+    for (auto& idDat : data) {
+        ForgetFieldMemory(idDat.second);
+        ops_free_dat(idDat.second);
+    }
+    data.clear();
+    dataBlock.clear();
+    freed = true;
+}
+
+template <typename T>
+void Field<T>::AssertNotFreed() const {
+    if (freed) {
+        ops_printf(
+            "Error! Field %s has been freed, e.g., the separate macroscopic "
+            "variables of an interleaved component, see MacroVarDat()!\n",
+            name.c_str());
+        assert(!freed);
+    }
+}
+
 template <typename T>
 void Field<T>::CreateFieldFromScratch(const BlockGroup& blocks) {
     for (const auto& idBlock : blocks) {
@@ -167,19 +214,27 @@ template <typename T>
 void Field<T>::CreateFieldFromFile(const std::string& fileName,
                                    const Block& block) {
     std::string dataName{name + "_" + block.Name()};
+    // A compressed snapshot is not known by OPS, see WriteSnapshotDat()
+    if (IsSnapshotDat(fileName, block.Name(), dataName)) {
+        CreateFieldFromScratch(block);
+        ReadSnapshotDat<T>(fileName, block.Name(), dataName,
+                           data.at(block.ID()), block.Size(), dim, haloDepth);
+        return;
+    }
     ops_dat localDat = ops_decl_dat_hdf5(block.Get(), dim, type.c_str(),
                                          dataName.c_str(), fileName.c_str());
     data.emplace(block.ID(), localDat);
     dataBlock.emplace(block.ID(), block);
+    AccountFieldMemory(name, localDat, dim, sizeof(T), haloDepth,
+                       block.Size());
 }
 
 template <typename T>
 void Field<T>::CreateFieldFromFile(const std::string& caseName,
                                    const Block& block,
                                    const SizeType timeStep) {
-    std::string fileName{caseName + "_" + block.Name() + "_T" +
-                         std::to_string(timeStep) + ".h5"};
-    CreateFieldFromFile(fileName, block);
+    CreateFieldFromFile(SnapshotFileToRead(caseName, block.Name(), timeStep),
+                        block);
 }
 
 template <typename T>
@@ -197,10 +252,19 @@ void Field<T>::WriteToHDF5(const std::string& caseName,
     for (const auto& idData : data) {
         const int blockId{idData.first};
         const Block& block{dataBlock.at(blockId)};
-        std::string fileName = caseName + "_" + block.Name() + "_T" +
-                               std::to_string(timeStep) + ".h5";
-        ops_fetch_block_hdf5_file(block.Get(), fileName.c_str());
-        ops_fetch_dat_hdf5_file(idData.second, fileName.c_str());
+        const std::string fileName{
+            SnapshotFileName(caseName, block.Name(), timeStep)};
+        TraceScope scope{"WriteToHDF5", Trace_IO};
+        // The shared file is written by WriteSnapshotDat() only
+        if (!IsSnapshotFileShared()) {
+            ops_fetch_block_hdf5_file(block.Get(), fileName.c_str());
+        }
+        const std::string datName{name + "_" + block.Name()};
+        const Real quantum{WriteSnapshot<T>(fileName, block.Name(), datName,
+                                            idData.second, name, block.Size(),
+                                            dim, haloDepth)};
+        AddXdmfDat<T>(block, fileName, datName, name, dim, haloDepth,
+                      quantum);
     }
 }
 /**
@@ -396,6 +460,8 @@ void Field<T>::CreateHalos() {
 
 using RealField = Field<Real>;
 using IntField = Field<int>;
+// 16-bit storage, e.g., the compressed populations, see DefinePopulationStorage
+using ShortField = Field<short>;
 using IntFieldGroup = std::map<int, IntField>;
 using RealFieldGroup = std::map<int, RealField>;
 #endif
\ No newline at end of file
@@ -47,6 +47,10 @@
 #include "model.h"
 #include "boundary.h"
 #include "scheme.h"
+#include "numa.h"
+#include "arena.h"
+#include <algorithm>
+#include <cmath>
 #include <vector>
 std::string CASENAME;
 bool TRANSIENT{false};
@@ -72,14 +76,23 @@ std::map<int, ops_reduction>& g_ResidualErrorHandle() {
 };
 
 RealFieldGroup MacroBodyforce;
+RealFieldGroup InterleavedMacroVars;
+ShortField fStageCompressed{"fStageCompressed"};
+RealField moments{"Moments"};
+RealField momentsStage{"MomentsStage"};
 const BlockGroup& g_Block() { return BLOCKS; };
 RealField& g_f() { return f; };
 RealField& g_fStage() { return fStage; };
 RealFieldGroup& g_MacroVars() { return MacroVars; };
 RealFieldGroup& g_MacroVarsCopy() { return MacroVarsCopy; };
 RealFieldGroup& g_MacroBodyforce() { return MacroBodyforce; };
+RealFieldGroup& g_InterleavedMacroVars() { return InterleavedMacroVars; };
+ShortField& g_fStageCompressed() { return fStageCompressed; };
+RealField& g_Moments() { return moments; };
+RealField& g_MomentsStage() { return momentsStage; };
 std::vector<RealField*> RealFieldWithHalos;
 std::vector<IntField*> IntFieldWithHalos;
+std::vector<ShortField*> ShortFieldWithHalos;
 /**
  * DT: time step
  */
@@ -92,6 +105,14 @@ IntFieldGroup NodeType;
 IntField GeometryProperty{"GeometryProperty"};
 IntFieldGroup& g_NodeType() { return NodeType; };
 IntField& g_GeometryProperty() { return GeometryProperty; };
+bool NODETYPESHARED{false};
+bool IsNodeTypeShared() { return NODETYPESHARED; }
+RealFieldGroup Statistics;
+RealFieldGroup& g_Statistics() { return Statistics; };
+SizeType STATISTICSPERIOD{0};
+SizeType STATISTICSTIMESTEP{0};
+// The statistics of (component, block) which start from zero
+std::vector<std::pair<int, int>> freshStatistics;
 
 void DefineCase(const std::string& caseName, const int spaceDim,
                 const bool transient) {
@@ -106,8 +127,34 @@ void DefineCase(const std::string& caseName, const int spaceDim,
 bool IsTransient() { return TRANSIENT; }
 
 void Partition() {
+    CreatePopulations();
+    CreateMacroVars();
+    CreateStagePopulations();
+    CreateStatistics();
+    CreateFieldHalos();
     ops_partition((char*)"LBM Solver");
+    MoveFieldsToArena();
     PrepareFlowField();
+#ifdef OPS_3D
+    // All the ranges, ops_dat handles and kernel choices of the evolution
+    // cycle are resolved once here.
+    BuildModelPlan3D();
+    BuildStreamPlan3D();
+    BuildBoundaryPlan3D();
+    // The boundary loops only sweep the block surfaces and are not tiled.
+    TileLoopPlans(g_CollisionPlan());
+    TileLoopPlans(g_MacroVarsPlan());
+    TileLoopPlans(g_BodyForcePlan());
+    // A swap stream plan replays the local swap and the swap stream, where the
+    // latter needs the former to be completed at the neighbouring tiles.
+    if (Scheme() != Scheme_StreamCollision_Swap) {
+        TileLoopPlans(g_StreamPlan());
+    }
+#endif
+    ReportThreadPlacement();
+    AdviseHugePages();
+    PlaceFieldPages();
+    ReportMemoryFootprint();
 }
 
 /*
@@ -116,16 +163,35 @@ void Partition() {
  */
 
 void WriteFlowfieldToHdf5(const SizeType timeStep) {
-    for (const auto& macroVar : MacroVars) {
-        macroVar.second.WriteToHDF5(CASENAME, timeStep);
+    for (const auto& idCompo : g_Components()) {
+        const Component& compo{idCompo.second};
+        if (IsMacroVarsInterleaved(compo)) {
+            InterleavedMacroVars.at(compo.id).WriteToHDF5(CASENAME, timeStep);
+            continue;
+        }
+        for (const auto& typeVar : compo.macroVars) {
+            MacroVars.at(typeVar.second.id).WriteToHDF5(CASENAME, timeStep);
+        }
+    }
+    // Only stretched blocks have the coordinate field, while the coordinates
+    // of a uniform block follow from its StartPos and MeshSize
+    if (CoordinateXYZ.IsAllocated()) {
+        CoordinateXYZ.WriteToHDF5(CASENAME, timeStep);
     }
-    CoordinateXYZ.WriteToHDF5(CASENAME, timeStep);
     for (const auto& force : MacroBodyforce) {
         force.second.WriteToHDF5(CASENAME, timeStep);
     }
 }
 
 void WriteDistributionsToHdf5(const SizeType timeStep) {
+#ifdef OPS_3D
+    // The moments are written (and read at a restart) under one name
+    if (Scheme() == Scheme_StreamCollision_Moment) {
+        SettleMoments3D();
+        moments.WriteToHDF5(CASENAME, timeStep);
+        return;
+    }
+#endif
     f.WriteToHDF5(CASENAME, timeStep);
 }
 
@@ -194,20 +260,10 @@ void DefineBlocks(const std::vector<int>& blockIds,
     const SizeType blockNum{BLOCKS.size()};
     SizeType numBlockStartPos{startPos.size()};
     if (numBlockStartPos == (blockNum)) {
+        // Uniform blocks need no coordinate field, see NodeCoordinate()
         for (const auto& idStartPos : startPos) {
-            std::vector<std::vector<Real>> blockCoordinates(SPACEDIM);
-            const int id{idStartPos.first};
-            const std::vector<Real> blockStartPos{idStartPos.second};
-            for (int coordIndex = 0; coordIndex < SPACEDIM; coordIndex++) {
-                const int numOfGridPoints{BLOCKS.at(id).Size().at(coordIndex)};
-                blockCoordinates.at(coordIndex).resize(numOfGridPoints);
-                for (int nodeIndex = 0; nodeIndex < numOfGridPoints;
-                     nodeIndex++) {
-                    blockCoordinates.at(coordIndex).at(nodeIndex) =
-                        blockStartPos.at(coordIndex) + nodeIndex * meshSize;
-                }
-            }
-            COORDINATES.emplace(id, blockCoordinates);
+            BLOCKS.at(idStartPos.first)
+                .SetUniformGrid(idStartPos.second, meshSize);
         }
     } else {
         ops_printf(
@@ -216,11 +272,33 @@ void DefineBlocks(const std::vector<int>& blockIds,
             blockNum, numBlockStartPos);
         assert(numBlockStartPos == blockNum);
     }
-    //NodeType.CreateFieldFromScratch(BLOCKS);
+    GeometryProperty.CreateFieldFromScratch(BLOCKS);
+}
+
+void DefineBlocks(
+    const std::vector<int>& blockIds,
+    const std::vector<std::string>& blockNames,
+    const std::vector<int>& blockSizes,
+    const std::map<int, std::vector<std::vector<Real>>>& coordinates) {
+    DefineBlocks(blockIds, blockNames, blockSizes);
+    const SizeType blockNum{BLOCKS.size()};
+    if (coordinates.size() != blockNum) {
+        ops_printf(
+            "Error! We expect coordinates for %i blocks, but only received %i "
+            "blocks!\n",
+            (int)blockNum, (int)coordinates.size());
+        assert(coordinates.size() == blockNum);
+    }
     CoordinateXYZ.SetDataDim(SPACEDIM);
-    CoordinateXYZ.CreateFieldFromScratch(BLOCKS);
+    for (const auto& idCoordinates : coordinates) {
+        Block& block{BLOCKS.at(idCoordinates.first)};
+        block.SetStretchedGrid(idCoordinates.second);
+        COORDINATES.emplace(idCoordinates.first, idCoordinates.second);
+        CoordinateXYZ.CreateFieldFromScratch(block);
+    }
     GeometryProperty.CreateFieldFromScratch(BLOCKS);
 }
+
 void PrepareFlowField() {
     ops_printf("The coordinates are assigned!\n");
     for (const auto& idBlock: BLOCKS) {
@@ -235,12 +313,25 @@ void PrepareFlowField() {
                 "Block %i\n",
                 idCompo.first, blockId);
         }
-        AssignCoordinates(block, COORDINATES.at(blockId));
+        if (!block.IsUniform()) {
+            AssignCoordinates(block, COORDINATES.at(blockId));
+        }
     }
     SetBoundaryNodeType();
+    NODETYPESHARED = IsBoundaryTypeSharedByComponents();
+    if (NODETYPESHARED && ComponentNum() > 1 && IsMultiComponentFusion()) {
+        ops_printf(
+            "All components share the same node type, fused kernels will be "
+            "used!\n");
+    }
     if (!IsTransient()) {
         CopyCurrentMacroVar();
     }
+#ifdef OPS_3D
+    for (const auto& compoBlock : freshStatistics) {
+        ResetStatistics3D(compoBlock.first, compoBlock.second);
+    }
+#endif
 }
 
 void DispResidualError(const int iter, const SizeType checkPeriod) {
@@ -255,6 +346,196 @@ void DispResidualError(const int iter, const SizeType checkPeriod) {
     }
 }
 
+std::vector<ProbePoint> probePoints;
+// The points of each probe in probePoints
+std::vector<std::pair<SizeType, SizeType>> probePointRanges;
+// The points of each probe in each block, which are sampled together
+std::vector<ProbeGroup> probeGroups;
+
+// The position of pos in the index space along an axis of a block, which is
+// negative if pos is out of the block.
+Real ProbeIndexCoordinate(const Block& block, const int axis, const Real pos) {
+    const int size{block.Size().at(axis)};
+    Real coordinate{-1};
+    if (block.IsUniform()) {
+        coordinate =
+            (pos - block.Grid()[2 * axis]) / block.Grid()[2 * axis + 1];
+    } else {
+        const std::vector<Real>& nodes{COORDINATES.at(block.ID()).at(axis)};
+        const auto upper{std::upper_bound(nodes.begin(), nodes.end(), pos)};
+        if (upper != nodes.begin() && upper != nodes.end()) {
+            const int lower{(int)(upper - nodes.begin()) - 1};
+            coordinate = lower + (pos - nodes[lower]) /
+                                     (nodes[lower + 1] - nodes[lower]);
+        } else if (pos == nodes.back()) {
+            coordinate = size - 1;
+        }
+    }
+    const Real tolerance{1e-9 * size};
+    if (coordinate < -tolerance || coordinate > size - 1 + tolerance) {
+        return -1;
+    }
+    return std::min(std::max(coordinate, (Real)0), (Real)(size - 1));
+}
+
+// Gather the points of a probe in a block, i.e., those of probePoints from
+// first to last, into a group with the range of their cells, where the points
+// are sorted by the corners of their cells numbered in the range.
+void GroupProbePoints(const std::string& probeName, const Block& block,
+                      const SizeType first, const SizeType last) {
+    ProbeGroup group;
+    group.blockId = block.ID();
+    for (int axis = 0; axis < SPACEDIM; axis++) {
+        group.range[2 * axis] = block.Size().at(axis);
+        group.range[2 * axis + 1] = 0;
+    }
+    for (SizeType pointIdx = first; pointIdx < last; pointIdx++) {
+        const ProbePoint& point{probePoints[pointIdx]};
+        if (point.blockId != block.ID()) {
+            continue;
+        }
+        group.points.push_back(pointIdx);
+        // The cell is a node wide along an axis of one node
+        for (int axis = 0; axis < SPACEDIM; axis++) {
+            group.range[2 * axis] =
+                std::min(group.range[2 * axis], point.corner[axis]);
+            group.range[2 * axis + 1] =
+                std::max(group.range[2 * axis + 1],
+                         std::min(point.corner[axis] + 2,
+                                  block.Size().at(axis)));
+        }
+    }
+    if (group.points.empty()) {
+        return;
+    }
+    std::vector<std::pair<int, SizeType>> keyPoints;
+    for (const SizeType pointIdx : group.points) {
+        const ProbePoint& point{probePoints[pointIdx]};
+        int key{0};
+        for (int axis = SPACEDIM - 1; axis >= 0; axis--) {
+            key = key * (group.range[2 * axis + 1] - group.range[2 * axis]) +
+                  point.corner[axis] - group.range[2 * axis];
+        }
+        keyPoints.emplace_back(key, pointIdx);
+    }
+    std::stable_sort(keyPoints.begin(), keyPoints.end());
+    group.points.clear();
+    for (const auto& keyPoint : keyPoints) {
+        const ProbePoint& point{probePoints[keyPoint.second]};
+        group.keys.push_back(keyPoint.first);
+        group.points.push_back(keyPoint.second);
+        group.fractions.insert(group.fractions.end(), point.fraction,
+                               point.fraction + SPACEDIM);
+    }
+    const int varNum{(int)MacroVars.size()};
+    group.samples = ops_decl_reduction_handle(
+        group.points.size() * varNum * sizeof(Real), "double",
+        ("Probe_" + probeName + "_" + block.Name()).c_str());
+    probeGroups.push_back(group);
+}
+
+void LocateProbes() {
+    std::string columns;
+    for (const auto& idCompo : g_Components()) {
+        for (const auto& typeVar : idCompo.second.macroVars) {
+            columns += " " + typeVar.second.name;
+        }
+    }
+    for (const ProbeDefinition& probe : ProbeSetting().probes) {
+        const std::vector<std::vector<Real>> positions{ProbePositions(probe)};
+        probePointRanges.emplace_back(probePoints.size(),
+                                      probePoints.size() + positions.size());
+        ProbeBuffer buffer;
+        buffer.fileName = CASENAME + "_Probe_" + probe.name + ".dat";
+        buffer.header = "# Probe " + probe.name + " of " +
+                        std::to_string(positions.size()) + " points\n";
+        for (SizeType pointIdx = 0; pointIdx < positions.size(); pointIdx++) {
+            const std::vector<Real>& position{positions[pointIdx]};
+            ProbePoint point;
+            for (const auto& idBlock : BLOCKS) {
+                const Block& block{idBlock.second};
+                bool inside{position.size() == (SizeType)SPACEDIM};
+                for (int axis = 0; inside && axis < SPACEDIM; axis++) {
+                    const Real coordinate{
+                        ProbeIndexCoordinate(block, axis, position[axis])};
+                    inside = coordinate >= 0;
+                    const int size{block.Size().at(axis)};
+                    point.corner[axis] = std::max(
+                        std::min((int)coordinate, size - 2), 0);
+                    point.fraction[axis] = coordinate - point.corner[axis];
+                }
+                if (inside) {
+                    point.blockId = block.ID();
+                    break;
+                }
+            }
+            std::string where{"# Point " + std::to_string(pointIdx) + " at"};
+            for (const Real coordinate : position) {
+                where += " " + std::to_string(coordinate);
+            }
+            if (point.blockId < 0) {
+                ops_printf(
+                    "Warning! Point %i of Probe %s is out of the blocks and "
+                    "will be written as nan!\n",
+                    pointIdx, probe.name.c_str());
+                where += " out of the blocks";
+            } else {
+                where += " in Block " + BLOCKS.at(point.blockId).Name();
+            }
+            buffer.header += where + "\n";
+            probePoints.push_back(point);
+        }
+        for (const auto& idBlock : BLOCKS) {
+            GroupProbePoints(probe.name, idBlock.second,
+                             probePointRanges.back().first,
+                             probePointRanges.back().second);
+        }
+        buffer.header +=
+            "# TimeStep Time, then for each point:" + columns + "\n";
+        if (IsProbeWriter()) {
+            AddProbeBuffer(buffer);
+        }
+    }
+}
+
+void SampleProbes(const SizeType timeStep) {
+    const ProbeSettings& setting{ProbeSetting()};
+    if (setting.probes.empty() || (timeStep % setting.period) != 0) {
+        return;
+    }
+    TraceScope scope{"SampleProbes", Trace_Reduction};
+    if (probePoints.empty()) {
+        LocateProbes();
+    }
+    const int varNum{(int)MacroVars.size()};
+    std::vector<Real> samples(probePoints.size() * varNum, NAN);
+    for (ProbeGroup& group : probeGroups) {
+#ifdef OPS_3D
+        UpdateMacroVarsInRange3D(group.blockId, group.range);
+#endif
+        CalcProbeSample(group);
+    }
+    // The results are only fetched once all the loops are issued
+    for (ProbeGroup& group : probeGroups) {
+        std::vector<Real> groupSamples(group.points.size() * varNum);
+        ops_reduction_result(group.samples, groupSamples.data());
+        for (SizeType idx = 0; idx < group.points.size(); idx++) {
+            std::copy(groupSamples.begin() + idx * varNum,
+                      groupSamples.begin() + (idx + 1) * varNum,
+                      samples.begin() + group.points[idx] * varNum);
+        }
+    }
+    for (SizeType probeIdx = 0; probeIdx < probePointRanges.size();
+         probeIdx++) {
+        const std::pair<SizeType, SizeType>& points{
+            probePointRanges[probeIdx]};
+        AppendProbeSample(
+            probeIdx, timeStep, timeStep * DT,
+            std::vector<Real>(samples.begin() + points.first * varNum,
+                              samples.begin() + points.second * varNum));
+    }
+}
+
 void DefineBlockConnection(const std::vector<int>& fromBlock,
                            const std::vector<BoundarySurface>& fromSurface,
                            const std::vector<int>& toBlock,
@@ -282,14 +563,34 @@ void DefineBlockConnection(const std::vector<int>& fromBlock,
     }
 }
 
+// The halos are created at Partition() when all the block connections,
+// including the periodic ones given by boundary conditions, are known.
 void RegisterFieldNeedHalo(RealField& field) {
-    field.CreateHalos();
     RealFieldWithHalos.push_back(&field);
 }
 void RegisterFieldNeedHalo(IntField& field) {
-    field.CreateHalos();
     IntFieldWithHalos.push_back(&field);
 }
+void RegisterFieldNeedHalo(ShortField& field) {
+    ShortFieldWithHalos.push_back(&field);
+}
+void DeregisterFieldNeedHalo(RealField& field) {
+    RealFieldWithHalos.erase(std::remove(RealFieldWithHalos.begin(),
+                                         RealFieldWithHalos.end(), &field),
+                             RealFieldWithHalos.end());
+}
+
+void CreateFieldHalos() {
+    for (auto field : RealFieldWithHalos) {
+        field->CreateHalos();
+    }
+    for (auto field : IntFieldWithHalos) {
+        field->CreateHalos();
+    }
+    for (auto field : ShortFieldWithHalos) {
+        field->CreateHalos();
+    }
+}
 
 void TransferHalos() {
     for (auto field : RealFieldWithHalos) {
@@ -299,4 +600,161 @@ void TransferHalos() {
     for (auto field : IntFieldWithHalos) {
         field->TransferHalos();
     }
+
+    for (auto field : ShortFieldWithHalos) {
+        field->TransferHalos();
+    }
+}
+
+void DefineStatistics(const SizeType period, const SizeType timeStep) {
+#ifdef OPS_2D
+    if (period > 0) {
+        ops_printf(
+            "Warning! The running statistics are only implemented for 3D "
+            "problems and will not be collected!\n");
+        return;
+    }
+#endif
+    STATISTICSPERIOD = period;
+    STATISTICSTIMESTEP = timeStep;
+}
+
+void CreateStatistics() {
+    if (STATISTICSPERIOD == 0) {
+        return;
+    }
+    for (const auto& idCompo : g_Components()) {
+        const Component& compo{idCompo.second};
+        std::vector<VariableTypes> macroVarTypes;
+        for (const auto& typeVar : compo.macroVars) {
+            macroVarTypes.push_back(typeVar.first);
+        }
+        if (!CanCollectStatistics(macroVarTypes)) {
+            ops_printf(
+                "The running statistics are not collected for Component %s "
+                "which does not have Rho, U, V and W\n",
+                compo.name.c_str());
+            continue;
+        }
+        RealField statistics{"Statistics_" + compo.name, Statistics_Num};
+        Statistics.emplace(compo.id, statistics);
+        RealField& field{Statistics.at(compo.id)};
+        for (const auto& idBlock : BLOCKS) {
+            const Block& block{idBlock.second};
+            const std::string fileName{SnapshotFileToRead(
+                CASENAME, block.Name(), STATISTICSTIMESTEP)};
+            if (STATISTICSTIMESTEP > 0 &&
+                HasSnapshotDat(fileName, block.Name(),
+                               "Statistics_" + compo.name + "_" +
+                                   block.Name())) {
+                field.CreateFieldFromFile(fileName, block);
+                continue;
+            }
+            if (STATISTICSTIMESTEP > 0) {
+                ops_printf(
+                    "Warning! There are no running statistics of Component "
+                    "%s at Block %s in the checkpoint, which start from zero "
+                    "again!\n",
+                    compo.name.c_str(), block.Name().c_str());
+            }
+            field.CreateFieldFromScratch(block);
+            freshStatistics.emplace_back(compo.id, block.ID());
+        }
+    }
+}
+
+void AccumulateStatistics(const SizeType timeStep) {
+    if (Statistics.empty() || (timeStep % STATISTICSPERIOD) != 0) {
+        return;
+    }
+#ifdef OPS_3D
+    TraceScope scope{"AccumulateStatistics", Trace_Kernel};
+    // The macroscopic variables of the standard scheme lag a step behind and
+    // the moment scheme does not keep them
+    UpdateMacroVars3D();
+    CalcStatistics3D();
+#endif
+}
+
+void WriteStatisticsToHdf5(const SizeType timeStep) {
+    for (const auto& statistics : Statistics) {
+        statistics.second.WriteToHDF5(CASENAME, timeStep);
+    }
+}
+
+void WriteFinalStatistics(const SizeType timeStep,
+                          const SizeType checkPointPeriod) {
+    if (Statistics.empty() || (timeStep % checkPointPeriod) == 0) {
+        return;
+    }
+    {
+        SnapshotScope snapshot{CASENAME, timeStep};
+        WriteStatisticsToHdf5(timeStep);
+    }
+    WriteXdmf(CASENAME, timeStep, timeStep * DT);
+}
+
+void WriteSlices(const SizeType timeStep) {
+    std::vector<const SliceDefinition*> dueSlices;
+    bool subsample{false};
+    for (const SliceDefinition& slice : SliceSetting()) {
+        if ((timeStep % slice.period) == 0) {
+            dueSlices.push_back(&slice);
+            subsample = subsample || slice.type == Slice_Subsample;
+        }
+    }
+    if (dueSlices.empty()) {
+        return;
+    }
+    TraceScope scope{"WriteSlices", Trace_IO};
+    // A plane only needs the macroscopic variables at its nodes
+#ifdef OPS_3D
+    if (subsample) {
+        UpdateMacroVars3D();
+    }
+#endif
+#ifdef OPS_2D
+    UpdateMacroVars();
+#endif
+    for (const SliceDefinition* slice : dueSlices) {
+        const std::string fileName{CASENAME + "_" + slice->name + "_T" +
+                                   std::to_string(timeStep) + ".h5"};
+        SnapshotScope sliceFile{fileName};
+        for (const auto& idBlock : BLOCKS) {
+            const Block& block{idBlock.second};
+            std::vector<int> range(2 * SPACEDIM, 0);
+            std::vector<int> stride{slice->stride};
+            for (int axis = 0; axis < SPACEDIM; axis++) {
+                range[2 * axis + 1] = block.Size().at(axis);
+            }
+            if (slice->type == Slice_Plane) {
+                const int axis{slice->axis};
+                const Real coordinate{
+                    ProbeIndexCoordinate(block, axis, slice->position)};
+                if (coordinate < 0) {
+                    continue;
+                }
+                range[2 * axis] = (int)std::lround(coordinate);
+                range[2 * axis + 1] = range[2 * axis] + 1;
+                stride[axis] = 1;
+#ifdef OPS_3D
+                UpdateMacroVarsInRange3D(block.ID(), range.data());
+#endif
+            }
+            for (const auto& idCompo : g_Components()) {
+                const Component& compo{idCompo.second};
+                for (const auto& typeVar : compo.macroVars) {
+                    const MacroVariable& macroVar{typeVar.second};
+                    int dim{1};
+                    int component{0};
+                    const ops_dat dat{MacroVarDat(compo, typeVar.first,
+                                                  block.ID(), dim, component)};
+                    WriteSliceDat(fileName, block.Name(),
+                                  macroVar.name + "_" + block.Name(),
+                                  slice->name + "_" + macroVar.name, dat, dim,
+                                  component, range, stride);
+                }
+            }
+        }
+    }
 }
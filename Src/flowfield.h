@@ -48,6 +48,8 @@
 #include "type.h"
 #include "block.h"
 #include "field.h"
+#include "probe.h"
+#include "slice.h"
 
 const BlockGroup& g_Block();
 RealField& g_f();
@@ -56,9 +58,21 @@ RealFieldGroup& g_MacroVars();
 RealFieldGroup& g_MacroVarsCopy();
 
 RealFieldGroup& g_MacroBodyforce();
+// The interleaved macroscopic variables of each component, see
+// DefineMacroVarsLayout()
+RealFieldGroup& g_InterleavedMacroVars();
+// The 16-bit post-collision populations, see DefinePopulationStorage()
+ShortField& g_fStageCompressed();
+// The pair of moment fields replacing f and fStage under the moment scheme,
+// see Scheme_StreamCollision_Moment
+RealField& g_Moments();
+RealField& g_MomentsStage();
 
 RealField& g_CoordinateXYZ();
 IntFieldGroup& g_NodeType();
+// True if all components have the same node type so that multi-component
+// kernels can use the node type of the first component.
+bool IsNodeTypeShared();
 IntField& g_GeometryProperty();
 Real TimeStep();
 const Real* pTimeStep();
@@ -98,9 +112,47 @@ void DefineBlocks(const std::vector<int>& blockIds,
                   const std::vector<std::string>& blockNames,
                   const std::vector<int>& blockSizes, const Real meshSize,
                   const std::map<int, std::vector<Real>>& startPos);
+// Stretched blocks, where coordinates gives the coordinates of the nodes
+// along each axis of each block, which are kept in g_CoordinateXYZ().
+void DefineBlocks(
+    const std::vector<int>& blockIds,
+    const std::vector<std::string>& blockNames,
+    const std::vector<int>& blockSizes,
+    const std::map<int, std::vector<std::vector<Real>>>& coordinates);
 bool IsTransient();
 
 void CalcResidualError();
+/*!
+ * Sample the probes if timeStep is a multiple of their period, see
+ * DefineProbes()
+ */
+void SampleProbes(const SizeType timeStep);
+// Interpolate the macroscopic variables at the points of a group from the
+// nodes of their cells by one loop over the range of the group per variable
+void CalcProbeSample(ProbeGroup& group);
+/*!
+ * Collect the running statistics of the density and velocity of each
+ * component every period steps, where a period of 0 collects nothing. At a
+ * restart, i.e., timeStep > 0, the statistics continue from those in the
+ * checkpoint if any.
+ */
+void DefineStatistics(const SizeType period, const SizeType timeStep = 0);
+// The statistics of each component, see StatisticsIndex
+RealFieldGroup& g_Statistics();
+void CreateStatistics();
+// Add a sample to the statistics if timeStep is a multiple of their period
+void AccumulateStatistics(const SizeType timeStep);
+void WriteStatisticsToHdf5(const SizeType timeStep);
+// Write the slices of which timeStep is a multiple of the period, see
+// DefineSlices()
+void WriteSlices(const SizeType timeStep);
+// Write the statistics at the last step unless a checkpoint just did
+void WriteFinalStatistics(const SizeType timeStep,
+                          const SizeType checkPointPeriod);
+#ifdef OPS_3D
+void ResetStatistics3D(const int compoId, const int blockId);
+void CalcStatistics3D();
+#endif
 void DispResidualError(const int iter, const SizeType checkPeriod);
 void CopyDistribution(RealField& fDest, RealField& fSrc);
 void CopyBlockEnvelopDistribution(Field<Real>& fDest, Field<Real>& fSrc);
@@ -132,5 +184,9 @@ void TransferHalos();
 
 void RegisterFieldNeedHalo(RealField& field);
 void RegisterFieldNeedHalo(IntField& field);
+void RegisterFieldNeedHalo(ShortField& field);
+// Stop exchanging the halos of a field which is replaced before Partition()
+void DeregisterFieldNeedHalo(RealField& field);
+void CreateFieldHalos();
 
 #endif
@@ -148,5 +148,67 @@ static inline OPS_FUN_PREFIX int SpaceDim(){return 3;};
 #ifdef OPS_2D
 static inline OPS_FUN_PREFIX int SpaceDim(){return 2;};
 #endif
+// The coordinate of a node along an axis, where grid is given by Block::Grid()
+// and idx by ops_arg_idx() within the block. A uniform block computes it from
+// the start position and mesh size, a stretched one looks it up in the table
+// of the axis.
+static inline OPS_FUN_PREFIX Real NodeCoordinate(const Real* grid,
+                                                 const int* idx,
+                                                 const int axis) {
+    const int stretched{2 * SpaceDim()};
+    if (grid[stretched] == 0) {
+        return grid[2 * axis] + idx[axis] * grid[2 * axis + 1];
+    }
+    return grid[(int)grid[stretched + 1 + axis] + idx[axis]];
+}
+
+/*!
+ * The running statistics kept at a node by AccumulateStatistics(), i.e., the
+ * number of samples, the means of the density and velocity, the sum of the
+ * squared deviations of the density, and the co-moments of the velocity
+ * components, i.e., the sums of u_i'u_j' which divided by the count give the
+ * Reynolds stresses.
+ */
+enum StatisticsIndex {
+    Statistics_Count = 0,
+    Statistics_Rho = 1,
+    Statistics_RhoM2 = 2,
+    Statistics_U = 3,
+    Statistics_V = 4,
+    Statistics_W = 5,
+    Statistics_UU = 6,
+    Statistics_VV = 7,
+    Statistics_WW = 8,
+    Statistics_UV = 9,
+    Statistics_UW = 10,
+    Statistics_VW = 11,
+    Statistics_Num = 12
+};
+
+// Add a sample to the statistics s by Welford's update, which unlike the raw
+// sums of squares does not lose the fluctuations to the cancellation against
+// the mean over a long average.
+static inline OPS_FUN_PREFIX void UpdateStatistics(Real* s, const Real rho,
+                                                   const Real* velocity) {
+    const Real count{s[Statistics_Count] + 1};
+    const Real deltaRho{rho - s[Statistics_Rho]};
+    s[Statistics_Count] = count;
+    s[Statistics_Rho] += deltaRho / count;
+    s[Statistics_RhoM2] += deltaRho * (rho - s[Statistics_Rho]);
+    Real delta[3];
+    for (int axis = 0; axis < 3; axis++) {
+        delta[axis] = velocity[axis] - s[Statistics_U + axis];
+        s[Statistics_U + axis] += delta[axis] / count;
+    }
+    // A pair takes the deviation of one component from the old mean and the
+    // other from the new mean.
+    const int pairs[6][2]{{0, 0}, {1, 1}, {2, 2}, {0, 1}, {0, 2}, {1, 2}};
+    for (int pair = 0; pair < 6; pair++) {
+        const int second{pairs[pair][1]};
+        s[Statistics_UU + pair] +=
+            delta[pairs[pair][0]] *
+            (velocity[second] - s[Statistics_U + second]);
+    }
+}
 
 #endif // FLOWFIELD_HOST_DEVICE_H
\ No newline at end of file
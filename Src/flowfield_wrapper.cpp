@@ -5,84 +5,119 @@
 #include "model.h"
 #include "scheme.h"
 #include "ops_seq_v2.h"
+#include "roofline.h"
 #include "flowfield_kernel.inc"
 
 void CopyCurrentMacroVar() {
-    for (auto& pair : g_MacroVars()) {
-        const int varId{pair.first};
-        RealField& macroVar{pair.second};
-        RealField& macroVarCopy{g_MacroVarsCopy().at(varId)};
-        for (const auto& idBlock : g_Block()) {
-            const Block& block{idBlock.second};
-            std::vector<int> iterRng;
-            iterRng.assign(block.WholeRange().begin(),
-                           block.WholeRange().end());
-            const int blockIdx{block.ID()};
-            ops_par_loop(KerCopyMacroVars, "KerCopyMacroVars", block.Get(),
-                         SpaceDim(), iterRng.data(),
-                         ops_arg_dat(macroVar.at(blockIdx), 1, LOCALSTENCIL,
-                                     "double", OPS_READ),
-                         ops_arg_dat(macroVarCopy.at(blockIdx), 1, LOCALSTENCIL,
-                                     "double", OPS_RW));
+    for (const auto& idCompo : g_Components()) {
+        const Component& compo{idCompo.second};
+        for (const auto& typeVar : compo.macroVars) {
+            RealField& macroVarCopy{g_MacroVarsCopy().at(typeVar.second.id)};
+            for (const auto& idBlock : g_Block()) {
+                const Block& block{idBlock.second};
+                std::vector<int> iterRng;
+                iterRng.assign(block.WholeRange().begin(),
+                               block.WholeRange().end());
+                const int blockIdx{block.ID()};
+                int dim{1};
+                int index{0};
+                const ops_dat macroVar{
+                    MacroVarDat(compo, typeVar.first, blockIdx, dim, index)};
+                KERNEL_SCOPE(
+                    "KerCopyMacroVars", SpaceDim(), iterRng.data(),
+                    {{macroVar, OPS_READ},
+                     {macroVarCopy.at(blockIdx), OPS_RW}});
+                ops_par_loop(KerCopyMacroVars, "KerCopyMacroVars", block.Get(),
+                             SpaceDim(), iterRng.data(),
+                             ops_arg_dat(macroVar, dim, LOCALSTENCIL, "double",
+                                         OPS_READ),
+                             ops_arg_dat(macroVarCopy.at(blockIdx), 1,
+                                         LOCALSTENCIL, "double", OPS_RW),
+                             ops_arg_gbl(&index, 1, "int", OPS_READ));
+            }
         }
     }
 }
 
 void CalcResidualError() {
     std::map<int, Real> diff;
-    for (const auto& pair : g_MacroVars()) {
-        const int varId{pair.first};
-        const RealField& macroVar{pair.second};
-        const RealField& macroVarCopy{g_MacroVarsCopy().at(varId)};
-        Real error{0};
-        diff.emplace(varId, error);
-        for (const auto& idBlock : g_Block()) {
-            const Block& block{idBlock.second};
-            std::vector<int> iterRng;
-            iterRng.assign(block.WholeRange().begin(),
-                           block.WholeRange().end());
-            const int blockIdx{block.ID()};
-            ops_par_loop(KerCalcMacroVarSquareofDifference,
-                         "KerCalcMacroVarSquareofDifference", block.Get(),
-                         SpaceDim(), iterRng.data(),
-                         ops_arg_dat(macroVar.at(blockIdx), 1, LOCALSTENCIL,
-                                     "double", OPS_READ),
-                         ops_arg_dat(macroVarCopy.at(blockIdx), 1, LOCALSTENCIL,
-                                     "double", OPS_READ),
-                         // TODO if we can change "double" here?
-                         ops_arg_reduce(g_ResidualErrorHandle().at(varId), 1,
-                                        "double", OPS_INC));
+    for (const auto& idCompo : g_Components()) {
+        const Component& compo{idCompo.second};
+        for (const auto& typeVar : compo.macroVars) {
+            const int varId{typeVar.second.id};
+            const RealField& macroVarCopy{g_MacroVarsCopy().at(varId)};
+            Real error{0};
+            diff.emplace(varId, error);
+            for (const auto& idBlock : g_Block()) {
+                const Block& block{idBlock.second};
+                std::vector<int> iterRng;
+                iterRng.assign(block.WholeRange().begin(),
+                               block.WholeRange().end());
+                const int blockIdx{block.ID()};
+                int dim{1};
+                int index{0};
+                const ops_dat macroVar{
+                    MacroVarDat(compo, typeVar.first, blockIdx, dim, index)};
+                KERNEL_SCOPE(
+                    "KerCalcMacroVarSquareofDifference", SpaceDim(),
+                    iterRng.data(),
+                    {{macroVar, OPS_READ},
+                     {macroVarCopy.at(blockIdx), OPS_READ}});
+                ops_par_loop(KerCalcMacroVarSquareofDifference,
+                             "KerCalcMacroVarSquareofDifference", block.Get(),
+                             SpaceDim(), iterRng.data(),
+                             ops_arg_dat(macroVar, dim, LOCALSTENCIL, "double",
+                                         OPS_READ),
+                             ops_arg_dat(macroVarCopy.at(blockIdx), 1,
+                                         LOCALSTENCIL, "double", OPS_READ),
+                             ops_arg_gbl(&index, 1, "int", OPS_READ),
+                             // TODO if we can change "double" here?
+                             ops_arg_reduce(g_ResidualErrorHandle().at(varId),
+                                            1, "double", OPS_INC));
+            }
         }
     }
     // TODO:check if ops_reduction_results works directly for multi-block
     for (const auto& pair : g_MacroVars()) {
+        TraceScope scope{"ResidualDifference", Trace_Reduction};
         ops_reduction_result(g_ResidualErrorHandle().at(pair.first),
                              &diff.at(pair.first));
     }
 
     CopyCurrentMacroVar();
 
-    for (const auto& pair : g_MacroVars()) {
-        const int varId{pair.first};
-        const RealField& macroVar{pair.second};
-        for (const auto& idBlock : g_Block()) {
-            const Block& block{idBlock.second};
-            std::vector<int> iterRng;
-            iterRng.assign(block.WholeRange().begin(),
-                           block.WholeRange().end());
-            const int blockIdx{block.ID()};
-            ops_par_loop(KerCalcMacroVarSquare, "KerCalcMacroVarSquare3D",
-                         block.Get(), SpaceDim(), iterRng.data(),
-                         ops_arg_dat(macroVar.at(blockIdx), 1, LOCALSTENCIL,
-                                     "double", OPS_READ),
-                         ops_arg_reduce(g_ResidualErrorHandle().at(varId), 1,
-                                        "double", OPS_INC));
+    for (const auto& idCompo : g_Components()) {
+        const Component& compo{idCompo.second};
+        for (const auto& typeVar : compo.macroVars) {
+            const int varId{typeVar.second.id};
+            for (const auto& idBlock : g_Block()) {
+                const Block& block{idBlock.second};
+                std::vector<int> iterRng;
+                iterRng.assign(block.WholeRange().begin(),
+                               block.WholeRange().end());
+                const int blockIdx{block.ID()};
+                int dim{1};
+                int index{0};
+                const ops_dat macroVar{
+                    MacroVarDat(compo, typeVar.first, blockIdx, dim, index)};
+                KERNEL_SCOPE(
+                    "KerCalcMacroVarSquare3D", SpaceDim(), iterRng.data(),
+                    {{macroVar, OPS_READ}});
+                ops_par_loop(KerCalcMacroVarSquare, "KerCalcMacroVarSquare3D",
+                             block.Get(), SpaceDim(), iterRng.data(),
+                             ops_arg_dat(macroVar, dim, LOCALSTENCIL, "double",
+                                         OPS_READ),
+                             ops_arg_gbl(&index, 1, "int", OPS_READ),
+                             ops_arg_reduce(g_ResidualErrorHandle().at(varId),
+                                            1, "double", OPS_INC));
+            }
         }
     }
 
     for (const auto& pair : g_MacroVars()) {
         int varId{pair.first};
         Real sum{0};
+        TraceScope scope{"ResidualSquare", Trace_Reduction};
         ops_reduction_result(g_ResidualErrorHandle().at(varId), &sum);
         g_ResidualError().at(varId) = diff.at(varId) / sum;
     }
@@ -94,6 +129,9 @@ void CopyDistribution(RealField& fDest, RealField& fSrc) {
         std::vector<int> iterRng;
         iterRng.assign(block.WholeRange().begin(), block.WholeRange().end());
         const int blockIndex{block.ID()};
+        KERNEL_SCOPE(
+            "KerCopyf", SpaceDim(), iterRng.data(),
+            {{fDest[blockIndex], OPS_WRITE}, {fSrc[blockIndex], OPS_READ}});
         ops_par_loop(KerCopyf, "KerCopyf", block.Get(), SpaceDim(),
                      iterRng.data(),
                      ops_arg_dat(fDest[blockIndex], NUMXI, LOCALSTENCIL,
@@ -232,8 +270,8 @@ void CopyBlockEnvelopDistribution(Field<Real>& fDest, Field<Real>& fSrc) {
 }
 
 void NormaliseF(Real* ratio) {
-    for (auto idBlock : g_Block()) {
-        Block& block{idBlock.second};
+    for (const auto& idBlock : g_Block()) {
+        const Block& block{idBlock.second};
         std::vector<int> iterRng;
         iterRng.assign(block.WholeRange().begin(), block.WholeRange().end());
         const int blockIdx{block.ID()};
@@ -288,6 +326,23 @@ void AssignCoordinates(const Block& block,
 #endif
 }
 
+// Empty the iteration range if any of the surfaces is connected periodically
+// and served by the halos, so that the geometry property is only given by
+// physical boundaries.
+void ExcludePeriodicSurface(const Block& block,
+                            const std::vector<BoundarySurface>& surfaces,
+                            int* range) {
+    if (!IsPeriodicServedByHalos()) {
+        return;
+    }
+    for (const auto surface : surfaces) {
+        if (block.Neighbors().count(surface) > 0 &&
+            block.Neighbors().at(surface).type == VertexType::MDPeriodic) {
+            range[1] = range[0];
+        }
+    }
+}
+
 void SetBlockGeometryProperty(const Block& block) {
     int geometryProperty = (int)VG_Fluid;
     // int* iterRange = BlockIterRng(blockIndex, IterRngBulk());
@@ -396,11 +451,30 @@ void SetBlockGeometryProperty(const Block& block) {
                              "int", OPS_WRITE));
 #endif  // OPS_3D
 
+    // Periodic surfaces served by the halos are not geometric boundaries but
+    // the faces, edges and corners shared with them are treated by the other
+    // surfaces
+    geometryProperty = VG_Fluid;
+    for (const auto& surfaceNeighbor : block.Neighbors()) {
+        if (surfaceNeighbor.second.type == VertexType::MDPeriodic &&
+            IsPeriodicServedByHalos()) {
+            iterRange.assign(
+                block.BoundarySurfaceRange().at(surfaceNeighbor.first).begin(),
+                block.BoundarySurfaceRange().at(surfaceNeighbor.first).end());
+            ops_par_loop(KerSetIntField, "KerSetIntField", block.Get(),
+                         SpaceDim(), iterRange.data(),
+                         ops_arg_gbl(&geometryProperty, 1, "int", OPS_READ),
+                         ops_arg_dat(g_GeometryProperty()[block.ID()], 1,
+                                     LOCALSTENCIL, "int", OPS_WRITE));
+        }
+    }
+
     // specify domain
     geometryProperty = VG_JP;
     iterRange.assign(
         block.BoundarySurfaceRange().at(BoundarySurface::Bottom).begin(),
         block.BoundarySurfaceRange().at(BoundarySurface::Bottom).end());
+    ExcludePeriodicSurface(block, {BoundarySurface::Bottom}, iterRange.data());
     ops_par_loop(KerSetIntField, "KerSetIntField", block.Get(), SpaceDim(),
                  iterRange.data(),
                  ops_arg_gbl(&geometryProperty, 1, "int", OPS_READ),
@@ -410,6 +484,7 @@ void SetBlockGeometryProperty(const Block& block) {
     iterRange.assign(
         block.BoundarySurfaceRange().at(BoundarySurface::Top).begin(),
         block.BoundarySurfaceRange().at(BoundarySurface::Top).end());
+    ExcludePeriodicSurface(block, {BoundarySurface::Top}, iterRange.data());
     ops_par_loop(KerSetIntField, "KerSetIntField", block.Get(), SpaceDim(),
                  iterRange.data(),
                  ops_arg_gbl(&geometryProperty, 1, "int", OPS_READ),
@@ -419,6 +494,7 @@ void SetBlockGeometryProperty(const Block& block) {
     iterRange.assign(
         block.BoundarySurfaceRange().at(BoundarySurface::Left).begin(),
         block.BoundarySurfaceRange().at(BoundarySurface::Left).end());
+    ExcludePeriodicSurface(block, {BoundarySurface::Left}, iterRange.data());
     ops_par_loop(KerSetIntField, "KerSetIntField", block.Get(), SpaceDim(),
                  iterRange.data(),
                  ops_arg_gbl(&geometryProperty, 1, "int", OPS_READ),
@@ -428,6 +504,7 @@ void SetBlockGeometryProperty(const Block& block) {
     iterRange.assign(
         block.BoundarySurfaceRange().at(BoundarySurface::Right).begin(),
         block.BoundarySurfaceRange().at(BoundarySurface::Right).end());
+    ExcludePeriodicSurface(block, {BoundarySurface::Right}, iterRange.data());
     ops_par_loop(KerSetIntField, "KerSetIntField", block.Get(), SpaceDim(),
                  iterRange.data(),
                  ops_arg_gbl(&geometryProperty, 1, "int", OPS_READ),
@@ -438,6 +515,7 @@ void SetBlockGeometryProperty(const Block& block) {
     iterRange.assign(
         block.BoundarySurfaceRange().at(BoundarySurface::Back).begin(),
         block.BoundarySurfaceRange().at(BoundarySurface::Back).end());
+    ExcludePeriodicSurface(block, {BoundarySurface::Back}, iterRange.data());
     ops_par_loop(KerSetIntField, "KerSetIntField", block.Get(), SpaceDim(),
                  iterRange.data(),
                  ops_arg_gbl(&geometryProperty, 1, "int", OPS_READ),
@@ -447,6 +525,7 @@ void SetBlockGeometryProperty(const Block& block) {
     iterRange.assign(
         block.BoundarySurfaceRange().at(BoundarySurface::Front).begin(),
         block.BoundarySurfaceRange().at(BoundarySurface::Front).end());
+    ExcludePeriodicSurface(block, {BoundarySurface::Front}, iterRange.data());
     ops_par_loop(KerSetIntField, "KerSetIntField", block.Get(), SpaceDim(),
                  iterRange.data(),
                  ops_arg_gbl(&geometryProperty, 1, "int", OPS_READ),
@@ -459,6 +538,8 @@ void SetBlockGeometryProperty(const Block& block) {
     // 2D Domain corner points four types
 #ifdef OPS_2D
     int iminjmin[]{0, 1, 0, 1};
+    ExcludePeriodicSurface(
+        block, {BoundarySurface::Left, BoundarySurface::Bottom}, iminjmin);
     geometryProperty = VG_IPJP_I;
     ops_par_loop(KerSetIntField, "KerSetIntField", block.Get(), SpaceDim(),
                  iminjmin, ops_arg_gbl(&geometryProperty, 1, "int", OPS_READ),
@@ -488,24 +569,32 @@ void SetBlockGeometryProperty(const Block& block) {
     const int nz{(int)block.Size().at(2)};
     // 3D Domain edges 12 types
     int iminjmin[]{0, 1, 0, 1, 0, nz};
+    ExcludePeriodicSurface(
+        block, {BoundarySurface::Left, BoundarySurface::Bottom}, iminjmin);
     geometryProperty = VG_IPJP_I;
     ops_par_loop(KerSetIntField, "KerSetIntField", block.Get(), SpaceDim(),
                  iminjmin, ops_arg_gbl(&geometryProperty, 1, "int", OPS_READ),
                  ops_arg_dat(g_GeometryProperty()[block.ID()], 1, LOCALSTENCIL,
                              "int", OPS_WRITE));
     int iminjmax[]{0, 1, ny - 1, ny, 0, nz};
+    ExcludePeriodicSurface(
+        block, {BoundarySurface::Left, BoundarySurface::Top}, iminjmax);
     geometryProperty = VG_IPJM_I;
     ops_par_loop(KerSetIntField, "KerSetIntField", block.Get(), SpaceDim(),
                  iminjmax, ops_arg_gbl(&geometryProperty, 1, "int", OPS_READ),
                  ops_arg_dat(g_GeometryProperty()[block.ID()], 1, LOCALSTENCIL,
                              "int", OPS_WRITE));
     int imaxjmax[]{nx - 1, nx, ny - 1, ny, 0, nz};
+    ExcludePeriodicSurface(
+        block, {BoundarySurface::Right, BoundarySurface::Top}, imaxjmax);
     geometryProperty = VG_IMJM_I;
     ops_par_loop(KerSetIntField, "KerSetIntField", block.Get(), SpaceDim(),
                  imaxjmax, ops_arg_gbl(&geometryProperty, 1, "int", OPS_READ),
                  ops_arg_dat(g_GeometryProperty()[block.ID()], 1, LOCALSTENCIL,
                              "int", OPS_WRITE));
     int imaxjmin[]{nx - 1, nx, 0, 1, 0, nz};
+    ExcludePeriodicSurface(
+        block, {BoundarySurface::Right, BoundarySurface::Bottom}, imaxjmin);
     geometryProperty = VG_IMJP_I;
     ops_par_loop(KerSetIntField, "KerSetIntField", block.Get(), SpaceDim(),
                  imaxjmin, ops_arg_gbl(&geometryProperty, 1, "int", OPS_READ),
@@ -513,24 +602,32 @@ void SetBlockGeometryProperty(const Block& block) {
                              "int", OPS_WRITE));
 
     int iminkmin[]{0, 1, 0, ny, 0, 1};
+    ExcludePeriodicSurface(
+        block, {BoundarySurface::Left, BoundarySurface::Back}, iminkmin);
     geometryProperty = VG_IPKP_I;
     ops_par_loop(KerSetIntField, "KerSetIntField", block.Get(), SpaceDim(),
                  iminkmin, ops_arg_gbl(&geometryProperty, 1, "int", OPS_READ),
                  ops_arg_dat(g_GeometryProperty()[block.ID()], 1, LOCALSTENCIL,
                              "int", OPS_WRITE));
     int iminkmax[]{0, 1, 0, ny, nz - 1, nz};
+    ExcludePeriodicSurface(
+        block, {BoundarySurface::Left, BoundarySurface::Front}, iminkmax);
     geometryProperty = VG_IPKM_I;
     ops_par_loop(KerSetIntField, "KerSetIntField", block.Get(), SpaceDim(),
                  iminkmax, ops_arg_gbl(&geometryProperty, 1, "int", OPS_READ),
                  ops_arg_dat(g_GeometryProperty()[block.ID()], 1, LOCALSTENCIL,
                              "int", OPS_WRITE));
     int imaxkmax[]{nx - 1, nx, 0, ny, nz - 1, nz};
+    ExcludePeriodicSurface(
+        block, {BoundarySurface::Right, BoundarySurface::Front}, imaxkmax);
     geometryProperty = VG_IMKM_I;
     ops_par_loop(KerSetIntField, "KerSetIntField", block.Get(), SpaceDim(),
                  imaxkmax, ops_arg_gbl(&geometryProperty, 1, "int", OPS_READ),
                  ops_arg_dat(g_GeometryProperty()[block.ID()], 1, LOCALSTENCIL,
                              "int", OPS_WRITE));
     int imaxkmin[]{nx - 1, nx, 0, ny, 0, 1};
+    ExcludePeriodicSurface(
+        block, {BoundarySurface::Right, BoundarySurface::Back}, imaxkmin);
     geometryProperty = VG_IMKP_I;
     ops_par_loop(KerSetIntField, "KerSetIntField", block.Get(), SpaceDim(),
                  imaxkmin, ops_arg_gbl(&geometryProperty, 1, "int", OPS_READ),
@@ -538,24 +635,32 @@ void SetBlockGeometryProperty(const Block& block) {
                              "int", OPS_WRITE));
 
     int jminkmin[]{0, nx, 0, 1, 0, 1};
+    ExcludePeriodicSurface(
+        block, {BoundarySurface::Bottom, BoundarySurface::Back}, jminkmin);
     geometryProperty = VG_JPKP_I;
     ops_par_loop(KerSetIntField, "KerSetIntField", block.Get(), SpaceDim(),
                  jminkmin, ops_arg_gbl(&geometryProperty, 1, "int", OPS_READ),
                  ops_arg_dat(g_GeometryProperty()[block.ID()], 1, LOCALSTENCIL,
                              "int", OPS_WRITE));
     int jminkmax[]{0, nx, 0, 1, nz - 1, nz};
+    ExcludePeriodicSurface(
+        block, {BoundarySurface::Bottom, BoundarySurface::Front}, jminkmax);
     geometryProperty = VG_JPKM_I;
     ops_par_loop(KerSetIntField, "KerSetIntField", block.Get(), SpaceDim(),
                  jminkmax, ops_arg_gbl(&geometryProperty, 1, "int", OPS_READ),
                  ops_arg_dat(g_GeometryProperty()[block.ID()], 1, LOCALSTENCIL,
                              "int", OPS_WRITE));
     int jmaxkmax[]{0, nx, ny - 1, ny, nz - 1, nz};
+    ExcludePeriodicSurface(
+        block, {BoundarySurface::Top, BoundarySurface::Front}, jmaxkmax);
     geometryProperty = VG_JMKM_I;
     ops_par_loop(KerSetIntField, "KerSetIntField", block.Get(), SpaceDim(),
                  jmaxkmax, ops_arg_gbl(&geometryProperty, 1, "int", OPS_READ),
                  ops_arg_dat(g_GeometryProperty()[block.ID()], 1, LOCALSTENCIL,
                              "int", OPS_WRITE));
     int jmaxkmin[]{0, nx, ny - 1, ny, 0, 1};
+    ExcludePeriodicSurface(
+        block, {BoundarySurface::Top, BoundarySurface::Back}, jmaxkmin);
     geometryProperty = VG_JMKP_I;
     ops_par_loop(KerSetIntField, "KerSetIntField", block.Get(), SpaceDim(),
                  jmaxkmin, ops_arg_gbl(&geometryProperty, 1, "int", OPS_READ),
@@ -564,6 +669,10 @@ void SetBlockGeometryProperty(const Block& block) {
 
     // 3D domain corners 8 types
     int iminjminkmin[]{0, 1, 0, 1, 0, 1};
+    ExcludePeriodicSurface(block,
+                           {BoundarySurface::Left, BoundarySurface::Bottom,
+                            BoundarySurface::Back},
+                           iminjminkmin);
     geometryProperty = VG_IPJPKP_I;
     ops_par_loop(KerSetIntField, "KerSetIntField", block.Get(), SpaceDim(),
                  iminjminkmin,
@@ -571,6 +680,10 @@ void SetBlockGeometryProperty(const Block& block) {
                  ops_arg_dat(g_GeometryProperty()[block.ID()], 1, LOCALSTENCIL,
                              "int", OPS_WRITE));
     int iminjminkmax[]{0, 1, 0, 1, nz - 1, nz};
+    ExcludePeriodicSurface(block,
+                           {BoundarySurface::Left, BoundarySurface::Bottom,
+                            BoundarySurface::Front},
+                           iminjminkmax);
     geometryProperty = VG_IPJPKM_I;
     ops_par_loop(KerSetIntField, "KerSetIntField", block.Get(), SpaceDim(),
                  iminjminkmax,
@@ -578,6 +691,10 @@ void SetBlockGeometryProperty(const Block& block) {
                  ops_arg_dat(g_GeometryProperty()[block.ID()], 1, LOCALSTENCIL,
                              "int", OPS_WRITE));
     int iminjmaxkmin[]{0, 1, ny - 1, ny, 0, 1};
+    ExcludePeriodicSurface(block,
+                           {BoundarySurface::Left, BoundarySurface::Top,
+                            BoundarySurface::Back},
+                           iminjmaxkmin);
     geometryProperty = VG_IPJMKP_I;
     ops_par_loop(KerSetIntField, "KerSetIntField", block.Get(), SpaceDim(),
                  iminjmaxkmin,
@@ -585,6 +702,10 @@ void SetBlockGeometryProperty(const Block& block) {
                  ops_arg_dat(g_GeometryProperty()[block.ID()], 1, LOCALSTENCIL,
                              "int", OPS_WRITE));
     int iminjmaxkmax[]{0, 1, ny - 1, ny, nz - 1, nz};
+    ExcludePeriodicSurface(block,
+                           {BoundarySurface::Left, BoundarySurface::Top,
+                            BoundarySurface::Front},
+                           iminjmaxkmax);
     geometryProperty = VG_IPJMKM_I;
     ops_par_loop(KerSetIntField, "KerSetIntField", block.Get(), SpaceDim(),
                  iminjmaxkmax,
@@ -592,6 +713,10 @@ void SetBlockGeometryProperty(const Block& block) {
                  ops_arg_dat(g_GeometryProperty()[block.ID()], 1, LOCALSTENCIL,
                              "int", OPS_WRITE));
     int imaxjminkmin[]{nx - 1, nx, 0, 1, 0, 1};
+    ExcludePeriodicSurface(block,
+                           {BoundarySurface::Right, BoundarySurface::Bottom,
+                            BoundarySurface::Back},
+                           imaxjminkmin);
     geometryProperty = VG_IMJPKP_I;
     ops_par_loop(KerSetIntField, "KerSetIntField", block.Get(), SpaceDim(),
                  imaxjminkmin,
@@ -599,6 +724,10 @@ void SetBlockGeometryProperty(const Block& block) {
                  ops_arg_dat(g_GeometryProperty()[block.ID()], 1, LOCALSTENCIL,
                              "int", OPS_WRITE));
     int imaxjminkmax[]{nx - 1, nx, 0, 1, nz - 1, nz};
+    ExcludePeriodicSurface(block,
+                           {BoundarySurface::Right, BoundarySurface::Bottom,
+                            BoundarySurface::Front},
+                           imaxjminkmax);
     geometryProperty = VG_IMJPKM_I;
     ops_par_loop(KerSetIntField, "KerSetIntField", block.Get(), SpaceDim(),
                  imaxjminkmax,
@@ -606,6 +735,10 @@ void SetBlockGeometryProperty(const Block& block) {
                  ops_arg_dat(g_GeometryProperty()[block.ID()], 1, LOCALSTENCIL,
                              "int", OPS_WRITE));
     int imaxjmaxkmin[]{nx - 1, nx, ny - 1, ny, 0, 1};
+    ExcludePeriodicSurface(block,
+                           {BoundarySurface::Right, BoundarySurface::Top,
+                            BoundarySurface::Back},
+                           imaxjmaxkmin);
     geometryProperty = VG_IMJMKP_I;
     ops_par_loop(KerSetIntField, "KerSetIntField", block.Get(), SpaceDim(),
                  imaxjmaxkmin,
@@ -613,6 +746,10 @@ void SetBlockGeometryProperty(const Block& block) {
                  ops_arg_dat(g_GeometryProperty()[block.ID()], 1, LOCALSTENCIL,
                              "int", OPS_WRITE));
     int imaxjmaxkmax[]{nx - 1, nx, ny - 1, ny, nz - 1, nz};
+    ExcludePeriodicSurface(block,
+                           {BoundarySurface::Right, BoundarySurface::Top,
+                            BoundarySurface::Front},
+                           imaxjmaxkmax);
     geometryProperty = VG_IMJMKM_I;
     ops_par_loop(KerSetIntField, "KerSetIntField", block.Get(), SpaceDim(),
                  imaxjmaxkmax,
@@ -623,7 +760,20 @@ void SetBlockGeometryProperty(const Block& block) {
 }
 
 void SetBoundaryNodeType() {
-    for (auto& boundary : BlockBoundaries()) {
+    // Periodic surfaces are set first so that the physical boundaries take
+    // the shared edges and corners
+    std::vector<BlockBoundary> boundaries;
+    for (const auto& boundary : BlockBoundaries()) {
+        if (boundary.boundaryType == VertexType::MDPeriodic) {
+            boundaries.push_back(boundary);
+        }
+    }
+    for (const auto& boundary : BlockBoundaries()) {
+        if (boundary.boundaryType != VertexType::MDPeriodic) {
+            boundaries.push_back(boundary);
+        }
+    }
+    for (auto& boundary : boundaries) {
         const int intBoundaryType{(int)boundary.boundaryType};
         const Block& block{g_Block().at(boundary.blockIndex)};
         const BoundarySurface surface{boundary.boundarySurface};
@@ -786,3 +936,111 @@ void SetBulkandHaloNodesType(const Block& block, int compoId) {
 #endif  // OPS_3D
     FreeArrayMemory(haloIterRng);
 }
+
+void CalcProbeSample(ProbeGroup& group) {
+    const int varNum{(int)g_MacroVars().size()};
+    const int pointNum{(int)group.points.size()};
+    // The number of points, the component of the variable in its dat, the
+    // position of the variable in a sample, the variables of a sample, then
+    // the lower end and the size of the range along each axis
+    int info[10]{pointNum, 0, 0, varNum, 0, 0, 0, 1, 1, 1};
+    for (int axis = 0; axis < SpaceDim(); axis++) {
+        info[4 + axis] = group.range[2 * axis];
+        info[7 + axis] = group.range[2 * axis + 1] - group.range[2 * axis];
+    }
+    int varIdx{0};
+    for (const auto& idCompo : g_Components()) {
+        const Component& compo{idCompo.second};
+        for (const auto& typeVar : compo.macroVars) {
+            int dim{1};
+            const ops_dat macroVar{MacroVarDat(compo, typeVar.first,
+                                               group.blockId, dim, info[1])};
+            info[2] = varIdx;
+            KERNEL_SCOPE("KerSampleProbes", SpaceDim(), group.range,
+                         {{macroVar, OPS_READ}});
+            ops_par_loop(KerSampleProbes, "KerSampleProbes",
+                         g_Block().at(group.blockId).Get(), SpaceDim(),
+                         group.range,
+                         ops_arg_dat(macroVar, dim, LOCALSTENCIL, "double",
+                                     OPS_READ),
+                         ops_arg_idx(),
+                         ops_arg_gbl(group.keys.data(), pointNum, "int",
+                                     OPS_READ),
+                         ops_arg_gbl(group.fractions.data(),
+                                     pointNum * SpaceDim(), "double", OPS_READ),
+                         ops_arg_gbl(info, 10, "int", OPS_READ),
+                         ops_arg_reduce(group.samples, pointNum * varNum,
+                                        "double", OPS_INC));
+            varIdx++;
+        }
+    }
+}
+
+#ifdef OPS_3D
+void ResetStatistics3D(const int compoId, const int blockId) {
+    const Block& block{g_Block().at(blockId)};
+    std::vector<int> iterRng;
+    iterRng.assign(block.WholeRange().begin(), block.WholeRange().end());
+    KERNEL_SCOPE(
+        "KerResetStatistics3D", SpaceDim(), iterRng.data(),
+        {{g_Statistics().at(compoId).at(blockId), OPS_WRITE}});
+    ops_par_loop(KerResetStatistics3D, "KerResetStatistics3D", block.Get(),
+                 SpaceDim(), iterRng.data(),
+                 ops_arg_dat(g_Statistics().at(compoId).at(blockId),
+                             Statistics_Num, LOCALSTENCIL, "double",
+                             OPS_WRITE));
+}
+
+void CalcStatistics3D() {
+    for (auto& idStatistics : g_Statistics()) {
+        const Component& compo{g_Components().at(idStatistics.first)};
+        RealField& statistics{idStatistics.second};
+        for (const auto& idBlock : g_Block()) {
+            const Block& block{idBlock.second};
+            const int blockIdx{block.ID()};
+            std::vector<int> iterRng;
+            iterRng.assign(block.WholeRange().begin(),
+                           block.WholeRange().end());
+            if (IsMacroVarsInterleaved(compo)) {
+                KERNEL_SCOPE(
+                    "KerAccumulateStatisticsInterleaved3D", SpaceDim(),
+                    iterRng.data(),
+                    {{statistics.at(blockIdx), OPS_RW},
+                     {g_InterleavedMacroVars().at(compo.id).at(blockIdx),
+                      OPS_READ}});
+                ops_par_loop(
+                    KerAccumulateStatisticsInterleaved3D,
+                    "KerAccumulateStatisticsInterleaved3D", block.Get(),
+                    SpaceDim(), iterRng.data(),
+                    ops_arg_dat(statistics.at(blockIdx), Statistics_Num,
+                                LOCALSTENCIL, "double", OPS_RW),
+                    ops_arg_dat(
+                        g_InterleavedMacroVars().at(compo.id).at(blockIdx), 4,
+                        LOCALSTENCIL, "double", OPS_READ));
+                continue;
+            }
+            const int rhoId{compo.macroVars.at(Variable_Rho).id};
+            KERNEL_SCOPE(
+                "KerAccumulateStatistics3D", SpaceDim(), iterRng.data(),
+                {{statistics.at(blockIdx), OPS_RW},
+                 {g_MacroVars().at(rhoId).at(blockIdx), OPS_READ},
+                 {g_MacroVars().at(compo.uId).at(blockIdx), OPS_READ},
+                 {g_MacroVars().at(compo.vId).at(blockIdx), OPS_READ},
+                 {g_MacroVars().at(compo.wId).at(blockIdx), OPS_READ}});
+            ops_par_loop(
+                KerAccumulateStatistics3D, "KerAccumulateStatistics3D",
+                block.Get(), SpaceDim(), iterRng.data(),
+                ops_arg_dat(statistics.at(blockIdx), Statistics_Num,
+                            LOCALSTENCIL, "double", OPS_RW),
+                ops_arg_dat(g_MacroVars().at(rhoId).at(blockIdx), 1,
+                            LOCALSTENCIL, "double", OPS_READ),
+                ops_arg_dat(g_MacroVars().at(compo.uId).at(blockIdx), 1,
+                            LOCALSTENCIL, "double", OPS_READ),
+                ops_arg_dat(g_MacroVars().at(compo.vId).at(blockIdx), 1,
+                            LOCALSTENCIL, "double", OPS_READ),
+                ops_arg_dat(g_MacroVars().at(compo.wId).at(blockIdx), 1,
+                            LOCALSTENCIL, "double", OPS_READ));
+        }
+    }
+}
+#endif  // OPS_3D
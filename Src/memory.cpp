@@ -0,0 +1,125 @@
+/**
+ * Copyright 2019 United Kingdom Research and Innovation
+ *
+ * Authors: See AUTHORS
+ *
+ * Contact: [jianping.meng@stfc.ac.uk and/or jpmeng@gmail.com]
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * ANDANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*! @brief   Account the memory footprint of the fields
+ * @author  Jianping Meng
+ * @details The records of the fields and the report of their memory, see
+ * memory.h.
+ */
+#include "memory.h"
+#include <algorithm>
+#include <map>
+#ifdef OPS_MPI
+#include "ops_mpi_core.h"
+#endif
+
+std::vector<FieldMemory> fieldMemories;
+
+const std::vector<FieldMemory>& FieldMemories() { return fieldMemories; }
+
+void AccountFieldMemory(const std::string& fieldName, const ops_dat dat,
+                        const int dim, const int typeSize, const int haloDepth,
+                        const std::vector<int>& blockSize) {
+    fieldMemories.push_back(
+        FieldMemory{fieldName, dat, dim, typeSize, haloDepth, blockSize});
+}
+
+void ForgetFieldMemory(const ops_dat dat) {
+    fieldMemories.erase(std::remove_if(fieldMemories.begin(),
+                                       fieldMemories.end(),
+                                       [dat](const FieldMemory& field) {
+                                           return field.dat == dat;
+                                       }),
+                        fieldMemories.end());
+}
+
+Real FieldBytes(const FieldMemory& field) {
+    Real bytes{(Real)field.dim * field.typeSize};
+    for (const int size : field.blockSize) {
+        bytes *= size + 2 * field.haloDepth;
+    }
+    return bytes;
+}
+
+Real LocalFieldBytes(const FieldMemory& field) {
+    Real bytes{(Real)field.dim * field.typeSize};
+    for (int axis = 0; axis < (int)field.blockSize.size(); axis++) {
+        bytes *= std::max(field.dat->size[axis], 0);
+    }
+    return bytes;
+}
+
+void ReportMemoryFootprint() {
+    std::map<std::string, std::vector<double>> fieldBytes;
+    std::vector<std::string> fieldNames;
+    for (const FieldMemory& field : fieldMemories) {
+        if (fieldBytes.find(field.fieldName) == fieldBytes.end()) {
+            fieldNames.push_back(field.fieldName);
+            fieldBytes[field.fieldName] = std::vector<double>(2, 0);
+        }
+        fieldBytes[field.fieldName][0] += FieldBytes(field);
+        fieldBytes[field.fieldName][1] += LocalFieldBytes(field);
+    }
+    // The whole domain, the local part and the total of both at the end
+    std::vector<double> localBytes;
+    std::vector<double> wholeBytes;
+    for (const std::string& fieldName : fieldNames) {
+        wholeBytes.push_back(fieldBytes[fieldName][0]);
+        localBytes.push_back(fieldBytes[fieldName][1]);
+    }
+    double wholeTotal{0}, localTotal{0};
+    for (SizeType idx = 0; idx < localBytes.size(); idx++) {
+        wholeTotal += wholeBytes[idx];
+        localTotal += localBytes[idx];
+    }
+    wholeBytes.push_back(wholeTotal);
+    localBytes.push_back(localTotal);
+    fieldNames.push_back("Total");
+    std::vector<double> maxBytes(localBytes), sumBytes(localBytes);
+    int rankNum{1};
+#ifdef OPS_MPI
+    MPI_Comm_size(OPS_MPI_GLOBAL, &rankNum);
+    MPI_Allreduce(localBytes.data(), maxBytes.data(), (int)localBytes.size(),
+                  MPI_DOUBLE, MPI_MAX, OPS_MPI_GLOBAL);
+    MPI_Allreduce(localBytes.data(), sumBytes.data(), (int)localBytes.size(),
+                  MPI_DOUBLE, MPI_SUM, OPS_MPI_GLOBAL);
+#endif
+    const double mega{1024. * 1024.};
+    ops_printf("\nMemory of the fields over %d ranks (MB):\n", rankNum);
+    ops_printf("%-24s %12s %12s %12s\n", "Field", "Domain", "MaxPerRank",
+               "AvgPerRank");
+    for (SizeType idx = 0; idx < fieldNames.size(); idx++) {
+        ops_printf("%-24s %12.2f %12.2f %12.2f\n", fieldNames[idx].c_str(),
+                   wholeBytes[idx] / mega, maxBytes[idx] / mega,
+                   sumBytes[idx] / rankNum / mega);
+    }
+}
@@ -0,0 +1,70 @@
+/**
+ * Copyright 2019 United Kingdom Research and Innovation
+ *
+ * Authors: See AUTHORS
+ *
+ * Contact: [jianping.meng@stfc.ac.uk and/or jpmeng@gmail.com]
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * ANDANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*! @brief   Account the memory footprint of the fields
+ * @author  Jianping Meng
+ * @details Every ops_dat created by a Field is recorded with its data
+ * dimension, type size, halo depth and block size. ReportMemoryFootprint(),
+ * called at the end of Partition(), prints the bytes of each field for the
+ * whole domain and, from the local sizes decided by ops_partition, the maximum
+ * and the average over the ranks. The halos of OPS itself and the MPI buffers
+ * are not included.
+ */
+
+#ifndef MEMORY_H
+#define MEMORY_H
+#include <string>
+#include <vector>
+#include "ops_lib_core.h"
+#include "type.h"
+
+struct FieldMemory {
+    std::string fieldName;
+    ops_dat dat;
+    int dim;
+    int typeSize;
+    int haloDepth;
+    std::vector<int> blockSize;
+};
+
+const std::vector<FieldMemory>& FieldMemories();
+void AccountFieldMemory(const std::string& fieldName, const ops_dat dat,
+                        const int dim, const int typeSize, const int haloDepth,
+                        const std::vector<int>& blockSize);
+// Drop a dat freed before the end of a run from the account
+void ForgetFieldMemory(const ops_dat dat);
+// Bytes of a block including the halo of the field
+Real FieldBytes(const FieldMemory& field);
+// Bytes held by this rank, where the size of a dat includes its halos
+Real LocalFieldBytes(const FieldMemory& field);
+void ReportMemoryFootprint();
+#endif  // MEMORY_H
@@ -42,9 +42,13 @@
 #include "model_host_device.h"
 #include "flowfield.h"
 #include "flowfield_host_device.h"
+#include "scheme.h"
 #include "type.h"
 
+#include <algorithm>
 #include <map>
+#include <set>
+#include <vector>
 int NUMXI{9};
 int FEQORDER{2};
 int LATTDIM{2};
@@ -57,6 +61,22 @@ int NUMCOMPONENTS{1};
 Real XIMAXVALUE{1};
 std::map<int,Component> components;
 const std::map<int, Component>& g_Components() { return components; };
+bool MULTICOMPONENTFUSION{true};
+MacroVarsLayout MACROVARSLAYOUT{MacroVars_Separate};
+PopulationStorage POPULATIONSTORAGE{Population_Double};
+bool POPULATIONCOMPRESSED{false};
+bool POPULATIONSCALESHARED{false};
+std::map<int, PopulationScale> populationScale;
+SizeType POPULATIONSCALEPERIOD{16};
+// The compressed collisions of the run, the one of the last fetch and the one
+// the fetches are scheduled from
+SizeType compressedCollisions{0};
+SizeType lastScaleFetch{0};
+SizeType scaleFetchOrigin{0};
+// The time step of the restart file holding the populations, 0 if none
+SizeType populationTimeStep{0};
+// The time step of the restart file holding the macroscopic variables
+SizeType macroVarsTimeStep{0};
 
 struct lattice {
     int lattDim;
@@ -73,6 +93,11 @@ lattice d2q36{2, 36, 1};
 std::map<std::string, lattice> latticeSet{
     {"d2q9", d2q9}, {"d3q19", d3q19}, {"d3q15", d3q15}, {"d2q36", d2q36}};
 
+int LatticeSize(const std::string& latticeName) {
+    const auto lattice = latticeSet.find(latticeName);
+    return lattice == latticeSet.end() ? 0 : lattice->second.length;
+}
+
 /**
  * @brief Find particles with opposite directions for bounce-back type boundary
  * using brute-force method. It could be slow for large lattice/discrete velocity set
@@ -295,20 +320,32 @@ void DefineComponents(const std::vector<std::string>& compoNames,
         g_NodeType().emplace(pair.second.id, nodeType);
     }
 
+    // f is allocated by CreatePopulations()
     g_f().SetDataDim(NUMXI);
+    populationTimeStep = timeStep;
     if (timeStep == 0) {
-        g_f().CreateFieldFromScratch(g_Block());
         for (auto& pair : g_NodeType()) {
             pair.second.CreateFieldFromScratch(g_Block());
         }
     } else {
-        g_f().CreateFieldFromFile(CaseName(), g_Block(), timeStep);
         for (auto& pair : g_NodeType()) {
             pair.second.CreateFieldFromFile(CaseName(), g_Block(), timeStep);
         }
     }
 }
 
+void CreatePopulations() {
+    RealField& populations{Scheme() == Scheme_StreamCollision_Moment
+                               ? g_Moments()
+                               : g_f()};
+    if (populationTimeStep == 0) {
+        populations.CreateFieldFromScratch(g_Block());
+    } else {
+        populations.CreateFieldFromFile(CaseName(), g_Block(),
+                                        populationTimeStep);
+    }
+}
+
 void DefineMacroVars(std::vector<VariableTypes> types,
                      std::vector<std::string> names, std::vector<int> varId,
                      std::vector<int> compoId, const SizeType timeStep) {
@@ -376,21 +413,20 @@ void DefineMacroVars(std::vector<VariableTypes> types,
 #endif
     }
 
-    if (timeStep == 0) {
-        for (auto& pair : g_MacroVars()) {
-            pair.second.CreateFieldFromScratch(g_Block());
-        }
+    // The fields are allocated by CreateMacroVars() once the layout is known
+    macroVarsTimeStep = timeStep;
 
+    if (IsTransient()) {
+        ops_printf(
+            "The copies of macroscopic variables are not allocated for a "
+            "transient run\n");
     } else {
-        for (auto& pair : g_MacroVars()) {
-            pair.second.CreateFieldFromFile(CaseName(), g_Block(), timeStep);
-        }
-    }
-
-    if (!IsTransient()) {
         for (auto& pair : g_MacroVarsCopy()) {
             pair.second.CreateFieldFromScratch(g_Block());
         }
+        ops_printf(
+            "The copies of macroscopic variables are allocated for the "
+            "residual of a steady run\n");
         for (const auto& compo : components) {
             for (const auto& var : compo.second.macroVars) {
                 ops_reduction handle{ops_decl_reduction_handle(
@@ -472,9 +508,23 @@ void DefineBodyForce(std::vector<BodyForceType> types,
         ops_printf(
             "The body force function type %i is chosen for Component %i\n",
             types.at(idx), compoId.at(idx));
-        components.at(compoId.at(idx)).bodyForceType = types.at(idx);
-        RealField force{"Force_" + components.at(compoId.at(idx)).name};
-        g_MacroBodyforce().emplace(compoId.at(idx), force);
+        Component& compo{components.at(compoId.at(idx))};
+        compo.bodyForceType = types.at(idx);
+        std::vector<VariableTypes> macroVarTypes;
+        for (const auto& macroVar : compo.macroVars) {
+            macroVarTypes.push_back(macroVar.first);
+        }
+        if (NeedBodyForceField(compo.bodyForceType, macroVarTypes)) {
+            RealField force{"Force_" + compo.name};
+            g_MacroBodyforce().emplace(compo.id, force);
+            ops_printf("The body force field is allocated for Component %s\n",
+                       compo.name.c_str());
+        } else {
+            ops_printf(
+                "No body force field is needed by Component %s, which is not "
+                "allocated\n",
+                compo.name.c_str());
+        }
     }
     if (compoSize < NUMCOMPONENTS) {
         ops_printf(
@@ -524,6 +574,522 @@ void DefineInitialCondition(std::vector<InitialType> types,
     }
 }
 
+void DefineMacroVarsLayout(const MacroVarsLayout layout) {
+    MACROVARSLAYOUT = layout;
+}
+
+bool IsMacroVarsInterleaved(const Component& compo) {
+    return g_InterleavedMacroVars().find(compo.id) !=
+           g_InterleavedMacroVars().end();
+}
+
+// The interleaved kernels only know the density and velocity of the
+// isothermal collision, where the body force would need the separate density.
+bool CanInterleaveMacroVars(const CollisionType collisionType,
+                            const BodyForceType forceType,
+                            const std::vector<VariableTypes>& macroVarTypes) {
+    std::set<VariableTypes> types(macroVarTypes.begin(), macroVarTypes.end());
+    return macroVarTypes.size() == 4 &&
+           types == std::set<VariableTypes>{Variable_Rho, Variable_U,
+                                            Variable_V, Variable_W} &&
+           (collisionType == Collision_BGKIsothermal2nd ||
+            collisionType == Collision_BGKIsothermal2nd_Swap) &&
+           (forceType == BodyForce_None || forceType == BodyForce_None_Swap);
+}
+
+bool CanInterleaveMacroVars(const Component& compo) {
+    std::vector<VariableTypes> macroVarTypes;
+    for (const auto& typeVar : compo.macroVars) {
+        macroVarTypes.push_back(typeVar.first);
+    }
+    return CanInterleaveMacroVars(compo.collisionType, compo.bodyForceType,
+                                  macroVarTypes);
+}
+
+void CreateMacroVars() {
+    const bool interleaved{
+        CanInterleaveMacroVars(MACROVARSLAYOUT, Scheme(), SpaceDim())};
+    if (MACROVARSLAYOUT == MacroVars_Interleaved && !interleaved) {
+        ops_printf(
+            "The macroscopic variables are stored separately as they are only "
+            "interleaved for 3D problems without the moment scheme\n");
+    }
+    for (const auto& idCompo : components) {
+        const Component& compo{idCompo.second};
+        if (interleaved && !CanInterleaveMacroVars(compo)) {
+            ops_printf(
+                "The macroscopic variables of Component %s are stored "
+                "separately as only Rho, U, V and W with the isothermal "
+                "collision and no body force can be interleaved\n",
+                compo.name.c_str());
+        }
+        if (interleaved && CanInterleaveMacroVars(compo)) {
+            RealField macroVars{"MacroVars_" + compo.name, 4};
+            g_InterleavedMacroVars().emplace(compo.id, macroVars);
+            RealField& field{g_InterleavedMacroVars().at(compo.id)};
+            if (macroVarsTimeStep == 0) {
+                field.CreateFieldFromScratch(g_Block());
+            } else {
+                field.CreateFieldFromFile(CaseName(), g_Block(),
+                                          macroVarsTimeStep);
+            }
+            ops_printf(
+                "The macroscopic variables of Component %s are interleaved in "
+                "one field\n",
+                compo.name.c_str());
+            // A restart file holds the interleaved field only, so there is
+            // nothing to pack, while a new run needs the separate fields for
+            // the initial condition until PreDefinedInitialCondition3D()
+            // packs and frees them.
+            if (macroVarsTimeStep != 0) {
+                continue;
+            }
+        }
+        for (const auto& typeVar : compo.macroVars) {
+            RealField& macroVar{g_MacroVars().at(typeVar.second.id)};
+            if (macroVarsTimeStep == 0) {
+                macroVar.CreateFieldFromScratch(g_Block());
+            } else {
+                macroVar.CreateFieldFromFile(CaseName(), g_Block(),
+                                             macroVarsTimeStep);
+            }
+        }
+    }
+}
+
+ops_dat MacroVarDat(const Component& compo, const VariableTypes type,
+                    const int blockId, int& dim, int& index) {
+    const RealField& macroVar{g_MacroVars().at(compo.macroVars.at(type).id)};
+    // The separate field holds the initial condition until it is packed
+    if (IsMacroVarsInterleaved(compo) && !macroVar.IsAllocated()) {
+        // The interleaved variables are rho, u, v and w in this order
+        dim = 4;
+        index = type;
+        return g_InterleavedMacroVars().at(compo.id).at(blockId);
+    }
+    dim = 1;
+    index = 0;
+    return macroVar.at(blockId);
+}
+
+void DefinePopulationStorage(const PopulationStorage storage,
+                             const SizeType scalePeriod) {
+    POPULATIONSTORAGE = storage;
+    if (scalePeriod < 1) {
+        ops_printf("Error! The scale period must be at least one step!\n");
+        assert(scalePeriod >= 1);
+    }
+    POPULATIONSCALEPERIOD = scalePeriod;
+}
+
+bool IsPopulationCompressed() { return POPULATIONCOMPRESSED; }
+
+std::map<int, PopulationScale>& g_PopulationScale() { return populationScale; }
+
+bool IsPopulationScaleShared() { return POPULATIONSCALESHARED; }
+
+SizeType CountCompressedCollision() {
+    compressedCollisions++;
+    const SizeType count{compressedCollisions - scaleFetchOrigin};
+    const bool due{count < POPULATIONSCALEPERIOD
+                       ? (count & (count - 1)) == 0
+                       : count % POPULATIONSCALEPERIOD == 0};
+    if (!due) {
+        return 0;
+    }
+    const SizeType collisions{compressedCollisions - lastScaleFetch};
+    lastScaleFetch = compressedCollisions;
+    return collisions;
+}
+
+void RestartPopulationScaleFetch() { scaleFetchOrigin = compressedCollisions; }
+
+// The compressed collision and stream kernels know neither a force term nor
+// the swap layout, and fStage holds all components so that either every
+// component qualifies or the populations stay in double.
+bool CanCompressPopulations(const CollisionType collisionType,
+                            const BodyForceType forceType,
+                            const std::vector<VariableTypes>& macroVarTypes,
+                            const bool interleaved) {
+    for (const VariableTypes type :
+         {Variable_Rho, Variable_U, Variable_V, Variable_W}) {
+        if (std::count(macroVarTypes.begin(), macroVarTypes.end(), type) != 1) {
+            return false;
+        }
+    }
+    return collisionType == Collision_BGKIsothermal2nd &&
+           forceType == BodyForce_None && !interleaved;
+}
+
+bool CanCompressPopulations(const Component& compo) {
+    std::vector<VariableTypes> macroVarTypes;
+    for (const auto& typeVar : compo.macroVars) {
+        macroVarTypes.push_back(typeVar.first);
+    }
+    return CanCompressPopulations(compo.collisionType, compo.bodyForceType,
+                                  macroVarTypes, IsMacroVarsInterleaved(compo));
+}
+
+void CreateStagePopulations() {
+    bool compressed{
+        CanCompressPopulations(POPULATIONSTORAGE, Scheme(), SpaceDim())};
+    if (POPULATIONSTORAGE == Population_Compressed16 && !compressed) {
+        ops_printf(
+            "The populations are not compressed as only the 3D "
+            "stream-collision scheme stores them in fStage\n");
+    }
+    if (Scheme() != Scheme_StreamCollision) {
+        return;
+    }
+    for (const auto& idCompo : components) {
+        const Component& compo{idCompo.second};
+        if (compressed && !CanCompressPopulations(compo)) {
+            ops_printf(
+                "The populations are stored in double as Component %s does "
+                "not use Rho, U, V and W with the isothermal collision, no "
+                "body force and separate macroscopic variables\n",
+                compo.name.c_str());
+            compressed = false;
+        }
+    }
+    if (!compressed) {
+        g_fStage().CreateFieldFromScratch(g_Block());
+        ops_printf("The field fStage is allocated for the scheme\n");
+        return;
+    }
+    // fStageCompressed takes the place of fStage, including its halo
+    g_fStageCompressed().SetDataDim(SizeF());
+    g_fStageCompressed().CreateFieldFromScratch(g_Block());
+    DeregisterFieldNeedHalo(g_fStage());
+    RegisterFieldNeedHalo(g_fStageCompressed());
+    for (const auto& idBlock : g_Block()) {
+        const Block& block{idBlock.second};
+        PopulationScale scale;
+        std::string handleName{"PopulationDeviation_" + block.Name()};
+        scale.handle = ops_decl_reduction_handle(sizeof(Real), "double",
+                                                 handleName.c_str());
+        populationScale.emplace(block.ID(), scale);
+        for (const auto& surfaceNeighbor : block.Neighbors()) {
+            if (surfaceNeighbor.second.blockId != block.ID()) {
+                POPULATIONSCALESHARED = true;
+            }
+        }
+    }
+    POPULATIONCOMPRESSED = true;
+    ops_printf(
+        "The post-collision populations are stored in 16 bits with a %s "
+        "scale instead of fStage\n",
+        POPULATIONSCALESHARED ? "shared" : "per-block");
+}
+
+void DefineMultiComponentFusion(const bool fusion) {
+    MULTICOMPONENTFUSION = fusion;
+}
+
+bool IsMultiComponentFusion() { return MULTICOMPONENTFUSION; }
+
+bool IsCollisionFused() {
+    if (!MULTICOMPONENTFUSION || NUMCOMPONENTS != 2 || !IsNodeTypeShared()) {
+        return false;
+    }
+    const Component& compo0{components.begin()->second};
+    const Component& compo1{components.rbegin()->second};
+    // The interleaved layout already merges the streams of a component
+    if (IsMacroVarsInterleaved(compo0) || IsMacroVarsInterleaved(compo1) ||
+        IsPopulationCompressed()) {
+        return false;
+    }
+    const CollisionType first{compo0.collisionType};
+    const CollisionType second{compo1.collisionType};
+    return (first == second) && (first == Collision_BGKIsothermal2nd ||
+                                 first == Collision_BGKIsothermal2nd_Swap);
+}
+
+bool IsMacroVarsUpdateFused() {
+    if (!MULTICOMPONENTFUSION || NUMCOMPONENTS != 2 || !IsNodeTypeShared()) {
+        return false;
+    }
+    for (const auto& idCompo : components) {
+        if (IsMacroVarsInterleaved(idCompo.second)) {
+            return false;
+        }
+        const auto& macroVars = idCompo.second.macroVars;
+        if (macroVars.size() != 4 || macroVars.count(Variable_Rho) == 0 ||
+            macroVars.count(Variable_U) == 0 ||
+            macroVars.count(Variable_V) == 0 ||
+            macroVars.count(Variable_W) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool NeedBodyForceField(const BodyForceType forceType,
+                        const std::vector<VariableTypes>& macroVarTypes) {
+    if (forceType != BodyForce_None && forceType != BodyForce_None_Swap) {
+        return true;
+    }
+    for (const VariableTypes varType : macroVarTypes) {
+        if (varType == Variable_U_Force || varType == Variable_V_Force ||
+            varType == Variable_W_Force) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool CanCollectStatistics(const std::vector<VariableTypes>& macroVarTypes) {
+    const auto hasType = [&macroVarTypes](const VariableTypes type,
+                                          const VariableTypes forcedType) {
+        return std::count(macroVarTypes.begin(), macroVarTypes.end(), type) +
+                   std::count(macroVarTypes.begin(), macroVarTypes.end(),
+                              forcedType) >
+               0;
+    };
+    return hasType(Variable_Rho, Variable_Rho) &&
+           hasType(Variable_U, Variable_U_Force) &&
+           hasType(Variable_V, Variable_V_Force) &&
+           hasType(Variable_W, Variable_W_Force);
+}
+
+bool IsBodyForceNoneFused() {
+    if (!MULTICOMPONENTFUSION || NUMCOMPONENTS < 2 || !IsNodeTypeShared()) {
+        return false;
+    }
+    for (const auto& idCompo : components) {
+        if (idCompo.second.bodyForceType != BodyForce_None) {
+            return false;
+        }
+    }
+    return true;
+}
+
+#ifdef OPS_3D
+LoopPlanGroup collisionPlan;
+LoopPlanGroup macroVarsPlan;
+LoopPlanGroup bodyForcePlan;
+LoopPlanGroup& g_CollisionPlan() { return collisionPlan; }
+LoopPlanGroup& g_MacroVarsPlan() { return macroVarsPlan; }
+LoopPlanGroup& g_BodyForcePlan() { return bodyForcePlan; }
+
+void BuildCollisionPlan3D(const Block& block) {
+    const int blockIndex{block.ID()};
+    if (IsCollisionFused()) {
+        const Component& compo0{components.begin()->second};
+        const Component& compo1{components.rbegin()->second};
+        LoopPlan loop{
+            CreateLoopPlan(block, block.WholeRange(), compo0.collisionType)};
+        loop.fused = true;
+        // fStage is not allocated for the swap scheme
+        const bool swap{compo0.collisionType == Collision_BGKIsothermal2nd_Swap};
+        loop.dats = {swap ? nullptr : g_fStage()[blockIndex],
+                     g_f()[blockIndex],
+                     g_NodeType().at(compo0.id).at(blockIndex)};
+        for (const Component* compo : {&compo0, &compo1}) {
+            loop.dats.push_back(g_MacroVars()
+                                    .at(compo->macroVars.at(Variable_Rho).id)
+                                    .at(blockIndex));
+            loop.dats.push_back(g_MacroVars().at(compo->uId).at(blockIndex));
+            loop.dats.push_back(g_MacroVars().at(compo->vId).at(blockIndex));
+            loop.dats.push_back(g_MacroVars().at(compo->wId).at(blockIndex));
+        }
+        loop.realArgs = {compo0.tauRef, compo1.tauRef};
+        loop.intArgs = {compo0.index[0], compo0.index[1], compo1.index[0],
+                        compo1.index[1]};
+        collisionPlan.push_back(loop);
+        return;
+    }
+    for (const auto& idCompo : components) {
+        const Component& compo{idCompo.second};
+        const CollisionType collisionType{compo.collisionType};
+        if (collisionType != Collision_BGKIsothermal2nd &&
+            collisionType != Collision_BGKIsothermal2nd_Swap &&
+            collisionType != Collision_BGKThermal4th) {
+            ops_printf("The specified collision type is not implemented!\n");
+            continue;
+        }
+        const bool swap{collisionType == Collision_BGKIsothermal2nd_Swap};
+        LoopPlan loop{CreateLoopPlan(block, block.WholeRange(), collisionType)};
+        if (IsMacroVarsInterleaved(compo)) {
+            loop.interleaved = true;
+            loop.dats = {swap ? nullptr : g_fStage()[blockIndex],
+                         g_f()[blockIndex],
+                         g_NodeType().at(compo.id).at(blockIndex),
+                         g_InterleavedMacroVars().at(compo.id).at(blockIndex)};
+            loop.realArgs = {compo.tauRef};
+            loop.intArgs = {compo.index[0], compo.index[1]};
+            collisionPlan.push_back(loop);
+            continue;
+        }
+        // fStage is replaced by fStageCompressed below if compressed
+        loop.dats = {
+            swap || IsPopulationCompressed() ? nullptr : g_fStage()[blockIndex],
+            g_f()[blockIndex],
+            g_NodeType().at(compo.id).at(blockIndex),
+            g_MacroVars().at(compo.macroVars.at(Variable_Rho).id).at(blockIndex),
+            g_MacroVars().at(compo.uId).at(blockIndex),
+            g_MacroVars().at(compo.vId).at(blockIndex),
+            g_MacroVars().at(compo.wId).at(blockIndex)};
+        if (collisionType == Collision_BGKThermal4th) {
+            loop.dats.push_back(g_MacroVars()
+                                    .at(compo.macroVars.at(Variable_T).id)
+                                    .at(blockIndex));
+        }
+        if (IsPopulationCompressed()) {
+            PopulationScale& scale{populationScale.at(blockIndex)};
+            loop.compressed = true;
+            loop.dats[0] = g_fStageCompressed()[blockIndex];
+            loop.scale = &scale.scale;
+            loop.deviation = scale.handle;
+        }
+        loop.realArgs = {compo.tauRef};
+        loop.intArgs = {compo.index[0], compo.index[1]};
+        collisionPlan.push_back(loop);
+    }
+}
+
+void BuildMacroVarsPlan3D(const Block& block) {
+    const int blockIndex{block.ID()};
+    // The density and velocity are the conserved moments of the last step
+    if (Scheme() == Scheme_StreamCollision_Moment) {
+        for (const auto& idCompo : components) {
+            const Component& compo{idCompo.second};
+            LoopPlan loop{
+                CreateLoopPlan(block, block.WholeRange(), Variable_Rho)};
+            loop.moment = true;
+            loop.dats = {g_MacroVars()
+                             .at(compo.macroVars.at(Variable_Rho).id)
+                             .at(blockIndex),
+                         g_MacroVars().at(compo.uId).at(blockIndex),
+                         g_MacroVars().at(compo.vId).at(blockIndex),
+                         g_MacroVars().at(compo.wId).at(blockIndex),
+                         g_Moments()[blockIndex],
+                         g_MomentsStage()[blockIndex],
+                         g_NodeType().at(compo.id).at(blockIndex)};
+            macroVarsPlan.push_back(loop);
+        }
+        return;
+    }
+    if (IsMacroVarsUpdateFused()) {
+        const Component& compo0{components.begin()->second};
+        const Component& compo1{components.rbegin()->second};
+        LoopPlan loop{CreateLoopPlan(block, block.WholeRange(), Variable_Rho)};
+        loop.fused = true;
+        for (const Component* compo : {&compo0, &compo1}) {
+            loop.dats.push_back(g_MacroVars()
+                                    .at(compo->macroVars.at(Variable_Rho).id)
+                                    .at(blockIndex));
+            loop.dats.push_back(g_MacroVars().at(compo->uId).at(blockIndex));
+            loop.dats.push_back(g_MacroVars().at(compo->vId).at(blockIndex));
+            loop.dats.push_back(g_MacroVars().at(compo->wId).at(blockIndex));
+        }
+        loop.dats.push_back(g_f()[blockIndex]);
+        loop.dats.push_back(g_NodeType().at(compo0.id).at(blockIndex));
+        loop.intArgs = {compo0.index[0], compo0.index[1], compo1.index[0],
+                        compo1.index[1]};
+        macroVarsPlan.push_back(loop);
+        return;
+    }
+    for (const auto& idCompo : components) {
+        const Component& compo{idCompo.second};
+        if (IsMacroVarsInterleaved(compo)) {
+            LoopPlan loop{
+                CreateLoopPlan(block, block.WholeRange(), Variable_Rho)};
+            loop.interleaved = true;
+            loop.dats = {g_InterleavedMacroVars().at(compo.id).at(blockIndex),
+                         g_f()[blockIndex],
+                         g_NodeType().at(compo.id).at(blockIndex)};
+            loop.intArgs = {compo.index[0], compo.index[1]};
+            macroVarsPlan.push_back(loop);
+            continue;
+        }
+        for (const auto& macroVar : compo.macroVars) {
+            const VariableTypes varType{macroVar.first};
+            LoopPlan loop{CreateLoopPlan(block, block.WholeRange(), varType)};
+            loop.dats = {g_MacroVars().at(macroVar.second.id).at(blockIndex),
+                         g_f()[blockIndex],
+                         g_NodeType().at(compo.id).at(blockIndex)};
+            if (varType != Variable_Rho) {
+                loop.dats.push_back(g_MacroVars()
+                                        .at(compo.macroVars.at(Variable_Rho).id)
+                                        .at(blockIndex));
+            }
+            if (varType == Variable_U_Force || varType == Variable_V_Force ||
+                varType == Variable_W_Force) {
+                loop.dats.push_back(
+                    g_MacroBodyforce().at(compo.id).at(blockIndex));
+            }
+            loop.intArgs = {compo.index[0], compo.index[1]};
+            macroVarsPlan.push_back(loop);
+        }
+    }
+}
+
+void BuildBodyForcePlan3D(const Block& block) {
+    const int blockIndex{block.ID()};
+    // BodyForce_None only clears the force term of fStage, which the
+    // compressed collision does not have
+    if (IsPopulationCompressed()) {
+        return;
+    }
+    if (IsBodyForceNoneFused()) {
+        const Component& compo0{components.begin()->second};
+        LoopPlan loop{CreateLoopPlan(block, block.WholeRange(), BodyForce_None)};
+        loop.fused = true;
+        // The force field is not allocated without body force
+        loop.dats = {g_fStage()[blockIndex], g_f()[blockIndex], nullptr,
+                     g_NodeType().at(compo0.id).at(blockIndex)};
+        loop.intArgs = {0, NUMXI - 1};
+        bodyForcePlan.push_back(loop);
+        return;
+    }
+    for (const auto& idCompo : components) {
+        const Component& compo{idCompo.second};
+        const BodyForceType forceType{compo.bodyForceType};
+        if (forceType == BodyForce_None_Swap) {
+            continue;
+        }
+        if (forceType != BodyForce_1st && forceType != BodyForce_1st_Swap &&
+            forceType != BodyForce_None) {
+            ops_printf("The specified force type is not implemented!\n");
+            continue;
+        }
+        LoopPlan loop{CreateLoopPlan(block, block.WholeRange(), forceType)};
+        const bool swap{forceType == BodyForce_1st_Swap};
+        const bool none{forceType == BodyForce_None};
+        // The force field is not allocated without body force
+        loop.dats = {swap ? nullptr : g_fStage()[blockIndex],
+                     g_f()[blockIndex],
+                     none ? nullptr
+                          : g_MacroBodyforce().at(compo.id).at(blockIndex),
+                     g_NodeType().at(compo.id).at(blockIndex)};
+        if (forceType != BodyForce_None) {
+            loop.dats.push_back(g_MacroVars()
+                                    .at(compo.macroVars.at(Variable_Rho).id)
+                                    .at(blockIndex));
+        }
+        loop.intArgs = {compo.index[0], compo.index[1]};
+        bodyForcePlan.push_back(loop);
+    }
+}
+
+void BuildModelPlan3D() {
+    collisionPlan.clear();
+    macroVarsPlan.clear();
+    bodyForcePlan.clear();
+    for (const auto& idBlock : g_Block()) {
+        const Block& block{idBlock.second};
+        BuildMacroVarsPlan3D(block);
+        // The moment scheme collides within its stream loop
+        if (Scheme() == Scheme_StreamCollision_Moment) {
+            continue;
+        }
+        BuildCollisionPlan3D(block);
+        BuildBodyForcePlan3D(block);
+    }
+}
+#endif  // OPS_3D
+
 void DestroyModel() {
     FreeArrayMemory(XI);
     FreeArrayMemory(WEIGHTS);
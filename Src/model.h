@@ -41,6 +41,7 @@
 #include <list>
 #include <map>
 #include "type.h"
+#include "plan.h"
 
 /**
  * @brief total number of discrete velocity/lattice
@@ -134,10 +135,178 @@ inline const int ComponentNum() { return NUMCOMPONENTS; }
 inline const int SizeF() { return NUMXI; }
 inline const Real SoundSpeed() { return CS; }
 inline const Real MaximumSpeed() { return XIMAXVALUE; }
+/*!
+ * The number of discrete velocities of a lattice, e.g., 19 for d3q19, or 0 if
+ * the lattice is unknown.
+ */
+int LatticeSize(const std::string& latticeName);
+/*!
+ * If a component needs the field of body force, i.e., a body force is applied
+ * or the velocity is corrected by the force. Otherwise, the field is not
+ * allocated.
+ */
+bool NeedBodyForceField(const BodyForceType forceType,
+                        const std::vector<VariableTypes>& macroVarTypes);
+/*!
+ * If the running statistics can be collected for a component, i.e., it has
+ * Rho and U, V, W or their forced counterparts, see DefineStatistics().
+ */
+bool CanCollectStatistics(const std::vector<VariableTypes>& macroVarTypes);
 /**
  * Free the pointer memory
  */
 void DestroyModel();
+/*!
+ * Multi-component kernels treating all components of a node in a single sweep
+ * require the components to share one node type, see IsNodeTypeShared().
+ * IsCollisionFused: two components with the BGKIsothermal2nd (or _Swap) model
+ * IsMacroVarsUpdateFused: two components with only Rho, U, V and W
+ * IsBodyForceNoneFused: all components without body force
+ */
+bool IsCollisionFused();
+bool IsMacroVarsUpdateFused();
+bool IsBodyForceNoneFused();
+/*!
+ * Switch the fused multi-component kernels, including the stream kernel
+ * sweeping all components, on (default) or off, so that the per-component
+ * kernels can be used as the reference of the fused ones.
+ * Must be called before Partition().
+ */
+void DefineMultiComponentFusion(const bool fusion);
+bool IsMultiComponentFusion();
+/*!
+ * Allocate f, or read it at a restart, which is called by Partition() before
+ * ops_partition so that the moment scheme can keep the moments in g_Moments()
+ * instead, see Scheme_StreamCollision_Moment.
+ */
+void CreatePopulations();
+/*!
+ * Storage of the macroscopic variables in the 3D evolution cycle
+ * MacroVars_Separate: one ops_dat per variable
+ * MacroVars_Interleaved: rho, u, v and w of a component in one ops_dat of
+ * dim 4, so that the collision and macroscopic variable loops read one stream
+ * instead of four. Only a component with just Rho, U, V and W, the
+ * BGKIsothermal2nd (or _Swap) collision and no body force is interleaved,
+ * which replaces the fused multi-component kernels for it. The separate
+ * fields of an interleaved component only hold the initial condition of a new
+ * run and are freed by PackMacroVars3D() at the end of
+ * PreDefinedInitialCondition3D(), after which g_MacroVars().at(id).at(block)
+ * of such a variable stops with an error and MacroVarDat() gives its dat
+ * instead. The residual, probes, slices and
+ * snapshots read the interleaved field, which is written to the HDF5 file as
+ * MacroVars_<component> and read back at a restart.
+ * Must be called before Partition().
+ */
+enum MacroVarsLayout { MacroVars_Separate = 0, MacroVars_Interleaved = 1 };
+void DefineMacroVarsLayout(const MacroVarsLayout layout);
+/*!
+ * Allocate the macroscopic variables, or read them at a restart, which is
+ * called by Partition() before ops_partition once the layout is known.
+ */
+void CreateMacroVars();
+/*!
+ * Whether a component qualifies for the interleaved macroscopic variables or
+ * the compressed populations, shared by CreateMacroVars(),
+ * CreateStagePopulations() and the dry run, see also the scheme level rules
+ * in scheme.h.
+ */
+bool CanInterleaveMacroVars(const CollisionType collisionType,
+                            const BodyForceType forceType,
+                            const std::vector<VariableTypes>& macroVarTypes);
+bool CanCompressPopulations(const CollisionType collisionType,
+                            const BodyForceType forceType,
+                            const std::vector<VariableTypes>& macroVarTypes,
+                            const bool interleaved);
+bool IsMacroVarsInterleaved(const Component& compo);
+/*!
+ * The dat holding a macroscopic variable of a component at a block with its
+ * data dimension and the index of the variable in it, i.e., the interleaved
+ * field of the component once packed, or the separate field of the variable.
+ */
+ops_dat MacroVarDat(const Component& compo, const VariableTypes type,
+                    const int blockId, int& dim, int& index);
+/*!
+ * Storage of the post-collision populations (fStage) in the 3D evolution cycle
+ * Population_Double: one double per population
+ * Population_Compressed16: experimental, the deviation f/w-1 from the rest
+ * equilibrium at rho=1 is kept as a 16-bit integer times a per-block scale,
+ * which is encoded by the collision and decoded by the stream kernel, and the
+ * double fStage is then not allocated. Only fStage is compressed, so the
+ * populations take 10 instead of 16 bytes per velocity and node, i.e., about
+ * 1.6 times less, while the swap scheme without fStage takes 8. The scale is
+ * twice the largest deviation, which is reduced by the collision but only
+ * fetched after the collisions 1, 2, 4, ... of a run up to every scalePeriod
+ * ones, so that the evolution cycle seldom waits for the reduction. A collision
+ * found saturated there is repeated with the adapted scale, and otherwise the
+ * scale is adapted before the next one. The earlier collisions of a saturated
+ * window have been streamed already and stay clipped, which is warned about,
+ * and the fetches are scheduled anew, where a smaller scalePeriod fetches more
+ * often. It applies only if every component uses Rho, U, V and W,
+ * the BGKIsothermal2nd collision, no body force and the separate macroscopic
+ * variables, with the (non-swap) stream-collision scheme. f itself is still
+ * kept in double so that the boundary conditions, output and restart are
+ * unchanged. Must be called before Partition().
+ */
+enum PopulationStorage {
+    Population_Double = 0,
+    Population_Compressed16 = 1
+};
+void DefinePopulationStorage(const PopulationStorage storage,
+                             const SizeType scalePeriod = 16);
+/*!
+ * Allocate the post-collision populations of the stream-collision scheme,
+ * i.e., fStageCompressed if the compressed storage is asked for and
+ * qualified, or fStage otherwise, called by Partition() before ops_partition.
+ */
+void CreateStagePopulations();
+bool IsPopulationCompressed();
+/*!
+ * Scale of the compressed populations of a block, where deviation is the
+ * largest |f/w-1| found by the last collision (negative before the first one)
+ * and handle the reduction giving it, where adapt tells to set the scale to
+ * the deviation before the next collision. Connected blocks exchange the
+ * encoded halos and therefore share the largest scale among them.
+ */
+struct PopulationScale {
+    Real scale{0};
+    Real deviation{-1};
+    bool adapt{true};
+    ops_reduction handle{nullptr};
+};
+std::map<int, PopulationScale>& g_PopulationScale();
+bool IsPopulationScaleShared();
+/*!
+ * Count a compressed collision of the run, which returns the collisions since
+ * the last fetch of the deviation if this one is due for a fetch, see
+ * DefinePopulationStorage(), or 0 otherwise.
+ */
+SizeType CountCompressedCollision();
+/*!
+ * Fetch the deviation after the next 1, 2, 4, ... collisions again up to
+ * every scalePeriod ones, e.g., after the populations saturated.
+ */
+void RestartPopulationScaleFetch();
+#ifdef OPS_3D
+/*!
+ * Execution plans of the collision, macroscopic variable and body force
+ * loops, which are built by BuildModelPlan3D() after Partition() and replayed
+ * by PreDefinedCollision3D(), UpdateMacroVars3D() and PreDefinedBodyForce3D()
+ * Under the moment scheme, only the macroscopic variables are computed, i.e.,
+ * {rho, u, v, w, moments, momentsStage, nodeType}, see CurrentMomentsIndex().
+ * collision: {fStage, f, nodeType, rho, u, v, w, T} or
+ * {fStage, f, nodeType, rho0, u0, v0, w0, rho1, u1, v1, w1} or, interleaved,
+ * {fStage, f, nodeType, macroVars} or, compressed,
+ * {fStageCompressed, f, nodeType, rho, u, v, w}
+ * macroscopic variables: {var, f, nodeType, rho, force} or
+ * {rho0, u0, v0, w0, rho1, u1, v1, w1, f, nodeType} or, interleaved,
+ * {macroVars, f, nodeType}
+ * body force: {fStage, f, force, nodeType, rho}
+ */
+LoopPlanGroup& g_CollisionPlan();
+LoopPlanGroup& g_MacroVarsPlan();
+LoopPlanGroup& g_BodyForcePlan();
+void BuildModelPlan3D();
+#endif  // OPS_3D
 
 void DefineComponents(const std::vector<std::string>& compoNames,
                       const std::vector<int>& compoId,
@@ -157,6 +326,10 @@ void DefineMacroVars(std::vector<VariableTypes> types,
 void DefineCollision(std::vector<CollisionType> types,
                      std::vector<int> compoId);
 
+/*!
+ * Must be called after DefineMacroVars() so that the field of body force is
+ * allocated only for those components needing it.
+ */
 void DefineBodyForce(std::vector<BodyForceType> types,
                      std::vector<SizeType> compoId);
 
@@ -164,6 +337,13 @@ void DefineInitialCondition(std::vector<InitialType> types,
                             std::vector<int> compoId);
 #ifdef OPS_3D
 void UpdateMacroVars3D();
+// Update the macroscopic variables at the nodes of range in a block only,
+// e.g., around the probes, see SampleProbes()
+void UpdateMacroVarsInRange3D(const int blockId, const int* range);
+// Copy the initial condition of the separate macroscopic variables to the
+// interleaved fields and free the former, called once by
+// PreDefinedInitialCondition3D(). A restart reads the interleaved fields.
+void PackMacroVars3D();
 void PreDefinedBodyForce3D();
 void PreDefinedInitialCondition3D();
 void PreDefinedCollision3D();
@@ -114,4 +114,118 @@ static inline OPS_FUN_PREFIX void Swap(Real& a, Real& b) {
     b = tmp;
 }
 
+// The 16-bit populations keep f/w-1 in units of scale, see
+// DefinePopulationStorage(), where a value out of range saturates.
+static inline OPS_FUN_PREFIX short EncodePopulation(const int l, const Real f,
+                                                    const Real scale) {
+    Real level{(f / WEIGHTS[l] - 1) / scale};
+    level = level > 32767 ? 32767 : (level < -32767 ? -32767 : level);
+    return (short)(level >= 0 ? level + 0.5 : level - 0.5);
+}
+
+static inline OPS_FUN_PREFIX Real DecodePopulation(const int l,
+                                                   const short level,
+                                                   const Real scale) {
+    return WEIGHTS[l] * (1 + scale * level);
+}
+
+/*!
+ * The moments kept by the moment scheme at a node, i.e., the density, the
+ * momentum and the momentum flux, see Scheme_StreamCollision_Moment.
+ */
+enum MomentIndex {
+    Moment_Rho = 0,
+    Moment_Jx = 1,
+    Moment_Jy = 2,
+    Moment_Jz = 3,
+    Moment_Pxx = 4,
+    Moment_Pyy = 5,
+    Moment_Pzz = 6,
+    Moment_Pxy = 7,
+    Moment_Pxz = 8,
+    Moment_Pyz = 9,
+    Moment_Num = 10
+};
+
+// The moment kernels keep the populations of a node in a local array, which
+// covers the single-speed 3D lattices up to D3Q27.
+enum { MomentLatticeMax = 27 };
+
+// The population l of the second-order Hermite expansion of the moments m,
+// i.e., w[rho + c.j + (cc - I):(P - rho I)/2] where the sound speed is one in
+// the units of CS.
+static inline OPS_FUN_PREFIX Real CalcRegularisedPopulation(const int l,
+                                                            const Real* m) {
+    const Real cx{CS * XI[l * LATTDIM]};
+    const Real cy{CS * XI[l * LATTDIM + 1]};
+    const Real cz{CS * XI[l * LATTDIM + 2]};
+    const Real rho{m[Moment_Rho]};
+    const Real nxx{m[Moment_Pxx] - rho};
+    const Real nyy{m[Moment_Pyy] - rho};
+    const Real nzz{m[Moment_Pzz] - rho};
+    const Real cj{cx * m[Moment_Jx] + cy * m[Moment_Jy] + cz * m[Moment_Jz]};
+    const Real cnc{cx * cx * nxx + cy * cy * nyy + cz * cz * nzz +
+                   2 * (cx * cy * m[Moment_Pxy] + cx * cz * m[Moment_Pxz] +
+                        cy * cz * m[Moment_Pyz])};
+    return WEIGHTS[l] * (rho + cj + 0.5 * (cnc - nxx - nyy - nzz));
+}
+
+// Project the populations f of the lattice indices lattIdx onto the moments
+static inline OPS_FUN_PREFIX void CalcMoments(const Real* f,
+                                              const int* lattIdx, Real* m) {
+    for (int momentIdx = 0; momentIdx < Moment_Num; momentIdx++) {
+        m[momentIdx] = 0;
+    }
+    for (int xiIdx = lattIdx[0]; xiIdx <= lattIdx[1]; xiIdx++) {
+        const Real cx{CS * XI[xiIdx * LATTDIM]};
+        const Real cy{CS * XI[xiIdx * LATTDIM + 1]};
+        const Real cz{CS * XI[xiIdx * LATTDIM + 2]};
+        const Real fx{f[xiIdx] * cx};
+        const Real fy{f[xiIdx] * cy};
+        m[Moment_Rho] += f[xiIdx];
+        m[Moment_Jx] += fx;
+        m[Moment_Jy] += fy;
+        m[Moment_Jz] += f[xiIdx] * cz;
+        m[Moment_Pxx] += fx * cx;
+        m[Moment_Pyy] += fy * cy;
+        m[Moment_Pzz] += f[xiIdx] * cz * cz;
+        m[Moment_Pxy] += fx * cy;
+        m[Moment_Pxz] += fx * cz;
+        m[Moment_Pyz] += fy * cz;
+    }
+}
+
+// The moments of the second-order equilibrium, i.e., P = rho I + rho uu
+static inline OPS_FUN_PREFIX void CalcEquilibriumMoments(const Real rho,
+                                                         const Real u,
+                                                         const Real v,
+                                                         const Real w,
+                                                         Real* m) {
+    m[Moment_Rho] = rho;
+    m[Moment_Jx] = rho * u;
+    m[Moment_Jy] = rho * v;
+    m[Moment_Jz] = rho * w;
+    m[Moment_Pxx] = rho * (1 + u * u);
+    m[Moment_Pyy] = rho * (1 + v * v);
+    m[Moment_Pzz] = rho * (1 + w * w);
+    m[Moment_Pxy] = rho * u * v;
+    m[Moment_Pxz] = rho * u * w;
+    m[Moment_Pyz] = rho * v * w;
+}
+
+// The BGK collision in the moment space, where only the momentum flux relaxes
+// towards its equilibrium rho I + jj/rho with the rate omega.
+static inline OPS_FUN_PREFIX void CollideMoments(Real* m, const Real omega) {
+    const Real rho{m[Moment_Rho]};
+    const Real jx{m[Moment_Jx]};
+    const Real jy{m[Moment_Jy]};
+    const Real jz{m[Moment_Jz]};
+    const Real eq[]{rho + jx * jx / rho, rho + jy * jy / rho,
+                    rho + jz * jz / rho, jx * jy / rho,
+                    jx * jz / rho,       jy * jz / rho};
+    for (int idx = 0; idx < 6; idx++) {
+        m[Moment_Pxx + idx] = eq[idx] + (1 - omega) * (m[Moment_Pxx + idx] - eq[idx]);
+    }
+}
+
 #endif //MODEL_HOST_DEVICE_H
\ No newline at end of file
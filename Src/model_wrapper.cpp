@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <vector>
 #include <map>
 #include "flowfield.h"
@@ -5,270 +6,630 @@
 #include "model.h"
 #include "scheme.h"
 #include "ops_seq_v2.h"
+#include "roofline.h"
 #include "model_kernel.inc"
 #ifdef OPS_3D
+// Set the scale of each block to twice the largest deviation of the last
+// fetch, or of the populations before the first collision.
+void AdaptPopulationScale3D() {
+    const Real headroom{2};
+    const Real smallest{1e-12};
+    Real shared{0};
+    for (auto& idScale : g_PopulationScale()) {
+        PopulationScale& scale{idScale.second};
+        if (scale.deviation < 0) {
+            const Block& block{g_Block().at(idScale.first)};
+            std::vector<int> iterRng;
+            iterRng.assign(block.WholeRange().begin(),
+                           block.WholeRange().end());
+            for (const auto& idCompo : g_Components()) {
+                const Component& compo{idCompo.second};
+                KERNEL_SCOPE(
+                    "KerCalcPopulationDeviation3D", SpaceDim(), iterRng.data(),
+                    {{g_f()[block.ID()], OPS_READ},
+                     {g_NodeType().at(compo.id).at(block.ID()), OPS_READ}});
+                ops_par_loop(
+                    KerCalcPopulationDeviation3D,
+                    "KerCalcPopulationDeviation3D", block.Get(), SpaceDim(),
+                    iterRng.data(),
+                    ops_arg_dat(g_f()[block.ID()], NUMXI, LOCALSTENCIL,
+                                "double", OPS_READ),
+                    ops_arg_dat(g_NodeType().at(compo.id).at(block.ID()), 1,
+                                LOCALSTENCIL, "int", OPS_READ),
+                    ops_arg_gbl(compo.index, 2, "int", OPS_READ),
+                    ops_arg_reduce(scale.handle, 1, "double", OPS_MAX));
+            }
+            TraceScope scope{"PopulationDeviation", Trace_Reduction};
+            ops_reduction_result(scale.handle, &scale.deviation);
+        }
+        scale.scale = std::max(headroom * scale.deviation / 32767, smallest);
+        scale.adapt = false;
+        shared = std::max(shared, scale.scale);
+    }
+    if (IsPopulationScaleShared()) {
+        for (auto& idScale : g_PopulationScale()) {
+            idScale.second.scale = shared;
+        }
+    }
+}
+
+// Fetch the largest deviations of the collisions since the last fetch, true if
+// any block saturated
+bool IsPopulationSaturated3D() {
+    bool saturated{false};
+    for (auto& idScale : g_PopulationScale()) {
+        PopulationScale& scale{idScale.second};
+        TraceScope scope{"PopulationDeviation", Trace_Reduction};
+        ops_reduction_result(scale.handle, &scale.deviation);
+        if (scale.deviation > 32767 * scale.scale) {
+            saturated = true;
+        }
+    }
+    return saturated;
+}
+
+void CollideByPlan3D() {
+    const Real* pdt{pTimeStep()};
+    for (auto& loop : g_CollisionPlan()) {
+        if (loop.fused) {
+            if (loop.kernel == Collision_BGKIsothermal2nd) {
+                KERNEL_SCOPE(
+                    "KerCollideBGKIsothermalBinary3D", SpaceDim(), loop.iterRng,
+                    {{loop.dats[0], OPS_RW}, {loop.dats[1], OPS_READ},
+                     {loop.dats[2], OPS_READ}, {loop.dats[3], OPS_READ},
+                     {loop.dats[4], OPS_READ}, {loop.dats[5], OPS_READ},
+                     {loop.dats[6], OPS_READ}, {loop.dats[7], OPS_READ},
+                     {loop.dats[8], OPS_READ}, {loop.dats[9], OPS_READ},
+                     {loop.dats[10], OPS_READ}});
+                ops_par_loop(
+                    KerCollideBGKIsothermalBinary3D,
+                    "KerCollideBGKIsothermalBinary3D", loop.block, SpaceDim(),
+                    loop.iterRng,
+                    ops_arg_dat(loop.dats[0], NUMXI, LOCALSTENCIL, "double",
+                                OPS_RW),
+                    ops_arg_dat(loop.dats[1], NUMXI, LOCALSTENCIL, "double",
+                                OPS_READ),
+                    ops_arg_dat(loop.dats[2], 1, LOCALSTENCIL, "int", OPS_READ),
+                    ops_arg_dat(loop.dats[3], 1, LOCALSTENCIL, "double",
+                                OPS_READ),
+                    ops_arg_dat(loop.dats[4], 1, LOCALSTENCIL, "double",
+                                OPS_READ),
+                    ops_arg_dat(loop.dats[5], 1, LOCALSTENCIL, "double",
+                                OPS_READ),
+                    ops_arg_dat(loop.dats[6], 1, LOCALSTENCIL, "double",
+                                OPS_READ),
+                    ops_arg_dat(loop.dats[7], 1, LOCALSTENCIL, "double",
+                                OPS_READ),
+                    ops_arg_dat(loop.dats[8], 1, LOCALSTENCIL, "double",
+                                OPS_READ),
+                    ops_arg_dat(loop.dats[9], 1, LOCALSTENCIL, "double",
+                                OPS_READ),
+                    ops_arg_dat(loop.dats[10], 1, LOCALSTENCIL, "double",
+                                OPS_READ),
+                    ops_arg_gbl(loop.realArgs.data(), 2, "double", OPS_READ),
+                    ops_arg_gbl(pdt, 1, "double", OPS_READ),
+                    ops_arg_gbl(loop.intArgs.data(), 4, "int", OPS_READ),
+                    ops_arg_gbl(loop.grid, loop.gridSize, "double", OPS_READ),
+                    ops_arg_idx());
+            } else {
+                KERNEL_SCOPE(
+                    "KerSwapCollideBGKIsothermalBinary3D", SpaceDim(),
+                    loop.iterRng,
+                    {{loop.dats[1], OPS_RW}, {loop.dats[2], OPS_READ},
+                     {loop.dats[3], OPS_READ}, {loop.dats[4], OPS_READ},
+                     {loop.dats[5], OPS_READ}, {loop.dats[6], OPS_READ},
+                     {loop.dats[7], OPS_READ}, {loop.dats[8], OPS_READ},
+                     {loop.dats[9], OPS_READ}, {loop.dats[10], OPS_READ}});
+                ops_par_loop(
+                    KerSwapCollideBGKIsothermalBinary3D,
+                    "KerSwapCollideBGKIsothermalBinary3D", loop.block,
+                    SpaceDim(), loop.iterRng,
+                    ops_arg_dat(loop.dats[1], NUMXI, LOCALSTENCIL, "double",
+                                OPS_RW),
+                    ops_arg_dat(loop.dats[2], 1, LOCALSTENCIL, "int", OPS_READ),
+                    ops_arg_dat(loop.dats[3], 1, LOCALSTENCIL, "double",
+                                OPS_READ),
+                    ops_arg_dat(loop.dats[4], 1, LOCALSTENCIL, "double",
+                                OPS_READ),
+                    ops_arg_dat(loop.dats[5], 1, LOCALSTENCIL, "double",
+                                OPS_READ),
+                    ops_arg_dat(loop.dats[6], 1, LOCALSTENCIL, "double",
+                                OPS_READ),
+                    ops_arg_dat(loop.dats[7], 1, LOCALSTENCIL, "double",
+                                OPS_READ),
+                    ops_arg_dat(loop.dats[8], 1, LOCALSTENCIL, "double",
+                                OPS_READ),
+                    ops_arg_dat(loop.dats[9], 1, LOCALSTENCIL, "double",
+                                OPS_READ),
+                    ops_arg_dat(loop.dats[10], 1, LOCALSTENCIL, "double",
+                                OPS_READ),
+                    ops_arg_gbl(loop.realArgs.data(), 2, "double", OPS_READ),
+                    ops_arg_gbl(pdt, 1, "double", OPS_READ),
+                    ops_arg_gbl(loop.intArgs.data(), 4, "int", OPS_READ),
+                    ops_arg_gbl(loop.grid, loop.gridSize, "double", OPS_READ),
+                    ops_arg_idx());
+            }
+            continue;
+        }
+        if (loop.compressed) {
+            KERNEL_SCOPE(
+                "KerCollideBGKIsothermalCompressed3D", SpaceDim(), loop.iterRng,
+                {{loop.dats[0], OPS_WRITE}, {loop.dats[1], OPS_READ},
+                 {loop.dats[2], OPS_READ}, {loop.dats[3], OPS_READ},
+                 {loop.dats[4], OPS_READ}, {loop.dats[5], OPS_READ},
+                 {loop.dats[6], OPS_READ}});
+            ops_par_loop(
+                KerCollideBGKIsothermalCompressed3D,
+                "KerCollideBGKIsothermalCompressed3D", loop.block, SpaceDim(),
+                loop.iterRng,
+                ops_arg_dat(loop.dats[0], NUMXI, LOCALSTENCIL, "short",
+                            OPS_WRITE),
+                ops_arg_dat(loop.dats[1], NUMXI, LOCALSTENCIL, "double",
+                            OPS_READ),
+                ops_arg_dat(loop.dats[2], 1, LOCALSTENCIL, "int", OPS_READ),
+                ops_arg_dat(loop.dats[3], 1, LOCALSTENCIL, "double", OPS_READ),
+                ops_arg_dat(loop.dats[4], 1, LOCALSTENCIL, "double", OPS_READ),
+                ops_arg_dat(loop.dats[5], 1, LOCALSTENCIL, "double", OPS_READ),
+                ops_arg_dat(loop.dats[6], 1, LOCALSTENCIL, "double", OPS_READ),
+                ops_arg_gbl(loop.realArgs.data(), 1, "double", OPS_READ),
+                ops_arg_gbl(pdt, 1, "double", OPS_READ),
+                ops_arg_gbl(loop.scale, 1, "double", OPS_READ),
+                ops_arg_gbl(loop.intArgs.data(), 2, "int", OPS_READ),
+                ops_arg_reduce(loop.deviation, 1, "double", OPS_MAX));
+            continue;
+        }
+        if (loop.interleaved) {
+            if (loop.kernel == Collision_BGKIsothermal2nd) {
+                KERNEL_SCOPE(
+                    "KerCollideBGKIsothermalInterleaved3D", SpaceDim(),
+                    loop.iterRng,
+                    {{loop.dats[0], OPS_RW}, {loop.dats[1], OPS_READ},
+                     {loop.dats[2], OPS_READ}, {loop.dats[3], OPS_READ}});
+                ops_par_loop(
+                    KerCollideBGKIsothermalInterleaved3D,
+                    "KerCollideBGKIsothermalInterleaved3D", loop.block,
+                    SpaceDim(), loop.iterRng,
+                    ops_arg_dat(loop.dats[0], NUMXI, LOCALSTENCIL, "double",
+                                OPS_RW),
+                    ops_arg_dat(loop.dats[1], NUMXI, LOCALSTENCIL, "double",
+                                OPS_READ),
+                    ops_arg_dat(loop.dats[2], 1, LOCALSTENCIL, "int", OPS_READ),
+                    ops_arg_dat(loop.dats[3], 4, LOCALSTENCIL, "double",
+                                OPS_READ),
+                    ops_arg_gbl(loop.realArgs.data(), 1, "double", OPS_READ),
+                    ops_arg_gbl(pdt, 1, "double", OPS_READ),
+                    ops_arg_gbl(loop.intArgs.data(), 2, "int", OPS_READ),
+                    ops_arg_gbl(loop.grid, loop.gridSize, "double", OPS_READ),
+                    ops_arg_idx());
+            } else {
+                KERNEL_SCOPE(
+                    "KerSwapCollideBGKIsothermalInterleaved3D", SpaceDim(),
+                    loop.iterRng,
+                    {{loop.dats[1], OPS_RW}, {loop.dats[2], OPS_READ},
+                     {loop.dats[3], OPS_READ}});
+                ops_par_loop(
+                    KerSwapCollideBGKIsothermalInterleaved3D,
+                    "KerSwapCollideBGKIsothermalInterleaved3D", loop.block,
+                    SpaceDim(), loop.iterRng,
+                    ops_arg_dat(loop.dats[1], NUMXI, LOCALSTENCIL, "double",
+                                OPS_RW),
+                    ops_arg_dat(loop.dats[2], 1, LOCALSTENCIL, "int", OPS_READ),
+                    ops_arg_dat(loop.dats[3], 4, LOCALSTENCIL, "double",
+                                OPS_READ),
+                    ops_arg_gbl(loop.realArgs.data(), 1, "double", OPS_READ),
+                    ops_arg_gbl(pdt, 1, "double", OPS_READ),
+                    ops_arg_gbl(loop.intArgs.data(), 2, "int", OPS_READ),
+                    ops_arg_gbl(loop.grid, loop.gridSize, "double", OPS_READ),
+                    ops_arg_idx());
+            }
+            continue;
+        }
+        switch (loop.kernel) {
+            case Collision_BGKIsothermal2nd: {
+                KERNEL_SCOPE(
+                    "KerCollideBGKIsothermal3D", SpaceDim(), loop.iterRng,
+                    {{loop.dats[0], OPS_WRITE}, {loop.dats[1], OPS_READ},
+                     {loop.dats[2], OPS_READ}, {loop.dats[3], OPS_READ},
+                     {loop.dats[4], OPS_READ}, {loop.dats[5], OPS_READ},
+                     {loop.dats[6], OPS_READ}});
+                ops_par_loop(
+                    KerCollideBGKIsothermal3D, "KerCollideBGKIsothermal3D",
+                    loop.block, SpaceDim(), loop.iterRng,
+                    ops_arg_dat(loop.dats[0], NUMXI, LOCALSTENCIL, "double",
+                                OPS_WRITE),
+                    ops_arg_dat(loop.dats[1], NUMXI, LOCALSTENCIL, "double",
+                                OPS_READ),
+                    ops_arg_dat(loop.dats[2], 1, LOCALSTENCIL, "int", OPS_READ),
+                    ops_arg_dat(loop.dats[3], 1, LOCALSTENCIL, "double",
+                                OPS_READ),
+                    ops_arg_dat(loop.dats[4], 1, LOCALSTENCIL, "double",
+                                OPS_READ),
+                    ops_arg_dat(loop.dats[5], 1, LOCALSTENCIL, "double",
+                                OPS_READ),
+                    ops_arg_dat(loop.dats[6], 1, LOCALSTENCIL, "double",
+                                OPS_READ),
+                    ops_arg_gbl(loop.realArgs.data(), 1, "double", OPS_READ),
+                    ops_arg_gbl(pdt, 1, "double", OPS_READ),
+                    ops_arg_gbl(loop.intArgs.data(), 2, "int", OPS_READ),
+                    ops_arg_gbl(loop.grid, loop.gridSize, "double", OPS_READ),
+                    ops_arg_idx());
+            } break;
+            case Collision_BGKIsothermal2nd_Swap: {
+                KERNEL_SCOPE(
+                    "KerSwapCollideBGKIsothermal3D", SpaceDim(), loop.iterRng,
+                    {{loop.dats[1], OPS_RW}, {loop.dats[2], OPS_READ},
+                     {loop.dats[3], OPS_READ}, {loop.dats[4], OPS_READ},
+                     {loop.dats[5], OPS_READ}, {loop.dats[6], OPS_READ}});
+                ops_par_loop(
+                    KerSwapCollideBGKIsothermal3D,
+                    "KerSwapCollideBGKIsothermal3D", loop.block, SpaceDim(),
+                    loop.iterRng,
+                    ops_arg_dat(loop.dats[1], NUMXI, LOCALSTENCIL, "double",
+                                OPS_RW),
+                    ops_arg_dat(loop.dats[2], 1, LOCALSTENCIL, "int", OPS_READ),
+                    ops_arg_dat(loop.dats[3], 1, LOCALSTENCIL, "double",
+                                OPS_READ),
+                    ops_arg_dat(loop.dats[4], 1, LOCALSTENCIL, "double",
+                                OPS_READ),
+                    ops_arg_dat(loop.dats[5], 1, LOCALSTENCIL, "double",
+                                OPS_READ),
+                    ops_arg_dat(loop.dats[6], 1, LOCALSTENCIL, "double",
+                                OPS_READ),
+                    ops_arg_gbl(loop.realArgs.data(), 1, "double", OPS_READ),
+                    ops_arg_gbl(pdt, 1, "double", OPS_READ),
+                    ops_arg_gbl(loop.intArgs.data(), 2, "int", OPS_READ),
+                    ops_arg_gbl(loop.grid, loop.gridSize, "double", OPS_READ),
+                    ops_arg_idx());
+            } break;
+            case Collision_BGKThermal4th: {
+                KERNEL_SCOPE(
+                    "KerCollideBGKThermal3D", SpaceDim(), loop.iterRng,
+                    {{loop.dats[0], OPS_WRITE}, {loop.dats[1], OPS_READ},
+                     {loop.dats[2], OPS_READ}, {loop.dats[3], OPS_READ},
+                     {loop.dats[4], OPS_READ}, {loop.dats[5], OPS_READ},
+                     {loop.dats[6], OPS_READ}, {loop.dats[7], OPS_READ}});
+                ops_par_loop(
+                    KerCollideBGKThermal3D, "KerCollideBGKThermal3D",
+                    loop.block, SpaceDim(), loop.iterRng,
+                    ops_arg_dat(loop.dats[0], NUMXI, LOCALSTENCIL, "double",
+                                OPS_WRITE),
+                    ops_arg_dat(loop.dats[1], NUMXI, LOCALSTENCIL, "double",
+                                OPS_READ),
+                    ops_arg_dat(loop.dats[2], 1, LOCALSTENCIL, "int", OPS_READ),
+                    ops_arg_dat(loop.dats[3], 1, LOCALSTENCIL, "double",
+                                OPS_READ),
+                    ops_arg_dat(loop.dats[4], 1, LOCALSTENCIL, "double",
+                                OPS_READ),
+                    ops_arg_dat(loop.dats[5], 1, LOCALSTENCIL, "double",
+                                OPS_READ),
+                    ops_arg_dat(loop.dats[6], 1, LOCALSTENCIL, "double",
+                                OPS_READ),
+                    ops_arg_dat(loop.dats[7], 1, LOCALSTENCIL, "double",
+                                OPS_READ),
+                    ops_arg_gbl(loop.realArgs.data(), 1, "double", OPS_READ),
+                    ops_arg_gbl(pdt, 1, "double", OPS_READ),
+                    ops_arg_gbl(loop.intArgs.data(), 2, "int", OPS_READ));
+            } break;
+            default:
+                break;
+        }
+    }
+}
+
 void PreDefinedCollision3D() {
 #ifdef OPS_3D
-    for (const auto& idBlock : g_Block()) {
-        const Block& block{idBlock.second};
-        std::vector<int> iterRng;
-        iterRng.assign(block.WholeRange().begin(), block.WholeRange().end());
-        const int blockIndex{block.ID()};
-        for (const auto& idCompo : g_Components()) {
-            const Component& compo{idCompo.second};
-            const CollisionType collisionType{compo.collisionType};
-            const Real tau{compo.tauRef};
-            const Real* pdt{pTimeStep()};
-            switch (collisionType) {
-                case Collision_BGKIsothermal2nd:
-                    ops_par_loop(
-                        KerCollideBGKIsothermal3D, "KerCollideBGKIsothermal3D",
-                        block.Get(), SpaceDim(), iterRng.data(),
-                        ops_arg_dat(g_fStage()[blockIndex], NUMXI, LOCALSTENCIL,
-                                    "double", OPS_WRITE),
-                        ops_arg_dat(g_f()[blockIndex], NUMXI, LOCALSTENCIL,
-                                    "double", OPS_READ),
-                        ops_arg_dat(g_CoordinateXYZ()[blockIndex], SpaceDim(),
-                                    LOCALSTENCIL, "double", OPS_READ),
-                        ops_arg_dat(g_NodeType().at(compo.id).at(blockIndex), 1,
-                                    LOCALSTENCIL, "int", OPS_READ),
-                        ops_arg_dat(g_MacroVars()
-                                        .at(compo.macroVars.at(Variable_Rho).id)
-                                        .at(blockIndex),
-                                    1, LOCALSTENCIL, "double", OPS_READ),
-                        ops_arg_dat(g_MacroVars().at(compo.uId).at(blockIndex),
-                                    1, LOCALSTENCIL, "double", OPS_READ),
-                        ops_arg_dat(g_MacroVars().at(compo.vId).at(blockIndex),
-                                    1, LOCALSTENCIL, "double", OPS_READ),
-                        ops_arg_dat(g_MacroVars().at(compo.wId).at(blockIndex),
-                                    1, LOCALSTENCIL, "double", OPS_READ),
-                        ops_arg_gbl(&tau, 1, "double", OPS_READ),
-                        ops_arg_gbl(pdt, 1, "double", OPS_READ),
-                        ops_arg_gbl(compo.index, 2, "int", OPS_READ));
-                    break;
-                case Collision_BGKIsothermal2nd_Swap:
-                    ops_par_loop(
-                        KerSwapCollideBGKIsothermal3D,
-                        "KerSwapCollideBGKIsothermal3D", block.Get(),
-                        SpaceDim(), iterRng.data(),
-                        ops_arg_dat(g_f()[blockIndex], NUMXI, LOCALSTENCIL,
-                                    "double", OPS_RW),
-                        ops_arg_dat(g_CoordinateXYZ()[blockIndex], SpaceDim(),
-                                    LOCALSTENCIL, "double", OPS_READ),
-                        ops_arg_dat(g_NodeType().at(compo.id).at(blockIndex), 1,
-                                    LOCALSTENCIL, "int", OPS_READ),
-                        ops_arg_dat(g_MacroVars()
-                                        .at(compo.macroVars.at(Variable_Rho).id)
-                                        .at(blockIndex),
-                                    1, LOCALSTENCIL, "double", OPS_READ),
-                        ops_arg_dat(g_MacroVars().at(compo.uId).at(blockIndex),
-                                    1, LOCALSTENCIL, "double", OPS_READ),
-                        ops_arg_dat(g_MacroVars().at(compo.vId).at(blockIndex),
-                                    1, LOCALSTENCIL, "double", OPS_READ),
-                        ops_arg_dat(g_MacroVars().at(compo.wId).at(blockIndex),
-                                    1, LOCALSTENCIL, "double", OPS_READ),
-                        ops_arg_gbl(&tau, 1, "double", OPS_READ),
-                        ops_arg_gbl(pdt, 1, "double", OPS_READ),
-                        ops_arg_gbl(compo.index, 2, "int", OPS_READ));
-                    break;
-                case Collision_BGKThermal4th:
-                    ops_par_loop(
-                        KerCollideBGKThermal3D, "KerCollideBGKThermal3D",
-                        block.Get(), SpaceDim(), iterRng.data(),
-                        ops_arg_dat(g_fStage()[blockIndex], NUMXI, LOCALSTENCIL,
-                                    "double", OPS_WRITE),
-                        ops_arg_dat(g_f()[blockIndex], NUMXI, LOCALSTENCIL,
-                                    "double", OPS_READ),
-                        ops_arg_dat(g_NodeType().at(compo.id).at(blockIndex), 1,
-                                    LOCALSTENCIL, "int", OPS_READ),
-                        ops_arg_dat(g_MacroVars()
-                                        .at(compo.macroVars.at(Variable_Rho).id)
-                                        .at(blockIndex),
-                                    1, LOCALSTENCIL, "double", OPS_READ),
-                        ops_arg_dat(g_MacroVars().at(compo.uId).at(blockIndex),
-                                    1, LOCALSTENCIL, "double", OPS_READ),
-                        ops_arg_dat(g_MacroVars().at(compo.vId).at(blockIndex),
-                                    1, LOCALSTENCIL, "double", OPS_READ),
-                        ops_arg_dat(g_MacroVars().at(compo.wId).at(blockIndex),
-                                    1, LOCALSTENCIL, "double", OPS_READ),
-                        ops_arg_dat(g_MacroVars()
-                                        .at(compo.macroVars.at(Variable_T).id)
-                                        .at(blockIndex),
-                                    1, LOCALSTENCIL, "double", OPS_READ),
-                        ops_arg_gbl(&tau, 1, "double", OPS_READ),
-                        ops_arg_gbl(pdt, 1, "double", OPS_READ),
-                        ops_arg_gbl(compo.index, 2, "int", OPS_READ));
-                    break;
-                default:
-                    ops_printf(
-                        "The specified collision type is not implemented!\n");
-                    break;
-            }
+    if (!IsPopulationCompressed()) {
+        CollideByPlan3D();
+        return;
+    }
+    if (g_PopulationScale().begin()->second.adapt) {
+        AdaptPopulationScale3D();
+    }
+    CollideByPlan3D();
+    const SizeType collisions{CountCompressedCollision()};
+    if (collisions == 0) {
+        return;
+    }
+    // The collision only writes fStage, so that a saturated one is repeated
+    // with the scale of its own deviation, which it cannot exceed again.
+    // The scale is otherwise adapted before the next collision, as fStage is
+    // yet to be decoded by the stream. The earlier collisions of a longer
+    // window have been streamed already and cannot be repaired, so that the
+    // fetches are scheduled anew to keep the next windows short.
+    if (IsPopulationSaturated3D()) {
+        if (collisions > 1) {
+            ops_printf(
+                "Warning! The compressed populations saturated within the "
+                "last %d collisions, where up to %d of them are clipped, "
+                "please fetch their scale more often!\n",
+                (int)collisions, (int)collisions - 1);
+        }
+        AdaptPopulationScale3D();
+        CollideByPlan3D();
+        RestartPopulationScaleFetch();
+    } else {
+        for (auto& idScale : g_PopulationScale()) {
+            idScale.second.adapt = true;
         }
     }
 #endif  // OPS_3D
 }
 
+// The interleaved variables are only computed at the nodes that are not
+// immersed solid, where the others keep the values given by the separate
+// fields, i.e., the initial condition.
+void PackMacroVars3D() {
+#ifdef OPS_3D
+    for (const auto& idCompo : g_Components()) {
+        const Component& compo{idCompo.second};
+        const int rhoId{compo.macroVars.at(Variable_Rho).id};
+        if (!IsMacroVarsInterleaved(compo) ||
+            !g_MacroVars().at(rhoId).IsAllocated()) {
+            continue;
+        }
+        for (const auto& idBlock : g_Block()) {
+            const Block& block{idBlock.second};
+            const int blockIndex{block.ID()};
+            std::vector<int> iterRng;
+            iterRng.assign(block.WholeRange().begin(),
+                           block.WholeRange().end());
+            ops_par_loop(
+                KerPackMacroVars3D, "KerPackMacroVars3D", block.Get(),
+                SpaceDim(), iterRng.data(),
+                ops_arg_dat(
+                    g_InterleavedMacroVars().at(compo.id).at(blockIndex), 4,
+                    LOCALSTENCIL, "double", OPS_WRITE),
+                ops_arg_dat(g_MacroVars().at(rhoId).at(blockIndex), 1,
+                            LOCALSTENCIL, "double", OPS_READ),
+                ops_arg_dat(g_MacroVars().at(compo.uId).at(blockIndex), 1,
+                            LOCALSTENCIL, "double", OPS_READ),
+                ops_arg_dat(g_MacroVars().at(compo.vId).at(blockIndex), 1,
+                            LOCALSTENCIL, "double", OPS_READ),
+                ops_arg_dat(g_MacroVars().at(compo.wId).at(blockIndex), 1,
+                            LOCALSTENCIL, "double", OPS_READ));
+        }
+        for (const auto& typeVar : compo.macroVars) {
+            g_MacroVars().at(typeVar.second.id).Free();
+        }
+        ops_printf(
+            "The separate macroscopic variables of Component %s are freed\n",
+            compo.name.c_str());
+    }
+#endif  // OPS_3D
+}
+
+#ifdef OPS_3D
+// Compute the macroscopic variables of a loop of the plan at loop.iterRng
+void CalcMacroVarsByPlan3D(LoopPlan& loop) {
+    const Real* pdt{pTimeStep()};
+    if (loop.moment) {
+        KERNEL_SCOPE(
+            "KerCalcMacroVarsMoment3D", SpaceDim(), loop.iterRng,
+            {{loop.dats[0], OPS_RW}, {loop.dats[1], OPS_RW},
+             {loop.dats[2], OPS_RW}, {loop.dats[3], OPS_RW},
+             {loop.dats[4 + CurrentMomentsIndex()], OPS_READ},
+             {loop.dats[6], OPS_READ}});
+        ops_par_loop(
+            KerCalcMacroVarsMoment3D, "KerCalcMacroVarsMoment3D",
+            loop.block, SpaceDim(), loop.iterRng,
+            ops_arg_dat(loop.dats[0], 1, LOCALSTENCIL, "double", OPS_RW),
+            ops_arg_dat(loop.dats[1], 1, LOCALSTENCIL, "double", OPS_RW),
+            ops_arg_dat(loop.dats[2], 1, LOCALSTENCIL, "double", OPS_RW),
+            ops_arg_dat(loop.dats[3], 1, LOCALSTENCIL, "double", OPS_RW),
+            ops_arg_dat(loop.dats[4 + CurrentMomentsIndex()], Moment_Num,
+                        LOCALSTENCIL, "double", OPS_READ),
+            ops_arg_dat(loop.dats[6], 1, LOCALSTENCIL, "int", OPS_READ));
+        return;
+    }
+    if (loop.interleaved) {
+        KERNEL_SCOPE(
+            "KerCalcMacroVarsInterleaved3D", SpaceDim(), loop.iterRng,
+            {{loop.dats[0], OPS_RW}, {loop.dats[1], OPS_READ},
+             {loop.dats[2], OPS_READ}});
+        ops_par_loop(
+            KerCalcMacroVarsInterleaved3D, "KerCalcMacroVarsInterleaved3D",
+            loop.block, SpaceDim(), loop.iterRng,
+            ops_arg_dat(loop.dats[0], 4, LOCALSTENCIL, "double", OPS_RW),
+            ops_arg_dat(loop.dats[1], NUMXI, LOCALSTENCIL, "double",
+                        OPS_READ),
+            ops_arg_dat(loop.dats[2], 1, LOCALSTENCIL, "int", OPS_READ),
+            ops_arg_gbl(loop.intArgs.data(), 2, "int", OPS_READ));
+        return;
+    }
+    if (loop.fused) {
+        KERNEL_SCOPE(
+            "KerCalcMacroVarsBinary3D", SpaceDim(), loop.iterRng,
+            {{loop.dats[0], OPS_RW}, {loop.dats[1], OPS_RW},
+             {loop.dats[2], OPS_RW}, {loop.dats[3], OPS_RW},
+             {loop.dats[4], OPS_RW}, {loop.dats[5], OPS_RW},
+             {loop.dats[6], OPS_RW}, {loop.dats[7], OPS_RW},
+             {loop.dats[8], OPS_READ}, {loop.dats[9], OPS_READ}});
+        ops_par_loop(
+            KerCalcMacroVarsBinary3D, "KerCalcMacroVarsBinary3D",
+            loop.block, SpaceDim(), loop.iterRng,
+            ops_arg_dat(loop.dats[0], 1, LOCALSTENCIL, "double", OPS_RW),
+            ops_arg_dat(loop.dats[1], 1, LOCALSTENCIL, "double", OPS_RW),
+            ops_arg_dat(loop.dats[2], 1, LOCALSTENCIL, "double", OPS_RW),
+            ops_arg_dat(loop.dats[3], 1, LOCALSTENCIL, "double", OPS_RW),
+            ops_arg_dat(loop.dats[4], 1, LOCALSTENCIL, "double", OPS_RW),
+            ops_arg_dat(loop.dats[5], 1, LOCALSTENCIL, "double", OPS_RW),
+            ops_arg_dat(loop.dats[6], 1, LOCALSTENCIL, "double", OPS_RW),
+            ops_arg_dat(loop.dats[7], 1, LOCALSTENCIL, "double", OPS_RW),
+            ops_arg_dat(loop.dats[8], NUMXI, LOCALSTENCIL, "double",
+                        OPS_READ),
+            ops_arg_dat(loop.dats[9], 1, LOCALSTENCIL, "int", OPS_READ),
+            ops_arg_gbl(loop.intArgs.data(), 4, "int", OPS_READ));
+        return;
+    }
+    switch (loop.kernel) {
+        case Variable_Rho: {
+            KERNEL_SCOPE(
+                "KerCalcDensity3D", SpaceDim(), loop.iterRng,
+                {{loop.dats[0], OPS_RW}, {loop.dats[1], OPS_READ},
+                 {loop.dats[2], OPS_READ}});
+            ops_par_loop(
+                KerCalcDensity3D, "KerCalcDensity3D", loop.block,
+                SpaceDim(), loop.iterRng,
+                ops_arg_dat(loop.dats[0], 1, LOCALSTENCIL, "double",
+                            OPS_RW),
+                ops_arg_dat(loop.dats[1], NUMXI, LOCALSTENCIL, "double",
+                            OPS_READ),
+                ops_arg_dat(loop.dats[2], 1, LOCALSTENCIL, "int", OPS_READ),
+                ops_arg_gbl(loop.intArgs.data(), 2, "int", OPS_READ));
+        } break;
+        case Variable_U: {
+            KERNEL_SCOPE(
+                "KerCalcU3D", SpaceDim(), loop.iterRng,
+                {{loop.dats[0], OPS_RW}, {loop.dats[1], OPS_READ},
+                 {loop.dats[2], OPS_READ}, {loop.dats[3], OPS_READ}});
+            ops_par_loop(
+                KerCalcU3D, "KerCalcU3D", loop.block, SpaceDim(),
+                loop.iterRng,
+                ops_arg_dat(loop.dats[0], 1, LOCALSTENCIL, "double",
+                            OPS_RW),
+                ops_arg_dat(loop.dats[1], NUMXI, LOCALSTENCIL, "double",
+                            OPS_READ),
+                ops_arg_dat(loop.dats[2], 1, LOCALSTENCIL, "int", OPS_READ),
+                ops_arg_dat(loop.dats[3], 1, LOCALSTENCIL, "double",
+                            OPS_READ),
+                ops_arg_gbl(loop.intArgs.data(), 2, "int", OPS_READ));
+        } break;
+        case Variable_V: {
+            KERNEL_SCOPE(
+                "KerCalcV3D", SpaceDim(), loop.iterRng,
+                {{loop.dats[0], OPS_RW}, {loop.dats[1], OPS_READ},
+                 {loop.dats[2], OPS_READ}, {loop.dats[3], OPS_READ}});
+            ops_par_loop(
+                KerCalcV3D, "KerCalcV3D", loop.block, SpaceDim(),
+                loop.iterRng,
+                ops_arg_dat(loop.dats[0], 1, LOCALSTENCIL, "double",
+                            OPS_RW),
+                ops_arg_dat(loop.dats[1], NUMXI, LOCALSTENCIL, "double",
+                            OPS_READ),
+                ops_arg_dat(loop.dats[2], 1, LOCALSTENCIL, "int", OPS_READ),
+                ops_arg_dat(loop.dats[3], 1, LOCALSTENCIL, "double",
+                            OPS_READ),
+                ops_arg_gbl(loop.intArgs.data(), 2, "int", OPS_READ));
+        } break;
+        case Variable_W: {
+            KERNEL_SCOPE(
+                "KerCalcW3D", SpaceDim(), loop.iterRng,
+                {{loop.dats[0], OPS_RW}, {loop.dats[1], OPS_READ},
+                 {loop.dats[2], OPS_READ}, {loop.dats[3], OPS_READ}});
+            ops_par_loop(
+                KerCalcW3D, "KerCalcW3D", loop.block, SpaceDim(),
+                loop.iterRng,
+                ops_arg_dat(loop.dats[0], 1, LOCALSTENCIL, "double",
+                            OPS_RW),
+                ops_arg_dat(loop.dats[1], NUMXI, LOCALSTENCIL, "double",
+                            OPS_READ),
+                ops_arg_dat(loop.dats[2], 1, LOCALSTENCIL, "int", OPS_READ),
+                ops_arg_dat(loop.dats[3], 1, LOCALSTENCIL, "double",
+                            OPS_READ),
+                ops_arg_gbl(loop.intArgs.data(), 2, "int", OPS_READ));
+        } break;
+        case Variable_U_Force: {
+            KERNEL_SCOPE(
+                "KerCalcUForce3D", SpaceDim(), loop.iterRng,
+                {{loop.dats[0], OPS_RW}, {loop.dats[1], OPS_READ},
+                 {loop.dats[2], OPS_READ}, {loop.dats[4], OPS_READ},
+                 {loop.dats[3], OPS_READ}});
+            ops_par_loop(
+                KerCalcUForce3D, "KerCalcUForce3D", loop.block, SpaceDim(),
+                loop.iterRng,
+                ops_arg_dat(loop.dats[0], 1, LOCALSTENCIL, "double",
+                            OPS_RW),
+                ops_arg_dat(loop.dats[1], NUMXI, LOCALSTENCIL, "double",
+                            OPS_READ),
+                ops_arg_dat(loop.dats[2], 1, LOCALSTENCIL, "int", OPS_READ),
+                ops_arg_dat(loop.dats[4], SpaceDim(), LOCALSTENCIL,
+                            "double", OPS_READ),
+                ops_arg_dat(loop.dats[3], 1, LOCALSTENCIL, "double",
+                            OPS_READ),
+                ops_arg_gbl(pdt, 1, "double", OPS_READ),
+                ops_arg_gbl(loop.intArgs.data(), 2, "int", OPS_READ),
+                ops_arg_gbl(loop.grid, loop.gridSize, "double", OPS_READ),
+                ops_arg_idx());
+        } break;
+        case Variable_V_Force: {
+            KERNEL_SCOPE(
+                "KerCalcVForce3D", SpaceDim(), loop.iterRng,
+                {{loop.dats[0], OPS_RW}, {loop.dats[1], OPS_READ},
+                 {loop.dats[2], OPS_READ}, {loop.dats[4], OPS_READ},
+                 {loop.dats[3], OPS_READ}});
+            ops_par_loop(
+                KerCalcVForce3D, "KerCalcVForce3D", loop.block, SpaceDim(),
+                loop.iterRng,
+                ops_arg_dat(loop.dats[0], 1, LOCALSTENCIL, "double",
+                            OPS_RW),
+                ops_arg_dat(loop.dats[1], NUMXI, LOCALSTENCIL, "double",
+                            OPS_READ),
+                ops_arg_dat(loop.dats[2], 1, LOCALSTENCIL, "int", OPS_READ),
+                ops_arg_dat(loop.dats[4], SpaceDim(), LOCALSTENCIL,
+                            "double", OPS_READ),
+                ops_arg_dat(loop.dats[3], 1, LOCALSTENCIL, "double",
+                            OPS_READ),
+                ops_arg_gbl(pdt, 1, "double", OPS_READ),
+                ops_arg_gbl(loop.intArgs.data(), 2, "int", OPS_READ),
+                ops_arg_gbl(loop.grid, loop.gridSize, "double", OPS_READ),
+                ops_arg_idx());
+        } break;
+        case Variable_W_Force: {
+            KERNEL_SCOPE(
+                "KerCalcWForce3D", SpaceDim(), loop.iterRng,
+                {{loop.dats[0], OPS_RW}, {loop.dats[1], OPS_READ},
+                 {loop.dats[2], OPS_READ}, {loop.dats[4], OPS_READ},
+                 {loop.dats[3], OPS_READ}});
+            ops_par_loop(
+                KerCalcWForce3D, "KerCalcWForce3D", loop.block, SpaceDim(),
+                loop.iterRng,
+                ops_arg_dat(loop.dats[0], 1, LOCALSTENCIL, "double",
+                            OPS_RW),
+                ops_arg_dat(loop.dats[1], NUMXI, LOCALSTENCIL, "double",
+                            OPS_READ),
+                ops_arg_dat(loop.dats[2], 1, LOCALSTENCIL, "int", OPS_READ),
+                ops_arg_dat(loop.dats[4], SpaceDim(), LOCALSTENCIL,
+                            "double", OPS_READ),
+                ops_arg_dat(loop.dats[3], 1, LOCALSTENCIL, "double",
+                            OPS_READ),
+                ops_arg_gbl(pdt, 1, "double", OPS_READ),
+                ops_arg_gbl(loop.intArgs.data(), 2, "int", OPS_READ),
+                ops_arg_gbl(loop.grid, loop.gridSize, "double", OPS_READ),
+                ops_arg_idx());
+        } break;
+        default:
+            break;
+    }
+}
+#endif  // OPS_3D
+
 void UpdateMacroVars3D() {
 #ifdef OPS_3D
-    for (const auto& idBlock : g_Block()) {
-        const Block& block{idBlock.second};
-        std::vector<int> iterRng;
-        iterRng.assign(block.WholeRange().begin(), block.WholeRange().end());
-        const int blockIndex{block.ID()};
-        const Real* pdt{pTimeStep()};
-        for (const auto& idCompo : g_Components()) {
-            const Component& compo{idCompo.second};
-            for (auto& macroVar : compo.macroVars) {
-                const int varId{macroVar.second.id};
-                const VariableTypes varType{macroVar.first};
-                switch (varType) {
-                    case Variable_Rho:
-                        ops_par_loop(
-                            KerCalcDensity3D, "KerCalcDensity3D", block.Get(),
-                            SpaceDim(), iterRng.data(),
-                            ops_arg_dat(g_MacroVars().at(varId).at(blockIndex),
-                                        1, LOCALSTENCIL, "double", OPS_RW),
-                            ops_arg_dat(g_f()[blockIndex], NUMXI, LOCALSTENCIL,
-                                        "double", OPS_READ),
-                            ops_arg_dat(
-                                g_NodeType().at(compo.id).at(blockIndex), 1,
-                                LOCALSTENCIL, "int", OPS_READ),
-                            ops_arg_gbl(compo.index, 2, "int", OPS_READ));
-                        break;
-                    case Variable_U:
-                        ops_par_loop(
-                            KerCalcU3D, "KerCalcU3D", block.Get(), SpaceDim(),
-                            iterRng.data(),
-                            ops_arg_dat(g_MacroVars().at(varId).at(blockIndex),
-                                        1, LOCALSTENCIL, "double", OPS_RW),
-                            ops_arg_dat(g_f()[blockIndex], NUMXI, LOCALSTENCIL,
-                                        "double", OPS_READ),
-                            ops_arg_dat(
-                                g_NodeType().at(compo.id).at(blockIndex), 1,
-                                LOCALSTENCIL, "int", OPS_READ),
-                            ops_arg_dat(
-                                g_MacroVars()
-                                    .at(compo.macroVars.at(Variable_Rho).id)
-                                    .at(blockIndex),
-                                1, LOCALSTENCIL, "double", OPS_READ),
-                            ops_arg_gbl(compo.index, 2, "int", OPS_READ));
-                        break;
-                    case Variable_V:
-                        ops_par_loop(
-                            KerCalcV3D, "KerCalcV3D", block.Get(), SpaceDim(),
-                            iterRng.data(),
-                            ops_arg_dat(g_MacroVars().at(varId).at(blockIndex),
-                                        1, LOCALSTENCIL, "double", OPS_RW),
-                            ops_arg_dat(g_f()[blockIndex], NUMXI, LOCALSTENCIL,
-                                        "double", OPS_READ),
-                            ops_arg_dat(
-                                g_NodeType().at(compo.id).at(blockIndex), 1,
-                                LOCALSTENCIL, "int", OPS_READ),
-                            ops_arg_dat(
-                                g_MacroVars()
-                                    .at(compo.macroVars.at(Variable_Rho).id)
-                                    .at(blockIndex),
-                                1, LOCALSTENCIL, "double", OPS_READ),
-                            ops_arg_gbl(compo.index, 2, "int", OPS_READ));
-                        break;
-                    case Variable_W:
-                        ops_par_loop(
-                            KerCalcW3D, "KerCalcW3D", block.Get(), SpaceDim(),
-                            iterRng.data(),
-                            ops_arg_dat(g_MacroVars().at(varId).at(blockIndex),
-                                        1, LOCALSTENCIL, "double", OPS_RW),
-                            ops_arg_dat(g_f()[blockIndex], NUMXI, LOCALSTENCIL,
-                                        "double", OPS_READ),
-                            ops_arg_dat(
-                                g_NodeType().at(compo.id).at(blockIndex), 1,
-                                LOCALSTENCIL, "int", OPS_READ),
-                            ops_arg_dat(
-                                g_MacroVars()
-                                    .at(compo.macroVars.at(Variable_Rho).id)
-                                    .at(blockIndex),
-                                1, LOCALSTENCIL, "double", OPS_READ),
-                            ops_arg_gbl(compo.index, 2, "int", OPS_READ));
-                        break;
-                    case Variable_U_Force:
-                        ops_par_loop(
-                            KerCalcUForce3D, "KerCalcUForce3D", block.Get(),
-                            SpaceDim(), iterRng.data(),
-                            ops_arg_dat(g_MacroVars().at(varId).at(blockIndex),
-                                        1, LOCALSTENCIL, "double", OPS_RW),
-                            ops_arg_dat(g_f()[blockIndex], NUMXI, LOCALSTENCIL,
-                                        "double", OPS_READ),
-                            ops_arg_dat(
-                                g_NodeType().at(compo.id).at(blockIndex), 1,
-                                LOCALSTENCIL, "int", OPS_READ),
-                            ops_arg_dat(g_CoordinateXYZ()[blockIndex],
-                                        SpaceDim(), LOCALSTENCIL, "double",
-                                        OPS_READ),
-                            ops_arg_dat(
-                                g_MacroBodyforce().at(compo.id).at(blockIndex),
-                                SpaceDim(), LOCALSTENCIL, "double", OPS_READ),
-                            ops_arg_dat(
-                                g_MacroVars()
-                                    .at(compo.macroVars.at(Variable_Rho).id)
-                                    .at(blockIndex),
-                                1, LOCALSTENCIL, "double", OPS_READ),
-                            ops_arg_gbl(pdt, 1, "double", OPS_READ),
-                            ops_arg_gbl(compo.index, 2, "int", OPS_READ));
-                        break;
-                    case Variable_V_Force:
-                        ops_par_loop(
-                            KerCalcVForce3D, "KerCalcVForce3D", block.Get(),
-                            SpaceDim(), iterRng.data(),
-                            ops_arg_dat(g_MacroVars().at(varId).at(blockIndex),
-                                        1, LOCALSTENCIL, "double", OPS_RW),
-                            ops_arg_dat(g_f()[blockIndex], NUMXI, LOCALSTENCIL,
-                                        "double", OPS_READ),
-                            ops_arg_dat(
-                                g_NodeType().at(compo.id).at(blockIndex), 1,
-                                LOCALSTENCIL, "int", OPS_READ),
-                            ops_arg_dat(g_CoordinateXYZ()[blockIndex],
-                                        SpaceDim(), LOCALSTENCIL, "double",
-                                        OPS_READ),
-                            ops_arg_dat(
-                                g_MacroBodyforce().at(compo.id).at(blockIndex),
-                                SpaceDim(), LOCALSTENCIL, "double", OPS_READ),
-                            ops_arg_dat(
-                                g_MacroVars()
-                                    .at(compo.macroVars.at(Variable_Rho).id)
-                                    .at(blockIndex),
-                                1, LOCALSTENCIL, "double", OPS_READ),
-                            ops_arg_gbl(pdt, 1, "double", OPS_READ),
-                            ops_arg_gbl(compo.index, 2, "int", OPS_READ));
-                        break;
-                    case Variable_W_Force:
-                        ops_par_loop(
-                            KerCalcWForce3D, "KerCalcWForce3D", block.Get(),
-                            SpaceDim(), iterRng.data(),
-                            ops_arg_dat(g_MacroVars().at(varId).at(blockIndex),
-                                        1, LOCALSTENCIL, "double", OPS_RW),
-                            ops_arg_dat(g_f()[blockIndex], NUMXI, LOCALSTENCIL,
-                                        "double", OPS_READ),
-                            ops_arg_dat(
-                                g_NodeType().at(compo.id).at(blockIndex), 1,
-                                LOCALSTENCIL, "int", OPS_READ),
-                            ops_arg_dat(g_CoordinateXYZ()[blockIndex],
-                                        SpaceDim(), LOCALSTENCIL, "double",
-                                        OPS_READ),
-                            ops_arg_dat(
-                                g_MacroBodyforce().at(compo.id).at(blockIndex),
-                                SpaceDim(), LOCALSTENCIL, "double", OPS_READ),
-                            ops_arg_dat(
-                                g_MacroVars()
-                                    .at(compo.macroVars.at(Variable_Rho).id)
-                                    .at(blockIndex),
-                                1, LOCALSTENCIL, "double", OPS_READ),
-                            ops_arg_gbl(pdt, 1, "double", OPS_READ),
-                            ops_arg_gbl(compo.index, 2, "int", OPS_READ));
-                        break;
-                    default:
-                        break;
-                }
-            }
+    for (auto& loop : g_MacroVarsPlan()) {
+        CalcMacroVarsByPlan3D(loop);
+    }
+#endif  // OPS_3D
+}
+
+void UpdateMacroVarsInRange3D(const int blockId, const int* range) {
+#ifdef OPS_3D
+    const ops_block block{g_Block().at(blockId).Get()};
+    for (const auto& loop : g_MacroVarsPlan()) {
+        if (loop.block != block) {
+            continue;
+        }
+        LoopPlan part{loop};
+        bool empty{false};
+        for (int axis = 0; axis < SpaceDim(); axis++) {
+            part.iterRng[2 * axis] =
+                std::max(loop.iterRng[2 * axis], range[2 * axis]);
+            part.iterRng[2 * axis + 1] =
+                std::min(loop.iterRng[2 * axis + 1], range[2 * axis + 1]);
+            empty = empty ||
+                    part.iterRng[2 * axis] >= part.iterRng[2 * axis + 1];
+        }
+        if (!empty) {
+            CalcMacroVarsByPlan3D(part);
         }
     }
 #endif  // OPS_3D
@@ -276,69 +637,56 @@ void UpdateMacroVars3D() {
 
 void PreDefinedBodyForce3D() {
 #ifdef OPS_3D
-    for (const auto& idBlock : g_Block()) {
-        const Block& block{idBlock.second};
-        std::vector<int> iterRng;
-        iterRng.assign(block.WholeRange().begin(), block.WholeRange().end());
-        const int blockIndex{block.ID()};
-        for (const auto& idCompo : g_Components()) {
-            const Component& compo{idCompo.second};
-            const BodyForceType forceType{compo.bodyForceType};
-            switch (forceType) {
-                case BodyForce_1st:
-                    ops_par_loop(
-                        KerCalcBodyForce1ST3D, "KerCalcBodyForce1ST3D",
-                        block.Get(), SpaceDim(), iterRng.data(),
-                        ops_arg_dat(g_fStage()[blockIndex], NUMXI, LOCALSTENCIL,
-                                    "double", OPS_WRITE),
-                        ops_arg_dat(
-                            g_MacroBodyforce().at(compo.id).at(blockIndex),
-                            SpaceDim(), LOCALSTENCIL, "double", OPS_READ),
-                        ops_arg_dat(g_MacroVars()
-                                        .at(compo.macroVars.at(Variable_Rho).id)
-                                        .at(blockIndex),
-                                    1, LOCALSTENCIL, "double", OPS_RW),
-                        ops_arg_dat(g_NodeType().at(compo.id).at(blockIndex), 1,
-                                    LOCALSTENCIL, "int", OPS_READ),
-                        ops_arg_gbl(compo.index, 2, "int", OPS_READ));
-                    break;
-                case BodyForce_1st_Swap:
-                    ops_par_loop(
-                        KerSwapCalcBodyForce1ST3D, "KerSwapCalcBodyForce1ST3D",
-                        block.Get(), SpaceDim(), iterRng.data(),
-                        ops_arg_dat(g_f()[blockIndex], NUMXI, LOCALSTENCIL,
-                                    "double", OPS_WRITE),
-                        ops_arg_dat(
-                            g_MacroBodyforce().at(compo.id).at(blockIndex),
-                            SpaceDim(), LOCALSTENCIL, "double", OPS_READ),
-                        ops_arg_dat(g_MacroVars()
-                                        .at(compo.macroVars.at(Variable_Rho).id)
-                                        .at(blockIndex),
-                                    1, LOCALSTENCIL, "double", OPS_RW),
-                        ops_arg_dat(g_NodeType().at(compo.id).at(blockIndex), 1,
-                                    LOCALSTENCIL, "int", OPS_READ),
-                        ops_arg_gbl(compo.index, 2, "int", OPS_READ));
-                    break;
-                case BodyForce_None:
-                    ops_par_loop(
-                        KerCalcBodyForceNone3D, "KerCalcBodyForceNone",
-                        block.Get(), SpaceDim(), iterRng.data(),
-                        ops_arg_dat(g_fStage()[blockIndex], NUMXI, LOCALSTENCIL,
-                                    "double", OPS_WRITE),
-                        ops_arg_dat(
-                            g_MacroBodyforce().at(compo.id).at(blockIndex),
-                            SpaceDim(), LOCALSTENCIL, "double", OPS_READ),
-                        ops_arg_dat(g_NodeType().at(compo.id).at(blockIndex), 1,
-                                    LOCALSTENCIL, "int", OPS_READ),
-                        ops_arg_gbl(compo.index, 2, "int", OPS_READ));
-                    break;
-                  case BodyForce_None_Swap:
-                    break;
-                default:
-                    ops_printf(
-                        "The specified force type is not implemented!\n");
-                    break;
-            }
+    for (auto& loop : g_BodyForcePlan()) {
+        switch (loop.kernel) {
+            case BodyForce_1st: {
+                KERNEL_SCOPE(
+                    "KerCalcBodyForce1ST3D", SpaceDim(), loop.iterRng,
+                    {{loop.dats[0], OPS_WRITE}, {loop.dats[2], OPS_READ},
+                     {loop.dats[4], OPS_RW}, {loop.dats[3], OPS_READ}});
+                ops_par_loop(
+                    KerCalcBodyForce1ST3D, "KerCalcBodyForce1ST3D", loop.block,
+                    SpaceDim(), loop.iterRng,
+                    ops_arg_dat(loop.dats[0], NUMXI, LOCALSTENCIL, "double",
+                                OPS_WRITE),
+                    ops_arg_dat(loop.dats[2], SpaceDim(), LOCALSTENCIL,
+                                "double", OPS_READ),
+                    ops_arg_dat(loop.dats[4], 1, LOCALSTENCIL, "double",
+                                OPS_RW),
+                    ops_arg_dat(loop.dats[3], 1, LOCALSTENCIL, "int", OPS_READ),
+                    ops_arg_gbl(loop.intArgs.data(), 2, "int", OPS_READ));
+            } break;
+            case BodyForce_1st_Swap: {
+                KERNEL_SCOPE(
+                    "KerSwapCalcBodyForce1ST3D", SpaceDim(), loop.iterRng,
+                    {{loop.dats[1], OPS_WRITE}, {loop.dats[2], OPS_READ},
+                     {loop.dats[4], OPS_RW}, {loop.dats[3], OPS_READ}});
+                ops_par_loop(
+                    KerSwapCalcBodyForce1ST3D, "KerSwapCalcBodyForce1ST3D",
+                    loop.block, SpaceDim(), loop.iterRng,
+                    ops_arg_dat(loop.dats[1], NUMXI, LOCALSTENCIL, "double",
+                                OPS_WRITE),
+                    ops_arg_dat(loop.dats[2], SpaceDim(), LOCALSTENCIL,
+                                "double", OPS_READ),
+                    ops_arg_dat(loop.dats[4], 1, LOCALSTENCIL, "double",
+                                OPS_RW),
+                    ops_arg_dat(loop.dats[3], 1, LOCALSTENCIL, "int", OPS_READ),
+                    ops_arg_gbl(loop.intArgs.data(), 2, "int", OPS_READ));
+            } break;
+            case BodyForce_None: {
+                KERNEL_SCOPE(
+                    "KerCalcBodyForceNone", SpaceDim(), loop.iterRng,
+                    {{loop.dats[0], OPS_WRITE}, {loop.dats[3], OPS_READ}});
+                ops_par_loop(
+                    KerCalcBodyForceNone3D, "KerCalcBodyForceNone", loop.block,
+                    SpaceDim(), loop.iterRng,
+                    ops_arg_dat(loop.dats[0], NUMXI, LOCALSTENCIL, "double",
+                                OPS_WRITE),
+                    ops_arg_dat(loop.dats[3], 1, LOCALSTENCIL, "int", OPS_READ),
+                    ops_arg_gbl(loop.intArgs.data(), 2, "int", OPS_READ));
+            } break;
+            default:
+                break;
         }
     }
 #endif  // OPS_3D
@@ -357,6 +705,33 @@ void PreDefinedInitialCondition3D() {
             const InitialType initialType{compo.initialType};
             switch (initialType) {
                 case Initial_BGKFeq2nd: {
+                    // The moment scheme starts from the equilibrium moments
+                    if (Scheme() == Scheme_StreamCollision_Moment) {
+                        ops_par_loop(
+                            KerInitialiseMoment3D, "KerInitialiseMoment3D",
+                            block.Get(), SpaceDim(), iterRng.data(),
+                            ops_arg_dat(CurrentMoments()[blockIndex],
+                                        Moment_Num, LOCALSTENCIL, "double",
+                                        OPS_WRITE),
+                            ops_arg_dat(
+                                g_NodeType().at(compoId).at(blockIndex), 1,
+                                LOCALSTENCIL, "int", OPS_READ),
+                            ops_arg_dat(
+                                g_MacroVars()
+                                    .at(compo.macroVars.at(Variable_Rho).id)
+                                    .at(blockIndex),
+                                1, LOCALSTENCIL, "double", OPS_READ),
+                            ops_arg_dat(
+                                g_MacroVars().at(compo.uId).at(blockIndex), 1,
+                                LOCALSTENCIL, "double", OPS_READ),
+                            ops_arg_dat(
+                                g_MacroVars().at(compo.vId).at(blockIndex), 1,
+                                LOCALSTENCIL, "double", OPS_READ),
+                            ops_arg_dat(
+                                g_MacroVars().at(compo.wId).at(blockIndex), 1,
+                                LOCALSTENCIL, "double", OPS_READ));
+                        break;
+                    }
                     ops_par_loop(
                         KerInitialiseBGK2nd3D, "KerInitialiseBGK2nd3D",
                         block.Get(), SpaceDim(), iterRng.data(),
@@ -383,6 +758,9 @@ void PreDefinedInitialCondition3D() {
             }
         }
     }
+    // The initial condition is complete, so the interleaved variables take
+    // over from the separate fields here.
+    PackMacroVars3D();
     // TODO this may be better arranged.
     if (!IsTransient()) {
         CopyCurrentMacroVar();
@@ -405,7 +783,19 @@ void PreDefinedCollision() {
             const Real tau{compo.tauRef};
             const Real* pdt{pTimeStep()};
             switch (collisionType) {
-                case Collision_BGKIsothermal2nd:
+                case Collision_BGKIsothermal2nd: {
+                    KERNEL_SCOPE(
+                        "KerCollideBGKIsothermal", SpaceDim(), iterRng.data(),
+                        {{g_fStage()[blockIndex], OPS_WRITE},
+                         {g_f()[blockIndex], OPS_READ},
+                         {g_NodeType().at(compo.id).at(blockIndex), OPS_READ},
+                         {g_MacroVars()
+                              .at(compo.macroVars.at(Variable_Rho).id)
+                              .at(blockIndex),
+                          OPS_READ},
+                         {g_MacroVars().at(compo.uId).at(blockIndex), OPS_READ},
+                         {g_MacroVars().at(compo.vId).at(blockIndex),
+                          OPS_READ}});
                     ops_par_loop(
                         KerCollideBGKIsothermal, "KerCollideBGKIsothermal",
                         block.Get(), SpaceDim(), iterRng.data(),
@@ -413,8 +803,6 @@ void PreDefinedCollision() {
                                     "double", OPS_WRITE),
                         ops_arg_dat(g_f()[blockIndex], NUMXI, LOCALSTENCIL,
                                     "double", OPS_READ),
-                        ops_arg_dat(g_CoordinateXYZ()[blockIndex], SpaceDim(),
-                                    LOCALSTENCIL, "double", OPS_READ),
                         ops_arg_dat(g_NodeType().at(compo.id).at(blockIndex), 1,
                                     LOCALSTENCIL, "int", OPS_READ),
                         ops_arg_dat(g_MacroVars()
@@ -427,9 +815,27 @@ void PreDefinedCollision() {
                                     1, LOCALSTENCIL, "double", OPS_READ),
                         ops_arg_gbl(&tau, 1, "double", OPS_READ),
                         ops_arg_gbl(pdt, 1, "double", OPS_READ),
-                        ops_arg_gbl(compo.index, 2, "int", OPS_READ));
-                    break;
-                case Collision_BGKThermal4th:
+                        ops_arg_gbl(compo.index, 2, "int", OPS_READ),
+                        ops_arg_gbl(block.Grid(), block.GridSize(), "double",
+                                    OPS_READ),
+                        ops_arg_idx());
+                } break;
+                case Collision_BGKThermal4th: {
+                    KERNEL_SCOPE(
+                        "KerCollideBGKThermal", SpaceDim(), iterRng.data(),
+                        {{g_fStage()[blockIndex], OPS_WRITE},
+                         {g_f()[blockIndex], OPS_READ},
+                         {g_NodeType().at(compo.id).at(blockIndex), OPS_READ},
+                         {g_MacroVars()
+                              .at(compo.macroVars.at(Variable_Rho).id)
+                              .at(blockIndex),
+                          OPS_READ},
+                         {g_MacroVars().at(compo.uId).at(blockIndex), OPS_READ},
+                         {g_MacroVars().at(compo.vId).at(blockIndex), OPS_READ},
+                         {g_MacroVars()
+                              .at(compo.macroVars.at(Variable_T).id)
+                              .at(blockIndex),
+                          OPS_READ}});
                     ops_par_loop(
                         KerCollideBGKThermal, "KerCollideBGKThermal",
                         block.Get(), SpaceDim(), iterRng.data(),
@@ -454,7 +860,7 @@ void PreDefinedCollision() {
                         ops_arg_gbl(&tau, 1, "double", OPS_READ),
                         ops_arg_gbl(pdt, 1, "double", OPS_READ),
                         ops_arg_gbl(compo.index, 2, "int", OPS_READ));
-                    break;
+                } break;
                 default:
                     ops_printf(
                         "The specified collision type is not implemented!\n");
@@ -479,7 +885,13 @@ void UpdateMacroVars() {
                 const int varId{macroVar.second.id};
                 const VariableTypes varType{macroVar.first};
                 switch (varType) {
-                    case Variable_Rho:
+                    case Variable_Rho: {
+                        KERNEL_SCOPE(
+                            "KerCalcDensity", SpaceDim(), iterRng.data(),
+                            {{g_MacroVars().at(varId).at(blockIndex), OPS_RW},
+                             {g_f()[blockIndex], OPS_READ},
+                             {g_NodeType().at(compo.id).at(blockIndex),
+                              OPS_READ}});
                         ops_par_loop(
                             KerCalcDensity, "KerCalcDensity", block.Get(),
                             SpaceDim(), iterRng.data(),
@@ -491,8 +903,18 @@ void UpdateMacroVars() {
                                 g_NodeType().at(compo.id).at(blockIndex), 1,
                                 LOCALSTENCIL, "int", OPS_READ),
                             ops_arg_gbl(compo.index, 2, "int", OPS_READ));
-                        break;
-                    case Variable_U:
+                    } break;
+                    case Variable_U: {
+                        KERNEL_SCOPE(
+                            "KerCalcU", SpaceDim(), iterRng.data(),
+                            {{g_MacroVars().at(varId).at(blockIndex), OPS_RW},
+                             {g_f()[blockIndex], OPS_READ},
+                             {g_NodeType().at(compo.id).at(blockIndex),
+                              OPS_READ},
+                             {g_MacroVars()
+                                  .at(compo.macroVars.at(Variable_Rho).id)
+                                  .at(blockIndex),
+                              OPS_READ}});
                         ops_par_loop(
                             KerCalcU, "KerCalcU", block.Get(), SpaceDim(),
                             iterRng.data(),
@@ -509,8 +931,18 @@ void UpdateMacroVars() {
                                     .at(blockIndex),
                                 1, LOCALSTENCIL, "double", OPS_READ),
                             ops_arg_gbl(compo.index, 2, "int", OPS_READ));
-                        break;
-                    case Variable_V:
+                    } break;
+                    case Variable_V: {
+                        KERNEL_SCOPE(
+                            "KerCalcV", SpaceDim(), iterRng.data(),
+                            {{g_MacroVars().at(varId).at(blockIndex), OPS_RW},
+                             {g_f()[blockIndex], OPS_READ},
+                             {g_NodeType().at(compo.id).at(blockIndex),
+                              OPS_READ},
+                             {g_MacroVars()
+                                  .at(compo.macroVars.at(Variable_Rho).id)
+                                  .at(blockIndex),
+                              OPS_READ}});
                         ops_par_loop(
                             KerCalcV, "KerCalcV", block.Get(), SpaceDim(),
                             iterRng.data(),
@@ -527,8 +959,20 @@ void UpdateMacroVars() {
                                     .at(blockIndex),
                                 1, LOCALSTENCIL, "double", OPS_READ),
                             ops_arg_gbl(compo.index, 2, "int", OPS_READ));
-                        break;
-                    case Variable_U_Force:
+                    } break;
+                    case Variable_U_Force: {
+                        KERNEL_SCOPE(
+                            "KerCalcUForce", SpaceDim(), iterRng.data(),
+                            {{g_MacroVars().at(varId).at(blockIndex), OPS_RW},
+                             {g_f()[blockIndex], OPS_READ},
+                             {g_NodeType().at(compo.id).at(blockIndex),
+                              OPS_READ},
+                             {g_MacroBodyforce().at(compo.id).at(blockIndex),
+                              OPS_READ},
+                             {g_MacroVars()
+                                  .at(compo.macroVars.at(Variable_Rho).id)
+                                  .at(blockIndex),
+                              OPS_READ}});
                         ops_par_loop(
                             KerCalcUForce, "KerCalcUForce", block.Get(),
                             SpaceDim(), iterRng.data(),
@@ -539,9 +983,6 @@ void UpdateMacroVars() {
                             ops_arg_dat(
                                 g_NodeType().at(compo.id).at(blockIndex), 1,
                                 LOCALSTENCIL, "int", OPS_READ),
-                            ops_arg_dat(g_CoordinateXYZ()[blockIndex],
-                                        SpaceDim(), LOCALSTENCIL, "double",
-                                        OPS_READ),
                             ops_arg_dat(
                                 g_MacroBodyforce().at(compo.id).at(blockIndex),
                                 SpaceDim(), LOCALSTENCIL, "double", OPS_READ),
@@ -551,9 +992,24 @@ void UpdateMacroVars() {
                                     .at(blockIndex),
                                 1, LOCALSTENCIL, "double", OPS_READ),
                             ops_arg_gbl(pdt, 1, "double", OPS_READ),
-                            ops_arg_gbl(compo.index, 2, "int", OPS_READ));
-                        break;
-                    case Variable_V_Force:
+                            ops_arg_gbl(compo.index, 2, "int", OPS_READ),
+                            ops_arg_gbl(block.Grid(), block.GridSize(), "double",
+                                        OPS_READ),
+                            ops_arg_idx());
+                    } break;
+                    case Variable_V_Force: {
+                        KERNEL_SCOPE(
+                            "KerCalcVForce", SpaceDim(), iterRng.data(),
+                            {{g_MacroVars().at(varId).at(blockIndex), OPS_RW},
+                             {g_f()[blockIndex], OPS_READ},
+                             {g_NodeType().at(compo.id).at(blockIndex),
+                              OPS_READ},
+                             {g_MacroBodyforce().at(compo.id).at(blockIndex),
+                              OPS_READ},
+                             {g_MacroVars()
+                                  .at(compo.macroVars.at(Variable_Rho).id)
+                                  .at(blockIndex),
+                              OPS_READ}});
                         ops_par_loop(
                             KerCalcVForce, "KerCalcVForce", block.Get(),
                             SpaceDim(), iterRng.data(),
@@ -564,9 +1020,6 @@ void UpdateMacroVars() {
                             ops_arg_dat(
                                 g_NodeType().at(compo.id).at(blockIndex), 1,
                                 LOCALSTENCIL, "int", OPS_READ),
-                            ops_arg_dat(g_CoordinateXYZ()[blockIndex],
-                                        SpaceDim(), LOCALSTENCIL, "double",
-                                        OPS_READ),
                             ops_arg_dat(
                                 g_MacroBodyforce().at(compo.id).at(blockIndex),
                                 SpaceDim(), LOCALSTENCIL, "double", OPS_READ),
@@ -576,8 +1029,11 @@ void UpdateMacroVars() {
                                     .at(blockIndex),
                                 1, LOCALSTENCIL, "double", OPS_READ),
                             ops_arg_gbl(pdt, 1, "double", OPS_READ),
-                            ops_arg_gbl(compo.index, 2, "int", OPS_READ));
-                        break;
+                            ops_arg_gbl(compo.index, 2, "int", OPS_READ),
+                            ops_arg_gbl(block.Grid(), block.GridSize(), "double",
+                                        OPS_READ),
+                            ops_arg_idx());
+                    } break;
                     default:
                         break;
                 }
@@ -598,7 +1054,17 @@ void PreDefinedBodyForce() {
             const Component& compo{idCompo.second};
             const BodyForceType forceType{compo.bodyForceType};
             switch (forceType) {
-                case BodyForce_1st:
+                case BodyForce_1st: {
+                    KERNEL_SCOPE(
+                        "KerCalcBodyForce1ST", SpaceDim(), iterRng.data(),
+                        {{g_fStage()[blockIndex], OPS_WRITE},
+                         {g_MacroBodyforce().at(compo.id).at(blockIndex),
+                          OPS_READ},
+                         {g_MacroVars()
+                              .at(compo.macroVars.at(Variable_Rho).id)
+                              .at(blockIndex),
+                          OPS_RW},
+                         {g_NodeType().at(compo.id).at(blockIndex), OPS_READ}});
                     ops_par_loop(
                         KerCalcBodyForce1ST, "KerCalcBodyForce1ST", block.Get(),
                         SpaceDim(), iterRng.data(),
@@ -614,20 +1080,21 @@ void PreDefinedBodyForce() {
                         ops_arg_dat(g_NodeType().at(compo.id).at(blockIndex), 1,
                                     LOCALSTENCIL, "int", OPS_READ),
                         ops_arg_gbl(compo.index, 2, "int", OPS_READ));
-                    break;
-                case BodyForce_None:
+                } break;
+                case BodyForce_None: {
+                    KERNEL_SCOPE(
+                        "KerCalcBodyForceNone", SpaceDim(), iterRng.data(),
+                        {{g_fStage()[blockIndex], OPS_WRITE},
+                         {g_NodeType().at(compo.id).at(blockIndex), OPS_READ}});
                     ops_par_loop(
                         KerCalcBodyForceNone, "KerCalcBodyForceNone",
                         block.Get(), SpaceDim(), iterRng.data(),
                         ops_arg_dat(g_fStage()[blockIndex], NUMXI, LOCALSTENCIL,
                                     "double", OPS_WRITE),
-                        ops_arg_dat(
-                            g_MacroBodyforce().at(compo.id).at(blockIndex),
-                            SpaceDim(), LOCALSTENCIL, "double", OPS_READ),
                         ops_arg_dat(g_NodeType().at(compo.id).at(blockIndex), 1,
                                     LOCALSTENCIL, "int", OPS_READ),
                         ops_arg_gbl(compo.index, 2, "int", OPS_READ));
-                    break;
+                } break;
                 default:
                     ops_printf(
                         "The specified force type is not implemented!\n");
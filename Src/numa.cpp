@@ -0,0 +1,258 @@
+/**
+ * Copyright 2019 United Kingdom Research and Innovation
+ *
+ * Authors: See AUTHORS
+ *
+ * Contact: [jianping.meng@stfc.ac.uk and/or jpmeng@gmail.com]
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * ANDANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*! @brief   Place the field pages on the NUMA nodes of the OpenMP threads
+ * @author  Jianping Meng
+ * @details The first touch and the page moves of the fields by the static
+ * schedule of the kernels, see numa.h.
+ */
+#include "numa.h"
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include "ops_lib_core.h"
+#ifdef OPS_MPI
+#include "ops_mpi_core.h"
+#endif
+#include "memory.h"
+#if defined(_OPENMP) && defined(__linux__)
+#include <omp.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstdint>
+#include <fstream>
+#ifndef MPOL_MF_MOVE
+#define MPOL_MF_MOVE (1 << 1)
+#endif
+
+int NumaNodeNum() {
+    int nodeNum{0};
+    while (std::ifstream("/sys/devices/system/node/node" +
+                         std::to_string(nodeNum) + "/cpulist")
+               .good()) {
+        nodeNum++;
+    }
+    return nodeNum;
+}
+
+int CurrentNumaNode() {
+    unsigned cpu{0}, node{0};
+    if (syscall(SYS_getcpu, &cpu, &node, nullptr) != 0) {
+        return -1;
+    }
+    return (int)node;
+}
+
+// The memory zeroed by FirstTouchDat(), which needs no move
+std::vector<const void*> firstTouchedData;
+
+/*
+ * The bytes [begin, end) of a dat that the calling thread of a parallel region
+ * sweeps, where size includes the halos along every axis, lower and upper are
+ * the halo depths of the outermost axis and the interior planes of that axis
+ * are split by the static schedule of the kernels. All the threads of the
+ * region must call it.
+ */
+void ThreadDatBytes(const std::vector<int>& size, const int lower,
+                    const int upper, const long elemBytes, long& begin,
+                    long& end) {
+    const int outer{(int)size.size() - 1};
+    long planeBytes{elemBytes};
+    for (int axis = 0; axis < outer; axis++) {
+        planeBytes *= std::max(size.at(axis), 0);
+    }
+    const int planeNum{std::max(size.at(outer), 0)};
+    int firstPlane{planeNum};
+    int lastPlane{-1};
+#pragma omp for schedule(static) nowait
+    for (int plane = lower; plane < planeNum - upper; plane++) {
+        firstPlane = std::min(firstPlane, plane);
+        lastPlane = std::max(lastPlane, plane);
+    }
+    if (lastPlane < firstPlane) {
+        begin = end = 0;
+        return;
+    }
+    if (firstPlane == lower) {
+        firstPlane = 0;
+    }
+    if (lastPlane == planeNum - upper - 1) {
+        lastPlane = planeNum - 1;
+    }
+    begin = firstPlane * planeBytes;
+    end = (lastPlane + 1) * planeBytes;
+}
+
+void FirstTouchDat(void* data, const void* source,
+                   const std::vector<int>& size, const int lower,
+                   const int upper, const long elemBytes) {
+#pragma omp parallel
+    {
+        long begin{0}, end{0};
+        ThreadDatBytes(size, lower, upper, elemBytes, begin, end);
+        if (end > begin && source != nullptr) {
+            std::memcpy((char*)data + begin, (const char*)source + begin,
+                        end - begin);
+        } else if (end > begin) {
+            std::memset((char*)data + begin, 0, end - begin);
+        }
+    }
+    firstTouchedData.push_back(data);
+}
+
+/*
+ * Move the pages of a local dat, which has been touched before the kernels
+ * run, to the nodes of the threads sweeping them and return the number of
+ * pages moved. A page belongs to the thread holding its first byte.
+ */
+long PlaceDatPages(const FieldMemory& field) {
+    const ops_dat dat{field.dat};
+    if (dat->data == nullptr ||
+        std::find(firstTouchedData.begin(), firstTouchedData.end(),
+                  (const void*)dat->data) != firstTouchedData.end()) {
+        return 0;
+    }
+    const int outer{(int)field.blockSize.size() - 1};
+    const std::vector<int> size(dat->size, dat->size + outer + 1);
+    const uintptr_t pageSize{(uintptr_t)sysconf(_SC_PAGESIZE)};
+    const uintptr_t data{(uintptr_t)dat->data};
+    long moved{0};
+#pragma omp parallel reduction(+ : moved)
+    {
+        long beginByte{0}, endByte{0};
+        ThreadDatBytes(size, -dat->d_m[outer], dat->d_p[outer], dat->elem_size,
+                       beginByte, endByte);
+        const uintptr_t begin{data + beginByte};
+        const uintptr_t end{data + endByte};
+        uintptr_t page{(begin + pageSize - 1) / pageSize * pageSize};
+        if (beginByte == 0) {
+            page = begin / pageSize * pageSize;
+        }
+        std::vector<void*> pages;
+        for (; page < end; page += pageSize) {
+            pages.push_back((void*)page);
+        }
+        const int node{CurrentNumaNode()};
+        if (!pages.empty() && node >= 0) {
+            std::vector<int> nodes(pages.size(), node);
+            std::vector<int> status(pages.size(), -1);
+            if (syscall(SYS_move_pages, 0, pages.size(), pages.data(),
+                        nodes.data(), status.data(), MPOL_MF_MOVE) == 0) {
+                for (const int pageNode : status) {
+                    moved += pageNode == node ? 1 : 0;
+                }
+            }
+        }
+    }
+    return moved;
+}
+
+void PlaceFieldPages() {
+    if (NumaNodeNum() < 2) {
+        ops_printf("There is a single NUMA node, the fields are not moved!\n");
+        return;
+    }
+    long moved{0};
+    for (const FieldMemory& field : FieldMemories()) {
+        moved += PlaceDatPages(field);
+    }
+#ifdef OPS_MPI
+    MPI_Allreduce(MPI_IN_PLACE, &moved, 1, MPI_LONG, MPI_SUM, OPS_MPI_GLOBAL);
+#endif
+    ops_printf(
+        "%d dats are first touched by the threads sweeping them, %ld pages "
+        "of the others are moved to the NUMA nodes of those threads\n",
+        (int)firstTouchedData.size(), moved);
+}
+
+void ReportThreadPlacement() {
+    const int threadNum{omp_get_max_threads()};
+    std::vector<int> cpus(threadNum, -1), nodes(threadNum, -1);
+#pragma omp parallel num_threads(threadNum)
+    {
+        const int thread{omp_get_thread_num()};
+        cpus[thread] = sched_getcpu();
+        nodes[thread] = CurrentNumaNode();
+    }
+    int rank{0};
+#ifdef OPS_MPI
+    rank = ops_my_global_rank;
+#endif
+    std::string placement;
+    for (int thread = 0; thread < threadNum; thread++) {
+        placement += "Rank " + std::to_string(rank) + " thread " +
+                     std::to_string(thread) + ": core " +
+                     std::to_string(cpus[thread]) + ", NUMA node " +
+                     std::to_string(nodes[thread]) + "\n";
+    }
+#ifdef OPS_MPI
+    int rankNum{1};
+    MPI_Comm_size(OPS_MPI_GLOBAL, &rankNum);
+    int length{(int)placement.size()};
+    std::vector<int> lengths(rankNum, 0), offsets(rankNum, 0);
+    MPI_Gather(&length, 1, MPI_INT, lengths.data(), 1, MPI_INT, 0,
+               OPS_MPI_GLOBAL);
+    int totalLength{0};
+    for (int idx = 0; idx < rankNum; idx++) {
+        offsets[idx] = totalLength;
+        totalLength += lengths[idx];
+    }
+    std::string allPlacement(rank == 0 ? totalLength : 0, ' ');
+    MPI_Gatherv(&placement[0], length, MPI_CHAR, &allPlacement[0],
+                lengths.data(), offsets.data(), MPI_CHAR, 0, OPS_MPI_GLOBAL);
+    placement = allPlacement;
+#endif
+    ops_printf("\nPlacement of the OpenMP threads:\n%s", placement.c_str());
+    if (omp_get_proc_bind() == omp_proc_bind_false) {
+        ops_printf(
+            "Warning! The threads are not pinned, please set OMP_PROC_BIND "
+            "and OMP_PLACES, see the manual!\n");
+    }
+}
+#else
+void FirstTouchDat(void* data, const void* source,
+                   const std::vector<int>& size, const int lower,
+                   const int upper, const long elemBytes) {
+    long bytes{elemBytes};
+    for (const int sizeAxis : size) {
+        bytes *= std::max(sizeAxis, 0);
+    }
+    if (source != nullptr) {
+        std::memcpy(data, source, bytes);
+    } else {
+        std::memset(data, 0, bytes);
+    }
+}
+void PlaceFieldPages() {}
+void ReportThreadPlacement() {}
+#endif  // _OPENMP && __linux__
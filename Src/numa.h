@@ -0,0 +1,67 @@
+/**
+ * Copyright 2019 United Kingdom Research and Innovation
+ *
+ * Authors: See AUTHORS
+ *
+ * Contact: [jianping.meng@stfc.ac.uk and/or jpmeng@gmail.com]
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * ANDANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*! @brief   Place the field pages on the NUMA nodes of the OpenMP threads
+ * @author  Jianping Meng
+ * @details The OpenMP kernels split the interior planes of the outermost axis
+ * of a loop among the threads by the static schedule. When the fields are
+ * moved into the field arena, see arena.h, FirstTouchDat() copies every dat by
+ * the same split before any kernel runs, where the halo planes go to the first
+ * and the last thread, so that the pages are placed on the node of the thread
+ * sweeping them. Otherwise, the memory is allocated, and may be zeroed by the
+ * master thread, or read from a HDF5 file by OPS when the fields are created.
+ * PlaceFieldPages(), called by Partition(), moves the pages of those dats to
+ * the nodes of the threads by the same split instead. Both are only effective
+ * if the threads are pinned, e.g., OMP_PROC_BIND=close and
+ * OMP_PLACES=cores, which ReportThreadPlacement() checks and reports.
+ */
+
+#ifndef NUMA_H
+#define NUMA_H
+#include <vector>
+
+/*
+ * Copy a dat from source, or zero it without a source, by the threads that
+ * will sweep it, where size includes the halos and lower and upper are the
+ * halo depths of the outermost axis.
+ */
+void FirstTouchDat(void* data, const void* source,
+                   const std::vector<int>& size, const int lower,
+                   const int upper, const long elemBytes);
+/*
+ * Move the pages of the fields that are not first touched to the nodes of the
+ * threads sweeping them, see PlaceDatPages().
+ */
+void PlaceFieldPages();
+// Print the core and the NUMA node of every thread of every rank
+void ReportThreadPlacement();
+#endif  // NUMA_H
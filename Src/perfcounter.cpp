@@ -0,0 +1,230 @@
+/**
+ * Copyright 2019 United Kingdom Research and Innovation
+ *
+ * Authors: See AUTHORS
+ *
+ * Contact: [jianping.meng@stfc.ac.uk and/or jpmeng@gmail.com]
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * ANDANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*! @brief   Sample hardware performance counters around each kernel
+ * @author  Jianping Meng
+ * @details The counter group of each thread and the counts per kernel, see
+ * perfcounter.h.
+ */
+#include "perfcounter.h"
+#if defined(PERFCOUNTERS) && defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+#include "ops_lib_core.h"
+
+struct KernelCounts {
+    long calls{0};
+    Real nodes{0};
+    double counts[Counter_Num]{0};
+};
+
+std::map<std::string, KernelCounts> kernelCounters;
+
+class CounterGroup {
+   public:
+    CounterGroup() {
+        const uint64_t tlbMiss{PERF_COUNT_HW_CACHE_DTLB |
+                               (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                               (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)};
+        const uint32_t types[Counter_Num]{
+            PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE,
+            PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE, PERF_TYPE_HARDWARE};
+        const uint64_t configs[Counter_Num]{
+            PERF_COUNT_HW_CPU_CYCLES,      PERF_COUNT_HW_INSTRUCTIONS,
+            PERF_COUNT_HW_CACHE_REFERENCES, PERF_COUNT_HW_CACHE_MISSES,
+            tlbMiss,                       PERF_COUNT_HW_STALLED_CYCLES_BACKEND};
+        for (int counter = 0; counter < Counter_Num; counter++) {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = types[counter];
+            attr.config = configs[counter];
+            attr.disabled = (leader < 0);
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_GROUP |
+                               PERF_FORMAT_TOTAL_TIME_ENABLED |
+                               PERF_FORMAT_TOTAL_TIME_RUNNING;
+            const int fd{(int)syscall(SYS_perf_event_open, &attr, 0, -1,
+                                      leader, 0)};
+            if (fd < 0) {
+                if (leader < 0) {
+                    ops_printf(
+                        "Warning! perf_event_open failed (%s), the hardware "
+                        "counters are not sampled!\n",
+                        std::strerror(errno));
+                    return;
+                }
+                ops_printf("Warning! The counter %d is not available (%s)!\n",
+                           counter, std::strerror(errno));
+                continue;
+            }
+            if (leader < 0) {
+                leader = fd;
+            }
+            fds.push_back(fd);
+            slots[counter] = (int)fds.size() - 1;
+        }
+        ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+    ~CounterGroup() {
+        for (const int fd : fds) {
+            close(fd);
+        }
+    }
+    bool Available() const { return leader >= 0; }
+    // Read the counters, scaled if the group has been multiplexed
+    bool Read(double* counts) const {
+        // nr, time_enabled, time_running and one value per counter
+        uint64_t values[3 + Counter_Num];
+        const ssize_t size{(ssize_t)((3 + fds.size()) * sizeof(uint64_t))};
+        if (read(leader, values, size) != size) {
+            return false;
+        }
+        const double scale{values[2] > 0 ? (double)values[1] / values[2] : 1};
+        for (int counter = 0; counter < Counter_Num; counter++) {
+            counts[counter] =
+                slots[counter] < 0 ? 0 : values[3 + slots[counter]] * scale;
+        }
+        return true;
+    }
+    bool Has(const CounterType counter) const { return slots[counter] >= 0; }
+
+   private:
+    int leader{-1};
+    std::vector<int> fds;
+    int slots[Counter_Num]{-1, -1, -1, -1, -1, -1};
+};
+
+// The counters of the calling thread, opened on the first use
+const CounterGroup& ThreadCounterGroup() {
+    thread_local CounterGroup counterGroup;
+    return counterGroup;
+}
+
+CounterScope::CounterScope(const char* name, const Real nodes)
+    : name{name}, nodes{nodes} {
+    const CounterGroup& group{ThreadCounterGroup()};
+    started = group.Available() && group.Read(start);
+}
+
+CounterScope::~CounterScope() {
+    double end[Counter_Num];
+    if (!started || !ThreadCounterGroup().Read(end)) {
+        return;
+    }
+    KernelCounts& kernelCounts{kernelCounters[name]};
+    kernelCounts.calls++;
+    kernelCounts.nodes += nodes;
+    for (int counter = 0; counter < Counter_Num; counter++) {
+        kernelCounts.counts[counter] += end[counter] - start[counter];
+    }
+}
+
+Real KernelCount(const std::string& name, const CounterType counter,
+                 Real& nodes) {
+    nodes = 0;
+    const auto nameCounts = kernelCounters.find(name);
+    if (nameCounts == kernelCounters.end() ||
+        !ThreadCounterGroup().Has(counter)) {
+        return -1;
+    }
+    nodes = nameCounts->second.nodes;
+    return nameCounts->second.counts[counter];
+}
+
+void ReportPerfCounters() {
+    if (kernelCounters.empty()) {
+        return;
+    }
+    const CounterGroup& group{ThreadCounterGroup()};
+    ops_printf("\nHardware counters per node (rank 0, n/a if unavailable)\n");
+    ops_printf("%-36s %8s %10s %6s %10s %8s %10s %8s\n", "Kernel", "Calls",
+               "Cycles", "IPC", "LLCMiss", "Miss%", "TLBMiss", "Stall%");
+    std::vector<std::pair<std::string, KernelCounts>> counters(
+        kernelCounters.begin(), kernelCounters.end());
+    std::sort(counters.begin(), counters.end(),
+              [](const std::pair<std::string, KernelCounts>& a,
+                 const std::pair<std::string, KernelCounts>& b) {
+                  return a.second.counts[Counter_Cycles] >
+                         b.second.counts[Counter_Cycles];
+              });
+    // Print a ratio or n/a when any of its counters is missing
+    auto ratio = [&group](const double numerator, const CounterType a,
+                          const double denominator,
+                          const CounterType b) -> std::string {
+        char text[16];
+        if (!group.Has(a) || !group.Has(b) || denominator <= 0) {
+            return std::string("n/a");
+        }
+        std::snprintf(text, sizeof(text), "%.3f", numerator / denominator);
+        return std::string(text);
+    };
+    for (const auto& nameCounts : counters) {
+        const KernelCounts& kernel{nameCounts.second};
+        const double* counts{kernel.counts};
+        const Real nodes{std::max(kernel.nodes, (Real)1)};
+        ops_printf(
+            "%-36s %8ld %10s %6s %10s %8s %10s %8s\n", nameCounts.first.c_str(),
+            kernel.calls,
+            ratio(counts[Counter_Cycles], Counter_Cycles, nodes,
+                  Counter_Cycles).c_str(),
+            ratio(counts[Counter_Instructions], Counter_Instructions,
+                  counts[Counter_Cycles], Counter_Cycles).c_str(),
+            ratio(counts[Counter_LLCMisses], Counter_LLCMisses, nodes,
+                  Counter_LLCMisses).c_str(),
+            ratio(100 * counts[Counter_LLCMisses], Counter_LLCMisses,
+                  counts[Counter_LLCReferences], Counter_LLCReferences).c_str(),
+            ratio(counts[Counter_TLBMisses], Counter_TLBMisses, nodes,
+                  Counter_TLBMisses).c_str(),
+            ratio(100 * counts[Counter_BackendStalls], Counter_BackendStalls,
+                  counts[Counter_Cycles], Counter_Cycles).c_str());
+    }
+}
+#else
+void ReportPerfCounters() {}
+Real KernelCount(const std::string& name, const CounterType counter,
+                 Real& nodes) {
+    nodes = 0;
+    return -1;
+}
+#endif  // PERFCOUNTERS
@@ -0,0 +1,86 @@
+/**
+ * Copyright 2019 United Kingdom Research and Innovation
+ *
+ * Authors: See AUTHORS
+ *
+ * Contact: [jianping.meng@stfc.ac.uk and/or jpmeng@gmail.com]
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * ANDANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*! @brief   Sample hardware performance counters around each kernel
+ * @author  Jianping Meng
+ * @details When PERFCOUNTERS is defined in the development mode on Linux, a
+ * group of counters is opened by perf_event_open for the calling thread and
+ * read before and after every kernel hooked by a KernelScope (roofline.h). The
+ * counts are accumulated per kernel name and printed per node at the end of
+ * Iterate(), i.e., the cycles, instructions per cycle, last-level cache misses
+ * and their ratio to the references, data TLB misses and the fraction of
+ * cycles stalled in the back end. The vectorisation ratio needs model-specific raw events, which are
+ * not portable, so it is not reported. Counters that cannot be opened, e.g.,
+ * in a container or when perf_event_paranoid is too strict, are skipped with a
+ * warning and the run continues without them. Counts are scaled by the ratio
+ * of enabled to running time when the group is multiplexed.
+ */
+
+#ifndef PERFCOUNTER_H
+#define PERFCOUNTER_H
+#include <string>
+#include "type.h"
+enum CounterType {
+    Counter_Cycles = 0,
+    Counter_Instructions = 1,
+    Counter_LLCReferences = 2,
+    Counter_LLCMisses = 3,
+    Counter_TLBMisses = 4,
+    Counter_BackendStalls = 5,
+    Counter_Num = 6,
+};
+#if defined(PERFCOUNTERS) && defined(__linux__)
+// The name must be a string literal as only the pointer is kept.
+class CounterScope {
+   public:
+    CounterScope(const char* name, const Real nodes);
+    ~CounterScope();
+
+   private:
+    const char* name;
+    Real nodes;
+    bool started{false};
+    double start[Counter_Num];
+};
+#else
+class CounterScope {
+   public:
+    CounterScope(const char* name, const Real nodes) {}
+};
+#endif  // PERFCOUNTERS
+// Print the counts per node of every kernel on this rank
+void ReportPerfCounters();
+// The count of a kernel accumulated on this rank, negative if it is not
+// sampled, and the nodes swept meanwhile
+Real KernelCount(const std::string& name, const CounterType counter,
+                 Real& nodes);
+#endif  // PERFCOUNTER_H
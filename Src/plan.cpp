@@ -0,0 +1,146 @@
+/**
+ * Copyright 2019 United Kingdom Research and Innovation
+ *
+ * Authors: See AUTHORS
+ *
+ * Contact: [jianping.meng@stfc.ac.uk and/or jpmeng@gmail.com]
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * ANDANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*! @brief   Tiling of the execution plans along space-filling curves
+ * @author  Jianping Meng
+ * @details Large 3D blocks are split into x-y tiles, which are traversed
+ * along the Morton or Hilbert curve. Neighbouring tiles in the sequence are
+ * also neighbours in space, so that the planes touched by the streaming
+ * stencil stay in the cache and TLB while a tile is swept along z.
+ */
+#include "plan.h"
+#include <algorithm>
+#include <cassert>
+#include <utility>
+
+TileOrder tileOrder{Tile_None};
+int tileSizeXY[2]{0, 0};
+
+TileOrder Tiling() { return tileOrder; }
+
+void DefineTiling(const TileOrder order, const std::vector<int>& tileSize) {
+    tileOrder = order;
+    if (tileOrder == Tile_None) {
+        return;
+    }
+    if (tileSize.size() < 2 || tileSize.at(0) <= 0 || tileSize.at(1) <= 0) {
+        ops_printf("Error! Please give a positive tile size along x and y!\n");
+        assert(tileSize.size() >= 2 && tileSize.at(0) > 0 &&
+               tileSize.at(1) > 0);
+    }
+    tileSizeXY[0] = tileSize.at(0);
+    tileSizeXY[1] = tileSize.at(1);
+    ops_printf("The %s tiling of %i x %i nodes is chosen!\n",
+               tileOrder == Tile_Morton ? "Morton" : "Hilbert", tileSizeXY[0],
+               tileSizeXY[1]);
+}
+
+/*
+ * The position of the tile (x, y) along the Morton curve, i.e., the
+ * interleaved bits of x and y.
+ */
+long MortonIndex(const int x, const int y) {
+    long index{0};
+    for (int bit = 0; bit < 31; bit++) {
+        index |= (long)((x >> bit) & 1) << (2 * bit);
+        index |= (long)((y >> bit) & 1) << (2 * bit + 1);
+    }
+    return index;
+}
+
+/*
+ * The position of the tile (x, y) along the Hilbert curve filling a n x n
+ * square, where n is a power of two.
+ */
+long HilbertIndex(const int n, int x, int y) {
+    long index{0};
+    for (int s = n / 2; s > 0; s /= 2) {
+        const int rx{(x & s) > 0};
+        const int ry{(y & s) > 0};
+        index += (long)s * s * ((3 * rx) ^ ry);
+        if (ry == 0) {
+            if (rx == 1) {
+                x = n - 1 - x;
+                y = n - 1 - y;
+            }
+            std::swap(x, y);
+        }
+    }
+    return index;
+}
+
+void TileLoopPlans(LoopPlanGroup& plans) {
+    if (tileOrder == Tile_None) {
+        return;
+    }
+    LoopPlanGroup tiledPlans;
+    for (const LoopPlan& loop : plans) {
+        const int* range{loop.iterRng};
+        const int tileNumX{(range[1] - range[0] + tileSizeXY[0] - 1) /
+                           tileSizeXY[0]};
+        const int tileNumY{(range[3] - range[2] + tileSizeXY[1] - 1) /
+                           tileSizeXY[1]};
+        if (tileNumX * tileNumY <= 1) {
+            tiledPlans.push_back(loop);
+            continue;
+        }
+        // The curve fills the enclosing square of a power-of-two side, where
+        // the tiles outside the block are simply absent.
+        int side{1};
+        while (side < std::max(tileNumX, tileNumY)) {
+            side *= 2;
+        }
+        std::vector<std::pair<long, std::pair<int, int>>> tiles;
+        for (int y = 0; y < tileNumY; y++) {
+            for (int x = 0; x < tileNumX; x++) {
+                const long index{tileOrder == Tile_Morton
+                                     ? MortonIndex(x, y)
+                                     : HilbertIndex(side, x, y)};
+                tiles.push_back({index, {x, y}});
+            }
+        }
+        std::sort(tiles.begin(), tiles.end());
+        for (const auto& tile : tiles) {
+            LoopPlan tileLoop{loop};
+            const int x{tile.second.first};
+            const int y{tile.second.second};
+            tileLoop.iterRng[0] = range[0] + x * tileSizeXY[0];
+            tileLoop.iterRng[1] =
+                std::min(range[1], tileLoop.iterRng[0] + tileSizeXY[0]);
+            tileLoop.iterRng[2] = range[2] + y * tileSizeXY[1];
+            tileLoop.iterRng[3] =
+                std::min(range[3], tileLoop.iterRng[2] + tileSizeXY[1]);
+            tiledPlans.push_back(tileLoop);
+        }
+    }
+    plans.swap(tiledPlans);
+}
@@ -0,0 +1,117 @@
+/**
+ * Copyright 2019 United Kingdom Research and Innovation
+ *
+ * Authors: See AUTHORS
+ *
+ * Contact: [jianping.meng@stfc.ac.uk and/or jpmeng@gmail.com]
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * ANDANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*! @brief   Define the execution plan of the time-step loops
+ * @author  Jianping Meng
+ * @details A LoopPlan records everything that is needed by a single
+ * ops_par_loop call, i.e., the block, the iteration range, the kernel choice,
+ * the ops_dat handles and the global arguments. The plans are built once
+ * after Partition() so that the evolution cycle replays them without any
+ * map lookup or memory allocation.
+ */
+
+#ifndef PLAN_H
+#define PLAN_H
+#include <vector>
+#include "ops_lib_core.h"
+#ifdef OPS_MPI
+#include "ops_mpi_core.h"
+#endif
+#include "type.h"
+#include "block.h"
+
+struct LoopPlan {
+    ops_block block;
+    int iterRng[6];
+    // The kernel choice, e.g., CollisionType, VariableTypes or BoundaryScheme
+    int kernel;
+    // If a multi-component kernel is used
+    bool fused{false};
+    // If the macroscopic variables of a component are interleaved in one dat
+    bool interleaved{false};
+    // If the post-collision populations are stored in 16 bits, where scale is
+    // the per-block scale and deviation the reduction of the largest deviation
+    bool compressed{false};
+    const Real* scale{nullptr};
+    ops_reduction deviation{nullptr};
+    // If the populations are represented by the pair of moment fields, see
+    // Scheme_StreamCollision_Moment
+    bool moment{false};
+    // ops_dat handles in the order of kernel arguments
+    std::vector<ops_dat> dats;
+    // Global arguments, e.g., relaxation time, boundary values
+    std::vector<Real> realArgs;
+    // Global arguments, e.g., lattice index ranges, boundary surface
+    std::vector<int> intArgs;
+    // Origin and spacing of the block, see Block::Grid()
+    const Real* grid{nullptr};
+    int gridSize{0};
+};
+
+typedef std::vector<LoopPlan> LoopPlanGroup;
+
+/*!
+ * Order of the tiles that a 3D block is traversed in. A tile spans the whole
+ * z extent of the block, which is the dimension split among OpenMP threads, so
+ * that a thread sweeps the same z slab of every tile as it first touched in
+ * the (untiled) initialisation loops.
+ */
+enum TileOrder { Tile_None = 0, Tile_Morton = 1, Tile_Hilbert = 2 };
+
+/*!
+ * Define the tiling of the 3D execution plans, where tileSize gives the number
+ * of nodes of a tile along x and y. Must be called before Partition().
+ */
+void DefineTiling(const TileOrder order, const std::vector<int>& tileSize);
+TileOrder Tiling();
+/*!
+ * Split each plan into tiles of its x-y range, which are replayed along the
+ * Morton or Hilbert curve. A kernel still completes the whole range before the
+ * next plan starts so that the data dependencies between loops are kept.
+ */
+void TileLoopPlans(LoopPlanGroup& plans);
+
+inline LoopPlan CreateLoopPlan(const Block& block,
+                               const std::vector<int>& range,
+                               const int kernel) {
+    LoopPlan loop;
+    loop.block = block.Get();
+    for (int i = 0; i < 6; i++) {
+        loop.iterRng[i] = i < (int)range.size() ? range[i] : 0;
+    }
+    loop.kernel = kernel;
+    loop.grid = block.Grid();
+    loop.gridSize = block.GridSize();
+    return loop;
+}
+
+#endif  // PLAN_H
@@ -0,0 +1,197 @@
+/**
+ * Copyright 2019 United Kingdom Research and Innovation
+ *
+ * Authors: See AUTHORS
+ *
+ * Contact: [jianping.meng@stfc.ac.uk and/or jpmeng@gmail.com]
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * ANDANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*! @brief   Sample the macroscopic variables at probes for time series
+ * @author  Jianping Meng
+ * @details The definitions of the probes and the buffers and files of their
+ * samples, see probe.h.
+ */
+#include "probe.h"
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#ifdef OPS_MPI
+#include "ops_mpi_core.h"
+#endif
+
+ProbeSettings probeSetting;
+std::vector<ProbeBuffer> probeBuffers;
+
+const ProbeSettings& ProbeSetting() { return probeSetting; }
+
+void DefineProbes(const std::vector<ProbeDefinition>& probes,
+                  const SizeType period, const SizeType bufferSize,
+                  const SizeType timeStep) {
+    if (!probes.empty() && (period == 0 || bufferSize == 0)) {
+        ops_printf(
+            "Error! The probe period and buffer size must be positive!\n");
+        assert(period > 0 && bufferSize > 0);
+    }
+    for (const ProbeDefinition& probe : probes) {
+        // i.e., none for a point, axis0 for a line and both for a plane
+        const SizeType axisNum{(SizeType)probe.type};
+        bool valid{!probe.name.empty() && probe.pointNum.size() >= axisNum &&
+                   (axisNum < 1 || probe.axis0.size() == probe.origin.size()) &&
+                   (axisNum < 2 || probe.axis1.size() == probe.origin.size())};
+        for (SizeType axis = 0; valid && axis < axisNum; axis++) {
+            valid = probe.pointNum.at(axis) >= 2;
+        }
+        if (!valid) {
+            ops_printf(
+                "Error! Probe %s needs a name, the axes of its type and at "
+                "least two points along each axis!\n",
+                probe.name.c_str());
+            assert(valid);
+        }
+    }
+    probeSetting.probes = probes;
+    probeSetting.period = period;
+    probeSetting.bufferSize = bufferSize;
+    probeSetting.timeStep = timeStep;
+}
+
+std::vector<std::vector<Real>> ProbePositions(const ProbeDefinition& probe) {
+    const int num0{probe.type == Probe_Point ? 1 : probe.pointNum.at(0)};
+    const int num1{probe.type == Probe_Plane ? probe.pointNum.at(1) : 1};
+    std::vector<std::vector<Real>> positions;
+    for (int idx1 = 0; idx1 < num1; idx1++) {
+        for (int idx0 = 0; idx0 < num0; idx0++) {
+            std::vector<Real> position(probe.origin);
+            for (SizeType axis = 0; axis < position.size(); axis++) {
+                if (num0 > 1) {
+                    position[axis] += probe.axis0[axis] * idx0 / (num0 - 1);
+                }
+                if (num1 > 1) {
+                    position[axis] += probe.axis1[axis] * idx1 / (num1 - 1);
+                }
+            }
+            positions.push_back(position);
+        }
+    }
+    return positions;
+}
+
+void AddProbeBuffer(const ProbeBuffer& buffer) {
+    probeBuffers.push_back(buffer);
+}
+
+bool IsProbeWriter() {
+    int rank{0};
+#ifdef OPS_MPI
+    rank = ops_my_global_rank;
+#endif
+    return rank == 0;
+}
+
+/*!
+ * Rewrite the file of a probe before the first samples of a run, i.e., only
+ * the header for a new run, and at a restart, the lines of the file up to the
+ * time step restarted from, so that the samples are not repeated.
+ */
+void StartProbeFile(const ProbeBuffer& buffer, const SizeType timeStep) {
+    std::vector<std::string> kept;
+    if (timeStep > 0) {
+        std::ifstream previous(buffer.fileName);
+        std::string line;
+        while (std::getline(previous, line)) {
+            // A sample starts with its time step and the header with #
+            if (!line.empty() &&
+                (line[0] == '#' ||
+                 std::strtoull(line.c_str(), nullptr, 10) <= timeStep)) {
+                kept.push_back(line + "\n");
+            }
+        }
+    }
+    FILE* file{std::fopen(buffer.fileName.c_str(), "w")};
+    if (file == nullptr) {
+        ops_printf("Error! Cannot open %s for writing!\n",
+                   buffer.fileName.c_str());
+        assert(file != nullptr);
+    }
+    if (kept.empty()) {
+        std::fputs(buffer.header.c_str(), file);
+    }
+    for (const std::string& line : kept) {
+        std::fputs(line.c_str(), file);
+    }
+    std::fclose(file);
+}
+
+// Append the buffered samples of a probe to its file
+void FlushProbe(ProbeBuffer& buffer) {
+    if (buffer.lines.empty()) {
+        return;
+    }
+    if (!buffer.started) {
+        StartProbeFile(buffer, probeSetting.timeStep);
+        buffer.started = true;
+    }
+    FILE* file{std::fopen(buffer.fileName.c_str(), "a")};
+    if (file == nullptr) {
+        ops_printf("Error! Cannot open %s for writing!\n",
+                   buffer.fileName.c_str());
+        assert(file != nullptr);
+    }
+    for (const std::string& line : buffer.lines) {
+        std::fputs(line.c_str(), file);
+    }
+    std::fclose(file);
+    buffer.lines.clear();
+}
+
+void FlushProbes() {
+    for (ProbeBuffer& buffer : probeBuffers) {
+        FlushProbe(buffer);
+    }
+}
+
+void AppendProbeSample(const SizeType probeIdx, const SizeType timeStep,
+                       const Real time, const std::vector<Real>& values) {
+    if (!IsProbeWriter()) {
+        return;
+    }
+    ProbeBuffer& buffer{probeBuffers.at(probeIdx)};
+    std::string line{std::to_string(timeStep)};
+    char value[32];
+    std::snprintf(value, sizeof(value), " %.12g", time);
+    line += value;
+    for (const Real variable : values) {
+        std::snprintf(value, sizeof(value), " %.12g", variable);
+        line += value;
+    }
+    buffer.lines.push_back(line + "\n");
+    if (buffer.lines.size() >= probeSetting.bufferSize) {
+        FlushProbe(buffer);
+    }
+}
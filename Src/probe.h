@@ -0,0 +1,138 @@
+/**
+ * Copyright 2019 United Kingdom Research and Innovation
+ *
+ * Authors: See AUTHORS
+ *
+ * Contact: [jianping.meng@stfc.ac.uk and/or jpmeng@gmail.com]
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * ANDANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*! @brief   Sample the macroscopic variables at probes for time series
+ * @author  Jianping Meng
+ * @details A probe is a point, a line of evenly spaced points between two
+ * positions or a plane of them spanned by two axes, which are located in the
+ * blocks once. The points of a probe in a block form a group. Every period
+ * steps, SampleProbes() updates the macroscopic variables at the nodes of the
+ * cells of a group only and interpolates them trilinearly (bilinearly in 2D)
+ * by one loop per variable into one reduction of the group, so that rank 0
+ * receives the samples, and buffers them. A probe appends its buffer to
+ * CASENAME_Probe_<name>.dat when bufferSize samples are kept and at the end of
+ * Iterate(), so that the cost follows the number of points instead of the
+ * size of the domain. The first append of a new run empties the file, and
+ * that of a restart drops the samples after the time step restarted from.
+ */
+
+#ifndef PROBE_H
+#define PROBE_H
+#include <string>
+#include <vector>
+#include "ops_lib_core.h"
+#include "type.h"
+
+enum ProbeType {
+    Probe_Point = 0,
+    Probe_Line = 1,
+    Probe_Plane = 2,
+};
+
+struct ProbeDefinition {
+    std::string name;
+    ProbeType type{Probe_Point};
+    std::vector<Real> origin;
+    // A line runs from origin to origin + axis0 and a plane spans axis0 and
+    // axis1 from origin
+    std::vector<Real> axis0;
+    std::vector<Real> axis1;
+    // The number of points along axis0 and axis1
+    std::vector<int> pointNum;
+};
+
+struct ProbeSettings {
+    std::vector<ProbeDefinition> probes;
+    SizeType period{0};
+    // The samples of a probe kept before appending them to its file
+    SizeType bufferSize{100};
+    // The time step restarted from, 0 for a new run
+    SizeType timeStep{0};
+};
+
+const ProbeSettings& ProbeSetting();
+/*!
+ * Sample the probes every period steps, where the positions are given in the
+ * coordinates of the blocks and timeStep is the time step restarted from.
+ */
+void DefineProbes(const std::vector<ProbeDefinition>& probes,
+                  const SizeType period, const SizeType bufferSize = 100,
+                  const SizeType timeStep = 0);
+// The positions of the points of a probe, along axis0 first
+std::vector<std::vector<Real>> ProbePositions(const ProbeDefinition& probe);
+/*!
+ * A point located in a block, i.e., the node at the lower corner of the cell
+ * holding it and its fractions along each axis in the cell. A point outside
+ * all the blocks has a negative block ID and is written as nan.
+ */
+struct ProbePoint {
+    int blockId{-1};
+    int corner[3]{0, 0, 0};
+    Real fraction[3]{0, 0, 0};
+};
+
+/*!
+ * The points of a probe in a block, which are sampled by one loop over range,
+ * i.e., the nodes of their cells. The points are sorted by keys, the corners
+ * of their cells numbered in range, with the fractions of each point in a
+ * row, and samples reduces the variables of all the points over the ranks.
+ */
+struct ProbeGroup {
+    int blockId{-1};
+    int range[6]{0, 0, 0, 0, 0, 0};
+    std::vector<int> keys;
+    std::vector<Real> fractions;
+    // The indices of the points in all the points of the probes
+    std::vector<SizeType> points;
+    ops_reduction samples{nullptr};
+};
+
+struct ProbeBuffer {
+    std::string fileName;
+    // The description of the points and the columns for a new file
+    std::string header;
+    // A line of the time step, the time and the variables of each point
+    std::vector<std::string> lines;
+    // If the file has been started by this run, see StartProbeFile()
+    bool started{false};
+};
+
+// Keep the buffer of the next probe, which is only done by the writer
+void AddProbeBuffer(const ProbeBuffer& buffer);
+bool IsProbeWriter();
+// Append the buffered samples of all the probes to their files
+void FlushProbes();
+// Keep a sample of a probe, i.e., the variables of each of its points
+void AppendProbeSample(const SizeType probeIdx, const SizeType timeStep,
+                       const Real time, const std::vector<Real>& values);
+#endif  // PROBE_H
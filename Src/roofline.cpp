@@ -0,0 +1,218 @@
+/**
+ * Copyright 2019 United Kingdom Research and Innovation
+ *
+ * Authors: See AUTHORS
+ *
+ * Contact: [jianping.meng@stfc.ac.uk and/or jpmeng@gmail.com]
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * ANDANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*! @brief   Account the traffic and operations of each kernel for a roofline
+ * @author  Jianping Meng
+ * @details The costs are kept per kernel name on this rank and printed as a
+ * table by ReportRoofline(), see roofline.h. KernelScope is defined here as
+ * it drives the trace and the hardware counters as well.
+ */
+#include "roofline.h"
+#include <algorithm>
+#ifdef ROOFLINE
+#include <map>
+#include <string>
+#include <vector>
+#include "model.h"
+
+struct KernelCost {
+    long calls{0};
+    Real nodes{0};
+    Real bytes{0};
+    Real flops{0};
+    Real seconds{0};
+};
+
+std::map<std::string, KernelCost> kernelCosts;
+// The machine ceilings in GB/s and GFLOP/s, zero if unknown
+Real peakBandwidth{0};
+Real peakFlops{0};
+
+void SetRooflinePeaks(const Real bandwidth, const Real flops) {
+    peakBandwidth = bandwidth;
+    peakFlops = flops;
+}
+
+/*!
+ * Estimated floating-point operations per node, where an equilibrium
+ * function costs about 30 operations per velocity and a relaxation 7.
+ * Kernels not listed here, e.g., the streaming, count as zero.
+ */
+Real KernelFlopsPerNode(const std::string& name) {
+    const bool binary{name.find("Binary") != std::string::npos};
+    const Real xiNum{binary ? (Real)NUMXI : (Real)NUMXI / NUMCOMPONENTS};
+    const Real feqFlops{30};
+    const Real relaxFlops{7};
+    if (name.find("KerCollideBGKThermal") == 0) {
+        return xiNum * (2 * feqFlops + relaxFlops) + 3;
+    }
+    if (name.find("KerCollideBGKIsothermal") == 0 ||
+        name.find("KerSwapCollideBGKIsothermal") == 0) {
+        return xiNum * (feqFlops + relaxFlops) + 3;
+    }
+    // A regularised population and its share of the moments cost about 40
+    // operations per velocity, the moment collision 30.
+    if (name.find("KerStreamCollideMoment") == 0) {
+        return xiNum * 40 + 30;
+    }
+    if (name.find("KerCutCell") == 0 || name.find("KerInitialiseBGK") == 0) {
+        return xiNum * feqFlops;
+    }
+    if (name.find("KerCalcMacroVarsBinary") == 0) {
+        return 7 * xiNum + 6;
+    }
+    if (name.find("KerCalcMacroVarsInterleaved") == 0) {
+        return 7 * xiNum + 3;
+    }
+    if (name.find("KerCalcDensity") == 0) {
+        return xiNum;
+    }
+    if (name.find("KerCalcU") == 0 || name.find("KerCalcV") == 0 ||
+        name.find("KerCalcW") == 0) {
+        return 2 * xiNum + (name.find("Force") != std::string::npos ? 4 : 1);
+    }
+    if (name.find("KerCalcBodyForce1ST") == 0 ||
+        name.find("KerSwapCalcBodyForce1ST") == 0) {
+        return xiNum * 8;
+    }
+    return 0;
+}
+
+void AccountKernelCost(const char* name, const Real nodes,
+                       const Real bytesPerNode, const double seconds) {
+    KernelCost& cost{kernelCosts[name]};
+    cost.calls++;
+    cost.nodes += nodes;
+    cost.bytes += bytesPerNode * nodes;
+    cost.flops += KernelFlopsPerNode(name) * nodes;
+    cost.seconds += seconds;
+}
+
+// The best bandwidth of a STREAM triad over arrays well beyond the caches
+Real MeasureTriadBandwidth() {
+    const long size{1 << 23};
+    std::vector<Real> a(size, 0), b(size, 1), c(size, 2);
+    Real best{0};
+    for (int repetition = 0; repetition < 5; repetition++) {
+        double ct0, ct1, et0, et1;
+        ops_timers(&ct0, &et0);
+        for (long i = 0; i < size; i++) {
+            a[i] = b[i] + 3 * c[i];
+        }
+        ops_timers(&ct1, &et1);
+        best = std::max(best, (Real)(3 * sizeof(Real) * size / (et1 - et0)));
+    }
+    return best / 1e9;
+}
+
+void ReportRoofline() {
+    if (kernelCosts.empty()) {
+        return;
+    }
+    if (peakBandwidth <= 0) {
+        peakBandwidth = MeasureTriadBandwidth();
+    }
+    ops_printf("\nRoofline with %.2f GB/s", peakBandwidth);
+    if (peakFlops > 0) {
+        ops_printf(" and %.2f GFLOP/s", peakFlops);
+    }
+    ops_printf(" (rank 0)\n");
+    ops_printf("%-36s %8s %10s %8s %8s %8s %9s %9s %7s\n", "Kernel", "Calls",
+               "Time(s)", "B/node", "F/node", "F/B", "GB/s", "GFLOP/s",
+               "Roof");
+    std::vector<std::pair<std::string, KernelCost>> costs(
+        kernelCosts.begin(), kernelCosts.end());
+    std::sort(costs.begin(), costs.end(),
+              [](const std::pair<std::string, KernelCost>& a,
+                 const std::pair<std::string, KernelCost>& b) {
+                  return a.second.seconds > b.second.seconds;
+              });
+    for (const auto& nameCost : costs) {
+        const KernelCost& cost{nameCost.second};
+        if (cost.nodes <= 0 || cost.seconds <= 0) {
+            continue;
+        }
+        const Real bandwidth{cost.bytes / cost.seconds / 1e9};
+        const Real flopRate{cost.flops / cost.seconds / 1e9};
+        const Real intensity{cost.bytes > 0 ? cost.flops / cost.bytes : 0};
+        // The attainable performance at this intensity, measured in bandwidth
+        // when there are no operations or the compute ceiling is unknown
+        Real roof{bandwidth / peakBandwidth};
+        if (peakFlops > 0 && cost.flops > 0) {
+            roof = flopRate / std::min(peakFlops, intensity * peakBandwidth);
+        }
+        ops_printf("%-36s %8ld %10.4f %8.1f %8.1f %8.3f %9.3f %9.3f %6.1f%%\n",
+                   nameCost.first.c_str(), cost.calls, cost.seconds,
+                   cost.bytes / cost.nodes, cost.flops / cost.nodes, intensity,
+                   bandwidth, flopRate, 100 * roof);
+    }
+}
+#else
+void SetRooflinePeaks(const Real bandwidth, const Real flops) {}
+void ReportRoofline() {}
+#endif  // ROOFLINE
+
+#if defined(ROOFLINE) || defined(TRACE) || defined(PERFCOUNTERS)
+Real LoopNodes(const int dim, const int* range) {
+    Real nodes{1};
+    for (int axis = 0; axis < dim; axis++) {
+        nodes *= std::max(range[2 * axis + 1] - range[2 * axis], 0);
+    }
+    return nodes;
+}
+
+KernelScope::KernelScope(const char* name, const int dim, const int* range,
+                         std::initializer_list<DatAccess> dats)
+    : name{name},
+      nodes{LoopNodes(dim, range)},
+      traceScope{name, Trace_Kernel},
+      counterScope{name, nodes} {
+#ifdef ROOFLINE
+    for (const DatAccess& datAccess : dats) {
+        const Real bytes{(Real)datAccess.dat->elem_size};
+        const bool twice{datAccess.access == OPS_RW ||
+                         datAccess.access == OPS_INC};
+        bytesPerNode += twice ? 2 * bytes : bytes;
+    }
+    double cpuTime;
+    ops_timers(&cpuTime, &start);
+#endif  // ROOFLINE
+}
+
+KernelScope::~KernelScope() {
+#ifdef ROOFLINE
+    double cpuTime, end;
+    ops_timers(&cpuTime, &end);
+    AccountKernelCost(name, nodes, bytesPerNode, end - start);
+#endif  // ROOFLINE
+}
+#endif
@@ -0,0 +1,106 @@
+/**
+ * Copyright 2019 United Kingdom Research and Innovation
+ *
+ * Authors: See AUTHORS
+ *
+ * Contact: [jianping.meng@stfc.ac.uk and/or jpmeng@gmail.com]
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * ANDANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*! @brief   Account the traffic and operations of each kernel for a roofline
+ * @author  Jianping Meng
+ * @details When ROOFLINE is defined in the development mode, every kernel
+ * launched in the time steps is timed and its theoretical bytes per node are
+ * derived from the fields it declares, i.e., the element size of each ops_dat,
+ * counted once for OPS_READ/OPS_WRITE and twice for OPS_RW/OPS_INC. Only the
+ * compulsory traffic is counted, i.e., the neighbours reached by a stencil are
+ * assumed to be cached and write-allocate is ignored. The operations per node
+ * are estimated from the lattice for the kernels known to MPLB. A table of the
+ * achieved bandwidth, arithmetic intensity and the fraction of the roofline is
+ * printed at the end of Iterate(). In the optimised mode, OPS reports the
+ * achieved bandwidth of each kernel itself. A launch is hooked by a
+ * KERNEL_SCOPE right before its ops_par_loop, which also feeds the TRACE
+ * timeline (trace.h) and the PERFCOUNTERS sampling (perfcounter.h). The
+ * kernels that only set up the fields, e.g., the node types, are not hooked.
+ */
+
+#ifndef ROOFLINE_H
+#define ROOFLINE_H
+#include <initializer_list>
+#include "ops_lib_core.h"
+#ifdef OPS_MPI
+#include "ops_mpi_core.h"
+#endif
+#include "type.h"
+#include "trace.h"
+#include "perfcounter.h"
+/*!
+ * Set the ceilings of the roofline in GB/s and GFLOP/s. Without a bandwidth,
+ * a STREAM triad is measured when the table is printed. Without a FLOP rate,
+ * kernels are only placed against the bandwidth roof.
+ */
+void SetRooflinePeaks(const Real bandwidth, const Real flops);
+void ReportRoofline();
+
+// A field declared by a kernel and how the kernel accesses it
+struct DatAccess {
+    ops_dat dat;
+    ops_access access;
+};
+
+/*!
+ * Instrument the ops_par_loop that follows in the same block, e.g.,
+ *     KERNEL_SCOPE("KerStream3D", SpaceDim(), loop.iterRng,
+ *                  {{loop.dats[0], OPS_RW}, {loop.dats[1], OPS_READ}});
+ *     ops_par_loop(KerStream3D, "KerStream3D", ...);
+ * The name is the one given to ops_par_loop and the dats are those passed by
+ * ops_arg_dat. The scope ends with the block, so a block launching several
+ * kernels needs one nested block per kernel. Without ROOFLINE, TRACE and
+ * PERFCOUNTERS, the macro expands to nothing, so that neither the scope nor
+ * its list of dats is evaluated at a launch. The list is not derived from the
+ * ops_arg_dat arguments, which must stay in the ops_par_loop for the OPS
+ * translator, so that it has to be kept in line with them by hand.
+ */
+#if defined(ROOFLINE) || defined(TRACE) || defined(PERFCOUNTERS)
+class KernelScope {
+   public:
+    KernelScope(const char* name, const int dim, const int* range,
+                std::initializer_list<DatAccess> dats = {});
+    ~KernelScope();
+
+   private:
+    const char* name;
+    Real nodes;
+    Real bytesPerNode{0};
+    TraceScope traceScope;
+    CounterScope counterScope;
+    double start{0};
+};
+#define KERNEL_SCOPE(...) KernelScope kernelScope{__VA_ARGS__}
+#else
+#define KERNEL_SCOPE(...)
+#endif
+#endif  // ROOFLINE_H
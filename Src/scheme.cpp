@@ -89,13 +89,27 @@ int schemeHaloPt{1};
 SchemeType schemeType{Scheme_StreamCollision};
 SchemeType Scheme() { return schemeType; }
 
+// The moment scheme computes the variables only when they are asked for.
+bool CanInterleaveMacroVars(const MacroVarsLayout layout,
+                            const SchemeType scheme, const int spaceDim) {
+    return layout == MacroVars_Interleaved && spaceDim == 3 &&
+           scheme != Scheme_StreamCollision_Moment;
+}
+
+// Only the (non-swap) stream-collision scheme stores fStage.
+bool CanCompressPopulations(const PopulationStorage storage,
+                            const SchemeType scheme, const int spaceDim) {
+    return storage == Population_Compressed16 && spaceDim == 3 &&
+           scheme == Scheme_StreamCollision;
+}
+
 void DefineScheme(const SchemeType scheme) {
     schemeType = scheme;
     switch (schemeType) {
         case Scheme_StreamCollision: {
             SetSchemeHaloNum(1);
+            // fStage is allocated by CreateStagePopulations()
             g_fStage().SetDataDim(SizeF());
-            g_fStage().CreateFieldFromScratch(g_Block());
             RegisterFieldNeedHalo(g_fStage());
             ops_printf("The stream-collision scheme is chosen!\n");
         } break;
@@ -103,6 +117,29 @@ void DefineScheme(const SchemeType scheme) {
             SetSchemeHaloNum(1);
             RegisterFieldNeedHalo(g_f());
             ops_printf("The stream-collision_swap scheme is chosen!\n");
+            ops_printf("The field fStage is not needed and not allocated\n");
+        } break;
+        case Scheme_StreamCollision_Moment: {
+#ifdef OPS_3D
+            SetSchemeHaloNum(1);
+            // g_Moments() takes the place of f, see CreatePopulations()
+            g_Moments().SetDataDim(Moment_Num);
+            g_MomentsStage().SetDataDim(Moment_Num);
+            g_MomentsStage().CreateFieldFromScratch(g_Block());
+            RegisterFieldNeedHalo(g_Moments());
+            RegisterFieldNeedHalo(g_MomentsStage());
+            ops_printf("The stream-collision_moment scheme is chosen!\n");
+            ops_printf(
+                "The fields f and fStage are replaced by two fields of %i "
+                "moments\n",
+                Moment_Num);
+#endif
+#ifdef OPS_2D
+            ops_printf(
+                "Error! The moment scheme is only implemented for 3D "
+                "problems!\n");
+            assert(false);
+#endif
         } break;
         default:
             break;
@@ -110,3 +147,112 @@ void DefineScheme(const SchemeType scheme) {
 }
 int SchemeHaloNum() { return schemeHaloPt; }
 void SetSchemeHaloNum(const int schemeHaloNum) { schemeHaloPt = schemeHaloNum; }
+
+#ifdef OPS_3D
+LoopPlanGroup streamPlan;
+LoopPlanGroup& g_StreamPlan() { return streamPlan; }
+
+// The stream loop decodes the 16-bit populations with the scale of the block
+void UseCompressedPopulations(LoopPlan& loop, const int blockIndex) {
+    if (!IsPopulationCompressed()) {
+        return;
+    }
+    loop.compressed = true;
+    loop.dats[1] = g_fStageCompressed()[blockIndex];
+    loop.scale = &g_PopulationScale().at(blockIndex).scale;
+}
+
+// The moment kernels only know the isothermal BGK collision without a force
+// term of a single component, whose lattice fits their local arrays.
+void CheckMomentScheme() {
+    bool qualified{ComponentNum() == 1 && SizeF() <= MomentLatticeMax};
+    for (const auto& idCompo : g_Components()) {
+        const Component& compo{idCompo.second};
+        qualified = qualified &&
+                    compo.collisionType == Collision_BGKIsothermal2nd &&
+                    compo.bodyForceType == BodyForce_None &&
+                    compo.macroVars.count(Variable_Rho) == 1 &&
+                    compo.macroVars.count(Variable_U) == 1 &&
+                    compo.macroVars.count(Variable_V) == 1 &&
+                    compo.macroVars.count(Variable_W) == 1;
+    }
+    if (!qualified) {
+        ops_printf(
+            "Error! The moment scheme needs a single component with Rho, U, "
+            "V and W, the BGKIsothermal2nd collision, no body force and a "
+            "lattice of at most %i velocities!\n",
+            MomentLatticeMax);
+        assert(qualified);
+    }
+}
+
+// Moments of the current step, which alternate between the pair of fields
+int currentMoments{0};
+
+RealField& CurrentMoments() {
+    return currentMoments == 0 ? g_Moments() : g_MomentsStage();
+}
+
+int CurrentMomentsIndex() { return currentMoments; }
+
+void SwapMoments() { currentMoments = 1 - currentMoments; }
+
+void BuildStreamPlan3D() {
+    streamPlan.clear();
+    if (schemeType == Scheme_StreamCollision_Moment) {
+        CheckMomentScheme();
+        const Component& compo{g_Components().begin()->second};
+        for (const auto& idBlock : g_Block()) {
+            const Block& block{idBlock.second};
+            const int blockIndex{block.ID()};
+            LoopPlan loop{
+                CreateLoopPlan(block, block.WholeRange(), schemeType)};
+            loop.moment = true;
+            loop.dats = {g_Moments()[blockIndex], g_MomentsStage()[blockIndex],
+                         g_NodeType().at(compo.id).at(blockIndex),
+                         g_GeometryProperty()[blockIndex]};
+            loop.realArgs = {compo.tauRef};
+            loop.intArgs = {compo.index[0], compo.index[1]};
+            streamPlan.push_back(loop);
+        }
+        return;
+    }
+    for (const auto& idBlock : g_Block()) {
+        const Block& block{idBlock.second};
+        const int blockIndex{block.ID()};
+        // The swap kernels rely on the lattice order of each component so
+        // that only the stream-collision scheme can be fused.
+        if (IsMultiComponentFusion() && IsNodeTypeShared() &&
+            schemeType == Scheme_StreamCollision) {
+            const int compoId{g_Components().begin()->first};
+            LoopPlan loop{
+                CreateLoopPlan(block, block.WholeRange(), schemeType)};
+            loop.fused = true;
+            loop.dats = {g_f()[blockIndex],
+                         IsPopulationCompressed() ? nullptr
+                                                  : g_fStage()[blockIndex],
+                         g_NodeType().at(compoId).at(blockIndex),
+                         g_GeometryProperty()[blockIndex]};
+            loop.intArgs = {0, SizeF() - 1};
+            UseCompressedPopulations(loop, blockIndex);
+            streamPlan.push_back(loop);
+            continue;
+        }
+        for (const auto& idCompo : g_Components()) {
+            const Component& compo{idCompo.second};
+            const bool swap{schemeType == Scheme_StreamCollision_Swap};
+            LoopPlan loop{CreateLoopPlan(block, block.WholeRange(), schemeType)};
+            // fStage is not allocated for the swap scheme or if compressed
+            loop.dats = {g_f()[blockIndex],
+                         swap || IsPopulationCompressed()
+                             ? nullptr
+                             : g_fStage()[blockIndex],
+                         g_NodeType().at(compo.id).at(blockIndex),
+                         g_GeometryProperty()[blockIndex]};
+            loop.intArgs = {compo.index[0], compo.index[1]};
+            UseCompressedPopulations(loop, blockIndex);
+            streamPlan.push_back(loop);
+        }
+    }
+}
+#endif  // OPS_3D
@@ -64,11 +64,21 @@ extern ops_stencil TWOPTREGULARSTENCIL;
  */
 extern ops_stencil ONEPTLATTICESTENCIL;
 
+/*!
+ * Scheme_StreamCollision_Moment: experimental, the populations are replaced
+ * by ten moments per node (rho, the momentum and the momentum flux), whose
+ * regularised populations are gathered from the neighbours and projected
+ * back after the collision in one loop. Two moment fields of dim 10 are
+ * allocated instead of f and fStage. It is limited to 3D with one component
+ * of the BGKIsothermal2nd collision without body force, and to the
+ * EQMDiffuseRefl, periodic and block-connection boundaries.
+ */
 enum SchemeType {
     Scheme_E1st2nd = 1,
     Scheme_I1st2nd = -1,
     Scheme_StreamCollision = 10,
     Scheme_StreamCollision_Swap=11,
+    Scheme_StreamCollision_Moment = 12,
 } ;
 
 void SetupCommonStencils();
@@ -79,8 +89,38 @@ void DefineScheme(const SchemeType scheme);
 int SchemeHaloNum();
 void SetSchemeHaloNum(const int schemeHaloNum);
 SchemeType Scheme();
+/*!
+ * Whether the interleaved macroscopic variables or the compressed populations
+ * asked for apply to a scheme in spaceDim dimensions before the components are
+ * looked at, which is shared by CreateMacroVars(), CreateStagePopulations()
+ * and the dry run that only has the configuration.
+ */
+bool CanInterleaveMacroVars(const MacroVarsLayout layout,
+                            const SchemeType scheme, const int spaceDim);
+bool CanCompressPopulations(const PopulationStorage storage,
+                            const SchemeType scheme, const int spaceDim);
 #ifdef OPS_3D
 void  PredefinedStream3D();
+/*!
+ * Execution plan of the stream loops, {f, fStage, nodeType, geometry},
+ * where fStage is fStageCompressed if the populations are compressed, see
+ * DefinePopulationStorage(), or {moments, momentsStage, nodeType, geometry}
+ * under the moment scheme, built by BuildStreamPlan3D() after Partition()
+ */
+LoopPlanGroup& g_StreamPlan();
+void BuildStreamPlan3D();
+/*!
+ * The moment scheme reads the moments of the last step from one of
+ * g_Moments() and g_MomentsStage() and writes the new ones into the other.
+ * CurrentMoments() is the field holding the latest moments and
+ * CurrentMomentsIndex() its position (0 or 1) in the pair of a plan.
+ * SwapMoments() is called at the end of a step, and SettleMoments3D() copies
+ * the latest moments into g_Moments() if they are not there.
+ */
+RealField& CurrentMoments();
+int CurrentMomentsIndex();
+void SwapMoments();
+void SettleMoments3D();
 #endif //OPS_3D
 
 #ifdef OPS_2D
@@ -3,60 +3,128 @@
 #include "flowfield.h"
 #include "scheme.h"
 #include "ops_seq_v2.h"
+#include "roofline.h"
 #include "scheme_kernel.inc"
 #ifdef OPS_3D
 void PredefinedStream3D() {
 #ifdef OPS_3D
-    for (const auto& idBlock : g_Block()) {
-        const Block& block{idBlock.second};
-        std::vector<int> iterRng;
-        iterRng.assign(block.WholeRange().begin(), block.WholeRange().end());
-        const int blockIndex{block.ID()};
-        for (const auto& compo : g_Components()) {
-            switch (Scheme()) {
-                case Scheme_StreamCollision:
+    for (auto& loop : g_StreamPlan()) {
+        switch (loop.kernel) {
+            case Scheme_StreamCollision: {
+                if (loop.compressed) {
+                    KERNEL_SCOPE(
+                        "KerStreamCompressed3D", SpaceDim(), loop.iterRng,
+                        {{loop.dats[0], OPS_RW}, {loop.dats[1], OPS_READ},
+                         {loop.dats[2], OPS_READ}, {loop.dats[3], OPS_READ}});
                     ops_par_loop(
-                        KerStream3D, "KerStream3D", block.Get(), SpaceDim(),
-                        iterRng.data(),
-                        ops_arg_dat(g_f().at(blockIndex), NUMXI, LOCALSTENCIL,
+                        KerStreamCompressed3D, "KerStreamCompressed3D",
+                        loop.block, SpaceDim(), loop.iterRng,
+                        ops_arg_dat(loop.dats[0], NUMXI, LOCALSTENCIL,
                                     "double", OPS_RW),
-                        ops_arg_dat(g_fStage().at(blockIndex), NUMXI,
-                                    ONEPTLATTICESTENCIL, "double", OPS_READ),
-                        ops_arg_dat(g_NodeType().at(compo.first).at(blockIndex),
-                                    1, LOCALSTENCIL, "int", OPS_READ),
-                        ops_arg_dat(g_GeometryProperty().at(blockIndex), 1,
-                                    LOCALSTENCIL, "int", OPS_READ),
-                        ops_arg_gbl(compo.second.index, 2, "int", OPS_READ));
+                        ops_arg_dat(loop.dats[1], NUMXI, ONEPTLATTICESTENCIL,
+                                    "short", OPS_READ),
+                        ops_arg_dat(loop.dats[2], 1, LOCALSTENCIL, "int",
+                                    OPS_READ),
+                        ops_arg_dat(loop.dats[3], 1, LOCALSTENCIL, "int",
+                                    OPS_READ),
+                        ops_arg_gbl(loop.scale, 1, "double", OPS_READ),
+                        ops_arg_gbl(loop.intArgs.data(), 2, "int", OPS_READ));
                     break;
-                case Scheme_StreamCollision_Swap: {
-                    ops_par_loop(
-                        KerLocalSwap3D, "KerLocalSwap3D", block.Get(),
-                        SpaceDim(), iterRng.data(),
-                        ops_arg_dat(g_f().at(blockIndex), NUMXI, LOCALSTENCIL,
-                                    "double", OPS_RW),
-                        ops_arg_dat(g_NodeType().at(compo.first).at(blockIndex),
-                                    1, LOCALSTENCIL, "int", OPS_READ),
-                        ops_arg_dat(g_GeometryProperty().at(blockIndex), 1,
-                                    LOCALSTENCIL, "int", OPS_READ),
-                        ops_arg_gbl(compo.second.index, 2, "int", OPS_READ));
-                    ops_par_loop(
-                        KerSwapStream3D, "KerSwapStream3D", block.Get(),
-                        SpaceDim(), iterRng.data(),
-                        ops_arg_dat(g_f().at(blockIndex), NUMXI, LOCALSTENCIL,
-                                    "double", OPS_RW),
-                        ops_arg_dat(g_NodeType().at(compo.first).at(blockIndex),
-                                    1, LOCALSTENCIL, "int", OPS_READ),
-                        ops_arg_dat(g_GeometryProperty().at(blockIndex), 1,
-                                    LOCALSTENCIL, "int", OPS_READ),
-                        ops_arg_gbl(compo.second.index, 2, "int", OPS_READ));
-                } break;
+                }
+                KERNEL_SCOPE(
+                    "KerStream3D", SpaceDim(), loop.iterRng,
+                    {{loop.dats[0], OPS_RW}, {loop.dats[1], OPS_READ},
+                     {loop.dats[2], OPS_READ}, {loop.dats[3], OPS_READ}});
+                ops_par_loop(
+                    KerStream3D, "KerStream3D", loop.block, SpaceDim(),
+                    loop.iterRng,
+                    ops_arg_dat(loop.dats[0], NUMXI, LOCALSTENCIL, "double",
+                                OPS_RW),
+                    ops_arg_dat(loop.dats[1], NUMXI, ONEPTLATTICESTENCIL,
+                                "double", OPS_READ),
+                    ops_arg_dat(loop.dats[2], 1, LOCALSTENCIL, "int", OPS_READ),
+                    ops_arg_dat(loop.dats[3], 1, LOCALSTENCIL, "int", OPS_READ),
+                    ops_arg_gbl(loop.intArgs.data(), 2, "int", OPS_READ));
+            } break;
+            case Scheme_StreamCollision_Swap: {
+                {
+                    KERNEL_SCOPE(
+                        "KerLocalSwap3D", SpaceDim(), loop.iterRng,
+                        {{loop.dats[0], OPS_RW}, {loop.dats[2], OPS_READ},
+                         {loop.dats[3], OPS_READ}});
+                    ops_par_loop(KerLocalSwap3D, "KerLocalSwap3D", loop.block,
+                                 SpaceDim(), loop.iterRng,
+                                 ops_arg_dat(loop.dats[0], NUMXI, LOCALSTENCIL,
+                                             "double", OPS_RW),
+                                 ops_arg_dat(loop.dats[2], 1, LOCALSTENCIL,
+                                             "int", OPS_READ),
+                                 ops_arg_dat(loop.dats[3], 1, LOCALSTENCIL,
+                                             "int", OPS_READ),
+                                 ops_arg_gbl(loop.intArgs.data(), 2, "int",
+                                             OPS_READ));
+                }
+                KERNEL_SCOPE(
+                    "KerSwapStream3D", SpaceDim(), loop.iterRng,
+                    {{loop.dats[0], OPS_RW}, {loop.dats[2], OPS_READ},
+                     {loop.dats[3], OPS_READ}});
+                ops_par_loop(
+                    KerSwapStream3D, "KerSwapStream3D", loop.block, SpaceDim(),
+                    loop.iterRng,
+                    ops_arg_dat(loop.dats[0], NUMXI, LOCALSTENCIL, "double",
+                                OPS_RW),
+                    ops_arg_dat(loop.dats[2], 1, LOCALSTENCIL, "int", OPS_READ),
+                    ops_arg_dat(loop.dats[3], 1, LOCALSTENCIL, "int", OPS_READ),
+                    ops_arg_gbl(loop.intArgs.data(), 2, "int", OPS_READ));
+            } break;
 
-                default:
-                    break;
-            }
+            case Scheme_StreamCollision_Moment: {
+                const int current{CurrentMomentsIndex()};
+                KERNEL_SCOPE(
+                    "KerStreamCollideMoment3D", SpaceDim(), loop.iterRng,
+                    {{loop.dats[1 - current], OPS_WRITE},
+                     {loop.dats[current], OPS_READ}, {loop.dats[2], OPS_READ},
+                     {loop.dats[3], OPS_READ}});
+                ops_par_loop(
+                    KerStreamCollideMoment3D, "KerStreamCollideMoment3D",
+                    loop.block, SpaceDim(), loop.iterRng,
+                    ops_arg_dat(loop.dats[1 - current], Moment_Num,
+                                LOCALSTENCIL, "double", OPS_WRITE),
+                    ops_arg_dat(loop.dats[current], Moment_Num,
+                                ONEPTLATTICESTENCIL, "double", OPS_READ),
+                    ops_arg_dat(loop.dats[2], 1, LOCALSTENCIL, "int", OPS_READ),
+                    ops_arg_dat(loop.dats[3], 1, LOCALSTENCIL, "int", OPS_READ),
+                    ops_arg_gbl(loop.realArgs.data(), 1, "double", OPS_READ),
+                    ops_arg_gbl(pTimeStep(), 1, "double", OPS_READ),
+                    ops_arg_gbl(loop.intArgs.data(), 2, "int", OPS_READ));
+            } break;
+            default:
+                break;
         }
     }
-#endif  // OPS_3Ds
+#endif  // OPS_3D
+}
+
+void SettleMoments3D() {
+    if (CurrentMomentsIndex() == 0) {
+        return;
+    }
+    for (const auto& idBlock : g_Block()) {
+        const Block& block{idBlock.second};
+        std::vector<int> iterRng;
+        iterRng.assign(block.WholeRange().begin(), block.WholeRange().end());
+        const int blockIndex{block.ID()};
+        KERNEL_SCOPE(
+            "KerCopyMoments3D", SpaceDim(), iterRng.data(),
+            {{g_Moments()[blockIndex], OPS_WRITE},
+             {g_MomentsStage()[blockIndex], OPS_READ}});
+        ops_par_loop(KerCopyMoments3D, "KerCopyMoments3D", block.Get(),
+                     SpaceDim(), iterRng.data(),
+                     ops_arg_dat(g_Moments()[blockIndex], Moment_Num,
+                                 LOCALSTENCIL, "double", OPS_WRITE),
+                     ops_arg_dat(g_MomentsStage()[blockIndex], Moment_Num,
+                                 LOCALSTENCIL, "double", OPS_READ));
+    }
+    SwapMoments();
 }
 #endif  // OPS_3D
 
@@ -69,6 +137,12 @@ void Stream() {
         iterRng.assign(block.WholeRange().begin(), block.WholeRange().end());
         const int blockIndex{block.ID()};
         for (const auto& compo : g_Components()) {
+            KERNEL_SCOPE(
+                "KerStream", SpaceDim(), iterRng.data(),
+                {{g_f().at(blockIndex), OPS_RW},
+                 {g_fStage().at(blockIndex), OPS_READ},
+                 {g_NodeType().at(compo.first).at(blockIndex), OPS_READ},
+                 {g_GeometryProperty().at(blockIndex), OPS_READ}});
             ops_par_loop(
                 KerStream, "KerStream", block.Get(), SpaceDim(), iterRng.data(),
                 ops_arg_dat(g_f().at(blockIndex), NUMXI, LOCALSTENCIL, "double",
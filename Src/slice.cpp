@@ -0,0 +1,145 @@
+/**
+ * Copyright 2019 United Kingdom Research and Innovation
+ *
+ * Authors: See AUTHORS
+ *
+ * Contact: [jianping.meng@stfc.ac.uk and/or jpmeng@gmail.com]
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * ANDANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*! @brief   Write slices and subsamples of the macroscopic variables
+ * @author  Jianping Meng
+ * @details The definitions of the slices and the writer of their datasets,
+ * see slice.h.
+ */
+#include "slice.h"
+#include <algorithm>
+#include <cassert>
+#include "snapshot.h"
+#ifdef OPS_MPI
+#include "ops_mpi_core.h"
+#endif
+
+std::vector<SliceDefinition> sliceSetting;
+
+const std::vector<SliceDefinition>& SliceSetting() { return sliceSetting; }
+
+void DefineSlices(const std::vector<SliceDefinition>& slices,
+                  const int spaceDim) {
+    for (const SliceDefinition& slice : slices) {
+        bool valid{!slice.name.empty() && slice.period > 0 &&
+                   slice.axis >= 0 && slice.axis < spaceDim &&
+                   slice.stride.size() == (SizeType)spaceDim};
+        for (SizeType axis = 0; valid && axis < slice.stride.size(); axis++) {
+            valid = slice.stride.at(axis) >= 1;
+        }
+        if (!valid) {
+            ops_printf(
+                "Error! Slice %s needs a name, a positive period, a normal "
+                "axis within the space and a positive stride along each "
+                "axis!\n",
+                slice.name.c_str());
+            assert(valid);
+        }
+    }
+    sliceSetting = slices;
+}
+
+void WriteSliceDat(const std::string& fileName, const std::string& blockName,
+                   const std::string& datName, const std::string& fieldName,
+                   const ops_dat dat, const int dim, const int component,
+                   const std::vector<int>& range,
+                   const std::vector<int>& stride) {
+    const int spaceDim{(int)stride.size()};
+    std::vector<int> disp(spaceDim, 0), sizes(spaceDim, 0);
+    if (ops_dat_get_local_npartitions(dat) > 0) {
+        ops_dat_get_extents(dat, 0, disp.data(), sizes.data());
+    }
+    // The nodes of this rank are [first, last) of the dataset along an axis
+    SnapshotSpace space;
+    space.shape.resize(spaceDim);
+    space.start.resize(spaceDim);
+    space.count.resize(spaceDim);
+    std::vector<int> first(spaceDim), last(spaceDim);
+    for (int axis = 0; axis < spaceDim; axis++) {
+        const int begin{range[2 * axis]};
+        const int total{
+            (range[2 * axis + 1] - begin + stride[axis] - 1) / stride[axis]};
+        const int lower{std::max(disp[axis], begin)};
+        const int upper{std::min(disp[axis] + sizes[axis],
+                                 range[2 * axis + 1])};
+        first[axis] = (lower - begin + stride[axis] - 1) / stride[axis];
+        last[axis] = std::max(
+            first[axis], (upper - begin + stride[axis] - 1) / stride[axis]);
+        const int fileAxis{spaceDim - 1 - axis};
+        space.shape[fileAxis] = total;
+        space.start[fileAxis] = first[axis];
+        space.count[fileAxis] = last[axis] - first[axis];
+        space.localSize *= space.count[fileAxis];
+    }
+    // Fetch the box holding the nodes of this rank at once and pick the
+    // strided ones from x
+    std::vector<Real> values;
+    values.reserve(space.localSize);
+    if (space.localSize > 0) {
+        std::vector<int> box(2 * spaceDim);
+        std::vector<SizeType> boxSize(3, 1);
+        SizeType boxVolume{1};
+        for (int axis = 0; axis < spaceDim; axis++) {
+            box[2 * axis] = range[2 * axis] + first[axis] * stride[axis];
+            box[2 * axis + 1] =
+                range[2 * axis] + (last[axis] - 1) * stride[axis] + 1;
+            boxSize[axis] = box[2 * axis + 1] - box[2 * axis];
+            boxVolume *= boxSize[axis];
+        }
+        std::vector<Real> boxValues(boxVolume * dim);
+        ops_dat_fetch_data_slab_host(dat, 0, (char*)boxValues.data(),
+                                     box.data());
+        const int nodes[3]{last[0] - first[0],
+                           spaceDim > 1 ? last[1] - first[1] : 1,
+                           spaceDim > 2 ? last[2] - first[2] : 1};
+        const SizeType step[3]{(SizeType)stride[0],
+                               spaceDim > 1 ? (SizeType)stride[1] : 1,
+                               spaceDim > 2 ? (SizeType)stride[2] : 1};
+        for (int k = 0; k < nodes[2]; k++) {
+            for (int j = 0; j < nodes[1]; j++) {
+                const SizeType row{(k * step[2] * boxSize[1] + j * step[1]) *
+                                   boxSize[0]};
+                for (int i = 0; i < nodes[0]; i++) {
+                    values.push_back(
+                        boxValues.at((row + i * step[0]) * dim + component));
+                }
+            }
+        }
+    }
+    std::vector<int> origin(spaceDim);
+    for (int axis = 0; axis < spaceDim; axis++) {
+        origin[axis] = range[2 * axis];
+    }
+    WriteSnapshotSlab(fileName, blockName, datName, fieldName, space, values,
+                      {{"Start", origin}, {"Stride", stride}});
+}
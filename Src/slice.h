@@ -0,0 +1,84 @@
+/**
+ * Copyright 2019 United Kingdom Research and Innovation
+ *
+ * Authors: See AUTHORS
+ *
+ * Contact: [jianping.meng@stfc.ac.uk and/or jpmeng@gmail.com]
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * ANDANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*! @brief   Write slices and subsamples of the macroscopic variables
+ * @author  Jianping Meng
+ * @details A slice is the plane of nodes nearest to a position along an axis
+ * of each block it crosses, and a subsample keeps every stride-th node of
+ * each block. Both may skip nodes by a stride and are written every period
+ * steps of their own into CASENAME_<name>_T<step>.h5, independently of the
+ * checkpoints. Each rank fetches its nodes of a slice once per variable and
+ * writes the strided ones through the snapshot writer, so that a slice is
+ * compressed as the snapshots and reported by ReportSnapshots().
+ */
+
+#ifndef SLICE_H
+#define SLICE_H
+#include <string>
+#include <vector>
+#include "ops_lib_core.h"
+#include "type.h"
+
+enum SliceType {
+    Slice_Plane = 0,
+    Slice_Subsample = 1,
+};
+
+struct SliceDefinition {
+    std::string name;
+    SliceType type{Slice_Plane};
+    // The normal axis, i.e., 0 for x, and the position along it of a plane
+    int axis{0};
+    Real position{0};
+    // Every stride[axis]-th node is written, where the normal axis of a plane
+    // is ignored
+    std::vector<int> stride;
+    SizeType period{0};
+};
+
+const std::vector<SliceDefinition>& SliceSetting();
+// The positions are given in the coordinates of the blocks.
+void DefineSlices(const std::vector<SliceDefinition>& slices,
+                  const int spaceDim);
+/*!
+ * Write the component of dat at the nodes range[2 * axis] + n * stride[axis]
+ * below range[2 * axis + 1] as datName in the group of its block. The
+ * dataset is from the slowest axis with the attributes Start and Stride from
+ * x, so that the node n of the dataset is the node Start + n * Stride.
+ */
+void WriteSliceDat(const std::string& fileName, const std::string& blockName,
+                   const std::string& datName, const std::string& fieldName,
+                   const ops_dat dat, const int dim, const int component,
+                   const std::vector<int>& range,
+                   const std::vector<int>& stride);
+#endif  // SLICE_H
@@ -0,0 +1,743 @@
+/**
+ * Copyright 2019 United Kingdom Research and Innovation
+ *
+ * Authors: See AUTHORS
+ *
+ * Contact: [jianping.meng@stfc.ac.uk and/or jpmeng@gmail.com]
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * ANDANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*! @brief   Write the fields into chunked and compressed HDF5 datasets
+ * @author  Jianping Meng
+ * @details The settings, the records of the writes and the HDF5 writer and
+ * reader of the snapshots, see snapshot.h.
+ */
+#include "snapshot.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <type_traits>
+#ifdef OPS_MPI
+#include "ops_mpi_core.h"
+#endif
+
+struct SnapshotSettings {
+    SnapshotCompression compression{Snapshot_Plain};
+    int deflateLevel{4};
+    // The absolute error allowed for a field under Snapshot_Quantised
+    std::map<std::string, Real> tolerances;
+    SnapshotLayout layout{Snapshot_FilePerBlock};
+    // The stripe size of the parallel file system in bytes
+    SizeType stripeSize{1 << 20};
+};
+
+SnapshotSettings snapshotSetting;
+
+void DefineSnapshotCompression(const SnapshotCompression compression,
+                               const int deflateLevel,
+                               const std::map<std::string, Real>& tolerances) {
+    if (deflateLevel < 0 || deflateLevel > 9) {
+        ops_printf("Error! The deflate level %i is not between 0 and 9!\n",
+                   deflateLevel);
+        assert(deflateLevel >= 0 && deflateLevel <= 9);
+    }
+    for (const auto& nameTolerance : tolerances) {
+        if (!(nameTolerance.second > 0)) {
+            ops_printf("Error! The tolerance of %s must be positive!\n",
+                       nameTolerance.first.c_str());
+            assert(nameTolerance.second > 0);
+        }
+    }
+    if (compression != Snapshot_Plain &&
+        H5Zfilter_avail(H5Z_FILTER_DEFLATE) <= 0) {
+        ops_printf("Error! The HDF5 library has no deflate filter!\n");
+        assert(H5Zfilter_avail(H5Z_FILTER_DEFLATE) > 0);
+    }
+    snapshotSetting.compression = compression;
+    snapshotSetting.deflateLevel = deflateLevel;
+    snapshotSetting.tolerances = tolerances;
+}
+
+void DefineSnapshotLayout(const SnapshotLayout layout,
+                          const SizeType stripeSize) {
+    if (stripeSize == 0) {
+        ops_printf("Error! The stripe size must be positive!\n");
+        assert(stripeSize > 0);
+    }
+    snapshotSetting.layout = layout;
+    snapshotSetting.stripeSize = stripeSize;
+}
+
+bool IsSnapshotFileShared() {
+    return snapshotSetting.layout == Snapshot_SharedFile;
+}
+
+std::string SnapshotFileName(const std::string& caseName,
+                             const std::string& blockName,
+                             const SizeType timeStep) {
+    if (snapshotSetting.layout == Snapshot_SharedFile) {
+        return caseName + "_T" + std::to_string(timeStep) + ".h5";
+    }
+    return caseName + "_" + blockName + "_T" + std::to_string(timeStep) +
+           ".h5";
+}
+
+struct SnapshotRecord {
+    SizeType writes{0};
+    double rawBytes{0};
+    double storedBytes{0};
+    double seconds{0};
+    double maxError{0};
+};
+
+std::vector<std::pair<std::string, SnapshotRecord>> snapshotRecords;
+
+void AccountSnapshot(const std::string& fieldName, const double rawBytes,
+                     const double storedBytes, const double seconds,
+                     const double maxError) {
+    std::vector<std::pair<std::string, SnapshotRecord>>& records{
+        snapshotRecords};
+    SizeType idx{0};
+    while (idx < records.size() && records[idx].first != fieldName) {
+        idx++;
+    }
+    if (idx == records.size()) {
+        records.emplace_back(fieldName, SnapshotRecord{});
+    }
+    SnapshotRecord& record{records[idx].second};
+    record.writes++;
+    record.rawBytes += rawBytes;
+    record.storedBytes += storedBytes;
+    record.seconds += seconds;
+    record.maxError = std::max(record.maxError, maxError);
+}
+
+template <>
+hid_t SnapshotH5Type<double>() {
+    return H5T_NATIVE_DOUBLE;
+}
+template <>
+hid_t SnapshotH5Type<float>() {
+    return H5T_NATIVE_FLOAT;
+}
+template <>
+hid_t SnapshotH5Type<int>() {
+    return H5T_NATIVE_INT;
+}
+template <>
+hid_t SnapshotH5Type<short>() {
+    return H5T_NATIVE_SHORT;
+}
+
+double SnapshotClock() {
+    double cpuTime, wallTime;
+    ops_timers(&cpuTime, &wallTime);
+    return wallTime;
+}
+
+// The file access of all the ranks, which share a file under MPI
+hid_t SnapshotFileAccess() {
+    hid_t fileAccess{H5Pcreate(H5P_FILE_ACCESS)};
+    const hsize_t stripeSize{snapshotSetting.stripeSize};
+    H5Pset_alignment(fileAccess, stripeSize, stripeSize);
+#ifdef OPS_MPI
+    H5Pset_fapl_mpio(fileAccess, OPS_MPI_GLOBAL, MPI_INFO_NULL);
+    H5Pset_all_coll_metadata_ops(fileAccess, true);
+    H5Pset_coll_metadata_write(fileAccess, true);
+#endif
+    return fileAccess;
+}
+
+bool SnapshotFileExists(const std::string& fileName) {
+    std::ifstream file(fileName);
+    return file.good();
+}
+
+// The file to read a block from, where the shared file is preferred
+std::string SnapshotFileToRead(const std::string& caseName,
+                               const std::string& blockName,
+                               const SizeType timeStep) {
+    const std::string sharedName{caseName + "_T" + std::to_string(timeStep) +
+                                 ".h5"};
+    if (SnapshotFileExists(sharedName)) {
+        return sharedName;
+    }
+    return caseName + "_" + blockName + "_T" + std::to_string(timeStep) +
+           ".h5";
+}
+
+hid_t OpenSnapshotFile(const std::string& fileName) {
+    hid_t fileAccess{SnapshotFileAccess()};
+    hid_t file{SnapshotFileExists(fileName)
+                   ? H5Fopen(fileName.c_str(), H5F_ACC_RDWR, fileAccess)
+                   : H5Fcreate(fileName.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT,
+                               fileAccess)};
+    H5Pclose(fileAccess);
+    if (file < 0) {
+        ops_printf("Error! Cannot open %s for writing!\n", fileName.c_str());
+        assert(file >= 0);
+    }
+    return file;
+}
+
+// The file opened by the current SnapshotScope and its name
+std::pair<std::string, hid_t> scopedSnapshotFile{"", -1};
+
+SnapshotScope::SnapshotScope(const std::string& caseName,
+                             const SizeType timeStep) {
+    if (IsSnapshotFileShared()) {
+        Open(SnapshotFileName(caseName, "", timeStep));
+    }
+}
+
+SnapshotScope::SnapshotScope(const std::string& fileName) { Open(fileName); }
+
+void SnapshotScope::Open(const std::string& fileName) {
+    if (scopedSnapshotFile.second >= 0) {
+        ops_printf("Error! The snapshot scopes cannot be nested!\n");
+        assert(scopedSnapshotFile.second < 0);
+    }
+    file = OpenSnapshotFile(fileName);
+    scopedSnapshotFile = {fileName, file};
+}
+
+// The file opened by the current scope if it is fileName, or -1
+hid_t ScopedSnapshotFile(const std::string& fileName) {
+    return scopedSnapshotFile.first == fileName ? scopedSnapshotFile.second
+                                                : -1;
+}
+
+SnapshotScope::~SnapshotScope() {
+    if (file < 0) {
+        return;
+    }
+    H5Fclose(file);
+    scopedSnapshotFile = {"", -1};
+}
+
+// The dataset of OPS, where OPS gives the extents of a partition from the
+// first inner node, including the halos at the ends of the block
+SnapshotSpace SnapshotSpaceOf(const ops_dat dat,
+                              const std::vector<int>& blockSize, const int dim,
+                              const int haloDepth) {
+    const int spaceDim{(int)blockSize.size()};
+    SnapshotSpace space;
+    std::vector<int> disp(spaceDim, 0), sizes(spaceDim, 0);
+    if (ops_dat_get_local_npartitions(dat) > 0) {
+        ops_dat_get_extents(dat, 0, disp.data(), sizes.data());
+    }
+    for (int axis = spaceDim - 1; axis >= 0; axis--) {
+        const hsize_t scale{axis == 0 ? (hsize_t)dim : 1};
+        space.shape.push_back((blockSize[axis] + 2 * haloDepth) * scale);
+        space.start.push_back((disp[axis] + haloDepth) * scale);
+        space.count.push_back(std::max(sizes[axis], 0) * scale);
+        space.localSize *= space.count.back();
+    }
+    return space;
+}
+
+// Select the part of this rank and return the matching memory space
+hid_t SelectSnapshotSpace(const hid_t fileSpace, const SnapshotSpace& space) {
+    const hsize_t localSize{std::max(space.localSize, (hsize_t)1)};
+    hid_t memSpace{H5Screate_simple(1, &localSize, nullptr)};
+    if (space.localSize == 0) {
+        H5Sselect_none(fileSpace);
+        H5Sselect_none(memSpace);
+        return memSpace;
+    }
+    H5Sselect_hyperslab(fileSpace, H5S_SELECT_SET, space.start.data(),
+                        nullptr, space.count.data(), nullptr);
+    return memSpace;
+}
+
+hid_t SnapshotTransfer() {
+    hid_t transfer{H5Pcreate(H5P_DATASET_XFER)};
+#ifdef OPS_MPI
+    // Filters need collective writes under MPI
+    H5Pset_dxpl_mpio(transfer, H5FD_MPIO_COLLECTIVE);
+#endif
+    return transfer;
+}
+
+// The native integer type of the levels of a quantised dataset
+hid_t SnapshotLevelType(const int levelBits) {
+    switch (levelBits) {
+        case 16:
+            return H5T_NATIVE_SHORT;
+        case 32:
+            return H5T_NATIVE_INT;
+        default:
+            return H5T_NATIVE_LLONG;
+    }
+}
+
+// Write or read the levels through an integer type L of levelBits bits
+template <typename L>
+void WriteSnapshotLevels(const hid_t dataset, const hid_t memSpace,
+                         const hid_t fileSpace, const hid_t transfer,
+                         const int levelBits,
+                         const std::vector<long long>& levels) {
+    const std::vector<L> narrowLevels(levels.begin(), levels.end());
+    H5Dwrite(dataset, SnapshotLevelType(levelBits), memSpace, fileSpace,
+             transfer, narrowLevels.data());
+}
+
+template <typename L>
+void ReadSnapshotLevels(const hid_t dataset, const hid_t memSpace,
+                        const hid_t fileSpace, const hid_t transfer,
+                        const int levelBits, std::vector<long long>& levels) {
+    std::vector<L> narrowLevels(levels.size());
+    H5Dread(dataset, SnapshotLevelType(levelBits), memSpace, fileSpace,
+            transfer, narrowLevels.data());
+    levels.assign(narrowLevels.begin(), narrowLevels.end());
+}
+
+void WriteSnapshotAttribute(const hid_t dataset, const char* name,
+                            const hid_t type, const void* value) {
+    hid_t attrSpace{H5Screate(H5S_SCALAR)};
+    hid_t attribute{
+        H5Acreate2(dataset, name, type, attrSpace, H5P_DEFAULT, H5P_DEFAULT)};
+    H5Awrite(attribute, type, value);
+    H5Aclose(attribute);
+    H5Sclose(attrSpace);
+}
+
+void WriteSnapshotAttribute(const hid_t dataset, const char* name,
+                            const std::vector<int>& values) {
+    const hsize_t size{values.size()};
+    hid_t attrSpace{H5Screate_simple(1, &size, nullptr)};
+    hid_t attribute{H5Acreate2(dataset, name, H5T_NATIVE_INT, attrSpace,
+                               H5P_DEFAULT, H5P_DEFAULT)};
+    H5Awrite(attribute, H5T_NATIVE_INT, values.data());
+    H5Aclose(attribute);
+    H5Sclose(attrSpace);
+}
+
+// Create datName of shape in the group of blockName, replacing an existing one
+// of the same name, which is chunked and compressed unless Snapshot_Plain
+hid_t CreateSnapshotDataset(const hid_t file, const std::string& blockName,
+                            const std::string& datName,
+                            const std::vector<hsize_t>& shape,
+                            const hid_t fileType) {
+    hid_t group{H5Lexists(file, blockName.c_str(), H5P_DEFAULT) > 0
+                    ? H5Gopen2(file, blockName.c_str(), H5P_DEFAULT)
+                    : H5Gcreate2(file, blockName.c_str(), H5P_DEFAULT,
+                                 H5P_DEFAULT, H5P_DEFAULT)};
+    if (H5Lexists(group, datName.c_str(), H5P_DEFAULT) > 0) {
+        H5Ldelete(group, datName.c_str(), H5P_DEFAULT);
+    }
+    // A chunk holds whole x rows of about one stripe
+    const int rank{(int)shape.size()};
+    hid_t creation{H5Pcreate(H5P_DATASET_CREATE)};
+    if (snapshotSetting.compression != Snapshot_Plain) {
+        std::vector<hsize_t> chunk(shape);
+        const hsize_t rowBytes{chunk[rank - 1] * H5Tget_size(fileType)};
+        hsize_t rows{std::max((hsize_t)1,
+                              (hsize_t)snapshotSetting.stripeSize / rowBytes)};
+        for (int axis = rank - 2; axis >= 0; axis--) {
+            chunk[axis] = std::min(shape[axis], rows);
+            rows = std::max((hsize_t)1, rows / chunk[axis]);
+        }
+        H5Pset_chunk(creation, rank, chunk.data());
+        H5Pset_shuffle(creation);
+        H5Pset_deflate(creation, snapshotSetting.deflateLevel);
+    }
+    hid_t fileSpace{H5Screate_simple(rank, shape.data(), nullptr)};
+    hid_t dataset{H5Dcreate2(group, datName.c_str(), fileType, fileSpace,
+                             H5P_DEFAULT, creation, H5P_DEFAULT)};
+    H5Sclose(fileSpace);
+    H5Pclose(creation);
+    H5Gclose(group);
+    return dataset;
+}
+
+/*!
+ * Write dat into the group of its block in fileName, replacing an existing
+ * one of the same name. The dataset is chunked and compressed unless the
+ * compression is Snapshot_Plain. It returns the quantum of the dataset, which
+ * is zero if the values are kept as they are.
+ */
+template <typename T>
+Real WriteSnapshotDat(const std::string& fileName, const std::string& blockName,
+                      const std::string& datName, const ops_dat dat,
+                      const std::string& fieldName,
+                      const std::vector<int>& blockSize, const int dim,
+                      const int haloDepth) {
+    const double start{SnapshotClock()};
+    const SnapshotSettings& setting{snapshotSetting};
+    const SnapshotSpace space{
+        SnapshotSpaceOf(dat, blockSize, dim, haloDepth)};
+    std::vector<T> values(std::max(space.localSize, (hsize_t)1));
+    if (space.localSize > 0) {
+        ops_dat_fetch_data(dat, 0, (char*)values.data());
+    }
+    // A value that cannot be rounded, e.g., a NaN, falls back to lossless
+    Real quantum{0};
+    if (setting.compression == Snapshot_Quantised &&
+        std::is_floating_point<T>::value &&
+        setting.tolerances.find(fieldName) != setting.tolerances.end()) {
+        quantum = 2 * setting.tolerances.at(fieldName);
+    }
+    std::vector<long long> levels;
+    double maxError{0};
+    int levelBits{64};
+    if (quantum > 0) {
+        int invalid{0};
+        double maxLevel{0};
+        levels.resize(values.size());
+        for (SizeType idx = 0; idx < values.size(); idx++) {
+            const double level{std::round(values[idx] / quantum)};
+            if (!(std::fabs(level) < 4e18)) {
+                invalid = 1;
+                break;
+            }
+            levels[idx] = (long long)level;
+            maxLevel = std::max(maxLevel, std::fabs(level));
+            maxError =
+                std::max(maxError, std::fabs(values[idx] - level * quantum));
+        }
+#ifdef OPS_MPI
+        MPI_Allreduce(MPI_IN_PLACE, &invalid, 1, MPI_INT, MPI_MAX,
+                      OPS_MPI_GLOBAL);
+        MPI_Allreduce(MPI_IN_PLACE, &maxLevel, 1, MPI_DOUBLE, MPI_MAX,
+                      OPS_MPI_GLOBAL);
+        MPI_Allreduce(MPI_IN_PLACE, &maxError, 1, MPI_DOUBLE, MPI_MAX,
+                      OPS_MPI_GLOBAL);
+#endif
+        if (maxLevel <= std::numeric_limits<short>::max()) {
+            levelBits = 16;
+        } else if (maxLevel <= std::numeric_limits<int>::max()) {
+            levelBits = 32;
+        }
+        if (invalid == 1) {
+            ops_printf(
+                "Warning! %s cannot be quantised and is written losslessly!\n",
+                fieldName.c_str());
+            quantum = 0;
+            maxError = 0;
+        }
+    }
+    const hid_t fileType{quantum > 0 ? SnapshotLevelType(levelBits)
+                                     : SnapshotH5Type<T>()};
+    // The shared file of a checkpoint stays open for all of its fields
+    const hid_t scopedFile{ScopedSnapshotFile(fileName)};
+    hid_t file{scopedFile >= 0 ? scopedFile : OpenSnapshotFile(fileName)};
+    hid_t dataset{CreateSnapshotDataset(file, blockName, datName, space.shape,
+                                        fileType)};
+    hid_t fileSpace{H5Dget_space(dataset)};
+    hid_t memSpace{SelectSnapshotSpace(fileSpace, space)};
+    hid_t transfer{SnapshotTransfer()};
+    if (quantum > 0) {
+        if (levelBits == 16) {
+            WriteSnapshotLevels<short>(dataset, memSpace, fileSpace, transfer,
+                                       levelBits, levels);
+        } else if (levelBits == 32) {
+            WriteSnapshotLevels<int>(dataset, memSpace, fileSpace, transfer,
+                                     levelBits, levels);
+        } else {
+            WriteSnapshotLevels<long long>(dataset, memSpace, fileSpace,
+                                           transfer, levelBits, levels);
+        }
+        WriteSnapshotAttribute(dataset, "Quantum", SnapshotH5Type<Real>(),
+                               &quantum);
+        WriteSnapshotAttribute(dataset, "LevelBits", H5T_NATIVE_INT,
+                               &levelBits);
+    } else {
+        H5Dwrite(dataset, SnapshotH5Type<T>(), memSpace, fileSpace, transfer,
+                 values.data());
+    }
+    WriteSnapshotAttribute(dataset, "Dim", H5T_NATIVE_INT, &dim);
+    WriteSnapshotAttribute(dataset, "HaloDepth", H5T_NATIVE_INT, &haloDepth);
+    const double storedBytes{(double)H5Dget_storage_size(dataset)};
+    H5Pclose(transfer);
+    H5Sclose(memSpace);
+    H5Dclose(dataset);
+    H5Sclose(fileSpace);
+    if (scopedFile < 0) {
+        H5Fclose(file);
+    }
+    double rawBytes{(double)sizeof(T)};
+    for (const hsize_t size : space.shape) {
+        rawBytes *= size;
+    }
+    AccountSnapshot(fieldName, rawBytes, storedBytes,
+                    SnapshotClock() - start, maxError);
+    return quantum;
+}
+
+void WriteSnapshotSlab(
+    const std::string& fileName, const std::string& blockName,
+    const std::string& datName, const std::string& fieldName,
+    const SnapshotSpace& space, const std::vector<Real>& values,
+    const std::map<std::string, std::vector<int>>& attributes) {
+    const double start{SnapshotClock()};
+    const hid_t scopedFile{ScopedSnapshotFile(fileName)};
+    hid_t file{scopedFile >= 0 ? scopedFile : OpenSnapshotFile(fileName)};
+    hid_t dataset{CreateSnapshotDataset(file, blockName, datName, space.shape,
+                                        SnapshotH5Type<Real>())};
+    hid_t fileSpace{H5Dget_space(dataset)};
+    hid_t memSpace{SelectSnapshotSpace(fileSpace, space)};
+    hid_t transfer{SnapshotTransfer()};
+    // A rank without nodes still writes collectively, selecting nothing
+    const Real none{0};
+    H5Dwrite(dataset, SnapshotH5Type<Real>(), memSpace, fileSpace, transfer,
+             values.empty() ? &none : values.data());
+    for (const auto& nameValues : attributes) {
+        WriteSnapshotAttribute(dataset, nameValues.first.c_str(),
+                               nameValues.second);
+    }
+    const double storedBytes{(double)H5Dget_storage_size(dataset)};
+    H5Pclose(transfer);
+    H5Sclose(memSpace);
+    H5Dclose(dataset);
+    H5Sclose(fileSpace);
+    if (scopedFile < 0) {
+        H5Fclose(file);
+    }
+    double rawBytes{(double)sizeof(Real)};
+    for (const hsize_t size : space.shape) {
+        rawBytes *= size;
+    }
+    AccountSnapshot(fieldName, rawBytes, storedBytes,
+                    SnapshotClock() - start, 0);
+}
+
+template <typename T>
+Real WriteSnapshot(const std::string& fileName, const std::string& blockName,
+                   const std::string& datName, const ops_dat dat,
+                   const std::string& fieldName,
+                   const std::vector<int>& blockSize, const int dim,
+                   const int haloDepth) {
+    if (snapshotSetting.compression != Snapshot_Plain ||
+        snapshotSetting.layout == Snapshot_SharedFile) {
+        return WriteSnapshotDat<T>(fileName, blockName, datName, dat,
+                                   fieldName, blockSize, dim, haloDepth);
+    }
+    const double start{SnapshotClock()};
+    ops_fetch_dat_hdf5_file(dat, fileName.c_str());
+    double bytes{(double)dim * sizeof(T)};
+    for (const int size : blockSize) {
+        bytes *= size + 2 * haloDepth;
+    }
+    AccountSnapshot(fieldName, bytes, bytes, SnapshotClock() - start, 0);
+    return 0;
+}
+
+bool HasSnapshotDat(const std::string& fileName, const std::string& blockName,
+                    const std::string& datName) {
+    if (!SnapshotFileExists(fileName)) {
+        return false;
+    }
+    hid_t file{H5Fopen(fileName.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT)};
+    if (file < 0) {
+        return false;
+    }
+    const std::string path{blockName + "/" + datName};
+    const bool exists{H5Lexists(file, blockName.c_str(), H5P_DEFAULT) > 0 &&
+                      H5Lexists(file, path.c_str(), H5P_DEFAULT) > 0};
+    H5Fclose(file);
+    return exists;
+}
+
+bool IsSnapshotDat(const std::string& fileName, const std::string& blockName,
+                   const std::string& datName) {
+    if (!SnapshotFileExists(fileName)) {
+        return false;
+    }
+    hid_t file{H5Fopen(fileName.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT)};
+    if (file < 0) {
+        return false;
+    }
+    bool snapshot{false};
+    const std::string path{blockName + "/" + datName};
+    if (H5Lexists(file, blockName.c_str(), H5P_DEFAULT) > 0 &&
+        H5Lexists(file, path.c_str(), H5P_DEFAULT) > 0) {
+        hid_t dataset{H5Dopen2(file, path.c_str(), H5P_DEFAULT)};
+        snapshot = H5Aexists(dataset, "HaloDepth") > 0;
+        H5Dclose(dataset);
+    }
+    H5Fclose(file);
+    return snapshot;
+}
+
+template <typename T>
+void ReadSnapshotDat(const std::string& fileName, const std::string& blockName,
+                     const std::string& datName, const ops_dat dat,
+                     const std::vector<int>& blockSize, const int dim,
+                     const int haloDepth) {
+    const SnapshotSpace space{
+        SnapshotSpaceOf(dat, blockSize, dim, haloDepth)};
+    hid_t fileAccess{SnapshotFileAccess()};
+    hid_t file{H5Fopen(fileName.c_str(), H5F_ACC_RDONLY, fileAccess)};
+    const std::string path{blockName + "/" + datName};
+    hid_t dataset{H5Dopen2(file, path.c_str(), H5P_DEFAULT)};
+    hid_t fileSpace{H5Dget_space(dataset)};
+    const int rank{H5Sget_simple_extent_ndims(fileSpace)};
+    std::vector<hsize_t> shape(std::max(rank, 0));
+    H5Sget_simple_extent_dims(fileSpace, shape.data(), nullptr);
+    if (shape != space.shape) {
+        ops_printf("Error! The shape of %s in %s does not match the field!\n",
+                   datName.c_str(), fileName.c_str());
+        assert(shape == space.shape);
+    }
+    hid_t memSpace{SelectSnapshotSpace(fileSpace, space)};
+    hid_t transfer{SnapshotTransfer()};
+    std::vector<T> values(std::max(space.localSize, (hsize_t)1));
+    if (H5Aexists(dataset, "Quantum") > 0) {
+        Real quantum{0};
+        hid_t attribute{H5Aopen(dataset, "Quantum", H5P_DEFAULT)};
+        H5Aread(attribute, SnapshotH5Type<Real>(), &quantum);
+        H5Aclose(attribute);
+        // The levels were kept in 64 bits before LevelBits was recorded
+        int levelBits{64};
+        if (H5Aexists(dataset, "LevelBits") > 0) {
+            attribute = H5Aopen(dataset, "LevelBits", H5P_DEFAULT);
+            H5Aread(attribute, H5T_NATIVE_INT, &levelBits);
+            H5Aclose(attribute);
+        }
+        std::vector<long long> levels(values.size());
+        if (levelBits == 16) {
+            ReadSnapshotLevels<short>(dataset, memSpace, fileSpace, transfer,
+                                      levelBits, levels);
+        } else if (levelBits == 32) {
+            ReadSnapshotLevels<int>(dataset, memSpace, fileSpace, transfer,
+                                    levelBits, levels);
+        } else {
+            ReadSnapshotLevels<long long>(dataset, memSpace, fileSpace,
+                                          transfer, levelBits, levels);
+        }
+        for (SizeType idx = 0; idx < values.size(); idx++) {
+            values[idx] = (T)(levels[idx] * quantum);
+        }
+    } else {
+        H5Dread(dataset, SnapshotH5Type<T>(), memSpace, fileSpace, transfer,
+                values.data());
+    }
+    H5Pclose(transfer);
+    H5Sclose(memSpace);
+    H5Sclose(fileSpace);
+    H5Dclose(dataset);
+    H5Fclose(file);
+    H5Pclose(fileAccess);
+    if (space.localSize > 0) {
+        ops_dat_set_data(dat, 0, (char*)values.data());
+    }
+}
+
+void ReportSnapshots() {
+    std::vector<std::pair<std::string, SnapshotRecord>>& records{
+        snapshotRecords};
+    if (records.empty()) {
+        return;
+    }
+    // The bytes are of the whole datasets, the slowest rank takes the time
+    std::vector<double> seconds;
+    for (const auto& nameRecord : records) {
+        seconds.push_back(nameRecord.second.seconds);
+    }
+#ifdef OPS_MPI
+    MPI_Allreduce(MPI_IN_PLACE, seconds.data(), (int)seconds.size(),
+                  MPI_DOUBLE, MPI_MAX, OPS_MPI_GLOBAL);
+#endif
+    const double mega{1024. * 1024.};
+    static const char* compressionNames[]{"plain", "deflate", "quantised"};
+    ops_printf("\nSnapshots written with the %s compression:\n",
+               compressionNames[snapshotSetting.compression]);
+    ops_printf("%-24s %8s %12s %12s %8s %12s %12s\n", "Field", "Writes",
+               "Raw(MB)", "Stored(MB)", "Ratio", "MB/s", "MaxError");
+    double rawTotal{0}, storedTotal{0}, secondsTotal{0};
+    for (SizeType idx = 0; idx < records.size(); idx++) {
+        const SnapshotRecord& record{records[idx].second};
+        ops_printf("%-24s %8zu %12.2f %12.2f %8.2f %12.2f %12.3e\n",
+                   records[idx].first.c_str(), record.writes,
+                   record.rawBytes / mega, record.storedBytes / mega,
+                   record.rawBytes / std::max(record.storedBytes, 1.),
+                   record.rawBytes / mega / std::max(seconds[idx], 1e-9),
+                   record.maxError);
+        rawTotal += record.rawBytes;
+        storedTotal += record.storedBytes;
+        secondsTotal += seconds[idx];
+    }
+    ops_printf("%-24s %8s %12.2f %12.2f %8.2f %12.2f\n", "Total", "",
+               rawTotal / mega, storedTotal / mega,
+               rawTotal / std::max(storedTotal, 1.),
+               rawTotal / mega / std::max(secondsTotal, 1e-9));
+}
+
+template Real WriteSnapshot<double>(const std::string& fileName,
+                                    const std::string& blockName,
+                                    const std::string& datName,
+                                    const ops_dat dat,
+                                    const std::string& fieldName,
+                                    const std::vector<int>& blockSize,
+                                    const int dim, const int haloDepth);
+template Real WriteSnapshot<float>(const std::string& fileName,
+                                   const std::string& blockName,
+                                   const std::string& datName,
+                                   const ops_dat dat,
+                                   const std::string& fieldName,
+                                   const std::vector<int>& blockSize,
+                                   const int dim, const int haloDepth);
+template Real WriteSnapshot<int>(const std::string& fileName,
+                                 const std::string& blockName,
+                                 const std::string& datName, const ops_dat dat,
+                                 const std::string& fieldName,
+                                 const std::vector<int>& blockSize,
+                                 const int dim, const int haloDepth);
+template Real WriteSnapshot<short>(const std::string& fileName,
+                                   const std::string& blockName,
+                                   const std::string& datName,
+                                   const ops_dat dat,
+                                   const std::string& fieldName,
+                                   const std::vector<int>& blockSize,
+                                   const int dim, const int haloDepth);
+template void ReadSnapshotDat<double>(const std::string& fileName,
+                                      const std::string& blockName,
+                                      const std::string& datName,
+                                      const ops_dat dat,
+                                      const std::vector<int>& blockSize,
+                                      const int dim, const int haloDepth);
+template void ReadSnapshotDat<float>(const std::string& fileName,
+                                     const std::string& blockName,
+                                     const std::string& datName,
+                                     const ops_dat dat,
+                                     const std::vector<int>& blockSize,
+                                     const int dim, const int haloDepth);
+template void ReadSnapshotDat<int>(const std::string& fileName,
+                                   const std::string& blockName,
+                                   const std::string& datName,
+                                   const ops_dat dat,
+                                   const std::vector<int>& blockSize,
+                                   const int dim, const int haloDepth);
+template void ReadSnapshotDat<short>(const std::string& fileName,
+                                     const std::string& blockName,
+                                     const std::string& datName,
+                                     const ops_dat dat,
+                                     const std::vector<int>& blockSize,
+                                     const int dim, const int haloDepth);
@@ -0,0 +1,184 @@
+/**
+ * Copyright 2019 United Kingdom Research and Innovation
+ *
+ * Authors: See AUTHORS
+ *
+ * Contact: [jianping.meng@stfc.ac.uk and/or jpmeng@gmail.com]
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * ANDANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*! @brief   Write the fields into chunked and compressed HDF5 datasets
+ * @author  Jianping Meng
+ * @details Snapshot_Plain keeps ops_fetch_dat_hdf5_file(). Snapshot_Deflate
+ * writes every dat as a chunked dataset with the shuffle and the deflate
+ * filters, which are lossless and suit restarts. Snapshot_Quantised does the
+ * same except that a real field given a tolerance, e.g., a macroscopic
+ * variable for visualisation, is first rounded to integer multiples of twice
+ * the tolerance so that the error of any value is within the tolerance.
+ * The datasets keep the layout of OPS, i.e., the halos are included and the
+ * components of a node are adjacent, in the group of the block, so that the
+ * existing readers still find them. A quantised dataset carries the quantum
+ * as the "Quantum" attribute and keeps the levels in the narrowest of the 16,
+ * 32 and 64-bit integers holding them, which the "LevelBits" attribute
+ * gives, and CreateFieldFromFile() reads both kinds back.
+ * With Snapshot_SharedFile, all the blocks and fields of a time step go into
+ * one file, CASENAME_T<step>.h5, which a SnapshotScope opens once for the
+ * checkpoint and all the ranks write collectively. Objects larger than a stripe of
+ * the parallel file system are aligned to the stripe and a chunk holds about
+ * one stripe. CreateFieldFromFile() prefers this file if it exists.
+ * The raw and the stored bytes and the time of every write are accumulated
+ * and ReportSnapshots() prints them at the end of Iterate().
+ */
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+#include <map>
+#include <string>
+#include <vector>
+#include "hdf5.h"
+#include "ops_lib_core.h"
+#include "type.h"
+
+enum SnapshotCompression {
+    Snapshot_Plain = 0,
+    Snapshot_Deflate = 1,
+    Snapshot_Quantised = 2,
+};
+
+enum SnapshotLayout {
+    Snapshot_FilePerBlock = 0,
+    Snapshot_SharedFile = 1,
+};
+
+/*!
+ * Choose how the fields are written, where deflateLevel is between 0 and 9
+ * and tolerances maps a field name, e.g., "rho", to its absolute error. The
+ * fields without a tolerance are always written losslessly.
+ */
+void DefineSnapshotCompression(
+    const SnapshotCompression compression, const int deflateLevel = 4,
+    const std::map<std::string, Real>& tolerances = {});
+/*!
+ * Choose between a file per block and time step, i.e., the files of OPS, and
+ * a file per time step shared by all the blocks, see Snapshot_SharedFile.
+ */
+void DefineSnapshotLayout(const SnapshotLayout layout,
+                          const SizeType stripeSize = 1 << 20);
+bool IsSnapshotFileShared();
+std::string SnapshotFileName(const std::string& caseName,
+                             const std::string& blockName,
+                             const SizeType timeStep);
+// The file to read a block from, where the shared file is preferred
+std::string SnapshotFileToRead(const std::string& caseName,
+                               const std::string& blockName,
+                               const SizeType timeStep);
+// Open fileName for writing by all the ranks, creating it if not existing
+hid_t OpenSnapshotFile(const std::string& fileName);
+/*!
+ * Keep the shared file of the checkpoint at timeStep open for all the fields
+ * written while the scope lives and close it when the scope ends, e.g.,
+ * before WriteXdmf(). A field written outside a scope opens and closes the
+ * file itself, and the scope does nothing for the files per block. The
+ * scope of a fileName keeps that file open whatever the layout, e.g., for
+ * the slices.
+ */
+class SnapshotScope {
+   public:
+    SnapshotScope(const std::string& caseName, const SizeType timeStep);
+    explicit SnapshotScope(const std::string& fileName);
+    ~SnapshotScope();
+    SnapshotScope(const SnapshotScope&) = delete;
+    SnapshotScope& operator=(const SnapshotScope&) = delete;
+
+   private:
+    hid_t file{-1};
+    void Open(const std::string& fileName);
+};
+/*!
+ * The shape of a dataset from the slowest axis, i.e., z, y and x times dim,
+ * and the part of this rank in it, which is localSize values from start.
+ */
+struct SnapshotSpace {
+    std::vector<hsize_t> shape;
+    std::vector<hsize_t> start;
+    std::vector<hsize_t> count;
+    hsize_t localSize{1};
+};
+template <typename T>
+hid_t SnapshotH5Type();
+template <>
+hid_t SnapshotH5Type<double>();
+template <>
+hid_t SnapshotH5Type<float>();
+template <>
+hid_t SnapshotH5Type<int>();
+template <>
+hid_t SnapshotH5Type<short>();
+// The transfer of a dataset, which is collective under MPI
+hid_t SnapshotTransfer();
+/*!
+ * Write dat into fileName by the chosen compression, see
+ * DefineSnapshotCompression(), into the group of its block, replacing an
+ * existing one of the same name. It returns the quantum of the dataset, which
+ * is zero if the values are kept as they are.
+ */
+template <typename T>
+Real WriteSnapshot(const std::string& fileName, const std::string& blockName,
+                   const std::string& datName, const ops_dat dat,
+                   const std::string& fieldName,
+                   const std::vector<int>& blockSize, const int dim,
+                   const int haloDepth);
+/*!
+ * Write the values of this rank in space as datName in the group of blockName
+ * together with the integer attributes, chunked and compressed losslessly as
+ * the snapshots unless Snapshot_Plain, replacing an existing one of the same
+ * name. The write is accounted under fieldName, see ReportSnapshots().
+ */
+void WriteSnapshotSlab(
+    const std::string& fileName, const std::string& blockName,
+    const std::string& datName, const std::string& fieldName,
+    const SnapshotSpace& space, const std::vector<Real>& values,
+    const std::map<std::string, std::vector<int>>& attributes = {});
+// If a dat has been written into the file whichever way
+bool HasSnapshotDat(const std::string& fileName, const std::string& blockName,
+                    const std::string& datName);
+// If the dataset of a dat is written by WriteSnapshot() in the compressed or
+// the shared way, which OPS cannot read
+bool IsSnapshotDat(const std::string& fileName, const std::string& blockName,
+                   const std::string& datName);
+/*!
+ * Read the dataset written by WriteSnapshot() into dat, which has been
+ * created with the same dimension and halo depth.
+ */
+template <typename T>
+void ReadSnapshotDat(const std::string& fileName, const std::string& blockName,
+                     const std::string& datName, const ops_dat dat,
+                     const std::vector<int>& blockSize, const int dim,
+                     const int haloDepth);
+// Print the bytes, the ratio and the rate of the snapshots of each field
+void ReportSnapshots();
+#endif  // SNAPSHOT_H
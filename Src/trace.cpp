@@ -0,0 +1,200 @@
+/**
+ * Copyright 2019 United Kingdom Research and Innovation
+ *
+ * Authors: See AUTHORS
+ *
+ * Contact: [jianping.meng@stfc.ac.uk and/or jpmeng@gmail.com]
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * ANDANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*! @brief   Record a timeline of kernels, halos, reductions and I/O
+ * @author  Jianping Meng
+ * @details The ring buffers of the threads and the writer of the Chrome
+ * trace-event file, see trace.h.
+ */
+#include "trace.h"
+#ifdef TRACE
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "ops_lib_core.h"
+#ifdef OPS_MPI
+#include "ops_mpi_core.h"
+#endif
+
+struct TraceEvent {
+    const char* name;
+    TraceCategory category;
+    double start;
+    double duration;
+};
+
+class TraceBuffer {
+   public:
+    TraceBuffer(const int thread, const size_t capacity)
+        : events(capacity), thread{thread} {}
+    void Record(const char* name, const TraceCategory category,
+                const double start, const double duration) {
+        events[next] = TraceEvent{name, category, start, duration};
+        next = (next + 1) % events.size();
+        recorded++;
+    }
+    int Thread() const { return thread; }
+    size_t Dropped() const {
+        return recorded > events.size() ? recorded - events.size() : 0;
+    }
+    // Events from the oldest to the newest
+    std::vector<TraceEvent> Events() const {
+        if (recorded <= events.size()) {
+            return std::vector<TraceEvent>(events.begin(),
+                                           events.begin() + recorded);
+        }
+        std::vector<TraceEvent> ordered(events.begin() + next, events.end());
+        ordered.insert(ordered.end(), events.begin(), events.begin() + next);
+        return ordered;
+    }
+
+   private:
+    std::vector<TraceEvent> events;
+    size_t next{0};
+    size_t recorded{0};
+    int thread;
+};
+
+// The number of events kept by each thread
+size_t traceCapacity{1 << 16};
+std::mutex traceMutex;
+std::vector<std::unique_ptr<TraceBuffer>> traceBuffers;
+
+// The buffer of the calling thread, which is registered on its first use
+TraceBuffer& ThreadTraceBuffer() {
+    thread_local TraceBuffer* buffer{nullptr};
+    if (buffer == nullptr) {
+        std::lock_guard<std::mutex> lock(traceMutex);
+        const int thread{(int)traceBuffers.size()};
+        traceBuffers.emplace_back(new TraceBuffer(thread, traceCapacity));
+        buffer = traceBuffers.back().get();
+    }
+    return *buffer;
+}
+
+// Microseconds of a monotonic clock shared by the ranks on a host
+double TraceClock() {
+    return std::chrono::duration<double, std::micro>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+TraceScope::TraceScope(const char* name, const TraceCategory category)
+    : name{name}, category{category}, start{TraceClock()} {}
+
+TraceScope::~TraceScope() {
+    ThreadTraceBuffer().Record(name, category, start, TraceClock() - start);
+}
+
+const char* TraceCategoryName(const TraceCategory category) {
+    static const char* categoryNames[]{"kernel", "halo", "reduction", "io"};
+    return categoryNames[category];
+}
+
+// The events of this rank as a part of the traceEvents array
+std::string TraceEventsOfRank(const int rank) {
+    std::string events;
+    char event[512];
+    std::snprintf(event, sizeof(event),
+                  "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,"
+                  "\"args\":{\"name\":\"Rank %d\"}},\n",
+                  rank, rank);
+    events += event;
+    std::lock_guard<std::mutex> lock(traceMutex);
+    for (const auto& buffer : traceBuffers) {
+        for (const TraceEvent& traceEvent : buffer->Events()) {
+            std::snprintf(event, sizeof(event),
+                          "{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\","
+                          "\"pid\":%d,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f},\n",
+                          traceEvent.name,
+                          TraceCategoryName(traceEvent.category), rank,
+                          buffer->Thread(), traceEvent.start,
+                          traceEvent.duration);
+            events += event;
+        }
+        if (buffer->Dropped() > 0) {
+            ops_printf(
+                "Warning! Rank %d thread %d dropped %zu oldest trace events, "
+                "enlarge traceCapacity to keep them.\n",
+                rank, buffer->Thread(), buffer->Dropped());
+        }
+    }
+    return events;
+}
+
+void WriteTrace(const std::string& fileName) {
+    int rank{0};
+#ifdef OPS_MPI
+    rank = ops_my_global_rank;
+#endif
+    std::string events{TraceEventsOfRank(rank)};
+#ifdef OPS_MPI
+    int rankNum{1};
+    MPI_Comm_size(OPS_MPI_GLOBAL, &rankNum);
+    int length{(int)events.size()};
+    std::vector<int> lengths(rankNum, 0);
+    MPI_Gather(&length, 1, MPI_INT, lengths.data(), 1, MPI_INT, 0,
+               OPS_MPI_GLOBAL);
+    std::vector<int> displacements(rankNum, 0);
+    for (int rankIdx = 1; rankIdx < rankNum; rankIdx++) {
+        displacements[rankIdx] =
+            displacements[rankIdx - 1] + lengths[rankIdx - 1];
+    }
+    std::string allEvents(
+        rank == 0 ? displacements[rankNum - 1] + lengths[rankNum - 1] : 0,
+        ' ');
+    MPI_Gatherv(&events[0], length, MPI_CHAR, &allEvents[0], lengths.data(),
+                displacements.data(), MPI_CHAR, 0, OPS_MPI_GLOBAL);
+    events.swap(allEvents);
+#endif
+    if (rank != 0) {
+        return;
+    }
+    // Drop the separator after the last event
+    events.erase(events.find_last_of(','));
+    FILE* traceFile{std::fopen(fileName.c_str(), "w")};
+    if (traceFile == nullptr) {
+        ops_printf("Error! Cannot open %s for writing the trace!\n",
+                   fileName.c_str());
+        return;
+    }
+    std::fprintf(traceFile,
+                 "{\"traceEvents\":[\n%s\n],\"displayTimeUnit\":\"ms\"}\n",
+                 events.c_str());
+    std::fclose(traceFile);
+    ops_printf("The trace is written into %s\n", fileName.c_str());
+}
+#else
+void WriteTrace(const std::string& fileName) {}
+#endif  // TRACE
@@ -0,0 +1,78 @@
+/**
+ * Copyright 2019 United Kingdom Research and Innovation
+ *
+ * Authors: See AUTHORS
+ *
+ * Contact: [jianping.meng@stfc.ac.uk and/or jpmeng@gmail.com]
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * ANDANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*! @brief   Record a timeline of kernels, halos, reductions and I/O
+ * @author  Jianping Meng
+ * @details When TRACE is defined, the begin and the duration of every kernel
+ * hooked by a KernelScope (roofline.h, development mode only), halo transfer,
+ * reduction and HDF5 write are recorded by a TraceScope. Each thread records
+ * into its own ring buffer so that no locking is needed while running. If a
+ * buffer is full, the oldest events are overwritten. At the end of Iterate(),
+ * the events of all ranks and threads are gathered to the root rank and
+ * written as a Chrome trace-event JSON file, which can be opened by
+ * chrome://tracing or https://ui.perfetto.dev, where each rank is shown as a
+ * process.
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+#include <string>
+enum TraceCategory {
+    Trace_Kernel = 0,
+    Trace_Halo = 1,
+    Trace_Reduction = 2,
+    Trace_IO = 3,
+};
+#ifdef TRACE
+// The name must be a string literal as only the pointer is kept.
+class TraceScope {
+   public:
+    TraceScope(const char* name, const TraceCategory category);
+    ~TraceScope();
+
+   private:
+    const char* name;
+    TraceCategory category;
+    double start;
+};
+#else
+class TraceScope {
+   public:
+    TraceScope(const char* name, const TraceCategory category) {}
+};
+#endif  // TRACE
+/*!
+ * Gather the events of all ranks to the root rank and write them into
+ * fileName as a Chrome trace-event JSON file.
+ */
+void WriteTrace(const std::string& fileName);
+#endif  // TRACE_H
@@ -0,0 +1,307 @@
+/**
+ * Copyright 2019 United Kingdom Research and Innovation
+ *
+ * Authors: See AUTHORS
+ *
+ * Contact: [jianping.meng@stfc.ac.uk and/or jpmeng@gmail.com]
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * ANDANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*! @brief   Describe the HDF5 snapshots by XDMF for visualisation in place
+ * @author  Jianping Meng
+ * @details The records of the datasets of a snapshot and the writer of the
+ * XDMF files, see xdmf.h.
+ */
+#include "xdmf.h"
+#include <cassert>
+#include <cstdio>
+#include <map>
+#include <type_traits>
+#include <vector>
+#include "ops_lib_core.h"
+#ifdef OPS_MPI
+#include "ops_mpi_core.h"
+#endif
+
+struct XdmfDat {
+    std::string fieldName;
+    std::string fileName;
+    std::string path;
+    int dim{1};
+    int haloDepth{1};
+    // "Float" or "Int" and the bytes of a value in the file
+    std::string numberType;
+    int precision{8};
+    Real quantum{0};
+};
+
+struct XdmfBlock {
+    std::string name;
+    std::vector<int> size;
+    bool uniform{true};
+    std::vector<Real> grid;
+    std::vector<XdmfDat> dats;
+};
+
+bool XDMFSIDECAR{true};
+// The datasets of the snapshot being written, by the block ID
+std::map<int, XdmfBlock> xdmfBlocks;
+// The time and the description file of the snapshots of this run
+std::vector<std::pair<Real, std::string>> xdmfSeries;
+
+void DefineXdmfSidecar(const bool sidecar) { XDMFSIDECAR = sidecar; }
+
+template <typename T>
+void AddXdmfDat(const Block& block, const std::string& fileName,
+                const std::string& datName, const std::string& fieldName,
+                const int dim, const int haloDepth, const Real quantum) {
+    if (!XDMFSIDECAR) {
+        return;
+    }
+    std::map<int, XdmfBlock>& blocks{xdmfBlocks};
+    if (blocks.find(block.ID()) == blocks.end()) {
+        const int spaceDim{(int)block.Size().size()};
+        XdmfBlock xdmfBlock;
+        xdmfBlock.name = block.Name();
+        xdmfBlock.size = block.Size();
+        xdmfBlock.uniform = block.IsUniform();
+        xdmfBlock.grid.assign(block.Grid(), block.Grid() + 2 * spaceDim);
+        blocks.emplace(block.ID(), xdmfBlock);
+    }
+    XdmfDat dat;
+    dat.fieldName = fieldName;
+    dat.fileName = fileName;
+    dat.path = block.Name() + "/" + datName;
+    dat.dim = dim;
+    dat.haloDepth = haloDepth;
+    // A quantised dataset holds 64-bit integers, see WriteSnapshotDat()
+    const bool real{quantum == 0 && std::is_floating_point<T>::value};
+    dat.numberType = real ? "Float" : "Int";
+    dat.precision = quantum > 0 ? 8 : sizeof(T);
+    dat.quantum = quantum;
+    blocks.at(block.ID()).dats.push_back(dat);
+}
+
+// The sizes from the slowest axis, i.e., z, y and x, as XDMF expects
+std::string XdmfDimensions(const std::vector<int>& size, const int extra = 0,
+                           const int last = 1) {
+    std::string dimensions;
+    for (int axis = (int)size.size() - 1; axis >= 0; axis--) {
+        dimensions += std::to_string(size.at(axis) + extra) +
+                      (axis > 0 ? " " : "");
+    }
+    if (last > 1) {
+        dimensions += " " + std::to_string(last);
+    }
+    return dimensions;
+}
+
+// The interior of a dataset of OPS, where the components are along x
+void WriteXdmfDataItem(FILE* file, const XdmfBlock& block, const XdmfDat& dat,
+                       const std::string& indent) {
+    const int spaceDim{(int)block.size.size()};
+    const std::string interior{XdmfDimensions(block.size, 0, dat.dim)};
+    std::vector<int> whole(block.size);
+    whole.at(0) = (whole.at(0) + 2 * dat.haloDepth) * dat.dim;
+    for (int axis = 1; axis < spaceDim; axis++) {
+        whole.at(axis) += 2 * dat.haloDepth;
+    }
+    std::string start, stride, count;
+    for (int axis = spaceDim - 1; axis >= 0; axis--) {
+        const int factor{axis == 0 ? dat.dim : 1};
+        start += " " + std::to_string(dat.haloDepth * factor);
+        stride += " 1";
+        count += " " + std::to_string(block.size.at(axis) * factor);
+    }
+    std::string inner{indent};
+    if (dat.quantum > 0) {
+        std::fprintf(file,
+                     "%s<DataItem ItemType=\"Function\" Function=\"%.17g * "
+                     "$0\" Dimensions=\"%s\">\n",
+                     indent.c_str(), dat.quantum, interior.c_str());
+        inner += "  ";
+    }
+    std::fprintf(file,
+                 "%s<DataItem ItemType=\"HyperSlab\" Dimensions=\"%s\" "
+                 "Type=\"HyperSlab\">\n",
+                 inner.c_str(), interior.c_str());
+    std::fprintf(file,
+                 "%s  <DataItem Dimensions=\"3 %i\" Format=\"XML\">%s %s "
+                 "%s</DataItem>\n",
+                 inner.c_str(), spaceDim, start.c_str() + 1,
+                 stride.c_str() + 1, count.c_str() + 1);
+    std::fprintf(file,
+                 "%s  <DataItem Dimensions=\"%s\" NumberType=\"%s\" "
+                 "Precision=\"%i\" Format=\"HDF\">%s:/%s</DataItem>\n",
+                 inner.c_str(), XdmfDimensions(whole).c_str(),
+                 dat.numberType.c_str(), dat.precision, dat.fileName.c_str(),
+                 dat.path.c_str());
+    std::fprintf(file, "%s</DataItem>\n", inner.c_str());
+    if (dat.quantum > 0) {
+        std::fprintf(file, "%s</DataItem>\n", indent.c_str());
+    }
+}
+
+void WriteXdmfGrid(FILE* file, const XdmfBlock& block) {
+    const int spaceDim{(int)block.size.size()};
+    const std::string nodes{XdmfDimensions(block.size)};
+    std::fprintf(file, "      <Grid Name=\"%s\" GridType=\"Uniform\">\n",
+                 block.name.c_str());
+    const XdmfDat* coordinates{nullptr};
+    for (const XdmfDat& dat : block.dats) {
+        if (dat.fieldName == "CoordinateXYZ") {
+            coordinates = &dat;
+        }
+    }
+    if (block.uniform || coordinates == nullptr) {
+        std::string origin, spacing;
+        for (int axis = spaceDim - 1; axis >= 0; axis--) {
+            char value[32];
+            std::snprintf(value, sizeof(value), " %.17g",
+                          block.grid.at(2 * axis));
+            origin += value;
+            std::snprintf(value, sizeof(value), " %.17g",
+                          block.grid.at(2 * axis + 1));
+            spacing += value;
+        }
+        std::fprintf(file,
+                     "        <Topology TopologyType=\"%iDCoRectMesh\" "
+                     "Dimensions=\"%s\"/>\n",
+                     spaceDim, nodes.c_str());
+        std::fprintf(file, "        <Geometry GeometryType=\"%s\">\n",
+                     spaceDim == 3 ? "ORIGIN_DXDYDZ" : "ORIGIN_DXDY");
+        for (const std::string& values : {origin, spacing}) {
+            std::fprintf(file,
+                         "          <DataItem Dimensions=\"%i\" "
+                         "NumberType=\"Float\" Precision=\"8\" "
+                         "Format=\"XML\">%s</DataItem>\n",
+                         spaceDim, values.c_str() + 1);
+        }
+    } else {
+        std::fprintf(file,
+                     "        <Topology TopologyType=\"%iDSMesh\" "
+                     "Dimensions=\"%s\"/>\n",
+                     spaceDim, nodes.c_str());
+        std::fprintf(file, "        <Geometry GeometryType=\"%s\">\n",
+                     spaceDim == 3 ? "XYZ" : "XY");
+        WriteXdmfDataItem(file, block, *coordinates, "          ");
+    }
+    std::fprintf(file, "        </Geometry>\n");
+    for (const XdmfDat& dat : block.dats) {
+        if (&dat == coordinates) {
+            continue;
+        }
+        const char* type{dat.dim == 1 ? "Scalar"
+                                      : (dat.dim == 3 ? "Vector" : "Matrix")};
+        std::fprintf(file,
+                     "        <Attribute Name=\"%s\" AttributeType=\"%s\" "
+                     "Center=\"Node\">\n",
+                     dat.fieldName.c_str(), type);
+        WriteXdmfDataItem(file, block, dat, "          ");
+        std::fprintf(file, "        </Attribute>\n");
+    }
+    std::fprintf(file, "      </Grid>\n");
+}
+
+void WriteXdmf(const std::string& caseName, const SizeType timeStep,
+               const Real time) {
+    std::map<int, XdmfBlock>& blocks{xdmfBlocks};
+    if (blocks.empty()) {
+        return;
+    }
+    int rank{0};
+#ifdef OPS_MPI
+    rank = ops_my_global_rank;
+#endif
+    const std::string fileName{caseName + "_T" + std::to_string(timeStep) +
+                               ".xmf"};
+    xdmfSeries.emplace_back(time, fileName);
+    if (rank == 0) {
+        FILE* file{std::fopen(fileName.c_str(), "w")};
+        if (file == nullptr) {
+            ops_printf("Error! Cannot open %s for writing!\n",
+                       fileName.c_str());
+            assert(file != nullptr);
+        }
+        std::fprintf(file, "<?xml version=\"1.0\" ?>\n");
+        std::fprintf(file, "<Xdmf Version=\"2.0\">\n  <Domain>\n");
+        std::fprintf(file,
+                     "    <Grid Name=\"T%llu\" GridType=\"Collection\" "
+                     "CollectionType=\"Spatial\">\n",
+                     (unsigned long long)timeStep);
+        std::fprintf(file, "      <Time Value=\"%.17g\"/>\n", time);
+        for (const auto& idBlock : blocks) {
+            WriteXdmfGrid(file, idBlock.second);
+        }
+        std::fprintf(file, "    </Grid>\n  </Domain>\n</Xdmf>\n");
+        std::fclose(file);
+        const std::string seriesName{caseName + ".xmf"};
+        FILE* series{std::fopen(seriesName.c_str(), "w")};
+        if (series == nullptr) {
+            ops_printf("Error! Cannot open %s for writing!\n",
+                       seriesName.c_str());
+            assert(series != nullptr);
+        }
+        std::fprintf(series, "<?xml version=\"1.0\" ?>\n");
+        std::fprintf(series,
+                     "<Xdmf Version=\"2.0\" "
+                     "xmlns:xi=\"http://www.w3.org/2001/XInclude\">\n");
+        std::fprintf(series,
+                     "  <Domain>\n    <Grid Name=\"%s\" "
+                     "GridType=\"Collection\" CollectionType=\"Temporal\">\n",
+                     caseName.c_str());
+        for (const auto& timeFile : xdmfSeries) {
+            std::fprintf(series,
+                         "      <xi:include href=\"%s\" "
+                         "xpointer=\"xpointer(//Xdmf/Domain/Grid)\"/>\n",
+                         timeFile.second.c_str());
+        }
+        std::fprintf(series, "    </Grid>\n  </Domain>\n</Xdmf>\n");
+        std::fclose(series);
+    }
+    blocks.clear();
+}
+
+template void AddXdmfDat<double>(const Block& block,
+                                 const std::string& fileName,
+                                 const std::string& datName,
+                                 const std::string& fieldName, const int dim,
+                                 const int haloDepth, const Real quantum);
+template void AddXdmfDat<float>(const Block& block,
+                                const std::string& fileName,
+                                const std::string& datName,
+                                const std::string& fieldName, const int dim,
+                                const int haloDepth, const Real quantum);
+template void AddXdmfDat<int>(const Block& block, const std::string& fileName,
+                              const std::string& datName,
+                              const std::string& fieldName, const int dim,
+                              const int haloDepth, const Real quantum);
+template void AddXdmfDat<short>(const Block& block,
+                                const std::string& fileName,
+                                const std::string& datName,
+                                const std::string& fieldName, const int dim,
+                                const int haloDepth, const Real quantum);
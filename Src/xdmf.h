@@ -0,0 +1,72 @@
+/**
+ * Copyright 2019 United Kingdom Research and Innovation
+ *
+ * Authors: See AUTHORS
+ *
+ * Contact: [jianping.meng@stfc.ac.uk and/or jpmeng@gmail.com]
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * ANDANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*! @brief   Describe the HDF5 snapshots by XDMF for visualisation in place
+ * @author  Jianping Meng
+ * @details Every dataset written by Field::WriteToHDF5() is recorded together
+ * with the grid of its block. WriteXdmf() then writes CASENAME_T<step>.xmf,
+ * which holds a spatial collection of the blocks at the time of the step.
+ * Each field is a hyperslab of its dataset without the halos, and a
+ * quantised dataset is scaled back by its quantum. A uniform block is a
+ * co-rectilinear mesh given by its start position and mesh size, and a
+ * stretched block is a curvilinear mesh given by CoordinateXYZ.
+ * CASENAME.xmf collects the snapshots of a run as a time series by XInclude,
+ * so that e.g. ParaView reads the output directly without PostProcess.py.
+ */
+
+#ifndef XDMF_H
+#define XDMF_H
+#include <string>
+#include "type.h"
+#include "block.h"
+
+/*!
+ * Switch the XDMF description of the snapshots on or off, which is on by
+ * default as it is only a small text file for each snapshot.
+ */
+void DefineXdmfSidecar(const bool sidecar);
+/*!
+ * Record the dataset datName of a field of type T written into fileName,
+ * where quantum is that of a quantised dataset or zero, see WriteSnapshot().
+ */
+template <typename T>
+void AddXdmfDat(const Block& block, const std::string& fileName,
+                const std::string& datName, const std::string& fieldName,
+                const int dim, const int haloDepth, const Real quantum);
+/*!
+ * Describe the datasets written since the last call as the snapshot of
+ * timeStep at time, and update the time series of the run.
+ */
+void WriteXdmf(const std::string& caseName, const SizeType timeStep,
+               const Real time);
+#endif  // XDMF_H
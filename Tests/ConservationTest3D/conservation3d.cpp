@@ -46,8 +46,8 @@ std::uniform_real_distribution<> range(0.001,0.01);
 #include "conservation3d_kernel.inc"
 // Provide macroscopic initial conditions
 void SetInitialMacrosVars() {
-    for (auto idBlock : g_Block()) {
-        Block& block{idBlock.second};
+    for (const auto& idBlock : g_Block()) {
+        const Block& block{idBlock.second};
         std::vector<int> iterRng;
         iterRng.assign(block.WholeRange().begin(), block.WholeRange().end());
         const int blockIdx{block.ID()};
@@ -64,8 +64,8 @@ void SetInitialMacrosVars() {
                                      1, LOCALSTENCIL, "Real", OPS_RW),
                          ops_arg_dat(g_MacroVars().at(compo.wId).at(blockIdx),
                                      1, LOCALSTENCIL, "Real", OPS_RW),
-                         ops_arg_dat(g_CoordinateXYZ()[blockIdx], SpaceDim(),
-                                     LOCALSTENCIL, "Real", OPS_READ),
+                         ops_arg_gbl(block.Grid(), block.GridSize(), "Real",
+                                     OPS_READ),
                          ops_arg_idx());
         }
     }
@@ -116,4 +116,6 @@ int main(int argc, const char** argv) {
     // Print OPS performance details to output stream
     ops_timing_output(std::cout);
     ops_exit();
+    // The fields moved into the arena are not freed by OPS
+    ReleaseFieldArena();
 }
\ No newline at end of file
@@ -0,0 +1,860 @@
+/**
+ * Copyright 2019 United Kingdom Research and Innovation
+ *
+ * Authors: See AUTHORS
+ *
+ * Contact: [jianping.meng@stfc.ac.uk and/or jpmeng@gmail.com]
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * ANDANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @brief Regression checks of the optimised 3D paths against their reference
+ *  @details A decaying shear wave in a periodic box is run by one call and
+ *  the fields are dumped into a binary file, which a compare call checks
+ *  against the dump of the reference path. The call is given on the command
+ *  line as key=value pairs:
+ *  case=run components=1|2 fusion=on|off storage=double|compressed16
+ *  scheme=stream|moment|swap tau=0.05 macrovars=separate|interleaved
+ *  fields=populations|macrovars|statistics|probes|probepoints|slices|slicenodes
+ *  box=periodic|cavity|channel boundary=batched|surface shift=0
+ *  periodic=halos|copy flow=wave|rest
+ *  tiling=none|morton|hilbert tile=5
+ *  statistics=0 checkpoint=0 restart=0 squeeze=0 steps=20 output=run.bin
+ *  compression=plain|deflate|quantised snapshot=perblock|shared
+ *  casename=Regression3D
+ *  case=compare first=a.bin second=b.bin tolerance=0
+ *  where the fused multi-component kernels are compared with the per-component
+ *  ones exactly, the macroscopic variables interleaved per component with the
+ *  separate ones exactly, the 16-bit populations with the double ones and the
+ *  macroscopic variables of the moment scheme with those of the populations
+ *  within a tolerance. The cavity box is closed by walls, the top one moving,
+ *  so that the batched boundary loops are compared with the boundary conditions
+ *  treated surface by surface exactly under either scheme, and the plans
+ *  traversed in tiles of tile x tile nodes with the untiled ones exactly, where
+ *  the default tile does not divide the block. The channel box is periodic
+ *  along x and z between walls at the bottom and top. Its initial condition can
+ *  be shifted by shift nodes along x, which the dump shifts back, so that the
+ *  periodic halos are checked to give the period of the block size and to treat
+ *  the edges shared with the walls like the rest of the walls, i.e., the
+ *  shifted run must give the same dump exactly. The periodic surfaces are
+ *  served by the halos unless they are copied from the images after the stream
+ *  step, the default of the library, where a fluid at rest in the channel must
+ *  stay at rest with either. A run collects the running statistics every
+ *  statistics steps, writes a checkpoint at the step checkpoint and starts from
+ *  the checkpoint of the step restart, so that the statistics of a run
+ *  restarted midway are compared with those of a straight one exactly. The
+ *  checkpoints may be compressed losslessly, so that a run restarted from them
+ *  must carry on exactly, or quantised with the tolerance of 2^-20 given to the
+ *  populations, which a run restarted at its last step must give back within,
+ *  and written into one file shared by the blocks and fields of the step, which
+ *  a run restarted from it must carry on from exactly as well. A case name of
+ *  its own keeps the checkpoints of a test apart. After the collision squeeze,
+ *  the deviation last fetched for the 16-bit populations is cut a thousandfold,
+ *  so that the collisions up to the next fetch saturate, which is repaired for
+ *  the collision of the fetch and warned about for the earlier ones. The probes
+ *  sampled by SampleProbes() into their files are compared with the macroscopic
+ *  variables interpolated at the same points by the test itself, i.e., the
+ *  probepoints, to the digits written. The slices written by WriteSlices() are
+ *  read back with their Start and Stride attributes and compared with the nodes
+ *  picked from the whole fields by the test itself, i.e., the slicenodes,
+ *  exactly, where the plane is expected at the node nearest to its position.
+ *  The tests are registered in CMakeLists.txt.
+ **/
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "mplb.h"
+#include "ops_seq_v2.h"
+#include "regression3d_kernel.inc"
+
+struct RegressionCase {
+    std::string name{"run"};
+    int compoNum{2};
+    bool fusion{true};
+    PopulationStorage storage{Population_Double};
+    SchemeType scheme{Scheme_StreamCollision};
+    bool macroVars{false};
+    MacroVarsLayout macroVarsLayout{MacroVars_Separate};
+    bool statistics{false};
+    bool probes{false};
+    bool probePoints{false};
+    bool slices{false};
+    bool sliceNodes{false};
+    bool cavity{false};
+    bool channel{false};
+    bool boundaryBatching{true};
+    bool periodicHalos{true};
+    bool rest{false};
+    int shift{0};
+    TileOrder tiling{Tile_None};
+    int tileSize{5};
+    Real tau{0.05};
+    SizeType statisticsPeriod{0};
+    SizeType checkpoint{0};
+    SizeType restart{0};
+    SizeType squeeze{0};
+    SizeType steps{20};
+    std::string output{"run.bin"};
+    SnapshotCompression compression{Snapshot_Plain};
+    SnapshotLayout snapshotLayout{Snapshot_FilePerBlock};
+    std::string caseName{"Regression3D"};
+    std::string first;
+    std::string second;
+    Real tolerance{0};
+};
+
+std::string ArgFromCmd(const int argc, const char** argv,
+                       const std::string& key, const std::string& fallback) {
+    const std::string prefix{key + "="};
+    for (int i = 1; i < argc; i++) {
+        if (std::strncmp(argv[i], prefix.c_str(), prefix.size()) == 0) {
+            return std::string(argv[i] + prefix.size());
+        }
+    }
+    return fallback;
+}
+
+RegressionCase ReadRegressionCase(const int argc, const char** argv) {
+    RegressionCase regressionCase;
+    regressionCase.name = ArgFromCmd(argc, argv, "case", regressionCase.name);
+    regressionCase.compoNum =
+        std::atoi(ArgFromCmd(argc, argv, "components", "2").c_str());
+    regressionCase.fusion = ArgFromCmd(argc, argv, "fusion", "on") == "on";
+    const std::string storage{ArgFromCmd(argc, argv, "storage", "double")};
+    if (storage != "double" && storage != "compressed16") {
+        ops_printf("Error! Unknown storage %s, use double or compressed16!\n",
+                   storage.c_str());
+        exit(EXIT_FAILURE);
+    }
+    regressionCase.storage = storage == "compressed16"
+                                 ? Population_Compressed16
+                                 : Population_Double;
+    const std::string scheme{ArgFromCmd(argc, argv, "scheme", "stream")};
+    if (scheme != "stream" && scheme != "moment" && scheme != "swap") {
+        ops_printf("Error! Unknown scheme %s, use stream, moment or swap!\n",
+                   scheme.c_str());
+        exit(EXIT_FAILURE);
+    }
+    regressionCase.scheme = scheme == "moment" ? Scheme_StreamCollision_Moment
+                            : scheme == "swap" ? Scheme_StreamCollision_Swap
+                                               : Scheme_StreamCollision;
+    const std::string fields{
+        ArgFromCmd(argc, argv, "fields", "populations")};
+    if (fields != "populations" && fields != "macrovars" &&
+        fields != "statistics" && fields != "probes" &&
+        fields != "probepoints" && fields != "slices" &&
+        fields != "slicenodes") {
+        ops_printf(
+            "Error! Unknown fields %s, use populations, macrovars, "
+            "statistics, probes, probepoints, slices or slicenodes!\n",
+            fields.c_str());
+        exit(EXIT_FAILURE);
+    }
+    regressionCase.macroVars = fields == "macrovars";
+    const std::string layout{
+        ArgFromCmd(argc, argv, "macrovars", "separate")};
+    if (layout != "separate" && layout != "interleaved") {
+        ops_printf(
+            "Error! Unknown macrovars %s, use separate or interleaved!\n",
+            layout.c_str());
+        exit(EXIT_FAILURE);
+    }
+    regressionCase.macroVarsLayout = layout == "interleaved"
+                                         ? MacroVars_Interleaved
+                                         : MacroVars_Separate;
+    regressionCase.statistics = fields == "statistics";
+    regressionCase.probes = fields == "probes";
+    regressionCase.probePoints = fields == "probepoints";
+    regressionCase.slices = fields == "slices";
+    regressionCase.sliceNodes = fields == "slicenodes";
+    const std::string box{ArgFromCmd(argc, argv, "box", "periodic")};
+    if (box != "periodic" && box != "cavity" && box != "channel") {
+        ops_printf("Error! Unknown box %s, use periodic, cavity or channel!\n",
+                   box.c_str());
+        exit(EXIT_FAILURE);
+    }
+    regressionCase.cavity = box == "cavity";
+    regressionCase.channel = box == "channel";
+    regressionCase.shift =
+        std::atoi(ArgFromCmd(argc, argv, "shift", "0").c_str());
+    if (regressionCase.shift < 0) {
+        ops_printf("Error! The shift must not be negative!\n");
+        exit(EXIT_FAILURE);
+    }
+    const std::string boundary{ArgFromCmd(argc, argv, "boundary", "batched")};
+    if (boundary != "batched" && boundary != "surface") {
+        ops_printf("Error! Unknown boundary %s, use batched or surface!\n",
+                   boundary.c_str());
+        exit(EXIT_FAILURE);
+    }
+    regressionCase.boundaryBatching = boundary == "batched";
+    const std::string periodic{ArgFromCmd(argc, argv, "periodic", "halos")};
+    if (periodic != "halos" && periodic != "copy") {
+        ops_printf("Error! Unknown periodic %s, use halos or copy!\n",
+                   periodic.c_str());
+        exit(EXIT_FAILURE);
+    }
+    regressionCase.periodicHalos = periodic == "halos";
+    const std::string flow{ArgFromCmd(argc, argv, "flow", "wave")};
+    if (flow != "wave" && flow != "rest") {
+        ops_printf("Error! Unknown flow %s, use wave or rest!\n",
+                   flow.c_str());
+        exit(EXIT_FAILURE);
+    }
+    regressionCase.rest = flow == "rest";
+    const std::string tiling{ArgFromCmd(argc, argv, "tiling", "none")};
+    if (tiling != "none" && tiling != "morton" && tiling != "hilbert") {
+        ops_printf("Error! Unknown tiling %s, use none, morton or hilbert!\n",
+                   tiling.c_str());
+        exit(EXIT_FAILURE);
+    }
+    regressionCase.tiling = tiling == "morton"    ? Tile_Morton
+                            : tiling == "hilbert" ? Tile_Hilbert
+                                                  : Tile_None;
+    regressionCase.tileSize =
+        std::atoi(ArgFromCmd(argc, argv, "tile", "5").c_str());
+    regressionCase.statisticsPeriod =
+        std::atol(ArgFromCmd(argc, argv, "statistics", "0").c_str());
+    regressionCase.checkpoint =
+        std::atol(ArgFromCmd(argc, argv, "checkpoint", "0").c_str());
+    regressionCase.restart =
+        std::atol(ArgFromCmd(argc, argv, "restart", "0").c_str());
+    regressionCase.squeeze =
+        std::atol(ArgFromCmd(argc, argv, "squeeze", "0").c_str());
+    regressionCase.tau =
+        std::atof(ArgFromCmd(argc, argv, "tau", "0.05").c_str());
+    if (regressionCase.tau <= 0) {
+        ops_printf("Error! The relaxation time must be positive!\n");
+        exit(EXIT_FAILURE);
+    }
+    regressionCase.steps =
+        std::atol(ArgFromCmd(argc, argv, "steps", "20").c_str());
+    regressionCase.output =
+        ArgFromCmd(argc, argv, "output", regressionCase.output);
+    const std::string compression{
+        ArgFromCmd(argc, argv, "compression", "plain")};
+    if (compression != "plain" && compression != "deflate" &&
+        compression != "quantised") {
+        ops_printf(
+            "Error! Unknown compression %s, use plain, deflate or "
+            "quantised!\n",
+            compression.c_str());
+        exit(EXIT_FAILURE);
+    }
+    regressionCase.compression = compression == "deflate"
+                                     ? Snapshot_Deflate
+                                 : compression == "quantised"
+                                     ? Snapshot_Quantised
+                                     : Snapshot_Plain;
+    const std::string snapshot{
+        ArgFromCmd(argc, argv, "snapshot", "perblock")};
+    if (snapshot != "perblock" && snapshot != "shared") {
+        ops_printf("Error! Unknown snapshot %s, use perblock or shared!\n",
+                   snapshot.c_str());
+        exit(EXIT_FAILURE);
+    }
+    regressionCase.snapshotLayout =
+        snapshot == "shared" ? Snapshot_SharedFile : Snapshot_FilePerBlock;
+    regressionCase.caseName =
+        ArgFromCmd(argc, argv, "casename", regressionCase.caseName);
+    regressionCase.first = ArgFromCmd(argc, argv, "first", "");
+    regressionCase.second = ArgFromCmd(argc, argv, "second", "");
+    regressionCase.tolerance =
+        std::atof(ArgFromCmd(argc, argv, "tolerance", "0").c_str());
+    if (regressionCase.name != "run" && regressionCase.name != "compare") {
+        ops_printf("Error! Unknown case %s, use run or compare!\n",
+                   regressionCase.name.c_str());
+        exit(EXIT_FAILURE);
+    }
+    if (regressionCase.compoNum != 1 && regressionCase.compoNum != 2) {
+        ops_printf("Error! Only one or two components can be run!\n");
+        exit(EXIT_FAILURE);
+    }
+    // The moment scheme keeps no populations to be dumped
+    if (regressionCase.scheme == Scheme_StreamCollision_Moment &&
+        !regressionCase.macroVars) {
+        ops_printf("Error! The moment scheme can only dump macrovars!\n");
+        exit(EXIT_FAILURE);
+    }
+    if (regressionCase.statistics && regressionCase.statisticsPeriod == 0) {
+        ops_printf("Error! The statistics are dumped without a period!\n");
+        exit(EXIT_FAILURE);
+    }
+    // The probes and slices are sampled and compared by their values only
+    if ((regressionCase.probes || regressionCase.probePoints ||
+         regressionCase.slices || regressionCase.sliceNodes) &&
+        regressionCase.shift != 0) {
+        ops_printf("Error! The probes and slices cannot be shifted!\n");
+        exit(EXIT_FAILURE);
+    }
+    // Only the stream-collision scheme may choose its periodic treatment
+    if ((regressionCase.scheme == Scheme_StreamCollision_Moment &&
+         !regressionCase.periodicHalos) ||
+        (regressionCase.scheme == Scheme_StreamCollision_Swap &&
+         regressionCase.periodicHalos)) {
+        ops_printf(
+            "Error! The moment scheme can only be periodic by the halos and "
+            "the swap scheme by the copy!\n");
+        exit(EXIT_FAILURE);
+    }
+    if (regressionCase.squeeze > 0 &&
+        regressionCase.storage != Population_Compressed16) {
+        ops_printf(
+            "Error! Only the compressed populations can be squeezed!\n");
+        exit(EXIT_FAILURE);
+    }
+    // A run restarted at its last step dumps the fields read back
+    if (regressionCase.restart > regressionCase.steps) {
+        ops_printf("Error! The restart must not be after the last step!\n");
+        exit(EXIT_FAILURE);
+    }
+    return regressionCase;
+}
+
+// Provide macroscopic initial conditions
+void SetInitialMacrosVars(const RegressionCase& regressionCase) {
+    for (const auto& idBlock : g_Block()) {
+        const Block& block{idBlock.second};
+        std::vector<int> iterRng;
+        iterRng.assign(block.WholeRange().begin(), block.WholeRange().end());
+        const int blockIdx{block.ID()};
+        std::vector<int> size{block.Size()};
+        for (auto& idCompo : g_Components()) {
+            const Component& compo{idCompo.second};
+            const int rhoId{compo.macroVars.at(Variable_Rho).id};
+            const Real amplitude{regressionCase.rest ? 0
+                                                     : 0.01 * (compo.id + 1)};
+            const int shift{regressionCase.shift};
+            ops_par_loop(KerSetShearWave, "KerSetShearWave", block.Get(),
+                         SpaceDim(), iterRng.data(),
+                         ops_arg_dat(g_MacroVars().at(rhoId).at(blockIdx), 1,
+                                     LOCALSTENCIL, "Real", OPS_RW),
+                         ops_arg_dat(g_MacroVars().at(compo.uId).at(blockIdx),
+                                     1, LOCALSTENCIL, "Real", OPS_RW),
+                         ops_arg_dat(g_MacroVars().at(compo.vId).at(blockIdx),
+                                     1, LOCALSTENCIL, "Real", OPS_RW),
+                         ops_arg_dat(g_MacroVars().at(compo.wId).at(blockIdx),
+                                     1, LOCALSTENCIL, "Real", OPS_RW),
+                         ops_arg_gbl(&amplitude, 1, "Real", OPS_READ),
+                         ops_arg_gbl(size.data(), SpaceDim(), "int", OPS_READ),
+                         ops_arg_gbl(&shift, 1, "int", OPS_READ),
+                         ops_arg_idx());
+        }
+    }
+}
+// The mesh size of the box, whose block starts at the origin
+const Real regressionMeshSize{(Real)1. / 15};
+
+/*
+ * A row of nodes along x, a plane of points inside the cells spanning several
+ * rows of the probe range and a point at the upper corner of the box, i.e.,
+ * the corner clamped to the last cell.
+ */
+std::vector<ProbeDefinition> RegressionProbes() {
+    const Real h{regressionMeshSize};
+    std::vector<ProbeDefinition> probes(3);
+    probes[0].name = "Row";
+    probes[0].type = Probe_Line;
+    probes[0].origin = {0, 3 * h, 4 * h};
+    probes[0].axis0 = {15 * h, 0, 0};
+    probes[0].pointNum = {16};
+    probes[1].name = "Plane";
+    probes[1].type = Probe_Plane;
+    probes[1].origin = {2.5 * h, 0.25 * h, 0.75 * h};
+    probes[1].axis0 = {0, 10 * h, 0};
+    probes[1].axis1 = {0, 0, 8 * h};
+    probes[1].pointNum = {6, 5};
+    probes[2].name = "Corner";
+    probes[2].type = Probe_Point;
+    probes[2].origin = {15 * h, 11 * h, 9 * h};
+    return probes;
+}
+
+// A plane normal to z nearest to the node 4, skipping nodes along x and y,
+// and a subsample of the box whose strides do not divide the block
+std::vector<SliceDefinition> RegressionSlices() {
+    std::vector<SliceDefinition> slices(2);
+    slices[0].name = "PlaneZ";
+    slices[0].type = Slice_Plane;
+    slices[0].axis = 2;
+    slices[0].position = 4.2 * regressionMeshSize;
+    slices[0].stride = {2, 3, 1};
+    slices[0].period = 10;
+    slices[1].name = "Coarse";
+    slices[1].type = Slice_Subsample;
+    slices[1].stride = {4, 5, 3};
+    slices[1].period = 10;
+    return slices;
+}
+
+// Provide macroscopic body-force term
+void UpdateMacroscopicBodyForce(const Real time) {}
+
+void DefineRegressionCase(const RegressionCase& regressionCase) {
+    DefineCase(regressionCase.caseName, 3);
+    std::vector<int> blockIds{0};
+    std::vector<std::string> blockNames{"Box"};
+    std::vector<int> blockSize{16, 12, 10};
+    const Real meshSize{regressionMeshSize};
+    std::map<int, std::vector<Real>> startPos{{0, {0, 0, 0}}};
+    DefineBlocks(blockIds, blockNames, blockSize, meshSize, startPos);
+
+    std::vector<std::string> compoNames;
+    std::vector<int> compoIds;
+    std::vector<std::string> lattNames;
+    std::vector<Real> tauRef;
+    std::vector<VariableTypes> macroVarTypes;
+    std::vector<std::string> macroVarNames;
+    std::vector<int> macroVarIds;
+    std::vector<int> macroCompoIds;
+    std::vector<CollisionType> collisionTypes;
+    std::vector<int> collisionCompoIds;
+    std::vector<BodyForceType> bodyForceTypes;
+    std::vector<SizeType> bodyForceCompoIds;
+    std::vector<InitialType> initialTypes;
+    std::vector<int> initialCompoIds;
+    const std::vector<std::string> varNames{"rho", "u", "v", "w"};
+    for (int compoId = 0; compoId < regressionCase.compoNum; compoId++) {
+        const std::string suffix{std::to_string(compoId)};
+        compoNames.push_back("Fluid" + suffix);
+        compoIds.push_back(compoId);
+        lattNames.push_back("d3q19");
+        tauRef.push_back(regressionCase.tau + 0.03 * compoId);
+        for (const VariableTypes varType :
+             {Variable_Rho, Variable_U, Variable_V, Variable_W}) {
+            macroVarTypes.push_back(varType);
+            macroVarNames.push_back(varNames.at(macroVarNames.size() % 4) +
+                                    suffix);
+            macroVarIds.push_back(macroVarIds.size());
+            macroCompoIds.push_back(compoId);
+        }
+        collisionTypes.push_back(Collision_BGKIsothermal2nd);
+        collisionCompoIds.push_back(compoId);
+        bodyForceTypes.push_back(BodyForce_None);
+        bodyForceCompoIds.push_back(compoId);
+        initialTypes.push_back(Initial_BGKFeq2nd);
+        initialCompoIds.push_back(compoId);
+    }
+    DefineComponents(compoNames, compoIds, lattNames, tauRef,
+                     regressionCase.restart);
+    DefineMacroVars(macroVarTypes, macroVarNames, macroVarIds, macroCompoIds,
+                    regressionCase.restart);
+    DefineCollision(collisionTypes, collisionCompoIds);
+    DefineBodyForce(bodyForceTypes, bodyForceCompoIds);
+    DefineScheme(regressionCase.scheme);
+    DefineMacroVarsLayout(regressionCase.macroVarsLayout);
+    DefineMultiComponentFusion(regressionCase.fusion);
+    DefinePopulationStorage(regressionCase.storage);
+    DefineStatistics(regressionCase.statisticsPeriod, regressionCase.restart);
+    DefineBoundaryBatching(regressionCase.boundaryBatching);
+    DefinePeriodicHalos(regressionCase.periodicHalos);
+    DefineTiling(regressionCase.tiling,
+                 {regressionCase.tileSize, regressionCase.tileSize});
+    // The populations are quantised by powers of two, i.e., exactly
+    DefineSnapshotCompression(regressionCase.compression, 4,
+                              {{"f", std::ldexp((Real)1, -20)}});
+    DefineSnapshotLayout(regressionCase.snapshotLayout);
+    if (regressionCase.probes) {
+        DefineProbes(RegressionProbes(), 5, 100, regressionCase.restart);
+    }
+    if (regressionCase.slices) {
+        DefineSlices(RegressionSlices(), 3);
+    }
+
+    std::vector<VariableTypes> macroVarTypesatBoundary{Variable_U, Variable_V,
+                                                       Variable_W};
+    std::vector<Real> noSlipStationaryWall{0, 0, 0};
+    std::vector<Real> noSlipMovingWall{regressionCase.rest ? 0 : 0.01, 0, 0};
+    for (int compoId = 0; compoId < regressionCase.compoNum; compoId++) {
+        for (const auto surface :
+             {BoundarySurface::Left, BoundarySurface::Right,
+              BoundarySurface::Top, BoundarySurface::Bottom,
+              BoundarySurface::Front, BoundarySurface::Back}) {
+            const bool wall{regressionCase.cavity ||
+                            (regressionCase.channel &&
+                             (surface == BoundarySurface::Top ||
+                              surface == BoundarySurface::Bottom))};
+            if (!wall) {
+                // The copy reads the images from the halos of a connection
+                if (!regressionCase.periodicHalos) {
+                    DefinePeriodicConnection(0, surface);
+                }
+                DefineBlockBoundary(0, compoId, surface,
+                                    BoundaryScheme::FDPeriodic,
+                                    macroVarTypesatBoundary,
+                                    noSlipStationaryWall,
+                                    VertexType::FDPeriodic);
+                continue;
+            }
+            DefineBlockBoundary(0, compoId, surface,
+                                BoundaryScheme::EQMDiffuseRefl,
+                                macroVarTypesatBoundary,
+                                surface == BoundarySurface::Top
+                                    ? noSlipMovingWall
+                                    : noSlipStationaryWall,
+                                VertexType::Wall);
+        }
+    }
+    DefineInitialCondition(initialTypes, initialCompoIds);
+    Partition();
+    if (regressionCase.restart == 0) {
+        SetInitialMacrosVars(regressionCase);
+        PreDefinedInitialCondition3D();
+    }
+    SetTimeStep(meshSize / SoundSpeed());
+}
+
+// Append the values of the nodes of a block, nodeSize values each, to the
+// dump, where the nodes are shifted back by shift along x
+void AppendShiftedBack(const std::vector<Real>& data, const int nodeSize,
+                       const int nx, const int shift,
+                       std::vector<Real>& values) {
+    const SizeType nodeNum{data.size() / nodeSize};
+    std::vector<Real> shifted(data.size());
+    for (SizeType node = 0; node < nodeNum; node++) {
+        const SizeType i{node % nx};
+        const SizeType target{node - i + (i + shift) % nx};
+        std::copy(data.begin() + node * nodeSize,
+                  data.begin() + (node + 1) * nodeSize,
+                  shifted.begin() + target * nodeSize);
+    }
+    values.insert(values.end(), shifted.begin(), shifted.end());
+}
+
+// Append the values of a field over the whole block to the dump, where the
+// nodes are shifted back by shift along x
+void DumpField(RealField& field, std::vector<Real>& values,
+               const int shift) {
+    for (const auto& idBlock : g_Block()) {
+        const Block& block{idBlock.second};
+        std::vector<int> range{block.WholeRange()};
+        SizeType nodeNum{1};
+        for (const int size : block.Size()) {
+            nodeNum *= size;
+        }
+        std::vector<Real> data(nodeNum * field.DataDim());
+        ops_dat_fetch_data_slab_host(field[block.ID()], 0, (char*)data.data(),
+                                     range.data());
+        AppendShiftedBack(data, field.DataDim(), block.Size().at(0), shift,
+                          values);
+    }
+}
+
+// The values of a macroscopic variable over the whole block, which may be
+// interleaved with the other variables of its component
+std::vector<Real> FetchMacroVar(const Component& compo,
+                                const VariableTypes type, const Block& block) {
+    int dim{1};
+    int index{0};
+    const ops_dat dat{MacroVarDat(compo, type, block.ID(), dim, index)};
+    std::vector<int> range{block.WholeRange()};
+    SizeType nodeNum{1};
+    for (const int size : block.Size()) {
+        nodeNum *= size;
+    }
+    std::vector<Real> data(nodeNum * dim);
+    ops_dat_fetch_data_slab_host(dat, 0, (char*)data.data(), range.data());
+    std::vector<Real> values(nodeNum);
+    for (SizeType node = 0; node < nodeNum; node++) {
+        values[node] = data[node * dim + index];
+    }
+    return values;
+}
+
+// Append the variables at the points of the probes interpolated trilinearly
+// from the nodes of their cells in the order of the probe files
+void DumpProbePoints(std::vector<Real>& values) {
+    const Block& block{g_Block().at(0)};
+    const std::vector<int> size{block.Size()};
+    std::vector<std::vector<Real>> variables;
+    for (const auto& idCompo : g_Components()) {
+        for (const auto& typeVar : idCompo.second.macroVars) {
+            variables.push_back(
+                FetchMacroVar(idCompo.second, typeVar.first, block));
+        }
+    }
+    for (const ProbeDefinition& probe : RegressionProbes()) {
+        for (const std::vector<Real>& position : ProbePositions(probe)) {
+            int corner[3];
+            Real fraction[3];
+            for (int axis = 0; axis < 3; axis++) {
+                const Real coordinate{position[axis] / regressionMeshSize};
+                corner[axis] = std::max(
+                    std::min((int)std::floor(coordinate), size[axis] - 2), 0);
+                fraction[axis] = coordinate - corner[axis];
+            }
+            for (const std::vector<Real>& variable : variables) {
+                Real value{0};
+                for (int node = 0; node < 8; node++) {
+                    const int i{corner[0] + (node & 1)};
+                    const int j{corner[1] + ((node >> 1) & 1)};
+                    const int k{corner[2] + ((node >> 2) & 1)};
+                    const Real weight{
+                        ((node & 1) ? fraction[0] : 1 - fraction[0]) *
+                        (((node >> 1) & 1) ? fraction[1] : 1 - fraction[1]) *
+                        (((node >> 2) & 1) ? fraction[2] : 1 - fraction[2])};
+                    const SizeType nodeIdx{
+                        ((SizeType)k * size[1] + j) * size[0] + i};
+                    value += weight * variable[nodeIdx];
+                }
+                values.push_back(value);
+            }
+        }
+    }
+}
+
+// Append the variables of the last sample of each probe in its file
+void DumpProbes(std::vector<Real>& values) {
+    FlushProbes();
+    for (const ProbeDefinition& probe : RegressionProbes()) {
+        const std::string fileName{CaseName() + "_Probe_" + probe.name +
+                                   ".dat"};
+        std::ifstream file(fileName);
+        std::string line, lastSample;
+        while (std::getline(file, line)) {
+            if (!line.empty() && line[0] != '#') {
+                lastSample = line;
+            }
+        }
+        if (lastSample.empty()) {
+            ops_printf("Error! %s holds no sample!\n", fileName.c_str());
+            exit(EXIT_FAILURE);
+        }
+        std::istringstream sample(lastSample);
+        SizeType timeStep{0};
+        Real time{0}, value{0};
+        sample >> timeStep >> time;
+        while (sample >> value) {
+            values.push_back(value);
+        }
+    }
+}
+
+// Append the Start and Stride of each slice, then the variables at its nodes
+// picked from the whole block in the order of the slice files
+void DumpSliceNodes(std::vector<Real>& values) {
+    const Block& block{g_Block().at(0)};
+    const std::vector<int> size{block.Size()};
+    for (const SliceDefinition& slice : RegressionSlices()) {
+        std::vector<int> start(3, 0), end(size), stride(slice.stride);
+        if (slice.type == Slice_Plane) {
+            const int axis{slice.axis};
+            start[axis] = (int)std::lround(slice.position / regressionMeshSize);
+            end[axis] = start[axis] + 1;
+            stride[axis] = 1;
+        }
+        values.insert(values.end(), start.begin(), start.end());
+        values.insert(values.end(), stride.begin(), stride.end());
+        for (const auto& idCompo : g_Components()) {
+            for (const auto& typeVar : idCompo.second.macroVars) {
+                const std::vector<Real> variable{
+                    FetchMacroVar(idCompo.second, typeVar.first, block)};
+                for (int k = start[2]; k < end[2]; k += stride[2]) {
+                    for (int j = start[1]; j < end[1]; j += stride[1]) {
+                        for (int i = start[0]; i < end[0]; i += stride[0]) {
+                            values.push_back(
+                                variable[((SizeType)k * size[1] + j) * size[0] +
+                                         i]);
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Append the Start and Stride of each slice written at timeStep, then the
+// variables at its nodes read back from its file
+void DumpSlices(const SizeType timeStep, std::vector<Real>& values) {
+    const Block& block{g_Block().at(0)};
+    for (const SliceDefinition& slice : RegressionSlices()) {
+        const std::string fileName{CaseName() + "_" + slice.name + "_T" +
+                                   std::to_string(timeStep) + ".h5"};
+        hid_t file{H5Fopen(fileName.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT)};
+        if (file < 0) {
+            ops_printf("Error! Cannot open %s!\n", fileName.c_str());
+            exit(EXIT_FAILURE);
+        }
+        hid_t group{H5Gopen2(file, block.Name().c_str(), H5P_DEFAULT)};
+        bool attributes{true};
+        for (const auto& idCompo : g_Components()) {
+            for (const auto& typeVar : idCompo.second.macroVars) {
+                const std::string datName{typeVar.second.name + "_" +
+                                          block.Name()};
+                hid_t dataset{H5Dopen2(group, datName.c_str(), H5P_DEFAULT)};
+                if (attributes) {
+                    for (const char* name : {"Start", "Stride"}) {
+                        int attribute[3]{0, 0, 0};
+                        hid_t attr{H5Aopen(dataset, name, H5P_DEFAULT)};
+                        H5Aread(attr, H5T_NATIVE_INT, attribute);
+                        H5Aclose(attr);
+                        values.insert(values.end(), attribute, attribute + 3);
+                    }
+                    attributes = false;
+                }
+                hid_t space{H5Dget_space(dataset)};
+                std::vector<Real> data(H5Sget_simple_extent_npoints(space));
+                H5Dread(dataset, SnapshotH5Type<Real>(), H5S_ALL, H5S_ALL,
+                        H5P_DEFAULT, data.data());
+                values.insert(values.end(), data.begin(), data.end());
+                H5Sclose(space);
+                H5Dclose(dataset);
+            }
+        }
+        H5Gclose(group);
+        H5Fclose(file);
+    }
+}
+
+void WriteDump(const std::string& fileName, const std::vector<Real>& values) {
+    std::ofstream dump(fileName, std::ios::binary);
+    if (!dump.is_open()) {
+        ops_printf("Error! Cannot open %s for the dump!\n", fileName.c_str());
+        exit(EXIT_FAILURE);
+    }
+    dump.write((const char*)values.data(), values.size() * sizeof(Real));
+}
+
+std::vector<Real> ReadDump(const std::string& fileName) {
+    std::ifstream dump(fileName, std::ios::binary | std::ios::ate);
+    if (!dump.is_open()) {
+        ops_printf("Error! Cannot open %s for the comparison!\n",
+                   fileName.c_str());
+        exit(EXIT_FAILURE);
+    }
+    std::vector<Real> values(dump.tellg() / sizeof(Real));
+    dump.seekg(0);
+    dump.read((char*)values.data(), values.size() * sizeof(Real));
+    return values;
+}
+
+int RunCase(const RegressionCase& regressionCase) {
+    DefineRegressionCase(regressionCase);
+    for (SizeType iter = regressionCase.restart; iter < regressionCase.steps;
+         iter++) {
+        if (regressionCase.scheme == Scheme_StreamCollision_Moment) {
+            MomentStreamCollision(iter * TimeStep());
+        } else if (regressionCase.scheme == Scheme_StreamCollision_Swap) {
+            SwapStreamCollision(iter * TimeStep());
+        } else {
+            StreamCollision(iter * TimeStep());
+        }
+        AccumulateStatistics(iter + 1);
+        SampleProbes(iter + 1);
+        WriteSlices(iter + 1);
+        if (iter + 1 == regressionCase.squeeze) {
+            for (auto& idScale : g_PopulationScale()) {
+                idScale.second.deviation /= 1000;
+            }
+        }
+        // The checkpoint of Iterate()
+        if (iter + 1 == regressionCase.checkpoint) {
+            UpdateMacroVars3D();
+            SnapshotScope snapshot{CaseName(), iter + 1};
+            WriteFlowfieldToHdf5(iter + 1);
+            WriteDistributionsToHdf5(iter + 1);
+            WriteNodePropertyToHdf5(iter + 1);
+            WriteStatisticsToHdf5(iter + 1);
+        }
+    }
+    std::vector<Real> values;
+    if (regressionCase.slices) {
+        DumpSlices(regressionCase.steps, values);
+    } else if (regressionCase.sliceNodes) {
+        UpdateMacroVars3D();
+        DumpSliceNodes(values);
+    } else if (regressionCase.probes) {
+        DumpProbes(values);
+    } else if (regressionCase.probePoints) {
+        UpdateMacroVars3D();
+        DumpProbePoints(values);
+    } else if (regressionCase.statistics) {
+        for (auto& idStatistics : g_Statistics()) {
+            DumpField(idStatistics.second, values, regressionCase.shift);
+        }
+    } else if (regressionCase.macroVars) {
+        UpdateMacroVars3D();
+        for (auto& idCompo : g_Components()) {
+            const Component& compo{idCompo.second};
+            for (const VariableTypes varType :
+                 {Variable_Rho, Variable_U, Variable_V, Variable_W}) {
+                for (const auto& idBlock : g_Block()) {
+                    const Block& block{idBlock.second};
+                    AppendShiftedBack(FetchMacroVar(compo, varType, block), 1,
+                                      block.Size().at(0), regressionCase.shift,
+                                      values);
+                }
+            }
+        }
+    } else {
+        DumpField(g_f(), values, regressionCase.shift);
+    }
+    WriteDump(regressionCase.output, values);
+    ops_printf("%s: %d values after %d steps\n", regressionCase.output.c_str(),
+               (int)values.size(),
+               (int)(regressionCase.steps - regressionCase.restart));
+    return EXIT_SUCCESS;
+}
+
+int CompareDumps(const RegressionCase& regressionCase) {
+    const std::vector<Real> first{ReadDump(regressionCase.first)};
+    const std::vector<Real> second{ReadDump(regressionCase.second)};
+    if (first.empty() || first.size() != second.size()) {
+        ops_printf("Error! %s and %s hold %d and %d values!\n",
+                   regressionCase.first.c_str(), regressionCase.second.c_str(),
+                   (int)first.size(), (int)second.size());
+        return EXIT_FAILURE;
+    }
+    Real maxDifference{0};
+    bool finite{true};
+    for (SizeType idx = 0; idx < first.size(); idx++) {
+        const Real difference{std::abs(first[idx] - second[idx])};
+        finite = finite && std::isfinite(difference);
+        maxDifference = std::max(maxDifference, difference);
+    }
+    const bool passed{finite && maxDifference <= regressionCase.tolerance};
+    ops_printf("%s vs %s: maximum difference %.6e, tolerance %.6e, %s\n",
+               regressionCase.first.c_str(), regressionCase.second.c_str(),
+               maxDifference, regressionCase.tolerance,
+               passed ? "passed" : "failed");
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int main(int argc, const char** argv) {
+    ops_init(argc, argv, 1);
+    const RegressionCase regressionCase{ReadRegressionCase(argc, argv)};
+    const int status{regressionCase.name == "compare"
+                         ? CompareDumps(regressionCase)
+                         : RunCase(regressionCase)};
+    ops_exit();
+    // The fields moved into the arena are not freed by OPS
+    ReleaseFieldArena();
+    return status;
+}